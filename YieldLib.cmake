@@ -42,6 +42,7 @@ file(GLOB SRC_YIELD_POLL_WIN32 "src/yield/poll/win32/*.h" "src/yield/poll/win32/
 file(GLOB SRC_YIELD_QUEUE "src/yield/queue/*.h" "src/yield/queue/*.hpp" "src/yield/queue/*.cpp" "src/yield/queue/*.h" "src/yield/queue/*.rl")
 file(GLOB SRC_YIELD_SOCKETS "src/yield/sockets/*.h" "src/yield/sockets/*.hpp" "src/yield/sockets/*.cpp" "src/yield/sockets/*.h" "src/yield/sockets/*.rl")
 file(GLOB SRC_YIELD_SOCKETS_AIO "src/yield/sockets/aio/*.h" "src/yield/sockets/aio/*.hpp" "src/yield/sockets/aio/*.cpp" "src/yield/sockets/aio/*.h" "src/yield/sockets/aio/*.rl")
+file(GLOB SRC_YIELD_SOCKETS_AIO_LINUX "src/yield/sockets/aio/linux/*.h" "src/yield/sockets/aio/linux/*.hpp" "src/yield/sockets/aio/linux/*.cpp" "src/yield/sockets/aio/linux/*.h" "src/yield/sockets/aio/linux/*.rl")
 file(GLOB SRC_YIELD_SOCKETS_AIO_WIN32 "src/yield/sockets/aio/win32/*.h" "src/yield/sockets/aio/win32/*.hpp" "src/yield/sockets/aio/win32/*.cpp" "src/yield/sockets/aio/win32/*.h" "src/yield/sockets/aio/win32/*.rl")
 file(GLOB SRC_YIELD_SOCKETS_POSIX "src/yield/sockets/posix/*.h" "src/yield/sockets/posix/*.hpp" "src/yield/sockets/posix/*.cpp" "src/yield/sockets/posix/*.h" "src/yield/sockets/posix/*.rl")
 file(GLOB SRC_YIELD_SOCKETS_SSL "src/yield/sockets/ssl/*.h" "src/yield/sockets/ssl/*.hpp" "src/yield/sockets/ssl/*.cpp" "src/yield/sockets/ssl/*.h" "src/yield/sockets/ssl/*.rl")
@@ -63,6 +64,7 @@ if (WIN32)
 	set_source_files_properties(${SRC_YIELD_POLL_LINUX} PROPERTIES HEADER_FILE_ONLY true)
 	set_source_files_properties(${SRC_YIELD_POLL_POSIX} PROPERTIES HEADER_FILE_ONLY true)
 	set_source_files_properties(${SRC_YIELD_POLL_SUNOS} PROPERTIES HEADER_FILE_ONLY true)
+	set_source_files_properties(${SRC_YIELD_SOCKETS_AIO_LINUX} PROPERTIES HEADER_FILE_ONLY true)
 	set_source_files_properties(${SRC_YIELD_SOCKETS_POSIX} PROPERTIES HEADER_FILE_ONLY true)
 	set_source_files_properties(${SRC_YIELD_THREAD_DARWIN} PROPERTIES HEADER_FILE_ONLY true)
 	set_source_files_properties(${SRC_YIELD_THREAD_LINUX} PROPERTIES HEADER_FILE_ONLY true)
@@ -110,6 +112,7 @@ if (WIN32)
 	source_group("Source Files\\yield\\queue" FILES ${SRC_YIELD_QUEUE})
 	source_group("Source Files\\yield\\sockets" FILES ${SRC_YIELD_SOCKETS})
 	source_group("Source Files\\yield\\sockets\\aio" FILES ${SRC_YIELD_SOCKETS_AIO})
+	source_group("Source Files\\yield\\sockets\\aio\\linux" FILES ${SRC_YIELD_SOCKETS_AIO_LINUX})
 	source_group("Source Files\\yield\\sockets\\aio\\win32" FILES ${SRC_YIELD_SOCKETS_AIO_WIN32})
 	source_group("Source Files\\yield\\sockets\\posix" FILES ${SRC_YIELD_SOCKETS_POSIX})
 	source_group("Source Files\\yield\\sockets\\ssl" FILES ${SRC_YIELD_SOCKETS_SSL})
@@ -304,6 +307,7 @@ elseif (${CMAKE_SYSTEM_NAME} MATCHES "Linux")
 		${SRC_YIELD_QUEUE}
 		${SRC_YIELD_SOCKETS}
 		${SRC_YIELD_SOCKETS_AIO}
+		${SRC_YIELD_SOCKETS_AIO_LINUX}
 		${SRC_YIELD_SOCKETS_POSIX}
 		${SRC_YIELD_SOCKETS_SSL}
 		${SRC_YIELD_STAGE}
@@ -2,6 +2,12 @@ enable_testing()
 
 include(YieldFlags.cmake)
 
+find_package(OpenSSL)
+if (OPENSSL_FOUND)
+	add_definitions(-DYIELD_HAVE_OPENSSL)
+	include_directories(${OPENSSL_INCLUDE_DIR})
+endif()
+
 include_directories(
 	include
 	share/gtest-1.7.0/fused-src
@@ -0,0 +1,103 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_BUFFER_POOL_HPP_
+#define _YIELD_BUFFER_POOL_HPP_
+
+#include <memory>
+
+#include "yield/buffer.hpp"
+
+namespace yield {
+/**
+  Recycling allocator for <code>Buffer</code>s.
+  Capacities are rounded up to a size class (the page size, 16K or 64K) and
+    served from a cache of page-aligned blocks owned by the calling thread,
+    which is refilled from and spilled to a process-wide depot in batches.
+    The Buffer object and its shared_ptr control block share one recycled
+    block as well, so a steady state of get()s and releases does not call
+    malloc. When the last reference to a pooled Buffer is released its memory
+    returns to the releasing thread's cache.
+  Capacities above CAPACITY_MAX are not pooled.
+*/
+class BufferPool {
+public:
+  /**
+    Largest capacity served from the pool.
+  */
+  const static size_t CAPACITY_MAX = 64 * 1024;
+
+public:
+  /**
+    Get a page-aligned Buffer of the given capacity.
+    @param capacity capacity of the new buffer
+    @return the new buffer, empty
+  */
+  static ::std::shared_ptr<Buffer> get(size_t capacity) {
+    return get(Buffer::getpagesize(), capacity);
+  }
+
+  /**
+    Get a Buffer of the given capacity and alignment.
+    Pooled buffers are page-aligned, which satisfies any alignment up to the
+      page size; larger alignments are not pooled.
+    @param alignment alignment boundary of the new buffer
+    @param capacity capacity of the new buffer
+    @return the new buffer, empty
+  */
+  static ::std::shared_ptr<Buffer> get(size_t alignment, size_t capacity);
+
+public:
+  /**
+    Return the blocks cached by the calling thread to the depot, e.g. before
+      the thread idles for a long time. Threads do this when they exit.
+  */
+  static void trim();
+
+private:
+  template <class> class Allocator;
+  class Depot;
+  class PooledBuffer;
+  class ThreadCache;
+
+private:
+  enum SizeClass {
+    SIZE_CLASS_HEADER, // PooledBuffer and shared_ptr control block
+    SIZE_CLASS_PAGE,
+    SIZE_CLASS_16K,
+    SIZE_CLASS_64K,
+    SIZE_CLASS_COUNT
+  };
+
+private:
+  static void* acquire(SizeClass size_class);
+  static void release(SizeClass size_class, void* block);
+  static size_t get_block_size(SizeClass size_class);
+};
+}
+
+#endif
@@ -0,0 +1,74 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_BUFFER_VIEW_HPP_
+#define _YIELD_BUFFER_VIEW_HPP_
+
+#include <memory>
+
+#include "yield/buffer.hpp"
+
+namespace yield {
+/**
+  A Buffer over (part of) another Buffer's data, which it keeps alive.
+  The view has its own size and next_buffer, so it can be linked into a
+    chain of Buffers, or handed out as a bounded slice, without modifying
+    the other Buffer.
+*/
+class BufferView final : public Buffer {
+public:
+  /**
+    Construct a view of the whole of buffer, as far as it has been filled.
+    @param buffer the buffer to view
+  */
+  BufferView(::std::shared_ptr<Buffer> buffer)
+    : Buffer(buffer->capacity(), buffer->data(), buffer->size()),
+      buffer_(buffer) {
+  }
+
+  /**
+    Construct a view of size bytes of buffer from offset, with no spare
+      capacity.
+    @param buffer the buffer to view
+    @param offset offset of the view into buffer
+    @param size size of the view
+  */
+  BufferView(::std::shared_ptr<Buffer> buffer, size_t offset, size_t size)
+    : Buffer(size, static_cast<char*>(buffer->data()) + offset, size),
+      buffer_(buffer) {
+  }
+
+  ~BufferView() {
+    data_ = NULL;
+  }
+
+private:
+  ::std::shared_ptr<Buffer> buffer_;
+};
+}
+
+#endif
@@ -28,6 +28,8 @@
 #ifndef _YIELD_BUFFERS_HPP_
 #define _YIELD_BUFFERS_HPP_
 
+#include <climits>
+#include <cstddef>
 #include <vector>
 
 #include "yield/iovec.hpp"
@@ -40,6 +42,85 @@ class Buffer;
     (Buffer::get_next_buffer, Buffer::set_next_buffer).
 */
 class Buffers final {
+public:
+  /**
+    Capacity of the fixed-size iovec arrays used for gather I/O
+      in place of a <code>std::vector</code>, bounded by the system's IOV_MAX.
+  */
+#if defined(IOV_MAX) && IOV_MAX < 64
+  const static int WRITE_IOVECS_MAX = IOV_MAX;
+#else
+  const static int WRITE_IOVECS_MAX = 64;
+#endif
+
+public:
+  /**
+    A read position in a linked list of <code>Buffer</code>s for gather I/O.
+    The cursor is advanced past the bytes consumed by each (partial) write,
+      so the next write starts from the current buffer instead of
+      re-walking the list from its head.
+    The list must outlive the cursor.
+  */
+  class WriteCursor final {
+  public:
+    /**
+      Construct an empty cursor.
+    */
+    WriteCursor()
+      : buffer_(NULL), offset_(0) {
+    }
+
+    /**
+      Construct a cursor at the start of a linked list of <code>Buffer</code>s.
+      @param buffers a linked list of <code>Buffer</code>s
+    */
+    explicit WriteCursor(const Buffer& buffers) {
+      reset(buffers);
+    }
+
+  public:
+    /**
+      Advance the cursor past bytes that have been written.
+      @param size number of bytes written from the cursor position
+    */
+    void advance(size_t size);
+
+    /**
+      Fill an array of iovecs for writing from the cursor position.
+      @param[out] write_iovecs the array to fill
+      @param write_iovecs_max the capacity of write_iovecs
+      @param[out] size the number of bytes covered by the filled iovecs
+      @return the number of iovecs filled, at most write_iovecs_max
+    */
+    int
+    as_write_iovecs(
+      iovec* write_iovecs,
+      int write_iovecs_max,
+      size_t& size
+    ) const;
+
+    /**
+      Check if the cursor has reached the end of its buffers.
+      @return true if there are no more bytes to write
+    */
+    bool empty() const {
+      return buffer_ == NULL;
+    }
+
+    /**
+      Move the cursor to the start of a linked list of <code>Buffer</code>s.
+      @param buffers a linked list of <code>Buffer</code>s
+    */
+    void reset(const Buffer& buffers);
+
+  private:
+    void skip_empty();
+
+  private:
+    const Buffer* buffer_;
+    size_t offset_;
+  };
+
 public:
   /**
     Construct an array of iovecs for reading into a linked list of Buffers
@@ -29,6 +29,7 @@
 #define _YIELD_EVENT_HANDLER_HPP_
 
 #include <memory>
+#include <vector>
 
 #include "yield/event_sink.hpp"
 
@@ -52,6 +53,19 @@ public:
   }
 
   virtual void handle(::std::unique_ptr<EventT> event) = 0;
+
+  /**
+    Handle a batch of events, e.g. from EventSource::dequeue_batch.
+    Handlers override this to coalesce work across the batch; the default
+      implementation hands each event to handle in order.
+    @param events the events, which the handler takes ownership of by
+      moving them out; the caller discards the vector's contents afterwards
+  */
+  virtual void handle_batch(::std::vector< ::std::unique_ptr<EventT> >& events) {
+    for (auto event_i = events.begin(); event_i != events.end(); ++event_i) {
+      handle(::std::move(*event_i));
+    }
+  }
 };
 }
 
@@ -29,6 +29,7 @@
 #define _YIELD_EVENT_SOURCE_HPP_
 
 #include <memory>
+#include <vector>
 
 #include "yield/time.hpp"
 
@@ -44,6 +45,39 @@ public:
   */
   virtual ~EventSource() { }
 
+  /**
+    Dequeue up to a number of events, blocking until at least one becomes
+      available, the timeout expires, or wake() is called.
+    The default implementation is a timeddequeue followed by trydequeues;
+      implementations override it to dequeue the batch at once.
+    @param timeout the time to wait for the first event
+    @param max_events_count the maximum number of events to dequeue
+    @param[out] events vector the dequeued events are appended to
+    @return the number of events dequeued, 0 on timeout or wake
+  */
+  virtual size_t
+  dequeue_batch(
+    const Time& timeout,
+    size_t max_events_count,
+    ::std::vector< ::std::unique_ptr<EventT> >& events
+  ) {
+    if (max_events_count == 0) {
+      return 0;
+    }
+
+    ::std::unique_ptr<EventT> event
+    = timeout == Time::FOREVER ? dequeue() : timeddequeue(timeout);
+    size_t events_count = 0;
+    while (event != NULL) {
+      events.push_back(::std::move(event));
+      if (++events_count == max_events_count) {
+        break;
+      }
+      event = trydequeue();
+    }
+    return events_count;
+  }
+
   /**
     Dequeue an event, blocking indefinitely until one becomes available or wake() is called.
     @return an event if one is available, NULL if wake() was called before that
@@ -61,6 +61,20 @@ public:
     FsEvent::Type fs_event_types = FsEvent::TYPE_ALL
   );
 
+  /**
+    Associate a directory and every directory under it with this
+      ScanningFsEventQueue in a single walk of the tree, watching each
+      for the specified FsEvent types.
+    Symbolic links are not followed.
+    @param path path to the root of the directory tree
+    @param fs_event_types FsEvent types to monitor
+    @return true on success, false+errno on failure
+  */
+  bool associate_tree(
+    const Path& path,
+    FsEvent::Type fs_event_types = FsEvent::TYPE_ALL
+  );
+
   /**
     Dissociate a file system path from this ScanningFsEventQueue.
     @param path the path to dissociate
@@ -36,6 +36,7 @@
 #include <vector>
 
 #include "yield/iovec.hpp"
+#include "yield/http/http_message_field_index.hpp"
 
 namespace yield {
 class Buffer;
@@ -48,6 +49,8 @@ class File;
 namespace http {
 /**
   An RFC 2616 HTTP message, the parent class of HttpRequest and HttpResponse.
+  Header fields are indexed as they are parsed or set, so that lookups by
+    name do not re-scan the header.
 */
 template <class HttpMessageType>
 class HttpMessage {
@@ -65,6 +68,12 @@ public:
   */
   const static size_t CONTENT_LENGTH_CHUNKED = SIZE_MAX;
 
+  /**
+    The length of an RFC 1123 date as formatted by format_date
+      e.g., "Sun, 06 Nov 1994 08:49:37 GMT".
+  */
+  const static size_t DATE_LENGTH = 29;
+
 public:
   /**
     Finalize an outgoing HTTP message, adding a trailing CRLF to its header.
@@ -72,6 +81,15 @@ public:
   */
   void finalize();
 
+public:
+  /**
+    Format a date-time as an RFC 1123 date, as used in the Date and
+      Last-Modified fields.
+    @param value the date-time
+    @param[out] date buffer of at least DATE_LENGTH bytes, not NUL-terminated
+  */
+  static void format_date(const DateTime& value, char* date);
+
 public:
   /**
     Get the body of this HTTP message.
@@ -225,6 +243,22 @@ public:
     return get_field(name);
   }
 
+public:
+  /**
+    Append a preformatted field line, such as a constant Server field built
+      once at startup, to the header with a single copy.
+    @param field the complete field line e.g., "Server: yield\r\n"
+    @param field_len the length of field in bytes, including the CRLF
+    @param name_len the length of the field name at the start of field
+    @return *this
+  */
+  HttpMessageType&
+  put_field(
+    const char* field,
+    size_t field_len,
+    size_t name_len
+  );
+
 public:
   /**
     Set the body of an HTTP message.
@@ -237,6 +271,22 @@ public:
   */
   void set_body(::std::shared_ptr< ::yield::fs::File > body_file);
 
+public:
+  /**
+    Set the Content-Length field, formatting the value without snprintf.
+    @param content_length the field value
+    @return *this
+  */
+  HttpMessageType& set_content_length_field(size_t content_length);
+
+  /**
+    Set the Date field to the current time.
+    The RFC 1123 date is cached per thread and only reformatted when the
+      second changes.
+    @return *this
+  */
+  HttpMessageType& set_date_field();
+
 public:
   /**
     Set a string field (set_field(..., const char* value) form).
@@ -480,6 +530,7 @@ protected:
     ::std::shared_ptr<Buffer> body_buffer,
     ::std::shared_ptr< ::yield::fs::File > body_file,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version
   );
@@ -490,11 +541,14 @@ protected:
 protected:
   void set_fields_offset(uint16_t fields_offset) {
     this->fields_offset_ = fields_offset;
+    field_index_.clear();
+    field_index_.size(fields_offset);
   }
 
 private:
   ::std::shared_ptr<Buffer> body_buffer_;
   ::std::shared_ptr< ::yield::fs::File > body_file_;
+  HttpMessageFieldIndex field_index_;
   uint16_t fields_offset_;
   ::std::shared_ptr<Buffer> header_;
   uint8_t http_version_;
@@ -0,0 +1,171 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_HTTP_HTTP_MESSAGE_FIELD_INDEX_HPP_
+#define _YIELD_HTTP_HTTP_MESSAGE_FIELD_INDEX_HPP_
+
+#include <cstdint>
+#include <utility> // for std::pair
+#include <vector>
+
+#include "yield/iovec.hpp"
+
+namespace yield {
+namespace http {
+/**
+  An index of the fields in an HTTP message header: a small open-addressed
+    table of case-insensitive field name hashes to the offsets and lengths
+    of the field name and value in the header buffer.
+  Filled by HttpMessageParser as it parses the fields, and extended by
+    HttpMessage as fields are set, so that field lookups do not re-scan the
+    header.
+  Indexes up to FIELDS_MAX fields; once full, insert returns false and
+    the owner falls back to scanning the header.
+*/
+class HttpMessageFieldIndex {
+public:
+  /**
+    Maximum number of fields in the index.
+  */
+  const static uint8_t FIELDS_MAX = 32;
+
+public:
+  HttpMessageFieldIndex() {
+    clear();
+  }
+
+public:
+  /**
+    Remove all fields from the index.
+  */
+  void clear();
+
+public:
+  /**
+    Look up a field value by name, ignoring case.
+    If a field occurs more than once the first value is returned.
+    @param base start of the header buffer the index refers to
+    @param name the field name
+    @param name_len length in bytes of name
+    @param[out] value the field value, pointing into the header buffer
+    @return true if the field is present, false if not
+  */
+  bool
+  find(
+    const char* base,
+    const char* name,
+    size_t name_len,
+    iovec& value
+  ) const;
+
+  /**
+    Check if the index is full, i.e. if some fields may be missing from it.
+  */
+  bool full() const {
+    return full_;
+  }
+
+  /**
+    Mark the index as full, e.g. when a field has been added to the header
+      without being indexed.
+  */
+  void set_full() {
+    full_ = true;
+  }
+
+  /**
+    Get all field name-value pairs, in header order.
+    @param base start of the header buffer the index refers to
+    @param[out] fields growable vector of name-value pairs as pointers
+      into the header buffer
+  */
+  void
+  get_fields(
+    const char* base,
+    ::std::vector< ::std::pair<iovec, iovec> >& fields
+  ) const;
+
+public:
+  /**
+    Add a field to the index.
+    @param base start of the header buffer the index refers to
+    @param name the field name, pointing into the header buffer
+    @param value the field value, pointing into the header buffer
+    @return true if the field was added, false if the index is full
+  */
+  bool insert(const char* base, const iovec& name, const iovec& value);
+
+  /**
+    Rebase the index onto a copy of the header buffer from offset on, e.g.
+      after a partial header has been moved to the start of a new buffer.
+    @param offset offset of the copy into the header buffer, which must not
+      be past any indexed field
+  */
+  void rebase(size_t offset);
+
+public:
+  /**
+    Get the size of the header buffer prefix that has been indexed.
+  */
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+    Set the size of the header buffer prefix that has been indexed.
+  */
+  void size(size_t size) {
+    size_ = size;
+  }
+
+private:
+  static uint32_t hash(const char* name, size_t name_len);
+
+private:
+  // Twice FIELDS_MAX, a power of two
+  const static uint8_t SLOTS_MAX = 64;
+
+  struct Field {
+    uint32_t hash;
+    uint32_t name_offset;
+    uint32_t value_offset;
+    uint16_t name_len;
+    uint16_t value_len;
+  };
+
+private:
+  uint8_t field_count_;
+  Field fields_[FIELDS_MAX];
+  bool full_;
+  size_t size_;
+  // Index into fields_ + 1, 0 for an empty slot
+  uint8_t slots_[SLOTS_MAX];
+};
+}
+}
+
+#endif
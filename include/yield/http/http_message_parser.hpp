@@ -65,11 +65,48 @@ protected:
   void parse_body_chunks(ParseCallbacks&);
 
 protected:
-  bool parse_fields(uint16_t& fields_offset, size_t& content_length);
+  /**
+    Parse the header fields starting at p, indexing them in field_index_.
+    Returns false with p == eof if the data ran out before the end of the
+      fields; the machine state is kept so that a later call with resume set
+      continues at p once more data has been appended to the buffer.
+    @param[out] fields_offset offset of the fields from the start of the
+      buffer, set unless resuming
+    @param[in,out] content_length the Content-Length or its equivalent,
+      reset unless resuming
+    @param resume continue a previous call that ran out of data
+    @return true if the fields were parsed through the trailing CRLF
+  */
+  bool
+  parse_fields(
+    uint16_t& fields_offset,
+    size_t& content_length,
+    bool resume = false
+  );
+
+protected:
+  /**
+    Continue parsing in buffer, which starts with a copy of this buffer's data
+      from ps on, without re-scanning the copy: move p, ps, eof and the
+      marks and index of the fields to it.
+    @param buffer the new buffer to parse
+  */
+  void rebase(::std::shared_ptr<Buffer> buffer);
+
+  /**
+    Move a mark from the old buffer of a rebase to the new one.
+    @param mark the mark to move; unset if it is not in the old buffer's
+      data from ps on
+    @param old_ps ps in the old buffer, which must still be alive
+  */
+  void rebase(iovec& mark, const char* old_ps) const;
 
 protected:
   ::std::shared_ptr<Buffer> buffer_;
+  int cs; // Ragel machine state, kept across calls by resumable parsers
   const char* eof;
+  iovec field_name, field_value;
+  HttpMessageFieldIndex field_index_; // Of the fields parse_fields parsed
   char* p, *ps;
 
 private:
@@ -28,6 +28,8 @@
 #ifndef _YIELD_HTTP_HTTP_REQUEST_HPP_
 #define _YIELD_HTTP_HTTP_REQUEST_HPP_
 
+#include <vector>
+
 #include "yield/date_time.hpp"
 #include "yield/exception.hpp"
 #include "yield/http/http_message.hpp"
@@ -180,6 +182,20 @@ public:
     uint8_t name_len;
   };
 
+public:
+  /**
+    An inclusive range of byte positions in a resource, from a Range field.
+  */
+  struct ByteRange {
+    uint64_t first_byte_pos;
+    uint64_t last_byte_pos;
+  };
+
+  /**
+    The most byte ranges get_byte_ranges accepts in a Range field.
+  */
+  const static size_t BYTE_RANGES_MAX = 16;
+
 public:
   /**
     Construct an HttpRequest from its constituent parts.
@@ -261,6 +277,7 @@ public:
     Usually called from parsers.
     @param body the HTTP request body, optional
     @param fields_offset offset into the header buffer where the fields start
+    @param field_index index of the fields in the header buffer
     @param header header buffer, required
     @param http_version the HTTP version as a single byte (0 or 1 for HTTP/1.0
       and HTTP/1.1, respectively)
@@ -270,6 +287,7 @@ public:
   HttpRequest(
     ::std::shared_ptr<Buffer> body,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     Method method,
@@ -279,6 +297,7 @@ public:
       body,
       NULL,
       fields_offset,
+      field_index,
       header,
       http_version
     ),
@@ -292,6 +311,23 @@ public:
   virtual ~HttpRequest() { }
 
 public:
+  /**
+    Get the byte ranges requested by the Range field (RFC 2616 section 14.35)
+      of a resource of the given length.
+    A Range field that is malformed, is not in bytes or has more than
+      BYTE_RANGES_MAX ranges is ignored, as if it were absent.
+    @param instance_length the length in bytes of the resource
+    @param[out] byte_ranges the satisfiable ranges in the order requested,
+      with their last byte positions clipped to the resource
+    @return true if the Range field is present, in which case an empty
+      byte_ranges means that no range is satisfiable; false if it is absent
+  */
+  bool
+  get_byte_ranges(
+    uint64_t instance_length,
+    ::std::vector<ByteRange>& byte_ranges
+  ) const;
+
   /**
     Get the HTTP request method e.g., HttpRequest::Method::GET
     @return the request method
@@ -49,6 +49,7 @@ public:
     handle_http_request(
       ::std::shared_ptr<Buffer> body,
       uint16_t fields_offset,
+      const HttpMessageFieldIndex& field_index,
       ::std::shared_ptr<Buffer> header,
       uint8_t http_version,
       HttpRequest::Method method,
@@ -70,7 +71,8 @@ public:
     @param buffer buffer to parse
   */
   HttpRequestParser(::std::shared_ptr<Buffer> buffer)
-    : HttpMessageParser(buffer)
+    : HttpMessageParser(buffer),
+      state_(State::START)
   { }
 
   /**
@@ -79,12 +81,24 @@ public:
     @param buffer buffer to parse.
   */
   HttpRequestParser(const ::std::string& buffer)
-    : HttpMessageParser(buffer)
+    : HttpMessageParser(buffer),
+      state_(State::START)
   { }
 
 public:
   /**
     Parse the next object from the buffer specified in the constructor.
+    If the data runs out in the middle of a request the parser keeps its
+      state and calls ParseCallbacks::read with the buffer to receive more
+      data into: the same buffer while it has room, or a buffer of its own
+      for the rest of a request body that does not fit. Call parse again once
+      the data has been appended; parsing resumes where it stopped, without
+      re-scanning what was already parsed. Only a partial request header at
+      the end of a full buffer is copied, to the start of a new one.
+    Requests refer to the buffer they were received into rather than to
+      copies: the header through a view bounded by the end of the header,
+      the body, if it was received with the header, through a view of its
+      own.
   */
   void parse(ParseCallbacks&);
 
@@ -97,8 +111,27 @@ protected:
     uint16_t& uri_port,
     iovec& uri_query,
     iovec& uri_scheme,
-    iovec& uri_userinfo
+    iovec& uri_userinfo,
+    bool resume = false
   );
+
+private:
+  enum class State { START, REQUEST_LINE, FIELDS, BODY };
+
+private:
+  void handle_http_request(ParseCallbacks&, ::std::shared_ptr<Buffer> body);
+  void read(ParseCallbacks&);
+
+private:
+  // The request being parsed, kept across parse calls
+  ::std::shared_ptr<Buffer> body_;
+  size_t content_length_;
+  uint16_t fields_offset_;
+  uint8_t http_version_;
+  HttpRequest::Method method_;
+  State state_;
+  iovec uri_host_, uri_path_, uri_query_, uri_scheme_, uri_userinfo_;
+  uint16_t uri_port_;
 };
 }
 }
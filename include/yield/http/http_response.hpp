@@ -105,6 +105,7 @@ public:
     Construct an HttpResponse from its constituent parts.
     @param body the HTTP request body, optional
     @param fields_offset offset into the header buffer where the fields start
+    @param field_index index of the fields in the header buffer
     @param header header buffer, required
     @param http_version the HTTP version as a single byte (0 or 1 for HTTP/1.0
       and HTTP/1.1, respectively)
@@ -114,6 +115,7 @@ public:
   HttpResponse(
     ::std::shared_ptr<Buffer> body,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     uint16_t status_code
@@ -121,6 +123,7 @@ public:
         body,
         NULL,
         fields_offset,
+        field_index,
         header,
         http_version
       ),
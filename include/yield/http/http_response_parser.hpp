@@ -54,6 +54,7 @@ public:
     handle_http_response(
       ::std::shared_ptr<Buffer> body,
       uint16_t fields_offset,
+      const HttpMessageFieldIndex& field_index,
       ::std::shared_ptr<Buffer> header,
       uint8_t http_version,
       uint16_t status_code
@@ -50,14 +50,20 @@ public:
     @param http_request_handler handler for HttpRequests and related Events
       originating from the server
     @param sockname address to listen to
+    @param aio_queue_trigger how connections are associated with the
+      server's FdEventQueue, when it drives them with non-blocking I/O
   */
   HttpServer(
     ::std::unique_ptr< EventHandler<HttpServerEvent> > http_server_event_handler,
-    const yield::sockets::SocketAddress& sockname
+    const yield::sockets::SocketAddress& sockname,
+    ::yield::poll::FdEventQueue::Trigger aio_queue_trigger
+    = ::yield::poll::FdEventQueue::Trigger::LEVEL
   )
     : ::yield::stage::StageImpl<HttpServerEvent>(
       ::std::move(http_server_event_handler),
-      ::std::unique_ptr< EventQueue<HttpServerEvent> >(new HttpServerEventQueue(sockname))
+      ::std::unique_ptr< EventQueue<HttpServerEvent> >(
+        new HttpServerEventQueue(sockname, false, aio_queue_trigger)
+      )
     ) {
   }
 };
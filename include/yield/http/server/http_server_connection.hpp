@@ -28,13 +28,21 @@
 #ifndef _YIELD_HTTP_SERVER_HTTP_CONNECTION_HPP_
 #define _YIELD_HTTP_SERVER_HTTP_CONNECTION_HPP_
 
+#include <atomic>
+#include <deque>
+#include <vector>
+
 #include "yield/event_queue.hpp"
 #include "yield/sockets/aio/socket_aio_queue.hpp"
 #include "yield/sockets/aio/accept_aiocb.hpp"
 #include "yield/sockets/aio/recv_aiocb.hpp"
+#include "yield/sockets/aio/send_aiocb.hpp"
+#include "yield/sockets/aio/sendfile_aiocb.hpp"
 #include "yield/sockets/tcp_socket.hpp"
+#include "yield/http/http_request_parser.hpp"
 #include "yield/http/server/http_server_message_body_chunk.hpp"
 #include "yield/http/server/http_server_response.hpp"
+#include "yield/thread/mutex.hpp"
 
 namespace yield {
 namespace http {
@@ -43,10 +51,23 @@ class HttpServerRequest;
 
 /**
   A server-side HTTP connection.
+  Every complete request in a received buffer is parsed at once (HTTP/1.1
+    pipelining), and the connection is kept alive for further requests.
+    Responses are sent in request order; ready responses to the requests of
+    one receive are coalesced into a single send over chained buffers.
+  The socket is closed only once no receive or send refers to it any more:
+    after an error, or after the peer has stopped sending and every
+    response has been sent.
 */
-class HttpServerConnection final : private ::std::enable_shared_from_this<HttpServerConnection> {
+class HttpServerConnection final : public ::std::enable_shared_from_this<HttpServerConnection> {
+public:
+  enum class State { CONNECTED, ERROR, CLOSED };
+
 public:
-  enum class State { CONNECTED, ERROR };
+  /**
+    Sequence number of a response that is not bound to a particular request.
+  */
+  const static uint64_t SEQUENCE_NUMBER_NONE = UINT64_MAX;
 
 public:
   ::yield::sockets::SocketAddress& peername() const {
@@ -62,11 +83,28 @@ public:
   }
 
 public:
-  void handle(::std::unique_ptr< ::yield::http::HttpMessageBodyChunk > http_message_body_chunk);
-  void handle(::std::unique_ptr<HttpServerResponse> http_response);
+  /**
+    Send a body chunk of the most recent response on this connection,
+      after that response's header.
+    @param http_message_body_chunk the chunk, or a chunk without data for
+      the last chunk
+  */
+  void handle(::std::unique_ptr< ::yield::http::HttpMessageBodyChunk > http_message_body_chunk) {
+    handle(::std::move(http_message_body_chunk), SEQUENCE_NUMBER_NONE);
+  }
+
+  /**
+    Send a response that is not bound to a request on this connection,
+      after the responses to every request received so far.
+    @param http_response the response
+  */
+  void handle(::std::unique_ptr<HttpServerResponse> http_response) {
+    handle(::std::move(http_response), SEQUENCE_NUMBER_NONE);
+  }
 
 private:
   friend class HttpServerEventQueue;
+  friend class HttpServerRequest;
 
 private:
   class ParseCallbacks;
@@ -90,6 +128,56 @@ private:
     ::std::shared_ptr<HttpServerConnection> connection_;
   };
 
+  class SendAiocb final : public ::yield::sockets::aio::SendAiocb {
+  public:
+    SendAiocb(
+      ::std::shared_ptr<Buffer> buffer,
+      ::std::shared_ptr<HttpServerConnection> connection
+    ) : ::yield::sockets::aio::SendAiocb(connection->socket_, buffer, 0),
+        connection_(connection) {
+    }
+
+  public:
+    ::std::shared_ptr<HttpServerConnection>& connection() {
+      return connection_;
+    }
+
+  private:
+    ::std::shared_ptr<HttpServerConnection> connection_;
+  };
+
+  class SendfileAiocb final : public ::yield::sockets::aio::SendfileAiocb {
+  public:
+    SendfileAiocb(
+      ::std::shared_ptr<HttpServerConnection> connection,
+      fd_t fd
+    ) : ::yield::sockets::aio::SendfileAiocb(connection->socket_, fd),
+        connection_(connection) {
+    }
+
+    SendfileAiocb(
+      ::std::shared_ptr<HttpServerConnection> connection,
+      fd_t fd,
+      off_t offset,
+      size_t nbytes
+    ) : ::yield::sockets::aio::SendfileAiocb(
+          connection->socket_,
+          fd,
+          offset,
+          nbytes
+        ),
+        connection_(connection) {
+    }
+
+  public:
+    ::std::shared_ptr<HttpServerConnection>& connection() {
+      return connection_;
+    }
+
+  private:
+    ::std::shared_ptr<HttpServerConnection> connection_;
+  };
+
 private:
   HttpServerConnection(
     ::std::shared_ptr< EventQueue< ::yield::sockets::aio::SocketAiocb > > aio_queue,
@@ -99,21 +187,70 @@ private:
   ) : aio_queue_(aio_queue),
       event_handler_(event_handler),
       peername_(peername),
-      socket_(socket_) {
-    state_ = State::CONNECTED;
+      recv_count_(0),
+      recv_pending_(false),
+      requests_count_(0),
+      response_sequence_number_(0),
+      sends_count_(0),
+      slot_i_(0),
+      socket_(socket_),
+      state_(State::CONNECTED) {
   }
 
+private:
+  struct Response {
+    Response()
+      : chunked(false),
+        header_sent(false),
+        last_chunk(false),
+        recv_i(0) {
+    }
+
+    ::std::unique_ptr<HttpServerResponse> http_response;
+    // Body chunks that have not been sent yet
+    ::std::vector< ::std::shared_ptr<Buffer> > chunks;
+    bool chunked; // Transfer-Encoding: chunked, ends with the last chunk
+    bool header_sent;
+    bool last_chunk;
+    uint32_t recv_i; // recv_count_ of the request's receive
+  };
+
 private:
   void handle(::std::unique_ptr< ::yield::sockets::aio::AcceptAiocb > accept_aiocb);
+  void handle(::std::unique_ptr< ::yield::http::HttpMessageBodyChunk > http_message_body_chunk, uint64_t sequence_number);
   void handle(::std::unique_ptr< ::yield::sockets::aio::RecvAiocb > recv_aiocb);
+  void handle(::std::unique_ptr<HttpServerResponse> http_response, uint64_t sequence_number);
+  void handle(::std::unique_ptr< ::yield::sockets::aio::SendAiocb > send_aiocb);
+  void handle(::std::unique_ptr< ::yield::sockets::aio::SendfileAiocb > sendfile_aiocb);
+  void handle_send(ssize_t return_);
+  bool has_pending_responses();
   void parse(::std::shared_ptr<Buffer> recv_buffer);
+  void recv(::std::shared_ptr<Buffer> recv_buffer);
+  uint64_t reserve_response();
+  void send(::std::shared_ptr<Buffer> send_buffer);
+  void send_file(fd_t fd, const HttpServerResponse::BodyPart* body_part);
+  void send_ready_responses();
+  void send_response(HttpServerResponse& http_response, ::std::shared_ptr<Buffer>& send_buffer, ::std::shared_ptr<Buffer>& send_buffer_tail);
+  void set_error();
+  bool try_close();
 
 private:
   ::std::shared_ptr< EventQueue< ::yield::sockets::aio::SocketAiocb > >  aio_queue_;
   ::std::shared_ptr< EventSink<HttpServerEvent> > event_handler_;
+  ::std::unique_ptr<HttpRequestParser> parser_;
   ::std::shared_ptr< ::yield::sockets::SocketAddress > peername_;
+  uint32_t recv_count_;
+  bool recv_pending_;
+  uint32_t requests_count_;
+  // Reserved in request order; http_response is NULL until handled
+  ::std::deque<Response> responses_;
+  ::yield::thread::Mutex responses_mutex_;
+  uint64_t response_sequence_number_; // of responses_.front()
+  uint32_t sends_count_; // Sends and sendfiles in flight
+  uint32_t slot_i_; // in HttpServerEventQueue's connection table
   ::std::shared_ptr< ::yield::sockets::StreamSocket > socket_;
-  State state_;
+  // Set to CLOSED under responses_mutex_, read from handler threads
+  ::std::atomic<State> state_;
 };
 }
 }
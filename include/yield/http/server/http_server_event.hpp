@@ -38,6 +38,10 @@ public:
     REQUEST
   };
 
+public:
+  virtual ~HttpServerEvent() {
+  }
+
 public:
   virtual Type type() const = 0;
 };
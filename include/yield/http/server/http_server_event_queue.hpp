@@ -28,9 +28,11 @@
 #ifndef _YIELD_HTTP_SERVER_HTTP_SERVER_EVENT_QUEUE_HPP_
 #define _YIELD_HTTP_SERVER_HTTP_SERVER_EVENT_QUEUE_HPP_
 
+#include <atomic>
 #include <vector>
 
 #include "yield/exception.hpp"
+#include "yield/timer_wheel.hpp"
 #include "yield/http/server/http_server_event.hpp"
 #include "yield/sockets/socket_address.hpp"
 #include "yield/sockets/aio/socket_aio_queue.hpp"
@@ -41,6 +43,8 @@ namespace sockets {
 namespace aio {
 class AcceptAiocb;
 class RecvAiocb;
+class SendAiocb;
+class SendfileAiocb;
 }
 class SocketAddress;
 class StreamSocket;
@@ -59,16 +63,45 @@ class HttpServerConnection;
   HttpServerEventQueue is "passive" in that it relies on the caller to drive it.
   HttpServerEventQueue::dequeue or its variants must be called repeatedly and frequently
     in order for the server to make progress.
+
+  Connections are kept in a slab of slots that are reused through a free
+    list, and closed when they stay idle past a timeout, which a TimerWheel
+    tracks without per-request bookkeeping.
 */
 class HttpServerEventQueue : public EventQueue<HttpServerEvent> {
+public:
+  /**
+    Default time an open connection with no outstanding responses has to
+      deliver its next complete request.
+  */
+  const static Time KEEP_ALIVE_TIMEOUT_DEFAULT;
+
+  /**
+    Default time a new connection has to deliver its first complete request.
+  */
+  const static Time REQUEST_TIMEOUT_DEFAULT;
+
+  /**
+    Granularity of connection timeouts.
+  */
+  const static Time TIMEOUT_TICK;
+
 public:
   /**
     Construct an HttpServerEventQueue that listens for connections on the given
       socket address.
     @param sockname address to listen to
+    @param reuse_port true to set SO_REUSEPORT on the listening socket, so
+      that several HttpServerEventQueues can listen to the same address and
+      have the kernel balance connections among them
+    @param aio_queue_trigger how the underlying SocketAioQueue, if it is a
+      SocketNbioQueue, associates the connections with its FdEventQueue
   */
   HttpServerEventQueue(
-    const yield::sockets::SocketAddress& sockname
+    const yield::sockets::SocketAddress& sockname,
+    bool reuse_port = false,
+    ::yield::poll::FdEventQueue::Trigger aio_queue_trigger
+    = ::yield::poll::FdEventQueue::Trigger::LEVEL
   ) throw(Exception);
 
   /**
@@ -76,14 +109,56 @@ public:
       then be bound and listen to the given socket address.
     @param socket_ server socket to use
     @param sockname address to bind and listen to
+    @param reuse_port true to set SO_REUSEPORT on socket_
+    @param aio_queue_implementation the SocketAioQueue to drive the
+      connections with, e.g. NBIO for sockets that do their own I/O like
+      SslSocket
+    @param aio_queue_trigger how the underlying SocketAioQueue, if it is a
+      SocketNbioQueue, associates the connections with its FdEventQueue
   */
   HttpServerEventQueue(
     ::std::unique_ptr<yield::sockets::TcpSocket> socket_,
-    const yield::sockets::SocketAddress& sockname
+    const yield::sockets::SocketAddress& sockname,
+    bool reuse_port = false,
+    ::yield::sockets::aio::SocketAioQueue::Implementation
+    aio_queue_implementation
+    = ::yield::sockets::aio::SocketAioQueue::Implementation::DEFAULT,
+    ::yield::poll::FdEventQueue::Trigger aio_queue_trigger
+    = ::yield::poll::FdEventQueue::Trigger::LEVEL
   ) throw(Exception);
 
   ~HttpServerEventQueue();
 
+public:
+  /**
+    Get the address the server is listening to, e.g. to learn the port the
+      system chose for a sockname with port 0.
+    @return the address the server is listening to
+  */
+  ::std::unique_ptr< ::yield::sockets::SocketAddress > sockname() const throw(Exception);
+
+public:
+  /**
+    Set the time an open connection with no outstanding responses has to
+      deliver its next complete request before it is closed.
+    Must be called before the queue is first dequeued from.
+    @param keep_alive_timeout the timeout, or Time::FOREVER for none
+  */
+  void set_keep_alive_timeout(const Time& keep_alive_timeout) {
+    keep_alive_timeout_ = keep_alive_timeout;
+  }
+
+  /**
+    Set the time a new connection has to deliver its first complete request
+      before it is closed, which bounds how long a client that trickles
+      in a request (Slowloris) can hold a connection.
+    Must be called before the queue is first dequeued from.
+    @param request_timeout the timeout, or Time::FOREVER for none
+  */
+  void set_request_timeout(const Time& request_timeout) {
+    request_timeout_ = request_timeout;
+  }
+
 public:
   // yield::EventQueue
   ::std::unique_ptr<HttpServerEvent> dequeue() override {
@@ -101,16 +176,50 @@ public:
   void wake() override;
 
 private:
-  void handle(::std::unique_ptr< ::yield::sockets::aio::AcceptAiocb > accept_aiocb);
-  void handle(::std::unique_ptr< ::yield::sockets::aio::RecvAiocb > recv_aiocb);
-  template <class AiocbType> void handle(::std::unique_ptr<AiocbType> aiocb);
-  void init(const yield::sockets::SocketAddress& sockname) throw(Exception);
+  const static uint32_t SLOT_I_NONE = UINT32_MAX;
+
+  struct ConnectionSlot {
+    ConnectionSlot()
+      : deadline(Time::FOREVER),
+        generation(0),
+        next_free_slot_i(SLOT_I_NONE),
+        timer_deadline(Time::FOREVER) {
+    }
+
+    ::std::shared_ptr<HttpServerConnection> connection;
+    Time deadline;
+    uint32_t generation; // Incremented when the slot is freed
+    uint32_t next_free_slot_i;
+    Time timer_deadline; // Of the earliest timer in timer_wheel_
+  };
+
+private:
+  void close_connection(HttpServerConnection& connection);
+  void close_idle_connections(const Time& now);
+  void erase_connection(HttpServerConnection& connection);
+  void handle(::std::unique_ptr< ::yield::sockets::aio::AcceptAiocb > accept_aiocb, const Time& now);
+  void handle(::std::unique_ptr< ::yield::sockets::aio::RecvAiocb > recv_aiocb, const Time& now);
+  void handle(::std::unique_ptr< ::yield::sockets::aio::SendAiocb > send_aiocb);
+  void handle(::std::unique_ptr< ::yield::sockets::aio::SendfileAiocb > sendfile_aiocb);
+  void
+  init(
+    const yield::sockets::SocketAddress& sockname,
+    bool reuse_port
+  ) throw(Exception);
+  void insert_connection(::std::shared_ptr<HttpServerConnection> connection, const Time& now);
+  void set_deadline(uint32_t slot_i, const Time& now, const Time& timeout);
 
 private:
   ::std::shared_ptr< ::yield::sockets::aio::SocketAioQueue > aio_queue_;
-  ::std::vector< ::std::shared_ptr<HttpServerConnection> > connections_;
+  ::std::vector<ConnectionSlot> connection_slots_;
   ::std::shared_ptr< ::yield::queue::SynchronizedEventQueue<HttpServerEvent> > event_queue_;
+  ::std::vector<uint64_t> expired_timer_ids_;
+  uint32_t free_connection_slot_i_;
+  Time keep_alive_timeout_;
+  Time request_timeout_;
   ::std::shared_ptr< ::yield::sockets::StreamSocket > socket_;
+  TimerWheel timer_wheel_;
+  ::std::atomic<bool> woken_;
 };
 }
 }
@@ -68,7 +68,8 @@ public:
     uint8_t http_version = HTTP_VERSION_DEFAULT
   ) : HttpRequest(body, method, uri, http_version),
     connection_(connection),
-    creation_date_time_(DateTime::now()) {
+    creation_date_time_(DateTime::now()),
+    response_sequence_number_(HttpServerConnection::SEQUENCE_NUMBER_NONE) {
   }
 
   /**
@@ -88,7 +89,8 @@ public:
     uint8_t http_version = HTTP_VERSION_DEFAULT
   ) : HttpRequest(body, method, uri, http_version),
     connection_(connection),
-    creation_date_time_(DateTime::now()) {
+    creation_date_time_(DateTime::now()),
+    response_sequence_number_(HttpServerConnection::SEQUENCE_NUMBER_NONE) {
   }
 
   /**
@@ -96,6 +98,7 @@ public:
     @param body an optional body
     @param connection the server connection
     @param fields_offset offset into the header buffer where the fields start
+    @param field_index index of the fields in the header buffer
     @param header header buffer
     @param http_version the HTTP version as a single byte (0 or 1 for HTTP/1.0
       and HTTP/1.1, respectively)
@@ -106,6 +109,7 @@ public:
     ::std::shared_ptr<Buffer> body,
     ::std::shared_ptr<HttpServerConnection> connection,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     Method method,
@@ -113,13 +117,15 @@ public:
   ) : HttpRequest(
     body,
     fields_offset,
+    field_index,
     header,
     http_version,
     method,
     uri
   ),
   connection_(connection),
-  creation_date_time_(DateTime::now()) {
+  creation_date_time_(DateTime::now()),
+  response_sequence_number_(HttpServerConnection::SEQUENCE_NUMBER_NONE) {
   }
 
 public:
@@ -142,21 +148,26 @@ public:
 
 public:
   /**
-    Respond to the HTTP request with a chunked body.
-    respond(HttpResponse&) or respond(status_code) must be called first.
-    @param chunk response body chunk
+    Respond to the HTTP request.
+    Responses to requests pipelined on the same connection are sent in
+      request order, regardless of the order in which they are made.
+    This method should only be called once.
+    @param response the response
   */
   void respond(::std::unique_ptr<HttpServerResponse> response) {
-    connection_->handle(::std::move(response));
+    connection_->handle(::std::move(response), response_sequence_number_);
   }
 
   /**
     Respond to the HTTP request with a chunked body.
     respond(HttpResponse&) or respond(status_code) must be called first.
-    @param chunk response body chunk
+    The chunks are sent after the response header, and the responses to
+      later requests on the same connection after the last chunk.
+    @param chunk response body chunk, or a chunk without data for the last
+      chunk
   */
   void respond(::std::unique_ptr<HttpServerMessageBodyChunk> chunk) {
-    connection_->handle(::std::move(chunk));
+    connection_->handle(::std::move(chunk), response_sequence_number_);
   }
 
   /**
@@ -200,9 +211,13 @@ public:
     return Type::REQUEST;
   }
 
+private:
+  friend class HttpServerConnection;
+
 private:
   ::std::shared_ptr<HttpServerConnection> connection_;
   DateTime creation_date_time_;
+  uint64_t response_sequence_number_;
 };
 }
 }
@@ -30,10 +30,34 @@
 
 #include "yield/http/http_response.hpp"
 
+#include <vector>
+
 namespace yield {
 namespace http {
 namespace server {
 class HttpServerResponse : public ::yield::http::HttpResponse {
+public:
+  /**
+    A segment of a response body that is sent as a sequence of parts, either
+      in-memory data or a byte range of the body file.
+  */
+  struct BodyPart {
+    /**
+      The part's data, or NULL if the part is a range of the body file.
+    */
+    ::std::shared_ptr<Buffer> data;
+
+    /**
+      The offset in the body file of the part's first byte.
+    */
+    uint64_t offset;
+
+    /**
+      The number of bytes in the part.
+    */
+    uint64_t length;
+  };
+
 public:
   HttpServerResponse(
     uint8_t http_version,
@@ -51,6 +75,45 @@ public:
     uint16_t status_code
   ) : HttpResponse(body, http_version, status_code) {
   }
+
+public:
+  /**
+    Append in-memory data to the body parts, e.g. a multipart boundary.
+    The Content-Length field must account for the data.
+    @param data the part's data
+  */
+  void add_body_part(::std::shared_ptr<Buffer> data) {
+    BodyPart body_part;
+    body_part.data = data;
+    body_part.offset = 0;
+    body_part.length = data->size();
+    body_parts_.push_back(body_part);
+  }
+
+  /**
+    Append a byte range of the body file to the body parts.
+    The Content-Length field must account for the range.
+    @param offset the offset in the body file of the range's first byte
+    @param length the number of bytes in the range
+  */
+  void add_body_part(uint64_t offset, uint64_t length) {
+    BodyPart body_part;
+    body_part.offset = offset;
+    body_part.length = length;
+    body_parts_.push_back(body_part);
+  }
+
+  /**
+    Get the parts to send as the body in place of the whole body file.
+    @return the body parts, in order, or an empty vector to send the whole
+      body file
+  */
+  const ::std::vector<BodyPart>& body_parts() const {
+    return body_parts_;
+  }
+
+private:
+  ::std::vector<BodyPart> body_parts_;
 };
 }
 }
@@ -0,0 +1,88 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_HTTP_SERVER_HTTPS_SERVER_HPP_
+#define _YIELD_HTTP_SERVER_HTTPS_SERVER_HPP_
+
+#include "yield/stage/stage_impl.hpp"
+#include "yield/http/server/http_server_event_queue.hpp"
+#ifdef YIELD_HAVE_OPENSSL
+#include "yield/sockets/ssl/ssl_socket.hpp"
+#endif
+
+namespace yield {
+namespace http {
+namespace server {
+#ifdef YIELD_HAVE_OPENSSL
+/**
+  An HTTPS server stage: an HttpServer whose connections are SslSockets.
+  The connections are driven by a SocketNbioQueue whatever the platform's
+    default SocketAioQueue, since only it can retry a TLS handshake, read or
+    write that is waiting on the other direction of the socket.
+*/
+class HttpsServer : public ::yield::stage::StageImpl<HttpServerEvent> {
+public:
+  /**
+    Construct an HttpsServer that will listen to the given socket address and
+      dispatch HttpRequests and related Events originating from the server
+      to the given handler.
+    @param http_request_handler handler for HttpRequests and related Events
+      originating from the server
+    @param sockname address to listen to
+    @param ssl_context context with the server's certificate and private key,
+      shared by the accepted connections; enable session resumption on it to
+      spare reconnecting clients full handshakes
+  */
+  HttpsServer(
+    ::std::unique_ptr< EventHandler<HttpServerEvent> > http_server_event_handler,
+    const yield::sockets::SocketAddress& sockname,
+    ::std::shared_ptr<yield::sockets::ssl::SslContext> ssl_context
+  )
+    : ::yield::stage::StageImpl<HttpServerEvent>(
+      ::std::move(http_server_event_handler),
+      ::std::unique_ptr< EventQueue<HttpServerEvent> >(
+        new HttpServerEventQueue(
+          ::std::unique_ptr<yield::sockets::TcpSocket>(
+            new yield::sockets::ssl::SslSocket(
+              ssl_context,
+              sockname.get_family()
+            )
+          ),
+          sockname,
+          false,
+          ::yield::sockets::aio::SocketAioQueue::Implementation::NBIO
+        )
+      )
+    ) {
+  }
+};
+#endif
+}
+}
+}
+
+#endif
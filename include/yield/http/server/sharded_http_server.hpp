@@ -0,0 +1,120 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_HTTP_SERVER_SHARDED_HTTP_SERVER_HPP_
+#define _YIELD_HTTP_SERVER_SHARDED_HTTP_SERVER_HPP_
+
+#include <vector>
+
+#include "yield/event_sink.hpp"
+#include "yield/exception.hpp"
+#include "yield/http/server/http_server_event.hpp"
+#include "yield/poll/fd_event_queue.hpp"
+
+namespace yield {
+namespace sockets {
+class SocketAddress;
+}
+
+namespace thread {
+class Thread;
+}
+
+namespace http {
+namespace server {
+/**
+  A multi-reactor HTTP server.
+  Each shard is an HttpServerEventQueue driven by its own thread, with its own
+    listening socket bound to the same address with SO_REUSEPORT, so the
+    kernel spreads incoming connections across the shards and accepting,
+    receiving and parsing scale with the number of shards. A connection stays
+    on the shard that accepted it, responses included.
+  Every HttpServerEvent a shard dequeues is forwarded to a single sink: a
+    handler stage (e.g. a StageImpl scheduled on a StageScheduler) to fan
+    requests out to its threads, or an EventHandler to handle them on the
+    shard's own thread.
+*/
+class ShardedHttpServer final {
+public:
+  /**
+    Construct a ShardedHttpServer and start its shards.
+    @param http_server_event_sink sink for the events of every shard, which
+      must accept events from several threads at once
+    @param sockname address to listen to; with port 0 the first shard's
+      listener picks the port and the other shards listen to the same one
+    @param shard_count number of shards, 0 for one per online logical
+      processor
+    @param setaffinity true to bind the thread of shard i to logical processor
+      i (modulo the number of online logical processors)
+    @param aio_queue_trigger how each shard associates its connections with
+      its FdEventQueue, when it drives them with non-blocking I/O. A shard
+      dequeues on a single thread, so EDGE saves re-associating a
+      connection whenever its pending aiocbs change.
+  */
+  ShardedHttpServer(
+    ::std::shared_ptr< EventSink<HttpServerEvent> > http_server_event_sink,
+    const ::yield::sockets::SocketAddress& sockname,
+    uint16_t shard_count = 0,
+    bool setaffinity = false,
+    ::yield::poll::FdEventQueue::Trigger aio_queue_trigger
+    = ::yield::poll::FdEventQueue::Trigger::EDGE
+  ) throw(Exception);
+
+  /**
+    Stop and join the shards, closing their listening sockets and connections.
+  */
+  ~ShardedHttpServer();
+
+public:
+  /**
+    Get the number of shards.
+    @return the number of shards
+  */
+  size_t shard_count() const {
+    return threads_.size();
+  }
+
+  /**
+    Get the address the shards are listening to.
+    @return the address the shards are listening to
+  */
+  ::std::unique_ptr< ::yield::sockets::SocketAddress > sockname() const throw(Exception);
+
+private:
+  class Shard;
+
+private:
+  void stop();
+
+private:
+  ::std::vector< ::std::unique_ptr< ::yield::thread::Thread > > threads_;
+};
+}
+}
+}
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_HTTP_SERVER_STATIC_FILE_REQUEST_HANDLER_HPP_
+#define _YIELD_HTTP_SERVER_STATIC_FILE_REQUEST_HANDLER_HPP_
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "yield/event_handler.hpp"
+#include "yield/time.hpp"
+#include "yield/fs/file_system.hpp"
+#include "yield/fs/path.hpp"
+#include "yield/fs/poll/fs_event_queue.hpp"
+#include "yield/http/http_request.hpp"
+#include "yield/http/server/http_server_event.hpp"
+#include "yield/thread/mutex.hpp"
+
+namespace yield {
+namespace http {
+namespace server {
+class HttpServerRequest;
+class HttpServerResponse;
+
+/**
+  An EventHandler that serves GET and HEAD requests from the files under a
+    root directory.
+  Open files and their Stat results are kept in a bounded LRU cache, so that
+    a cached file is sent with sendfile from an already open descriptor.
+    Cached files are watched through an FsEventQueue and dropped from the
+    cache when they change. The FsEventQueue is drained at most once per
+    fs_events_poll_interval, so a changed file may be served from the cache
+    for up to that long.
+  Responses carry ETag and Last-Modified fields; a conditional GET whose
+    If-None-Match or If-Modified-Since field matches a cached file is answered
+    with 304 Not Modified without touching the disk.
+  GET requests with a Range field, subject to If-Range, are answered with
+    206 Partial Content: a single range is sent from the file at its offset
+    and several ranges as a multipart/byteranges body that interleaves part
+    headers with sendfiles of the ranges.
+*/
+class StaticFileRequestHandler final : public EventHandler<HttpServerEvent> {
+public:
+  /**
+    Default maximum number of open files to cache.
+  */
+  const static size_t CACHE_CAPACITY_DEFAULT = 1024;
+
+  /**
+    Default minimum interval between two drains of the FsEventQueue.
+  */
+  const static Time FS_EVENTS_POLL_INTERVAL_DEFAULT;
+
+public:
+  /**
+    Construct a StaticFileRequestHandler.
+    @param root_directory_path the directory request URI paths are resolved
+      against
+    @param cache_capacity the maximum number of open files to cache
+    @param fs_events_poll_interval the minimum interval between two drains
+      of the FsEventQueue, each of which costs a system call
+  */
+  StaticFileRequestHandler(
+    const ::yield::fs::Path& root_directory_path,
+    size_t cache_capacity = CACHE_CAPACITY_DEFAULT,
+    const Time& fs_events_poll_interval = FS_EVENTS_POLL_INTERVAL_DEFAULT
+  );
+
+  ~StaticFileRequestHandler();
+
+public:
+  /**
+    Get the number of files in the cache.
+    @return the number of files in the cache
+  */
+  size_t cache_size();
+
+public:
+  // yield::EventHandler
+  void handle(::std::unique_ptr<HttpServerEvent> event) override;
+
+private:
+  class CachedFile;
+
+private:
+  ::std::shared_ptr<CachedFile> get_cached_file(const ::yield::fs::Path& path);
+  void handle(::std::unique_ptr<HttpServerRequest> http_request);
+
+  static bool
+  if_range_matches(
+    const HttpServerRequest& http_request,
+    const CachedFile& cached_file
+  );
+  void invalidate(const ::yield::fs::Path& path);
+  void invalidate(const ::yield::fs::poll::FsEvent& fs_event);
+  void poll_fs_events();
+
+  ::std::unique_ptr<HttpServerResponse>
+  respond_partial(
+    const HttpServerRequest& http_request,
+    ::std::shared_ptr<CachedFile> cached_file,
+    const ::std::vector<HttpRequest::ByteRange>& byte_ranges
+  );
+
+private:
+  typedef ::std::list< ::std::shared_ptr<CachedFile> > CachedFileList;
+
+  // Most recently used first
+  CachedFileList cache_;
+  size_t cache_capacity_;
+  ::std::map< ::yield::fs::Path, CachedFileList::iterator > cache_index_;
+  ::yield::fs::FileSystem file_system_;
+  ::yield::fs::poll::FsEventQueue fs_event_queue_;
+  Time fs_events_poll_interval_;
+  ::std::atomic<uint32_t> multipart_boundary_count_;
+  uint64_t next_fs_events_poll_ns_;
+  ::yield::thread::Mutex mutex_; // Protects everything above
+  ::yield::fs::Path root_directory_path_;
+};
+}
+}
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_HTTP_SERVER_YGI_REVERSE_DNS_CACHE_HPP_
+#define _YIELD_HTTP_SERVER_YGI_REVERSE_DNS_CACHE_HPP_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "yield/time.hpp"
+#include "yield/sockets/socket_address.hpp"
+#include "yield/thread/mutex.hpp"
+
+namespace yield {
+namespace thread {
+class Thread;
+}
+
+namespace http {
+namespace server {
+namespace ygi {
+/**
+  A bounded cache of the host names of peer addresses, for REMOTE_HOST.
+  Looking up an address never blocks the caller: a miss queues the address
+    for a background resolver thread, which does the reverse DNS lookup and
+    fills in the entry, so one slow resolver only delays the names and not
+    the requests that want them.
+  Entries, including those for addresses without a name, expire after a time
+    to live; the least recently used entry is evicted when the cache is full.
+*/
+class ReverseDnsCache final {
+public:
+  /**
+    Default maximum number of addresses to cache.
+  */
+  const static size_t CAPACITY_DEFAULT = 1024;
+
+  /**
+    Default time to live of a cache entry.
+  */
+  const static Time TTL_DEFAULT;
+
+public:
+  /**
+    Construct a ReverseDnsCache and start its resolver thread.
+    @param capacity the maximum number of addresses to cache, including
+      those waiting on the resolver
+    @param ttl the time to live of an entry
+  */
+  ReverseDnsCache(
+    size_t capacity = CAPACITY_DEFAULT,
+    const Time& ttl = TTL_DEFAULT
+  );
+
+  /**
+    Stop and join the resolver thread.
+  */
+  ~ReverseDnsCache();
+
+public:
+  /**
+    Get the host name of a peer address from the cache.
+    If the address is not cached, or its entry has expired, queue it for the
+      resolver and return immediately.
+    @param peername the peer address
+    @param remote_addr the numeric form of peername, from SocketAddress::ntop
+    @param[out] remote_host the host name of peername, empty if the address
+      has no name
+    @return true if the address had an unexpired, resolved entry
+  */
+  bool
+  get(
+    const ::yield::sockets::SocketAddress& peername,
+    const ::std::string& remote_addr,
+    ::std::string& remote_host
+  );
+
+  /**
+    Get the number of addresses in the cache, including those waiting on the
+      resolver.
+    @return the number of addresses in the cache
+  */
+  size_t size();
+
+private:
+  class Entry;
+  class Resolver;
+
+private:
+  void put(const ::std::string& remote_addr, const ::std::string& remote_host);
+
+private:
+  typedef ::std::list< ::std::shared_ptr<Entry> > EntryList;
+  // Most recently used first
+  EntryList entries_;
+  size_t capacity_;
+  ::std::map< ::std::string, EntryList::iterator > entries_index_;
+  ::yield::thread::Mutex mutex_; // Protects everything above
+  ::std::unique_ptr< ::yield::thread::Thread > resolver_thread_;
+  Time ttl_;
+};
+}
+}
+}
+}
+
+#endif
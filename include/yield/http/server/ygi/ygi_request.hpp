@@ -36,9 +36,21 @@ namespace yield {
 namespace http {
 namespace server {
 namespace ygi {
+class ReverseDnsCache;
+
 class YgiRequest final : public ygi_request_t {
 public:
-  YgiRequest(::std::unique_ptr<HttpServerRequest> http_request);
+  /**
+    Construct a YgiRequest around an HttpServerRequest.
+    REMOTE_ADDR and REMOTE_HOST are only computed when first asked for.
+    @param http_request the request
+    @param reverse_dns_cache the cache REMOTE_HOST is looked up in, or NULL
+      to always substitute REMOTE_ADDR for REMOTE_HOST
+  */
+  YgiRequest(
+    ::std::unique_ptr<HttpServerRequest> http_request,
+    ReverseDnsCache* reverse_dns_cache = NULL
+  );
 
 public:
   // RFC 3875 meta-variables
@@ -162,10 +174,13 @@ private:
 
   ygi_response_t* static_respond(uint16_t status_code);
 
+  const ::std::string& remote_addr() const;
+
 private:
   ::std::unique_ptr<HttpServerRequest> http_request_;
-  ::std::string remote_addr_;
-  ::std::string remote_host_;
+  mutable ::std::string remote_addr_;
+  mutable ::std::string remote_host_;
+  ReverseDnsCache* reverse_dns_cache_;
   iovec server_protocol_;
 };
 }
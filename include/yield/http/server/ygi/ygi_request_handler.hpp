@@ -32,6 +32,7 @@
 
 #include "yield/event_handler.hpp"
 #include "yield/http/server/http_server_event.hpp"
+#include "yield/http/server/ygi/reverse_dns_cache.hpp"
 
 namespace yield {
 namespace http {
@@ -46,6 +47,7 @@ public:
   void handle(::std::unique_ptr<HttpServerEvent>) override;
 
 private:
+  ReverseDnsCache reverse_dns_cache_;
   ygi_request_handler_t ygi_request_handler;
 };
 }
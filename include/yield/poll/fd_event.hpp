@@ -48,6 +48,8 @@ public:
 public:
   /**
     Construct an FdEvent from a file descriptor and a Type.
+    The Type may combine several of the TYPE_ flags, e.g. read readiness
+      and hangup reported by the same wait.
   */
   FdEvent(fd_t fd, Type type);
 
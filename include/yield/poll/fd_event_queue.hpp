@@ -32,9 +32,17 @@
 #include "yield/event_queue.hpp"
 #include "yield/poll/fd_event.hpp"
 
+#include <vector>
+#ifdef __linux__
+#include <unordered_map>
+#endif
+
 #ifndef _WIN32
 #include <sys/poll.h>
 #endif
+#ifdef __linux__
+struct epoll_event;
+#endif
 
 namespace yield {
 namespace poll {
@@ -43,12 +51,45 @@ namespace poll {
   Implemented in terms of efficient poll() variants on different platforms.
 */
 class FdEventQueue final : public EventQueue<FdEvent> {
+public:
+  /**
+    How an associated file descriptor reports readiness.
+    Platforms without an equivalent of EDGE or ONESHOT treat them as LEVEL.
+  */
+  enum class Trigger {
+    /**
+      Report the fd for as long as it is ready (the default).
+    */
+    LEVEL,
+
+    /**
+      Report the fd only when it becomes ready (EPOLLET, EV_CLEAR).
+      The caller must consume input or output until it would block before
+        another event is reported.
+    */
+    EDGE,
+
+    /**
+      Report the fd once, then disable it until it is associated again
+        (EPOLLONESHOT, EV_ONESHOT). With several threads dequeuing, each
+        readiness change is handed to only one of them.
+    */
+    ONESHOT
+  };
+
 public:
   /**
     Construct an FdEventQueue, allocating any associated system resources.
     @param for_sockets_only true if this FdEventQueue is only for sockets
+    @param batch_size maximum number of events to harvest from the kernel
+      per wait. Events beyond the first are buffered in the queue and
+      handed out by subsequent dequeues without another system call.
+      A batch_size > 1 restricts the queue to a single dequeuing thread.
   */
-  FdEventQueue(bool for_sockets_only = false) throw(Exception);
+  FdEventQueue(
+    bool for_sockets_only = false,
+    size_t batch_size = 1
+  ) throw(Exception);
 
   /**
     Destroy an FdEventQueue, deallocating any associated system resources.
@@ -60,11 +101,21 @@ public:
     Associate a file descriptor with this FdEventQueue,
       watching for the specified FdEvent types (read readiness,
       write readiness, et al.).
+    Re-associating an fd with unchanged types and trigger is cheap: the
+      queue remembers each association and only asks the kernel to modify
+      it when it has changed (or, with Trigger::ONESHOT, to re-arm it).
+    associate and dissociate must not be called concurrently.
    @param fd the file descriptor to associate
    @param fd_event_types FdEvent types to monitor
+   @param trigger how the fd reports readiness
    @return true on success, false+errno on failure
   */
-  bool associate(fd_t fd, FdEvent::Type fd_event_types);
+  bool
+  associate(
+    fd_t fd,
+    FdEvent::Type fd_event_types,
+    Trigger trigger = Trigger::LEVEL
+  );
 
   /**
     Dissociate a file descriptor from this FdEventQueue.
@@ -73,6 +124,19 @@ public:
   */
   bool dissociate(fd_t fd);
 
+public:
+  /**
+    Dequeue every buffered FdEvent, waiting up to timeout for the kernel
+      to report new ones if none are buffered.
+    Unlike timeddequeue this does not allocate: the events remain owned by
+      the queue and are valid until the next dequeue call, so only one
+      thread may call dequeue_batch.
+    @param timeout time to wait for new events if none are buffered
+    @param[out] events the first dequeued event
+    @return the number of dequeued events, 0 on timeout or wake
+  */
+  size_t dequeue_batch(const Time& timeout, const FdEvent*& events);
+
 public:
   // yield::EventQueue
   ::std::unique_ptr<FdEvent> dequeue() override {
@@ -89,8 +153,19 @@ public:
   void wake() override;
 
 private:
+#ifdef __linux__
+  bool fill_ready_events(const Time& timeout);
+  void read_wake_fd();
+#endif
+
+private:
+  ::std::vector<FdEvent> ready_events_;
 #if defined(__linux__)
+  ::std::unordered_map<fd_t, uint32_t> associations_;
+  size_t batch_size_;
   int epfd_, wake_fd_;
+  epoll_event* epoll_events_;
+  size_t ready_event_i_;
 #elif defined(__MACH__) || defined(__FreeBSD__)
   int kq_, wake_pipe_[2];
 #elif defined(__sun)
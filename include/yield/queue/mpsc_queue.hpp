@@ -0,0 +1,248 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_QUEUE_MPSC_QUEUE_HPP_
+#define _YIELD_QUEUE_MPSC_QUEUE_HPP_
+
+#include "yield/time.hpp"
+#include "yield/thread/semaphore.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace yield {
+namespace queue {
+/**
+  An unbounded queue that can handle multiple concurrent enqueues but only a
+    single dequeuer at a time.
+
+  Enqueues never take a lock: a producer links its element onto the back of
+    the queue with one atomic exchange. A dequeuer that finds the queue empty
+    spins briefly before parking on a semaphore (a futex on Linux), which
+    producers post only while the dequeuer is parked.
+
+  Adapted from Vyukov, D. Non-intrusive MPSC node-based queue.
+*/
+template <class ElementT>
+class MpscQueue {
+public:
+  MpscQueue()
+    : parked_(false) {
+    front_ = new Node(NULL); // Stub node
+    back_ = front_;
+  }
+
+  ~MpscQueue() {
+    while (front_ != NULL) {
+      Node* next = front_->next.load();
+      delete front_->element;
+      delete front_;
+      front_ = next;
+    }
+  }
+
+public:
+  /**
+    Dequeue an element.
+    Always succeeds.
+    @return the dequeued element
+  */
+  ::std::unique_ptr<ElementT> dequeue() {
+    ::std::unique_ptr<ElementT> element;
+    while (!spin(element)) {
+      parked_.store(true);
+      if (pop(element)) {
+        parked_.store(false);
+        break;
+      }
+      semaphore_.wait();
+    }
+    return element;
+  }
+
+  /**
+    Dequeue up to a number of elements, blocking until a timeout if the queue
+      is empty.
+    @param timeout time to block on an empty queue
+    @param max_elements_count the maximum number of elements to dequeue
+    @param[out] elements vector the dequeued elements are appended to
+    @return the number of dequeued elements, 0 on timeout or wake
+  */
+  size_t
+  dequeue_batch(
+    const Time& timeout,
+    size_t max_elements_count,
+    ::std::vector< ::std::unique_ptr<ElementT> >& elements
+  ) {
+    if (max_elements_count == 0) {
+      return 0;
+    }
+
+    ::std::unique_ptr<ElementT> element = timeddequeue(timeout);
+    size_t elements_count = 0;
+    // A NULL element is a wake(), which ends the batch
+    while (element != NULL) {
+      elements.push_back(::std::move(element));
+      if (++elements_count == max_elements_count || !pop(element)) {
+        break;
+      }
+    }
+    return elements_count;
+  }
+
+  /**
+    Dequeue an element, blocking until a timeout if the queue is empty.
+    @param timeout time to block on an empty queue
+    @return the dequeued element or NULL if queue was empty for the duration
+      of the timeout
+  */
+  ::std::unique_ptr<ElementT> timeddequeue(const Time& timeout) {
+    if (timeout == Time::FOREVER) {
+      return dequeue();
+    }
+
+    ::std::unique_ptr<ElementT> element;
+    if (spin(element)) {
+      return element;
+    }
+
+    Time timeout_left(timeout);
+    for (;;) {
+      parked_.store(true);
+      if (pop(element)) {
+        parked_.store(false);
+        return element;
+      }
+
+      Time start_time = Time::now();
+      semaphore_.timedwait(timeout_left);
+      // A producer that cleared parked_ first leaves a stray post behind,
+      // which only costs a later wait an extra loop.
+      parked_.store(false);
+
+      if (pop(element)) {
+        return element;
+      } else {
+        Time elapsed_time(Time::now() - start_time);
+        if (elapsed_time < timeout_left) {
+          timeout_left -= elapsed_time;
+        } else {
+          return ::std::unique_ptr<ElementT>();
+        }
+      }
+    }
+  }
+
+  /**
+    Try to dequeue an element.
+    Never blocks.
+    @return the dequeued element or NULL if the queue was empty
+  */
+  ::std::unique_ptr<ElementT> trydequeue() {
+    ::std::unique_ptr<ElementT> element;
+    pop(element);
+    return element;
+  }
+
+  /**
+    Enqueue a new element.
+    Never blocks.
+    @param element the element to enqueue
+    @return NULL
+  */
+  ::std::unique_ptr<ElementT> tryenqueue(::std::unique_ptr<ElementT> element) {
+    Node* node = new Node(element.release());
+    Node* prev_back = back_.exchange(node);
+    prev_back->next.store(node);
+
+    if (parked_.load() && parked_.exchange(false)) {
+      semaphore_.post();
+    }
+
+    return ::std::unique_ptr<ElementT>();
+  }
+
+  /**
+    Interrupt a blocking dequeue.
+   */
+  void wake() {
+    tryenqueue(::std::unique_ptr<ElementT>());
+  }
+
+private:
+  class Node {
+  public:
+    Node(ElementT* element)
+      : element(element), next(NULL) {
+    }
+
+  public:
+    ElementT* element;
+    ::std::atomic<Node*> next;
+  };
+
+private:
+  // Dequeue into element, returning false if the queue was empty or a
+  // producer has yet to link its node
+  bool pop(::std::unique_ptr<ElementT>& element) {
+    Node* front = front_;
+    Node* next = front->next.load();
+    if (next == NULL) {
+      return false;
+    }
+
+    // next becomes the new stub node
+    element.reset(next->element);
+    next->element = NULL;
+    front_ = next;
+    delete front;
+    return true;
+  }
+
+  bool spin(::std::unique_ptr<ElementT>& element) {
+    for (uint16_t spin_i = 0; spin_i < SPIN_COUNT; ++spin_i) {
+      if (pop(element)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  const static uint16_t SPIN_COUNT = 128;
+
+private:
+  ::std::atomic<Node*> back_;
+  Node* front_;
+  ::std::atomic<bool> parked_;
+  ::yield::thread::Semaphore semaphore_;
+};
+}
+}
+
+#endif
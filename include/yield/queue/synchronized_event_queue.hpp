@@ -44,6 +44,15 @@ public:
     return synchronized_queue_.dequeue();
   }
 
+  size_t
+  dequeue_batch(
+    const Time& timeout,
+    size_t max_events_count,
+    ::std::vector< ::std::unique_ptr<EventT> >& events
+  ) override {
+    return synchronized_queue_.dequeue_batch(timeout, max_events_count, events);
+  }
+
   ::std::unique_ptr<EventT> timeddequeue(const Time& timeout) override {
     return synchronized_queue_.timeddequeue(timeout);
   }
@@ -32,6 +32,7 @@
 #include "yield/thread/condition_variable.hpp"
 
 #include <queue>
+#include <vector>
 
 namespace yield {
 namespace queue {
@@ -64,6 +65,51 @@ public:
     return element;
   }
 
+  /**
+    Dequeue up to a number of elements, blocking until a timeout if the queue
+      is empty.
+    The elements after the first are taken under a single lock.
+    @param timeout time to block on an empty queue
+    @param max_elements_count the maximum number of elements to dequeue
+    @param[out] elements vector the dequeued elements are appended to
+    @return the number of dequeued elements, 0 on timeout or wake
+  */
+  size_t
+  dequeue_batch(
+    const Time& timeout,
+    size_t max_elements_count,
+    ::std::vector< ::std::unique_ptr<ElementT> >& elements
+  ) {
+    if (max_elements_count == 0) {
+      return 0;
+    }
+
+    ::std::unique_ptr<ElementT> element
+    = timeout == Time::FOREVER ? dequeue() : timeddequeue(timeout);
+    if (element == NULL) {
+      return 0;
+    }
+    elements.push_back(::std::move(element));
+
+    size_t elements_count = 1;
+    cond_.lock_mutex();
+    // Leave a wake() for the next dequeue
+    while (
+      elements_count < max_elements_count
+      &&
+      !queue_.empty()
+      &&
+      queue_.front() != NULL
+    ) {
+      elements.push_back(::std::move(queue_.front()));
+      queue_.pop();
+      elements_count++;
+    }
+    cond_.unlock_mutex();
+
+    return elements_count;
+  }
+
   /**
     Dequeue an element, blocking until a timeout if the queue is empty.
     @param timeout time to block on an empty queue
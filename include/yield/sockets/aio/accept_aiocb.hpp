@@ -101,6 +101,9 @@ public:
 
 protected:
   friend class SocketNbioQueue;
+#ifdef __linux__
+  friend class linux::IoUringSocketAioQueue;
+#endif
 #ifdef _WIN32
   friend class win32::Win32SocketAioQueue;
 #endif
@@ -0,0 +1,134 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_SOCKETS_AIO_RECVMMSG_AIOCB_HPP_
+#define _YIELD_SOCKETS_AIO_RECVMMSG_AIOCB_HPP_
+
+#include "yield/sockets/datagram_socket.hpp"
+#include "yield/sockets/aio/socket_aiocb.hpp"
+
+#include <vector>
+
+namespace yield {
+namespace sockets {
+namespace aio {
+/**
+  AIO control block for receiving a batch of datagrams with one system call.
+  The operation completes once at least one datagram has been received:
+    return_() is then the number of buffers filled, from the front.
+  @see DatagramSocket::recvmmsg
+*/
+class RecvmmsgAiocb : public SocketAiocb {
+public:
+  /**
+    Construct a RecvmmsgAiocb.
+    @param socket_ socket to receive datagrams on
+    @param buffers the single (unlinked) buffers to receive datagrams into,
+      at most DatagramSocket::MMSG_VLEN_MAX
+    @param flags flags to pass to the recvmmsg method
+  */
+  RecvmmsgAiocb(
+    ::std::shared_ptr<DatagramSocket> socket_,
+    const ::std::vector< ::std::shared_ptr<Buffer> >& buffers,
+    const Socket::MessageFlags& flags
+  ) : buffers_(buffers),
+    flags_(flags),
+    gro_segment_sizes_(buffers.size()),
+    peernames_(buffers.size()),
+    socket_(socket_)
+  { }
+
+  virtual ~RecvmmsgAiocb() {
+  }
+
+public:
+  /**
+    Get the buffers in which to receive datagrams.
+    @return the buffers in which to receive datagrams
+  */
+  const ::std::vector< ::std::shared_ptr<Buffer> >& buffers() const {
+    return buffers_;
+  }
+
+  /**
+    Get the flags to pass to the recvmmsg method.
+    @return the flags to pass to the recvmmsg method
+  */
+  const Socket::MessageFlags& flags() const {
+    return flags_;
+  }
+
+  /**
+    Get the UDP GRO segment size of each buffer, or 0 if the buffer holds a
+      single datagram.
+    @return the segment sizes, parallel to buffers()
+  */
+  const ::std::vector<uint16_t>& gro_segment_sizes() const {
+    return gro_segment_sizes_;
+  }
+
+  /**
+    Get the sender of each datagram.
+    @return the senders, parallel to buffers()
+  */
+  const ::std::vector<SocketAddress>& peernames() const {
+    return peernames_;
+  }
+
+  /**
+    Get the socket associated with this control block.
+  */
+  DatagramSocket& socket() override {
+    return *socket_;
+  }
+
+  Type type() const override {
+    return Type::RECVMMSG;
+  }
+
+private:
+  friend class SocketNbioQueue;
+
+  ::std::vector< ::std::shared_ptr<Buffer> > buffers_;
+  Socket::MessageFlags flags_;
+  ::std::vector<uint16_t> gro_segment_sizes_;
+  ::std::vector<SocketAddress> peernames_;
+  ::std::shared_ptr<DatagramSocket> socket_;
+};
+
+/**
+  Print a string representation of a RecvmmsgAiocb to a std::ostream.
+  @param os std::ostream to print to
+  @param recvmmsg_aiocb RecvmmsgAiocb to print
+  @return os
+*/
+std::ostream& operator<<(std::ostream& os, const RecvmmsgAiocb& recvmmsg_aiocb);
+}
+}
+}
+
+#endif
@@ -0,0 +1,137 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_SOCKETS_AIO_SENDMMSG_AIOCB_HPP_
+#define _YIELD_SOCKETS_AIO_SENDMMSG_AIOCB_HPP_
+
+#include "yield/sockets/datagram_socket.hpp"
+#include "yield/sockets/aio/socket_aiocb.hpp"
+
+#include <vector>
+
+namespace yield {
+namespace sockets {
+namespace aio {
+/**
+  AIO control block for sending a batch of datagrams with as few system
+    calls as possible.
+  The operation completes once every buffer has been sent: return_() is
+    then the number of buffers.
+  @see DatagramSocket::sendmmsg
+*/
+class SendmmsgAiocb : public SocketAiocb {
+public:
+  /**
+    Construct a SendmmsgAiocb.
+    @param socket_ socket to send datagrams on
+    @param buffers the single (unlinked) buffers to send datagrams from
+    @param peernames the receiver of each datagram, parallel to buffers, or
+      empty on a connected socket
+    @param flags flags to pass to the sendmmsg method
+    @param gso_segment_size if not 0, the kernel splits each buffer into
+      datagrams of this many bytes (UDP GSO, Linux only)
+  */
+  SendmmsgAiocb(
+    ::std::shared_ptr<DatagramSocket> socket_,
+    const ::std::vector< ::std::shared_ptr<Buffer> >& buffers,
+    const ::std::vector<SocketAddress>& peernames,
+    const Socket::MessageFlags& flags,
+    uint16_t gso_segment_size = 0
+  ) : buffers_(buffers),
+    flags_(flags),
+    gso_segment_size_(gso_segment_size),
+    peernames_(peernames),
+    socket_(socket_)
+  { }
+
+  virtual ~SendmmsgAiocb() {
+  }
+
+public:
+  /**
+    Get the buffers to send datagrams from.
+    @return the buffers to send datagrams from
+  */
+  const ::std::vector< ::std::shared_ptr<Buffer> >& buffers() const {
+    return buffers_;
+  }
+
+  /**
+    Get the flags to pass to the sendmmsg method.
+    @return the flags to pass to the sendmmsg method
+  */
+  const Socket::MessageFlags& flags() const {
+    return flags_;
+  }
+
+  /**
+    Get the UDP GSO segment size, or 0 to send each buffer as one datagram.
+    @return the UDP GSO segment size
+  */
+  uint16_t gso_segment_size() const {
+    return gso_segment_size_;
+  }
+
+  /**
+    Get the receiver of each datagram.
+    @return the receivers, parallel to buffers(), or empty
+  */
+  const ::std::vector<SocketAddress>& peernames() const {
+    return peernames_;
+  }
+
+  /**
+    Get the socket associated with this control block.
+  */
+  DatagramSocket& socket() override {
+    return *socket_;
+  }
+
+  Type type() const override {
+    return Type::SENDMMSG;
+  }
+
+private:
+  ::std::vector< ::std::shared_ptr<Buffer> > buffers_;
+  Socket::MessageFlags flags_;
+  uint16_t gso_segment_size_;
+  ::std::vector<SocketAddress> peernames_;
+  ::std::shared_ptr<DatagramSocket> socket_;
+};
+
+/**
+  Print a string representation of a SendmmsgAiocb to a std::ostream.
+  @param os std::ostream to print to
+  @param sendmmsg_aiocb SendmmsgAiocb to print
+  @return os
+*/
+std::ostream& operator<<(std::ostream& os, const SendmmsgAiocb& sendmmsg_aiocb);
+}
+}
+}
+
+#endif
@@ -29,6 +29,7 @@
 #define _YIELD_SOCKETS_AIO_SOCKET_AIO_QUEUE_HPP_
 
 #include "yield/event_queue.hpp"
+#include "yield/poll/fd_event_queue.hpp"
 #include "yield/sockets/aio/socket_aiocb.hpp"
 
 namespace yield {
@@ -43,6 +44,28 @@ namespace aio {
     events through from producer to consumer.
 */
 class SocketAioQueue : public EventQueue<SocketAiocb> {
+public:
+  /**
+    SocketAioQueue implementations that can be selected at runtime.
+  */
+  enum class Implementation {
+    /**
+      The platform's default: I/O completion ports on Win32, non-blocking I/O
+        elsewhere.
+    */
+    DEFAULT,
+
+    /**
+      Linux io_uring. Falls back to DEFAULT if io_uring is unavailable.
+    */
+    IO_URING,
+
+    /**
+      Non-blocking I/O (SocketNbioQueue), on every platform.
+    */
+    NBIO
+  };
+
 public:
   virtual ~SocketAioQueue() {
   }
@@ -55,11 +78,30 @@ public:
   */
   virtual bool associate(socket_t socket_) = 0;
 
+  /**
+    Dissociate a socket from this AioQueue.
+    Call this method before closing a socket that was associated, once no
+      AIO operation on the socket is pending.
+    The default implementation does nothing.
+  */
+  virtual bool dissociate(socket_t) {
+    return true;
+  }
+
 public:
   /**
     Create a platform-specific SocketAioQueue implementation.
+    @param implementation the implementation to create
+    @param trigger how a SocketNbioQueue associates sockets with its
+      FdEventQueue; ignored by the other implementations
+    @return the new SocketAioQueue
   */
-  static ::std::unique_ptr<SocketAioQueue> create();
+  static ::std::unique_ptr<SocketAioQueue>
+  create(
+    Implementation implementation = Implementation::DEFAULT,
+    ::yield::poll::FdEventQueue::Trigger trigger
+    = ::yield::poll::FdEventQueue::Trigger::LEVEL
+  );
 
 protected:
   template <class AiocbType> void log_completion(AiocbType& aiocb);
@@ -36,6 +36,11 @@ namespace sockets {
 class Socket;
 
 namespace aio {
+#ifdef __linux__
+namespace linux {
+class IoUringSocketAioQueue;
+}
+#endif
 #ifdef _WIN32
 namespace win32 {
 class Win32SocketAioQueue;
@@ -52,8 +57,11 @@ public:
     CONNECT,
     RECV,
     RECVFROM,
+    RECVMMSG,
     SEND,
-    SENDFILE
+    SENDFILE,
+    SENDMMSG,
+    SPLICE
   };
 
 public:
@@ -106,6 +114,9 @@ protected:
 
 protected:
   friend class SocketNbioQueue;
+#ifdef __linux__
+  friend class linux::IoUringSocketAioQueue;
+#endif
 #ifdef _WIN32
   friend class win32::Win32SocketAioQueue;
 #endif
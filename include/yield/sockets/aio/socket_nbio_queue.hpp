@@ -28,13 +28,19 @@
 #ifndef _YIELD_SOCKETS_AIO_SOCKET_NBIO_QUEUE_HPP_
 #define _YIELD_SOCKETS_AIO_SOCKET_NBIO_QUEUE_HPP_
 
+#include "yield/buffers.hpp"
 #include "yield/event_queue.hpp"
 #include "yield/poll/fd_event_queue.hpp"
 #include "yield/queue/blocking_concurrent_queue.hpp"
 #include "yield/sockets/aio/socket_aiocb.hpp"
 #include "yield/sockets/aio/socket_aio_queue.hpp"
+#include "yield/thread/mutex.hpp"
 
+#include <atomic>
+#include <deque>
 #include <map>
+#include <unordered_set>
+#include <vector>
 
 namespace yield {
 class Buffer;
@@ -45,8 +51,11 @@ class AcceptAiocb;
 class ConnectAiocb;
 class RecvAiocb;
 class RecvfromAiocb;
+class RecvmmsgAiocb;
 class SendAiocb;
 class SendfileAiocb;
+class SendmmsgAiocb;
+class SpliceAiocb;
 
 /**
   Queue for asynchronous input/output (AIO) operations on sockets,
@@ -55,6 +64,10 @@ class SendfileAiocb;
     AioQueue for platforms that do not natively support socket AIO (e.g., all
     platforms besides Win32). Even on Win32 the SocketNbioQueue is needed for socket
     types that only support blocking or non-blocking I/O, like SSL sockets.
+  The queue remembers which directions of a socket were last reported ready
+    and have not since would-blocked, and only retries aiocbs on those.
+  A SpliceAiocb waits for its socket to be readable and, if its descriptor
+    then would-block, moves to the descriptor's sends until it is writable.
   @see AioQueue
 */
 
@@ -62,18 +75,40 @@ class SocketNbioQueue final : public SocketAioQueue {
 public:
   /**
     Construct a SocketNbioQueue.
+    @param trigger how sockets are associated with the underlying FdEventQueue:
+      - Trigger::LEVEL associates a socket for the directions its pending
+        aiocbs want, modifying the association only when that set changes,
+        and dissociates it when nothing is pending.
+      - Trigger::EDGE associates a socket for both directions once, when it
+        is associated (or when it first would-block, if it never was), and
+        does not modify the association until the socket is dissociated.
+        A socket should be dissociated before it is closed. A socket that
+        reuses the descriptor of one that was not is associated again when
+        its first aiocb is enqueued.
+      - Trigger::ONESHOT re-arms a socket after each event while aiocbs are
+        pending, which lets several threads dequeue from the same queue.
   */
-  SocketNbioQueue();
+  SocketNbioQueue(
+    ::yield::poll::FdEventQueue::Trigger trigger
+    = ::yield::poll::FdEventQueue::Trigger::LEVEL
+  );
+
+  ~SocketNbioQueue();
 
 public:
   /**
     Associate a socket with this AioQueue.
-    This is a no-op in the SocketNbioQueue, intended only to conform to the interface
-      of the AioQueue on Win32.
+    With Trigger::EDGE this associates the socket with the underlying
+      FdEventQueue for the lifetime of the socket. It is a no-op otherwise.
   */
-  bool associate(socket_t) {
-    return true;
-  }
+  bool associate(socket_t socket_) override;
+
+  /**
+    Dissociate a socket from this AioQueue, before it is closed.
+    With Trigger::EDGE this dissociates the socket from the underlying
+      FdEventQueue. It is a no-op otherwise.
+  */
+  bool dissociate(socket_t socket_) override;
 
 public:
   // yield::EventQueue
@@ -93,17 +128,25 @@ public:
 private:
   class AiocbState;
 
+  // Readiness events harvested per epoll_wait and handed out from user space
+  const static size_t FD_EVENT_BATCH_SIZE = 256;
+
   enum class RetryStatus {
     COMPLETE,
     ERROR,
     WANT_RECV,
-    WANT_SEND
+    WANT_SEND,
+    // A SpliceAiocb has received data that its descriptor would block on
+    WANT_SEND_FD
   };
 
   class SocketState;
 
 private:
-  void associate(SocketAiocb& aiocb, RetryStatus retry_status);
+  void associate(::std::map<fd_t, SocketState*>::iterator socket_state_i);
+  void associate_splice_fds();
+  ::std::unique_ptr<SocketAiocb> pop_completed_aiocb();
+  void retry_ready(SocketState&);
 
 private:
   template <class AiocbType> void log_retry(AiocbType&);
@@ -112,24 +155,63 @@ private:
 
 private:
   static uint8_t get_aiocb_priority(const SocketAiocb& aiocb);
+  static uint8_t get_aiocb_priority(SocketAiocb::Type aiocb_type);
+  static RetryStatus get_aiocb_want(const SocketAiocb& aiocb);
+  static ::yield::poll::FdEvent::Type get_fd_event_type(RetryStatus);
 
 private:
-  RetryStatus retry(SocketAiocb&, size_t& partial_send_len);
+  RetryStatus
+  retry(
+    SocketAiocb&,
+    size_t& partial_send_len,
+    Buffers::WriteCursor& send_cursor
+  );
   RetryStatus retry_accept(AcceptAiocb&);
-  RetryStatus retry_connect(ConnectAiocb&, size_t& partial_send_len);
+  RetryStatus
+  retry_connect(
+    ConnectAiocb&,
+    size_t& partial_send_len,
+    Buffers::WriteCursor& send_cursor
+  );
   RetryStatus retry_recv(RecvAiocb&);
   RetryStatus retry_recvfrom(RecvfromAiocb&);
-  RetryStatus retry_send(SendAiocb&, size_t& partial_send_len);
+  RetryStatus retry_recvmmsg(RecvmmsgAiocb&);
+  RetryStatus
+  retry_send(
+    SendAiocb&,
+    size_t& partial_send_len,
+    Buffers::WriteCursor& send_cursor
+  );
   template <class AiocbType>
-  RetryStatus retry_send(AiocbType&, const Buffer&, size_t& partial_send_len);
+  RetryStatus
+  retry_send(
+    AiocbType&,
+    const Buffer&,
+    size_t& partial_send_len,
+    Buffers::WriteCursor& send_cursor
+  );
   RetryStatus retry_sendfile(SendfileAiocb&, size_t& partial_send_len);
+  RetryStatus retry_sendmmsg(SendmmsgAiocb&, size_t& partial_send_len);
+  RetryStatus retry_splice(SpliceAiocb&, size_t& partial_send_len);
   ::std::unique_ptr<SocketAiocb> timeddequeue_fd_event_queue(const Time&);
   ::std::unique_ptr<SocketAiocb> trydequeue_aiocb_queue();
 
 private:
   ::yield::queue::BlockingConcurrentQueue<SocketAiocb> aiocb_queue_;
+  ::std::deque< ::std::unique_ptr<SocketAiocb> > completed_aiocbs_;
   ::yield::poll::FdEventQueue fd_event_queue_;
+  // Trigger::EDGE associations, which outlive the SocketStates of their fds
+  ::std::unordered_set<fd_t> edge_associated_fds_;
   ::std::map<fd_t, SocketState*> socket_state_;
+  // SpliceAiocbs to wait on their descriptors, between a retry_ready and
+  // associate_splice_fds
+  ::std::vector<AiocbState*> splice_aiocb_states_;
+  // Guards completed_aiocbs_, edge_associated_fds_, socket_state_,
+  // splice_aiocb_states_ and fd_event_queue_ associations
+  ::yield::thread::Mutex socket_state_mutex_;
+  ::yield::poll::FdEventQueue::Trigger trigger_;
+  // tryenqueue also wakes fd_event_queue_; only wake() interrupts a dequeue
+  ::std::atomic<bool> woken_;
 };
 }
 }
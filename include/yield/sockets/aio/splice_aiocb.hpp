@@ -0,0 +1,136 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_SOCKETS_AIO_SPLICE_AIOCB_HPP_
+#define _YIELD_SOCKETS_AIO_SPLICE_AIOCB_HPP_
+
+#include "yield/unique_fd.hpp"
+#include "yield/sockets/aio/socket_aiocb.hpp"
+
+#include <memory>
+#include <ostream>
+
+namespace yield {
+class Buffer;
+
+namespace sockets {
+class StreamSocket;
+
+namespace aio {
+/**
+  AIO control block for moving data from a socket to another descriptor,
+    e.g. a socket or a pipe, as a proxy does.
+  Like a recv the operation completes as soon as it has moved some data:
+    return_() is then the number of bytes moved, all of them written to the
+    descriptor, or 0 at the end of the stream.
+  The SocketNbioQueue moves the data with splice(2) through a pipe on Linux,
+    so that it never enters user space, and with recv and write into an
+    intermediate buffer elsewhere. Other socket AIO queues refuse
+    SpliceAiocbs from tryenqueue.
+*/
+class SpliceAiocb : public SocketAiocb {
+public:
+  /**
+    The most bytes moved by one operation, the capacity of a default pipe.
+  */
+  const static size_t NBYTES_MAX = 65536;
+
+public:
+  /**
+    Construct a SpliceAiocb.
+    @param socket_ socket to receive data on
+    @param fd descriptor to write the data to, which must already be in
+      non-blocking mode and must stay open until the operation completes
+    @throw Exception if fd is not in non-blocking mode
+    @param nbytes the maximum number of bytes to move, at most NBYTES_MAX
+  */
+  SpliceAiocb(
+    ::std::shared_ptr<StreamSocket> socket_,
+    fd_t fd,
+    size_t nbytes = NBYTES_MAX
+  );
+
+  ~SpliceAiocb();
+
+public:
+  /**
+    Get the descriptor data is written to.
+    @return the descriptor data is written to
+  */
+  fd_t fd() const {
+    return fd_;
+  }
+
+  /**
+    Get the maximum number of bytes to move.
+    @return the maximum number of bytes to move
+  */
+  size_t nbytes() const {
+    return nbytes_;
+  }
+
+  /**
+    Get the socket data is received on.
+    @return the socket data is received on
+  */
+  StreamSocket& socket() override {
+    return *socket_;
+  }
+
+  Type type() const override {
+    return Type::SPLICE;
+  }
+
+private:
+  friend class SocketNbioQueue;
+
+  fd_t fd_;
+  size_t nbytes_;
+#ifdef __linux__
+  // Data received and not yet written sits in the pipe
+  unique_fd pipe_[2];
+#else
+  ::std::shared_ptr<Buffer> buffer_;
+#endif
+  // Bytes received from the socket, written to fd_ once partial_send_len
+  // reaches it
+  size_t recv_len_;
+  ::std::shared_ptr<StreamSocket> socket_;
+};
+
+/**
+  Print a string representation of a SpliceAiocb to a std::ostream.
+  @param os std::ostream to print to
+  @param splice_aiocb SpliceAiocb to print
+  @return os
+*/
+std::ostream& operator<<(std::ostream& os, const SpliceAiocb& splice_aiocb);
+}
+}
+}
+
+#endif
@@ -30,6 +30,8 @@
 
 #include "yield/sockets/socket.hpp"
 
+#include <memory>
+
 namespace yield {
 namespace sockets {
 /**
@@ -43,6 +45,11 @@ public:
   */
   const static int TYPE;
 
+  /**
+    The most datagrams one recvmmsg or sendmmsg call transfers.
+  */
+  const static size_t MMSG_VLEN_MAX = 64;
+
 public:
   /**
     Construct a DatagramSocket with the given domain.
@@ -59,6 +66,56 @@ public:
   virtual ~DatagramSocket() { }
 
 public:
+  /**
+    Read several datagrams from the socket, one into each buffer, also
+      recording each sender's address.
+    On Linux this is a single recvmmsg call; elsewhere recvfrom is called
+      until it would block.
+    With UdpSocket::Option::GRO set a buffer may receive several datagrams
+      from the same sender coalesced into one, each but the last of them
+      gro_segment_sizes[i] bytes long.
+    Updates the size of each buffer that receives a datagram.
+    @param buffers the single (unlinked) buffers to read datagrams into
+    @param buffers_len the number of buffers; at most MMSG_VLEN_MAX are
+      filled
+    @param flags flags altering the behavior of the underlying system call
+    @param[out] peernames the sender of each datagram, parallel to buffers
+    @param[out] gro_segment_sizes the segment size of each coalesced buffer,
+      else 0, parallel to buffers; may be NULL
+    @return the number of buffers filled on success, -1+errno on failure
+  */
+  virtual ssize_t
+  recvmmsg(
+    const ::std::shared_ptr<Buffer>* buffers,
+    size_t buffers_len,
+    const MessageFlags& flags,
+    SocketAddress* peernames,
+    uint16_t* gro_segment_sizes = NULL
+  );
+
+  /**
+    Write several datagrams to the socket, one from each buffer.
+    On Linux this is a single sendmmsg call; elsewhere sendto is called
+      until it would block.
+    @param buffers the single (unlinked) buffers to write datagrams from
+    @param buffers_len the number of buffers; at most MMSG_VLEN_MAX are
+      written
+    @param flags flags altering the behavior of the underlying system call
+    @param peernames the receiver of each datagram, parallel to buffers, or
+      NULL on a connected socket
+    @param gso_segment_size if not 0, the kernel splits each buffer into
+      datagrams of this many bytes (UDP GSO, Linux only)
+    @return the number of buffers written on success, -1+errno on failure
+  */
+  virtual ssize_t
+  sendmmsg(
+    const ::std::shared_ptr<Buffer>* buffers,
+    size_t buffers_len,
+    const MessageFlags& flags,
+    const SocketAddress* peernames,
+    uint16_t gso_segment_size = 0
+  );
+
   /**
     Write to the socket and a specific peer from multiple buffers (gather I/O).
     @param iov array of I/O vectors describing the buffers
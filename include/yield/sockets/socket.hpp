@@ -96,6 +96,8 @@ public:
   public:
     const static int RCVBUF;
     const static int REUSEADDR;
+    // SO_REUSEPORT where supported, else -1
+    const static int REUSEPORT;
     const static int SNDBUF;
   };
 
@@ -367,6 +369,7 @@ public:
     May be a send(const void*, size_t, const MessageFlags&) or a
       sendmsg(const iovec*, int, const MessageFlags&),
       depending on whether buffer is a single buffer or a linked list of them.
+    At most Buffers::WRITE_IOVECS_MAX buffers of a list are written per call.
     @param buffer the buffer to write from
     @param flags flags altering the behavior of the underlying system call
     @return the number of bytes written on success, -1+errno on failure
@@ -376,16 +379,15 @@ public:
       iovec iov = buffer.as_write_iovec();
       return send(iov.iov_base, iov.iov_len, flags);
     } else {
-      ::std::vector<iovec> iov;
-      Buffers::as_write_iovecs(buffer, iov);
-#ifdef _WIN32
-#pragma warning(push)
-#pragma warning(disable: 4365)
-#endif
-      return sendmsg(&iov[0], iov.size(), flags);
-#ifdef _WIN32
-#pragma warning(pop)
-#endif
+      iovec iov[Buffers::WRITE_IOVECS_MAX];
+      size_t iov_size;
+      int iovlen
+      = Buffers::WriteCursor(buffer).as_write_iovecs(
+          iov,
+          Buffers::WRITE_IOVECS_MAX,
+          iov_size
+        );
+      return sendmsg(iov, iovlen, flags);
     }
   }
 
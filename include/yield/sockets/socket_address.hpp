@@ -405,6 +405,17 @@ public:
     int flags = GETNAMEINFO_FLAG_NUMERICHOST | GETNAMEINFO_FLAG_NUMERICSERV
   ) const;
 
+public:
+  /**
+    Format the host part of this SocketAddress numerically e.g., as 127.0.0.1,
+      without going through getnameinfo.
+    Only the first address in the list is formatted.
+    @param[out] nodename the numeric host
+    @return true on success, false if the address is not an IPv4 or IPv6
+      address
+  */
+  bool ntop(::std::string& nodename) const;
+
 public:
   /**
     Get the length in bytes of the underlying platform-specific socket address.
@@ -31,72 +31,143 @@
 #define _YIELD_SOCKETS_SSL_SSL_CONTEXT_HPP_
 
 #include "yield/exception.hpp"
+#include "yield/time.hpp"
+#include "yield/sockets/ssl/ssl_session_cache.hpp"
 #include "yield/sockets/ssl/ssl_version.hpp"
 
+#include <memory>
+#include <string>
+
 #ifdef YIELD_HAVE_OPENSSL
 struct ssl_ctx_st;
 typedef ssl_ctx_st SSL_CTX;
-struct ssl_method_st;
-typedef ssl_method_st SSL_METHOD;
 #endif
 
 namespace yield {
 namespace sockets {
 #ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
-class SslContext : public Object {
+/**
+  An OpenSSL context (SSL_CTX): the protocol version, certificate and private
+    key shared by SslSockets.
+  SslSockets keep a shared_ptr to their context.
+  A server context does no session resumption by default. Resumption saves
+    reconnecting clients the full (public key) handshake, and can be enabled
+    with a session cache, session tickets or both.
+*/
+class SslContext final {
+public:
+  /**
+    Default interval between rotations of the session ticket key.
+  */
+  const static Time SESSION_TICKET_KEY_ROTATION_INTERVAL_DEFAULT;
+
 public:
+  /**
+    Construct an SslContext without a certificate, e.g. for clients.
+    @param ssl_version the protocol version(s) to speak
+  */
   SslContext(SslVersion ssl_version = SSL_VERSION_23) throw(Exception);
 
+  /**
+    Construct an SslContext with a certificate and private key, e.g. for
+      servers.
+    @param pem_certificate a PEM certificate or the path to a PEM
+      certificate file
+    @param pem_private_key a PEM private key or the path to a PEM private
+      key file
+    @param pem_private_key_passphrase the passphrase of the private key
+    @param ssl_version the protocol version(s) to speak
+  */
   SslContext(
-    const string& pem_certificate,
-    const string& pem_private_key,
-    const string& pem_private_key_passphrase,
+    const ::std::string& pem_certificate,
+    const ::std::string& pem_private_key,
+    const ::std::string& pem_private_key_passphrase,
     SslVersion ssl_version = SSL_VERSION_23
   ) throw(Exception);
 
+  SslContext(const SslContext&) = delete;
+  SslContext& operator=(const SslContext&) = delete;
+
   ~SslContext();
 
 public:
   operator SSL_CTX* () const {
-    return ctx;
+    return ctx_;
   }
 
 public:
-  // yield::Object
-  SslContext& inc_ref() {
-    return Object::inc_ref(*this);
-  }
+  /**
+    Cache server-side sessions in an SslSessionCache, which the threads
+      handshaking on this context share, instead of OpenSSL's internal cache
+      and its single lock.
+    Call before the context is shared with SslSockets.
+    @param capacity the maximum number of sessions to cache
+    @param shard_count the number of independently locked shards of the cache
+  */
+  void
+  enable_session_cache(
+    size_t capacity = SslSessionCache::CAPACITY_DEFAULT,
+    uint16_t shard_count = SslSessionCache::SHARD_COUNT_DEFAULT
+  ) throw(Exception);
 
-private:
-  void init(SslVersion ssl_version);
+  /**
+    Issue stateless session tickets, encrypted with a key that only exists in
+      memory and is replaced every key_rotation_interval.
+    Tickets under the previous key are still accepted, and renewed under the
+      current key, so that a rotation does not force every client back to a
+      full handshake at once.
+    Call before the context is shared with SslSockets.
+    @param key_rotation_interval the lifetime of a ticket key
+  */
+  void
+  enable_session_tickets(
+    const Time& key_rotation_interval
+    = SESSION_TICKET_KEY_ROTATION_INTERVAL_DEFAULT
+  ) throw(Exception);
+
+  /**
+    Get the session cache.
+    @return the session cache, NULL if it has not been enabled
+  */
+  SslSessionCache* session_cache() const {
+    return session_cache_.get();
+  }
 
 public:
-  static int pem_password_callback(char*, int, int, void*);
   void
   use_pem_certificate(
-    const string& pem_certificate
+    const ::std::string& pem_certificate
   ) throw(Exception);
 
   void
   use_pem_certificate_file(
-    const string& pem_certificate_file_path
+    const ::std::string& pem_certificate_file_path
   ) throw(Exception);
 
   void
   use_pem_private_key(
-    const string& pem_private_key,
-    const string& pem_private_key_passphrase
+    const ::std::string& pem_private_key,
+    const ::std::string& pem_private_key_passphrase
   ) throw(Exception);
 
   void
   use_pem_private_key_file(
-    const string& pem_private_key_file_path,
-    const string& pem_private_key_passphrase
+    const ::std::string& pem_private_key_file_path,
+    const ::std::string& pem_private_key_passphrase
   ) throw(Exception);
 
 private:
-  SSL_CTX* ctx;
+  class SessionTicketKeys;
+
+private:
+  void init(SslVersion ssl_version);
+  static int pem_password_callback(char*, int, int, void*);
+
+private:
+  SSL_CTX* ctx_;
+  ::std::unique_ptr<SslSessionCache> session_cache_;
+  ::std::unique_ptr<SessionTicketKeys> session_ticket_keys_;
 };
 }
 #endif
@@ -0,0 +1,129 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_SOCKETS_SSL_SSL_SESSION_CACHE_HPP_
+#define _YIELD_SOCKETS_SSL_SSL_SESSION_CACHE_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef YIELD_HAVE_OPENSSL
+struct ssl_session_st;
+typedef ssl_session_st SSL_SESSION;
+#endif
+
+namespace yield {
+namespace sockets {
+#ifdef YIELD_HAVE_OPENSSL
+namespace ssl {
+/**
+  A bounded cache of server-side TLS sessions, keyed by session ID, for
+    resuming the sessions of reconnecting clients without a full handshake.
+  The cache is split into shards by session ID, each with its own lock and
+    least recently used list, so that the threads handshaking on the
+    SslSockets of one SslContext rarely contend for it. A shard evicts its
+    least recently used session when it is full.
+  Expiry is left to OpenSSL, which checks the timeout of a session found
+    here before resuming it.
+*/
+class SslSessionCache final {
+public:
+  /**
+    Default maximum number of sessions to cache, across all shards.
+  */
+  const static size_t CAPACITY_DEFAULT = 20480;
+
+  /**
+    Default number of shards.
+  */
+  const static uint16_t SHARD_COUNT_DEFAULT = 16;
+
+public:
+  /**
+    Construct an empty SslSessionCache.
+    @param capacity the maximum number of sessions to cache, divided evenly
+      among the shards
+    @param shard_count the number of shards
+  */
+  SslSessionCache(
+    size_t capacity = CAPACITY_DEFAULT,
+    uint16_t shard_count = SHARD_COUNT_DEFAULT
+  );
+
+  SslSessionCache(const SslSessionCache&) = delete;
+  SslSessionCache& operator=(const SslSessionCache&) = delete;
+
+  /**
+    Release the cached sessions.
+  */
+  ~SslSessionCache();
+
+public:
+  /**
+    Remove a session from the cache, if present.
+    @param session_id the ID of the session
+    @param session_id_len the length of session_id
+  */
+  void erase(const unsigned char* session_id, size_t session_id_len);
+
+  /**
+    Look up a session and make it the most recently used of its shard.
+    @param session_id the ID of the session
+    @param session_id_len the length of session_id
+    @return a new reference to the session, which the caller must free, or
+      NULL if the session is not cached
+  */
+  SSL_SESSION* get(const unsigned char* session_id, size_t session_id_len);
+
+  /**
+    Add a session to the cache, replacing any session with the same ID.
+    @param session the session; the cache takes over the caller's reference
+  */
+  void put(SSL_SESSION* session);
+
+  /**
+    Get the number of sessions in the cache.
+    @return the number of sessions in the cache
+  */
+  size_t size();
+
+private:
+  class Shard;
+
+private:
+  Shard& get_shard(const ::std::string& session_id);
+
+private:
+  ::std::vector< ::std::unique_ptr<Shard> > shards_;
+};
+}
+#endif
+}
+}
+
+#endif
@@ -35,6 +35,8 @@
 #include "yield/sockets/ssl/ssl_context.hpp"
 #endif
 
+#include <memory>
+
 #ifdef YIELD_HAVE_OPENSSL
 struct ssl_st;
 typedef ssl_st SSL;
@@ -44,53 +46,107 @@ namespace yield {
 namespace sockets {
 #ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
+/**
+  A TLS connection over a TCP socket.
+  Reads and writes go through SSL_read and SSL_write, in blocking or
+    non-blocking mode. In non-blocking mode a call that cannot make progress
+    fails with EWOULDBLOCK, and want_recv or want_send tell which direction
+    the TLS layer is waiting on; a read may have to wait for the socket to
+    become writable and vice versa, e.g. in the middle of a handshake.
+  The handshake need not be done explicitly: the first read or write on an
+    accepted or connected socket drives it. This is how SocketNbioQueue runs
+    TLS connections, with the RecvAiocbs and SendAiocbs it already has.
+    Other SocketAioQueues operate on the descriptor directly and cannot
+    drive an SslSocket.
+  Where OpenSSL and the kernel support it, the negotiated keys are handed to
+    the kernel after the handshake (Linux kernel TLS): records sent are then
+    encrypted by the kernel, and sendfile is zero-copy as on a TcpSocket.
+    Otherwise sendfile reads the file through a buffer, because the data has
+    to be encrypted in userspace.
+*/
 class SslSocket : public TcpSocket {
 public:
-  SslSocket(int domain = DOMAIN_DEFAULT);
-  SslSocket(SslContext& ssl_context, int domain = DOMAIN_DEFAULT);
+  /**
+    Construct an SslSocket with a default SslContext, e.g. for clients.
+    @param domain the domain of the new socket
+  */
+  SslSocket(int domain = DOMAIN_DEFAULT) throw(Exception);
+
+  /**
+    Construct an SslSocket with the given SslContext. Sockets accepted from
+      the new socket share the context.
+    @param ssl_context the context, with a certificate and private key for
+      a server
+    @param domain the domain of the new socket
+  */
+  SslSocket(
+    ::std::shared_ptr<SslContext> ssl_context,
+    int domain = DOMAIN_DEFAULT
+  ) throw(Exception);
+
   ~SslSocket();
 
 public:
+  /**
+    Do (part of) the TLS handshake explicitly, rather than leaving it to the
+      first read or write.
+    @return true if the handshake is complete, false+errno if it failed or,
+      in non-blocking mode, would block
+  */
   bool do_handshake();
 
+  /**
+    Check whether the kernel encrypts the records sent on this socket, after
+      the handshake.
+    @return true if kernel TLS is in use for sending
+  */
+  bool ktls_send() const;
+
 public:
   operator SSL* () const {
-    return ssl;
+    return ssl_;
   }
 
 public:
+  using TcpSocket::recv;
+  using TcpSocket::recvmsg;
+  using TcpSocket::send;
+  using TcpSocket::sendmsg;
+
   // yield::sockets::Socket
-  bool connect(const SocketAddress& peername);
-  ssize_t recv(Buffer& buffer, const MessageFlags& flags);
-  ssize_t recvmsg(const iovec* iov, int iovlen, const MessageFlags& flags);
-  ssize_t recv(void* buf, size_t buflen, const MessageFlags&);
-  ssize_t send(const void* buf, size_t buflen, const MessageFlags&);
-  ssize_t sendmsg(const iovec* iov, int iovlen, const MessageFlags&);
-  bool shutdown(bool shut_rd = true, bool shut_wr = true);
-  bool want_recv() const;
-  bool want_send() const;
+  bool connect(const SocketAddress& peername) override;
+  ssize_t recv(void* buf, size_t buflen, const MessageFlags&) override;
+  ssize_t recvmsg(const iovec* iov, int iovlen, const MessageFlags&) override;
+  ssize_t send(const void* buf, size_t buflen, const MessageFlags&) override;
+  ssize_t sendmsg(const iovec* iov, int iovlen, const MessageFlags&) override;
+  bool want_recv() const override;
+  bool want_send() const override;
 
 public:
   // yield::sockets::StreamSocket
-  YO_NEW_REF SslSocket* accept();
-  YO_NEW_REF SslSocket* accept(SocketAddress& peername);
-  YO_NEW_REF SslSocket* dup();
-  bool listen();
+  ::std::unique_ptr<StreamSocket> dup() override;
+  ssize_t sendfile(fd_t fd, off_t offset, size_t nbytes) override;
+  bool shutdown(bool shut_rd = true, bool shut_wr = true) override;
 
-private:
-  SslSocket(int domain, socket_t socket_, SSL* ssl, SslContext& ssl_context);
+protected:
+  // yield::sockets::StreamSocket
+  ::std::unique_ptr<StreamSocket> dup2(socket_t socket_) override;
 
 private:
-  void init(SslContext& ssl_context);
-  void init(SSL* ssl);
+  SslSocket(
+    ::std::shared_ptr<SslContext> ssl_context,
+    int domain,
+    socket_t socket_
+  ) throw(Exception);
 
 private:
-  // yield::sockets::StreamSocket
-  YO_NEW_REF SslSocket* dup2(socket_t);
+  ssize_t check_ssl_ret(int ssl_ret);
+  void init();
 
 private:
-  SSL* ssl;
-  SslContext& ssl_context;
+  SSL* ssl_;
+  ::std::shared_ptr<SslContext> ssl_context_;
+  int ssl_error_; // Of the last SSL_* call, for want_recv and want_send
 };
 }
 #endif
@@ -33,6 +33,14 @@
 
 namespace yield {
 namespace sockets {
+#ifdef __linux__
+namespace aio {
+namespace linux {
+class IoUringSocketAioQueue;
+}
+}
+#endif
+
 /**
   A connection-oriented, stream-type socket.
 */
@@ -155,6 +163,9 @@ public:
 
 protected:
   friend class StreamSocketPair;
+#ifdef __linux__
+  friend class aio::linux::IoUringSocketAioQueue;
+#endif
 
   StreamSocket(int domain, int protocol, socket_t socket_)
     : Socket(domain, TYPE, protocol, socket_)
@@ -49,6 +49,20 @@ public:
   */
   const static int PROTOCOL;
 
+public:
+  /**
+    UDP-specific options for setsockopt.
+  */
+  class Option : public DatagramSocket::Option {
+  public:
+    /**
+      Receive datagrams from the same flow coalesced into one buffer (UDP
+        GRO), where supported, else -1.
+      @see DatagramSocket::recvmmsg
+    */
+    const static int GRO;
+  };
+
 public:
   /**
     Construct a UdpSocket with the given domain.
@@ -62,6 +76,10 @@ public:
     Empty virtual destructor.
   */
   virtual ~UdpSocket() { }
+
+public:
+  // yield::sockets::Socket
+  bool setsockopt(int option_name, int option_value) override;
 };
 }
 }
@@ -48,6 +48,8 @@ typedef intptr_t ssize_t;
 #include <unistd.h> // For ssize_t
 #endif
 #undef __XOPEN_OR_POSIX
+#else
+#include <sys/types.h> // For ssize_t
 #endif
 #endif
 
@@ -28,24 +28,122 @@
 #ifndef _YIELD_STAGE_SEDA_STAGE_SCHEDULER_HPP_
 #define _YIELD_STAGE_SEDA_STAGE_SCHEDULER_HPP_
 
+#include "yield/time.hpp"
 #include "yield/stage/stage_scheduler.hpp"
+#include "yield/thread/mutex.hpp"
 #include "yield/thread/thread.hpp"
 
+#include <list>
+#include <vector>
+
 namespace yield {
 namespace stage {
+/**
+  Stage scheduler that gives each stage its own pool of threads, in the
+    manner of Welsh, M., Culler, D. and Brewer, E. 2001. SEDA: an architecture
+    for well-conditioned, scalable internet services.
+
+  A controller thread samples every stage each CONTROL_INTERVAL and adds a
+    thread to a stage whose queue is longer than QUEUE_LENGTH_THRESHOLD or
+    whose offered load (Stage::rho) exceeds RHO_THRESHOLD per thread.
+    Threads beyond a stage's scheduled concurrency level retire after
+    IDLE_TIMEOUT without an event. The total number of threads across all
+    stages is capped by a thread budget.
+  Only stages scheduled with a maximum concurrency level above their
+    concurrency level are grown; the other stages keep a fixed number of
+    threads, as with the other schedulers.
+*/
 class SedaStageScheduler final : public StageScheduler {
 public:
+  /**
+    Interval between two samples of the stages by the controller.
+  */
+  const static Time CONTROL_INTERVAL;
+
+  /**
+    Time a thread added by the controller may go without an event before
+      it retires.
+  */
+  const static Time IDLE_TIMEOUT;
+
+  /**
+    Queue length above which a stage is given another thread.
+  */
+  const static uint64_t QUEUE_LENGTH_THRESHOLD = 32;
+
+  /**
+    Offered load per thread above which a stage is given another thread.
+  */
+  const static double RHO_THRESHOLD;
+
+public:
+  /**
+    Construct a scheduler with a default thread budget of four threads per
+      online logical processor.
+  */
+  SedaStageScheduler();
+
+  /**
+    Construct a scheduler with an explicit thread budget.
+    @param thread_budget maximum number of threads across all stages; the
+      concurrency levels passed to schedule are honored even beyond it
+  */
+  SedaStageScheduler(uint16_t thread_budget);
+
   virtual ~SedaStageScheduler();
 
+public:
+  /**
+    Get the number of threads currently servicing a stage.
+    @param stage a stage previously passed to schedule
+    @return the number of threads servicing the stage, 0 if not scheduled
+  */
+  uint16_t get_concurrency_level(const Stage& stage);
+
+  /**
+    Schedule a stage with a fixed minimum and maximum number of threads.
+    A stage whose event queue allows only one dequeuer at a time
+      (e.g., MpscEventQueue) must be scheduled with a maximum of 1.
+    @param stage the stage to schedule
+    @param concurrency_level the initial and minimum number of threads
+    @param max_concurrency_level the maximum number of threads
+  */
+  void
+  schedule(
+    ::std::shared_ptr<Stage> stage,
+    ConcurrencyLevel concurrency_level,
+    ConcurrencyLevel max_concurrency_level
+  );
+
 public:
   // StageScheduler
+  using StageScheduler::schedule;
+
+  /**
+    Schedule a stage with a fixed number of threads, which the controller
+      does not grow.
+    @param stage the stage to schedule
+    @param concurrency_level the number of threads
+  */
   void schedule(::std::shared_ptr<Stage>, ConcurrencyLevel) override;
 
 private:
+  class Controller;
   class SedaStage;
+  class SedaStageThread;
+
+private:
+  void add_thread(SedaStage&);
+  void control();
+  void init();
 
 private:
-  ::std::vector< ::std::unique_ptr< ::yield::thread::Thread > > threads;
+  ::std::unique_ptr< ::yield::thread::Thread > controller_thread_;
+  // Guards seda_stages_ and threads
+  ::yield::thread::Mutex mutex_;
+  ::std::vector< ::std::unique_ptr<SedaStage> > seda_stages_;
+  uint16_t thread_budget_;
+  ::std::list< ::std::unique_ptr< ::yield::thread::Thread > > threads;
 };
 }
 }
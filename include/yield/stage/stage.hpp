@@ -30,20 +30,65 @@
 
 #include "yield/time.hpp"
 
+#include <atomic>
+#include <cstddef>
+
 namespace yield {
 namespace stage {
 class Stage {
 public:
+  /**
+    Interface for schedulers that run a stage when events arrive on it,
+      rather than having threads wait on the stage's queue.
+  */
+  class Activator {
+  public:
+    virtual ~Activator() {
+    }
+
+  public:
+    /**
+      Called once for every event enqueued on the stage, on the enqueuing
+        thread.
+      @param stage the stage with a new event
+    */
+    virtual void activate(Stage& stage) = 0;
+  };
+
+public:
+  Stage() {
+    activator_ = NULL;
+  }
+
   virtual ~Stage() {
   }
 
+public:
+  void set_activator(Activator* activator) {
+    activator_ = activator;
+  }
+
 public:
   virtual double arrival_rate_s() const = 0;
+  virtual uint64_t event_queue_length() const = 0;
+  virtual Time interarrival_time_percentile(double percentile) const = 0;
   virtual double rho() const = 0;
   virtual double service_rate_s() const = 0;
+  virtual Time service_time_percentile(double percentile) const = 0;
 
   virtual void visit() = 0;
   virtual bool visit(const Time& timeout) = 0;
+
+protected:
+  void activate() {
+    Activator* activator = activator_;
+    if (activator != NULL) {
+      activator->activate(*this);
+    }
+  }
+
+private:
+  ::std::atomic<Activator*> activator_;
 };
 };
 };
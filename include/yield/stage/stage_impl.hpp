@@ -33,23 +33,30 @@
 #include "yield/event_sink.hpp"
 #include "yield/time.hpp"
 #include "yield/stage/stage.hpp"
+#include "yield/stage/stage_statistics.hpp"
 #include "yield/queue/synchronized_event_queue.hpp"
 
 namespace yield {
 namespace stage {
 template <class EventT>
 class StageImpl : public EventSink<EventT>, public Stage {
+public:
+  /**
+    Default maximum number of events dequeued and serviced by one visit.
+  */
+  const static size_t VISIT_BATCH_SIZE_DEFAULT = 32;
+
 public:
   StageImpl(::std::unique_ptr< EventHandler<EventT> > event_handler)
     : event_handler_(::std::move(event_handler)),
-      event_queue_(new ::yield::queue::SynchronizedEventQueue<EventT>) {
-    init();
+      event_queue_(new ::yield::queue::SynchronizedEventQueue<EventT>),
+      visit_batch_size_(VISIT_BATCH_SIZE_DEFAULT) {
   }
 
   StageImpl(::std::unique_ptr< EventHandler<EventT> > event_handler, ::std::unique_ptr< EventQueue<EventT> > event_queue)
     : event_handler_(::std::move(event_handler)),
-      event_queue_(::std::move(event_queue)) {
-    init();
+      event_queue_(::std::move(event_queue)),
+      visit_batch_size_(VISIT_BATCH_SIZE_DEFAULT) {
   }
 
   virtual ~StageImpl() {
@@ -57,7 +64,7 @@ public:
 
 public:
   double arrival_rate_s() const {
-    return arrival_rate_s_;
+    return statistics_.arrival_rate_s();
   }
 
   EventHandler<EventT>& event_handler() {
@@ -68,56 +75,60 @@ public:
     return *event_queue_;
   }
 
-  double rho() const {
-    return rho_;
+  uint64_t event_queue_length() const {
+    return statistics_.event_queue_length();
   }
 
-  double service_rate_s() const {
-    return service_rate_s_;
+  Time interarrival_time_percentile(double percentile) const {
+    return statistics_.interarrival_time_percentile(percentile);
   }
 
-  ::std::unique_ptr<EventT> tryenqueue(::std::unique_ptr<EventT> event) override {
-    event_queue_length_++;
-    event_queue_arrival_count_++;
-    return event_queue_->tryenqueue(::std::move(event));
+  double rho() const {
+    return statistics_.rho();
   }
 
-  void visit() {
-    ::std::unique_ptr<EventT> event = event_queue_->dequeue();
-    if (event == NULL) {
-      return;
-    }
-
-    event_queue_length_--;
+  double service_rate_s() const {
+    return statistics_.service_rate_s();
+  }
 
-    Time service_time_start(Time::now());
+  /**
+    Set the maximum number of events dequeued and serviced by one visit,
+      1 to service events one at a time.
+    @param visit_batch_size the maximum batch size, at least 1
+  */
+  void set_visit_batch_size(size_t visit_batch_size) {
+    visit_batch_size_ = visit_batch_size;
+  }
 
-    service(::std::move(event));
+  Time service_time_percentile(double percentile) const {
+    return statistics_.service_time_percentile(percentile);
+  }
 
-    Time service_time(Time::now() - service_time_start);
+  StageStatistics& statistics() {
+    return statistics_;
   }
 
-  bool visit(const Time& timeout) {
-    ::std::unique_ptr<EventT> event = event_queue_->timeddequeue(timeout);
+  ::std::unique_ptr<EventT> tryenqueue(::std::unique_ptr<EventT> event) override {
+    event = event_queue_->tryenqueue(::std::move(event));
     if (event == NULL) {
-      return false;
+      statistics_.arrival();
+      activate();
     }
+    return event;
+  }
 
-    event_queue_length_--;
-
-    Time service_time_start(Time::now());
-
-    service(::std::move(event));
-
-    Time service_time(Time::now() - service_time_start);
+  void visit() {
+    visit_batch(Time::FOREVER);
+  }
 
-    return true;
+  bool visit(const Time& timeout) {
+    return visit_batch(timeout);
   }
 
 protected:
   StageImpl(::std::unique_ptr< EventQueue<EventT> > event_queue)
-    : event_queue_(::std::move(event_queue)) {
-    init();
+    : event_queue_(::std::move(event_queue)),
+      visit_batch_size_(VISIT_BATCH_SIZE_DEFAULT) {
   }
 
   EventQueue<EventT>& get_event_queue() {
@@ -125,23 +136,44 @@ protected:
   }
 
 private:
-  void init() {
-    event_queue_arrival_count_ = 0;
-    event_queue_length_ = 0;
+  virtual void service(::std::vector< ::std::unique_ptr<EventT> >& events) {
+    event_handler_->handle_batch(events);
   }
 
-  virtual void service(::std::unique_ptr<EventT> event) {
-    event_handler_->handle(::std::move(event));
+  bool visit_batch(const Time& timeout) {
+    // Reuse this thread's vector across visits; a nested visit on the same
+    // thread finds it taken and starts a fresh one
+    static thread_local ::std::vector< ::std::unique_ptr<EventT> > events_cache;
+    ::std::vector< ::std::unique_ptr<EventT> > events;
+    events.swap(events_cache);
+
+    size_t events_count
+    = event_queue_->dequeue_batch(timeout, visit_batch_size_, events);
+    if (events_count == 0) {
+      statistics_.update(Time::now());
+    } else {
+      Time service_time_start(Time::now());
+
+      service(events);
+
+      Time service_time_end(Time::now());
+      statistics_.service(
+        service_time_end - service_time_start,
+        static_cast<uint32_t>(events_count)
+      );
+      statistics_.update(service_time_end);
+    }
+
+    events.clear();
+    events.swap(events_cache);
+    return events_count > 0;
   }
 
 private:
-  double arrival_rate_s_;
   ::std::unique_ptr< EventHandler<EventT> > event_handler_;
   ::std::unique_ptr< EventQueue<EventT> > event_queue_;
-  uint32_t event_queue_arrival_count_, event_queue_length_;
-  double rho_;
-  double service_rate_s_;
-  // Sampler<uint64_t, 1024, Mutex> service_times;
+  StageStatistics statistics_;
+  size_t visit_batch_size_;
 };
 }
 }
@@ -0,0 +1,199 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_STAGE_STAGE_STATISTICS_HPP_
+#define _YIELD_STAGE_STAGE_STATISTICS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "yield/time.hpp"
+
+namespace yield {
+namespace stage {
+/**
+  Queueing statistics of a stage: arrival rate (lambda), service rate (mu),
+    offered load (rho = lambda / mu) and percentiles of service times and
+    interarrival gaps.
+
+  Arrivals and services are recorded on striped counters, so concurrent
+    producers and consumers rarely touch the same cache line. Interarrival
+    gaps are sampled on each stripe: one gap between consecutive arrivals
+    on the stripe is timed in every INTERARRIVAL_SAMPLING, so that most
+    arrivals neither read the clock nor touch the shared histogram. Rates are
+    exponentially weighted moving averages and the histograms are decayed
+    with the same half-life; both are refreshed at most once per
+    UPDATE_INTERVAL by whichever thread calls update() first.
+*/
+class StageStatistics {
+public:
+  /**
+    Half-life of the moving averages and histogram weights.
+  */
+  const static Time HALF_LIFE;
+
+  /**
+    Minimum interval between two refreshes of the published statistics.
+  */
+  const static Time UPDATE_INTERVAL;
+
+  /**
+    Number of arrivals on a stripe per timed interarrival gap.
+  */
+  const static uint64_t INTERARRIVAL_SAMPLING = 16;
+
+public:
+  StageStatistics();
+
+public:
+  /**
+    Record the arrival of an event on the stage's queue.
+  */
+  void arrival();
+
+  /**
+    Record the servicing of one or more events.
+    @param service_time time spent servicing the events
+    @param events_count number of events serviced in service_time
+  */
+  void service(const Time& service_time, uint32_t events_count = 1);
+
+  /**
+    Refresh the published statistics if UPDATE_INTERVAL has passed since
+      the last refresh.
+    @param now the current time
+  */
+  void update(const Time& now);
+
+public:
+  /**
+    Get the decayed mean rate of arrivals.
+    @return arrivals per second
+  */
+  double arrival_rate_s() const {
+    return arrival_rate_s_.load(::std::memory_order_relaxed);
+  }
+
+  /**
+    Get the number of events that have arrived but not been serviced yet.
+    @return the number of queued or in-service events
+  */
+  uint64_t event_queue_length() const;
+
+  /**
+    Get a percentile of the decayed distribution of sampled gaps between
+      arrivals.
+    @param percentile between 0 and 1, e.g. 0.99
+    @return the approximate gap, or 0 if there have been no arrivals
+  */
+  Time interarrival_time_percentile(double percentile) const {
+    return interarrival_times_.percentile(percentile);
+  }
+
+  /**
+    Get the offered load, the ratio of arrival rate to service rate.
+    Above 1 per servicing thread, the stage's queue grows without bound.
+    @return the offered load
+  */
+  double rho() const {
+    return rho_.load(::std::memory_order_relaxed);
+  }
+
+  /**
+    Get the rate at which one thread services events, the inverse of the
+      decayed mean service time.
+    @return services per second
+  */
+  double service_rate_s() const {
+    return service_rate_s_.load(::std::memory_order_relaxed);
+  }
+
+  /**
+    Get a percentile of the decayed distribution of service times.
+    @param percentile between 0 and 1, e.g. 0.99
+    @return the approximate service time, or 0 if nothing has been serviced
+  */
+  Time service_time_percentile(double percentile) const {
+    return service_times_.percentile(percentile);
+  }
+
+private:
+  // Log-linear histogram of nanosecond values: four sub-buckets per power
+  // of two, i.e. within 25% of the recorded value
+  class Histogram {
+  public:
+    Histogram();
+
+  public:
+    void decay(double factor);
+    Time percentile(double percentile) const;
+    void record(uint64_t ns, uint32_t samples_count);
+
+  private:
+    const static size_t BUCKETS = 252;
+    // Weight of one sample, so that decayed weights keep some precision
+    const static uint64_t SAMPLE_WEIGHT = 256;
+
+  private:
+    ::std::atomic<uint64_t> buckets_[BUCKETS];
+  };
+
+  // Counters of one stripe, padded to their own cache line
+  struct Stripe {
+    ::std::atomic<uint64_t> arrivals;
+    // Time of the arrival that starts the stripe's current sampled gap
+    ::std::atomic<uint64_t> sampled_arrival_ns;
+    ::std::atomic<uint64_t> services;
+    ::std::atomic<uint64_t> service_ns;
+    char pad[64 - 4 * sizeof(::std::atomic<uint64_t>)];
+  };
+
+private:
+  static size_t get_stripe_i();
+
+private:
+  const static size_t STRIPES = 16;
+
+private:
+  ::std::atomic<double> arrival_rate_s_;
+  Histogram interarrival_times_;
+  ::std::atomic<uint64_t> last_update_ns_;
+  ::std::atomic<double> rho_;
+  ::std::atomic<double> service_rate_s_;
+  Histogram service_times_;
+  Stripe stripes_[STRIPES];
+
+  // Owned by the thread that won the update
+  uint64_t updated_arrivals_, updated_services_, updated_service_ns_;
+  uint32_t updates_;
+  double services_ewma_, service_ns_ewma_;
+};
+}
+}
+
+#endif
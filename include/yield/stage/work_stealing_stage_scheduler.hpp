@@ -0,0 +1,108 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_STAGE_WORK_STEALING_STAGE_SCHEDULER_HPP_
+#define _YIELD_STAGE_WORK_STEALING_STAGE_SCHEDULER_HPP_
+
+#include "yield/stage/stage.hpp"
+#include "yield/stage/stage_scheduler.hpp"
+#include "yield/thread/condition_variable.hpp"
+#include "yield/thread/mutex.hpp"
+#include "yield/thread/thread.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace yield {
+namespace stage {
+/**
+  Stage scheduler that runs stage activations on a fixed set of worker
+    threads, one per logical processor by default.
+
+  Every event enqueued on a scheduled stage becomes an activation of that
+    stage. An event enqueued from a worker (i.e., by a stage's event handler)
+    is activated on that worker's own deque, so the next stage usually runs
+    on the same core with the event still in its cache; events from other
+    threads are spread over the workers. A worker runs its newest activation
+    first and, when its deque is empty, steals the oldest activation of
+    another worker before going idle.
+
+  Any worker may visit any stage, so a stage's event queue must allow
+    concurrent dequeues (i.e., not MpscEventQueue).
+*/
+class WorkStealingStageScheduler final
+  : public StageScheduler,
+    private Stage::Activator {
+public:
+  /**
+    Construct a scheduler with one worker per online logical processor,
+      each bound to its processor.
+  */
+  WorkStealingStageScheduler();
+
+  /**
+    Construct a scheduler with an explicit number of unbound workers.
+    @param workers_count number of worker threads
+  */
+  WorkStealingStageScheduler(uint16_t workers_count);
+
+  ~WorkStealingStageScheduler();
+
+public:
+  // StageScheduler
+  using StageScheduler::schedule;
+  // The concurrency level is ignored: every worker serves every stage
+  void schedule(::std::shared_ptr<Stage>, ConcurrencyLevel) override;
+
+private:
+  class Worker;
+
+private:
+  // Stage::Activator
+  void activate(Stage& stage) override;
+
+private:
+  bool has_activations() const;
+  void init(uint16_t workers_count, bool setaffinity);
+  void wait(Worker&);
+
+private:
+  ::yield::thread::ConditionVariable idle_cond_;
+  ::std::atomic<uint32_t> idle_workers_count_;
+  ::std::atomic<uint32_t> next_worker_i_;
+  ::std::vector< ::std::shared_ptr<Stage> > stages_;
+  // Guards stages_
+  ::yield::thread::Mutex stages_mutex_;
+  ::std::vector< ::std::unique_ptr< ::yield::thread::Thread > > threads_;
+  // Owned by threads_
+  ::std::vector<Worker*> workers_;
+};
+}
+}
+
+#endif
@@ -191,6 +191,7 @@ private:
   unsigned long id;
 #else
   pthread_t pthread;
+  bool joinable_; // Started by this Thread and not yet joined
 #if defined(__linux__)
   pid_t tid;
 #elif defined(__sun)
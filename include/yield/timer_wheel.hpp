@@ -0,0 +1,135 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_TIMER_WHEEL_HPP_
+#define _YIELD_TIMER_WHEEL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "yield/time.hpp"
+
+namespace yield {
+/**
+  A hierarchical timing wheel of opaque timer ids.
+  Inserting a timer is O(1). Advancing the wheel costs O(1) per elapsed tick,
+    plus the work of expiring timers and of cascading them from a coarser
+    level into a finer one, so that hundreds of thousands of timers can be
+    kept without a heap.
+  Timers cannot be cancelled: the owner of a timer id is expected to recheck
+    its own deadline when the id expires, to insert the id again if the
+    deadline has moved, and to ignore ids it no longer recognizes.
+  Not thread-safe.
+*/
+class TimerWheel final {
+public:
+  /**
+    Number of levels in the wheel. Each level is coarser than the one below
+      it by a factor of LEVEL_SLOTS.
+  */
+  const static uint8_t LEVELS = 4;
+
+  /**
+    Number of slots in each level.
+  */
+  const static uint16_t LEVEL_SLOTS = 64;
+
+public:
+  /**
+    Construct an empty TimerWheel.
+    @param tick the granularity of the wheel; deadlines are rounded up
+      to the next tick
+    @param now the current time, from which ticks are counted
+  */
+  TimerWheel(const Time& tick, const Time& now);
+
+public:
+  /**
+    Advance the wheel to the given time, collecting the ids of the timers
+      whose deadlines have passed.
+    @param now the current time
+    @param[out] expired_timer_ids vector to append the expired timer ids to
+  */
+  void advance(const Time& now, ::std::vector<uint64_t>& expired_timer_ids);
+
+  /**
+    Check if the wheel has no timers.
+    @return true if the wheel has no timers
+  */
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  /**
+    Insert a timer.
+    A deadline further out than LEVEL_SLOTS ^ LEVELS ticks may expire early,
+      at the end of the wheel's range.
+    @param timer_id an id chosen by the caller, returned by advance
+      when the timer expires
+    @param deadline the time at which the timer expires
+  */
+  void insert(uint64_t timer_id, const Time& deadline);
+
+  /**
+    Get the number of timers in the wheel.
+    @return the number of timers in the wheel
+  */
+  size_t size() const {
+    return size_;
+  }
+
+  /**
+    Get the granularity of the wheel.
+    @return the granularity of the wheel
+  */
+  const Time& tick() const {
+    return tick_;
+  }
+
+private:
+  const static uint8_t LEVEL_SLOTS_BITS = 6;
+
+  struct Timer {
+    uint64_t deadline_tick;
+    uint64_t id;
+  };
+
+private:
+  void cascade(uint8_t level);
+  void place(const Timer& timer);
+
+private:
+  uint64_t current_tick_;
+  Time origin_;
+  size_t size_;
+  ::std::vector<Timer> slots_[LEVELS][LEVEL_SLOTS];
+  Time tick_;
+};
+}
+
+#endif
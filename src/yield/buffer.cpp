@@ -26,6 +26,7 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -97,7 +98,7 @@ Buffer::copy(
   const void* data,
   size_t size
 ) {
-  ::std::shared_ptr<Buffer> buffer = ::std::make_shared<Buffer>(alignment, capacity);
+  ::std::shared_ptr<Buffer> buffer = BufferPool::get(alignment, capacity);
   memcpy_s(*buffer, buffer->capacity(), data, size);
   buffer->size_ = size;
   return buffer;
@@ -0,0 +1,342 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/buffer_pool.hpp"
+
+#include <mutex>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <stdlib.h>
+#endif
+
+namespace yield {
+using ::std::shared_ptr;
+
+namespace {
+// Bytes of blocks a thread keeps cached per size class before spilling half
+// of them to the depot.
+const size_t THREAD_CACHE_BYTES_MAX = 256 * 1024;
+// Bytes of blocks the depot keeps per size class before freeing.
+const size_t DEPOT_BYTES_MAX = 16 * 1024 * 1024;
+// Large enough for a PooledBuffer and its shared_ptr control block.
+const size_t HEADER_BLOCK_SIZE = 128;
+const size_t HEADER_BLOCK_ALIGNMENT = 64;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  FreeList() : count(0), head(NULL) {
+  }
+
+  void* pop() {
+    FreeBlock* block = head;
+    head = block->next;
+    --count;
+    return block;
+  }
+
+  void push(void* block) {
+    FreeBlock* free_block = static_cast<FreeBlock*>(block);
+    free_block->next = head;
+    head = free_block;
+    ++count;
+  }
+
+  size_t count;
+  FreeBlock* head;
+};
+}
+
+class BufferPool::Depot {
+public:
+  void* acquire(SizeClass size_class, FreeList& into, size_t count) {
+    ::std::lock_guard< ::std::mutex > lock(mutex_);
+    FreeList& free_list = free_lists_[size_class];
+    while (count-- > 1 && free_list.count > 1) {
+      into.push(free_list.pop());
+    }
+    return free_list.count > 0 ? free_list.pop() : NULL;
+  }
+
+  void release(SizeClass size_class, void* block) {
+    {
+      ::std::lock_guard< ::std::mutex > lock(mutex_);
+      FreeList& free_list = free_lists_[size_class];
+      if (free_list.count * get_block_size(size_class) < DEPOT_BYTES_MAX) {
+        free_list.push(block);
+        return;
+      }
+    }
+    free_block(block);
+  }
+
+  void release(SizeClass size_class, FreeList& from, size_t count) {
+    ::std::lock_guard< ::std::mutex > lock(mutex_);
+    FreeList& free_list = free_lists_[size_class];
+    while (count-- > 0 && from.count > 0) {
+      if (free_list.count * get_block_size(size_class) < DEPOT_BYTES_MAX) {
+        free_list.push(from.pop());
+      } else {
+        free_block(from.pop());
+      }
+    }
+  }
+
+public:
+  static void free_block(void* block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+  }
+
+private:
+  FreeList free_lists_[SIZE_CLASS_COUNT];
+  ::std::mutex mutex_;
+};
+
+class BufferPool::ThreadCache {
+public:
+  ~ThreadCache() {
+    trim();
+    destroyed = true;
+  }
+
+public:
+  void* acquire(SizeClass size_class) {
+    FreeList& free_list = free_lists_[size_class];
+    if (free_list.count > 0) {
+      return free_list.pop();
+    } else {
+      return get_depot().acquire(
+               size_class,
+               free_list,
+               get_count_max(size_class) / 2
+             );
+    }
+  }
+
+  void release(SizeClass size_class, void* block) {
+    FreeList& free_list = free_lists_[size_class];
+    free_list.push(block);
+    size_t count_max = get_count_max(size_class);
+    if (free_list.count > count_max) {
+      get_depot().release(size_class, free_list, count_max / 2);
+    }
+  }
+
+  void trim() {
+    for (int size_class = 0; size_class < SIZE_CLASS_COUNT; ++size_class) {
+      FreeList& free_list = free_lists_[size_class];
+      get_depot().release(
+        static_cast<SizeClass>(size_class),
+        free_list,
+        free_list.count
+      );
+    }
+  }
+
+public:
+  static ThreadCache* get() {
+    if (destroyed) {
+      // Buffers released by other thread_local destructors after this
+      // thread's cache has been flushed go straight to the depot.
+      return NULL;
+    } else {
+      static thread_local ThreadCache thread_cache;
+      return &thread_cache;
+    }
+  }
+
+  static Depot& get_depot() {
+    // Leaked so that Buffers released during static destruction are safe.
+    static Depot* depot = new Depot;
+    return *depot;
+  }
+
+private:
+  static size_t get_count_max(SizeClass size_class) {
+    size_t count_max = THREAD_CACHE_BYTES_MAX / get_block_size(size_class);
+    return count_max >= 4 ? count_max : 4;
+  }
+
+private:
+  static thread_local bool destroyed;
+
+private:
+  FreeList free_lists_[SIZE_CLASS_COUNT];
+};
+
+thread_local bool BufferPool::ThreadCache::destroyed = false;
+
+class BufferPool::PooledBuffer : public Buffer {
+public:
+  PooledBuffer(size_t capacity, SizeClass size_class, void* data)
+    : Buffer(capacity, data, 0),
+      size_class_(size_class) {
+  }
+
+  ~PooledBuffer() {
+    release(size_class_, data_);
+    data_ = NULL;
+  }
+
+private:
+  SizeClass size_class_;
+};
+
+template <class T>
+class BufferPool::Allocator {
+public:
+  typedef T value_type;
+
+public:
+  Allocator() {
+  }
+
+  template <class U>
+  Allocator(const Allocator<U>&) {
+  }
+
+public:
+  T* allocate(size_t n) {
+    if (n * sizeof(T) <= HEADER_BLOCK_SIZE) {
+      return static_cast<T*>(BufferPool::acquire(SIZE_CLASS_HEADER));
+    } else {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (n * sizeof(T) <= HEADER_BLOCK_SIZE) {
+      BufferPool::release(SIZE_CLASS_HEADER, p);
+    } else {
+      ::operator delete(p);
+    }
+  }
+
+public:
+  template <class U>
+  bool operator==(const Allocator<U>&) const {
+    return true;
+  }
+
+  template <class U>
+  bool operator!=(const Allocator<U>&) const {
+    return false;
+  }
+};
+
+void* BufferPool::acquire(SizeClass size_class) {
+  void* block = NULL;
+  ThreadCache* thread_cache = ThreadCache::get();
+  if (thread_cache != NULL) {
+    block = thread_cache->acquire(size_class);
+  } else {
+    FreeList unused;
+    block = ThreadCache::get_depot().acquire(size_class, unused, 1);
+  }
+
+  if (block == NULL) {
+    size_t alignment
+    = size_class == SIZE_CLASS_HEADER
+      ? HEADER_BLOCK_ALIGNMENT : Buffer::getpagesize();
+#ifdef _WIN32
+    if (
+      (block = _aligned_malloc(get_block_size(size_class), alignment))
+      ==
+      NULL
+    )
+#else
+    if (posix_memalign(&block, alignment, get_block_size(size_class)) != 0)
+#endif
+      throw ::std::bad_alloc();
+  }
+
+  return block;
+}
+
+shared_ptr<Buffer> BufferPool::get(size_t alignment, size_t capacity) {
+  SizeClass size_class;
+  if (alignment > Buffer::getpagesize() || capacity > CAPACITY_MAX) {
+    return ::std::make_shared<Buffer>(alignment, capacity);
+  } else if (capacity <= Buffer::getpagesize()) {
+    size_class = SIZE_CLASS_PAGE;
+  } else if (capacity <= 16 * 1024) {
+    size_class = SIZE_CLASS_16K;
+  } else {
+    size_class = SIZE_CLASS_64K;
+  }
+
+  void* data = acquire(size_class);
+  try {
+    return ::std::allocate_shared<PooledBuffer>(
+             Allocator<PooledBuffer>(),
+             capacity,
+             size_class,
+             data
+           );
+  } catch (const ::std::bad_alloc&) {
+    release(size_class, data);
+    throw;
+  }
+}
+
+size_t BufferPool::get_block_size(SizeClass size_class) {
+  switch (size_class) {
+  case SIZE_CLASS_HEADER:
+    return HEADER_BLOCK_SIZE;
+  case SIZE_CLASS_PAGE:
+    return Buffer::getpagesize();
+  case SIZE_CLASS_16K:
+    return 16 * 1024;
+  default:
+    return CAPACITY_MAX;
+  }
+}
+
+void BufferPool::release(SizeClass size_class, void* block) {
+  ThreadCache* thread_cache = ThreadCache::get();
+  if (thread_cache != NULL) {
+    thread_cache->release(size_class, block);
+  } else {
+    ThreadCache::get_depot().release(size_class, block);
+  }
+}
+
+void BufferPool::trim() {
+  ThreadCache* thread_cache = ThreadCache::get();
+  if (thread_cache != NULL) {
+    thread_cache->trim();
+  }
+}
+}
@@ -32,6 +32,8 @@
 namespace yield {
 using ::std::vector;
 
+const int Buffers::WRITE_IOVECS_MAX;
+
 void
 Buffers::as_read_iovecs(
   Buffer& buffers,
@@ -99,6 +101,62 @@ Buffers::as_write_iovecs(
   return ret;
 }
 
+void Buffers::WriteCursor::advance(size_t size) {
+  while (buffer_ != NULL) {
+    size_t buffer_left = buffer_->size() - offset_;
+    if (size < buffer_left) {
+      offset_ += size;
+      return;
+    }
+
+    size -= buffer_left;
+    buffer_ = buffer_->next_buffer().get();
+    offset_ = 0;
+    skip_empty();
+  }
+
+  CHECK_EQ(size, 0);
+}
+
+int
+Buffers::WriteCursor::as_write_iovecs(
+  iovec* write_iovecs,
+  int write_iovecs_max,
+  size_t& size
+) const {
+  int write_iovecs_len = 0;
+  size = 0;
+
+  const Buffer* next_buffer = buffer_;
+  size_t offset = offset_;
+  while (next_buffer != NULL && write_iovecs_len < write_iovecs_max) {
+    iovec write_iovec = next_buffer->as_write_iovec();
+    if (write_iovec.iov_len > offset) {
+      write_iovec.iov_base = static_cast<char*>(write_iovec.iov_base) + offset;
+      write_iovec.iov_len -= offset;
+      size += write_iovec.iov_len;
+      write_iovecs[write_iovecs_len++] = write_iovec;
+    }
+    next_buffer = next_buffer->next_buffer().get();
+    offset = 0;
+  }
+
+  return write_iovecs_len;
+}
+
+void Buffers::WriteCursor::reset(const Buffer& buffers) {
+  buffer_ = &buffers;
+  offset_ = 0;
+  skip_empty();
+}
+
+void Buffers::WriteCursor::skip_empty() {
+  while (buffer_ != NULL && buffer_->size() == offset_) {
+    buffer_ = buffer_->next_buffer().get();
+    offset_ = 0;
+  }
+}
+
 void Buffers::put(Buffer& buffers, const void* data, size_t size) {
   CHECK_EQ(data, NULL);
 
@@ -0,0 +1,95 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef _YIELD_FS_POLL_ASSOCIATE_DIRECTORY_TREE_HPP_
+#define _YIELD_FS_POLL_ASSOCIATE_DIRECTORY_TREE_HPP_
+
+#include "yield/fs/file_system.hpp"
+#include "yield/fs/poll/fs_event.hpp"
+
+#include <errno.h>
+
+namespace yield {
+namespace fs {
+namespace poll {
+/**
+  Associate a directory and every directory under it with an FsEventQueue
+    implementation, reading each directory once.
+  Symbolic links are not followed. Subdirectories that disappear during the
+    walk (ENOENT) or that alias an already-watched directory (EEXIST) are
+    skipped.
+  @param fs_event_queue the FsEventQueue implementation to associate with
+  @param path path to the root of the directory tree
+  @param fs_event_types FsEvent types to monitor
+  @return true on success, false+errno on failure
+*/
+template <class FsEventQueueType>
+bool
+associate_directory_tree(
+  FsEventQueueType& fs_event_queue,
+  const Path& path,
+  FsEvent::Type fs_event_types
+) {
+  if (!fs_event_queue.associate(path, fs_event_types)) {
+    return false;
+  }
+
+  ::std::unique_ptr<Directory> directory = FileSystem().opendir(path);
+  if (directory == NULL) {
+    return false;
+  }
+
+  ::std::unique_ptr<Directory::Entry> dentry = directory->read();
+  if (dentry != NULL) {
+    do {
+      if (dentry->is_special() || !dentry->ISDIR()) {
+        continue;
+      }
+
+      if (
+        !associate_directory_tree(
+          fs_event_queue,
+          path / dentry->name(),
+          fs_event_types
+        )
+      ) {
+        if (errno == ENOENT || errno == EEXIST) {
+          continue;
+        } else {
+          return false;
+        }
+      }
+    } while (directory->read(*dentry));
+  }
+
+  return true;
+}
+}
+}
+}
+
+#endif
@@ -26,6 +26,7 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "directory_watch.hpp"
+#include "../associate_directory_tree.hpp"
 #include "file_watch.hpp"
 #include "../watches.hpp"
 #include "yield/exception.hpp"
@@ -126,6 +127,14 @@ FsEventQueue::associate(
   return false;
 }
 
+bool
+FsEventQueue::associate_tree(
+  const Path& path,
+  FsEvent::Type fs_event_types
+) {
+  return associate_directory_tree(*this, path, fs_event_types);
+}
+
 bool FsEventQueue::dissociate(const Path& path) {
   bsd::Watch* watch = watches->erase(path);
   if (watch != NULL) {
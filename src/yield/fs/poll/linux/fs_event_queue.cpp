@@ -26,6 +26,7 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "watches.hpp"
+#include "../associate_directory_tree.hpp"
 #include "yield/exception.hpp"
 #include "yield/logging.hpp"
 #include "yield/fs/poll/fs_event_queue.hpp"
@@ -45,32 +46,32 @@ using ::std::unique_ptr;
 
 FsEventQueue::FsEventQueue() {
   epoll_fd_.reset(::epoll_create(32768));
-  if (epoll_fd_ == -1) {
+  if (!epoll_fd_) {
     throw Exception();
   }
 
   event_fd_.reset(::eventfd(0, 0));
-  if (event_fd_ == -1) {
+  if (!event_fd_) {
     throw Exception();
   }
 
   epoll_event epoll_event_;
   memset(&epoll_event_, 0, sizeof(epoll_event_));
-  epoll_event_.data.fd = event_fd_;
+  epoll_event_.data.fd = *event_fd_;
   epoll_event_.events = EPOLLIN;
-  if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &epoll_event_) != 0) {
+  if (::epoll_ctl(*epoll_fd_, EPOLL_CTL_ADD, *event_fd_, &epoll_event_) != 0) {
     throw Exception();
   }
 
   inotify_fd_.reset(inotify_init());
-  if (inotify_fd_ == -1) {
+  if (!inotify_fd_) {
     throw Exception();
   }
 
   memset(&epoll_event_, 0, sizeof(epoll_event_));
-  epoll_event_.data.fd = inotify_fd_;
+  epoll_event_.data.fd = *inotify_fd_;
   epoll_event_.events = EPOLLIN;
-  if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, inotify_fd_, &epoll_event_) != 0) {
+  if (epoll_ctl(*epoll_fd_, EPOLL_CTL_ADD, *inotify_fd_, &epoll_event_) != 0) {
     throw Exception();
   }
 
@@ -78,9 +79,6 @@ FsEventQueue::FsEventQueue() {
 }
 
 FsEventQueue::~FsEventQueue() {
-  ::close(epoll_fd_);
-  ::close(event_fd_);
-  ::close(inotify_fd_);
 }
 
 bool
@@ -125,16 +123,42 @@ FsEventQueue::associate(
     mask |= IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO;
   }
 
-  int wd = inotify_add_watch(inotify_fd_, path.c_str(), mask);
+#ifdef IN_MASK_CREATE
+  // Fail with EEXIST rather than silently replacing the mask of an inode
+  // that is already watched under another path (e.g., a bind mount).
+  mask |= IN_MASK_CREATE;
+#endif
+
+  int wd = inotify_add_watch(*inotify_fd_, path.c_str(), mask);
+#ifdef IN_MASK_CREATE
+  if (wd == -1 && errno == EINVAL) {
+    // Kernels before 4.18 reject IN_MASK_CREATE; fall back to the
+    // watches_ check below.
+    wd = inotify_add_watch(*inotify_fd_, path.c_str(), mask & ~IN_MASK_CREATE);
+  }
+#endif
   if (wd == -1) {
     return false;
   }
 
-  watch = new linux::Watch(fs_event_types, inotify_fd_, path, wd);
+  if (watches_->find(wd) != NULL) {
+    errno = EEXIST;
+    return false;
+  }
+
+  watch = new linux::Watch(fs_event_types, *inotify_fd_, path, wd);
   watches_->insert(*watch);
   return true;
 }
 
+bool
+FsEventQueue::associate_tree(
+  const Path& path,
+  FsEvent::Type fs_event_types
+) {
+  return associate_directory_tree(*this, path, fs_event_types);
+}
+
 bool FsEventQueue::dissociate(const Path& path) {
   linux::Watch* watch = watches_->erase(path);
   if (watch != NULL) {
@@ -147,7 +171,7 @@ bool FsEventQueue::dissociate(const Path& path) {
 
 unique_ptr<FsEvent> FsEventQueue::tryenqueue(unique_ptr<FsEvent> event) {
   CHECK(false);
-  return false;
+  return event;
   //if (event_queue.enqueue(event)) {
   //  uint64_t data = 1;
   //  ssize_t write_ret = write(event_fd, &data, sizeof(data));
@@ -167,7 +191,7 @@ unique_ptr<FsEvent> FsEventQueue::timeddequeue(const Time& timeout) {
   epoll_event epoll_event_;
   int timeout_ms
   = (timeout == Time::FOREVER) ? -1 : static_cast<int>(timeout.ms());
-  int ret = epoll_wait(epoll_fd_, &epoll_event_, 1, timeout_ms);
+  int ret = epoll_wait(*epoll_fd_, &epoll_event_, 1, timeout_ms);
 
   if (ret == 0) {
     return unique_ptr<FsEvent>();
@@ -178,17 +202,17 @@ unique_ptr<FsEvent> FsEventQueue::timeddequeue(const Time& timeout) {
 
   CHECK_EQ(ret, 1);
 
-  if (epoll_event_.data.fd == event_fd_) {
+  if (epoll_event_.data.fd == *event_fd_) {
     uint64_t data;
-    ::read(event_fd_, &data, sizeof(data));
+    ::read(*event_fd_, &data, sizeof(data));
     return unique_ptr<FsEvent>();
   }
 
-  CHECK_EQ(epoll_event_.data.fd, inotify_fd_);
+  CHECK_EQ(epoll_event_.data.fd, *inotify_fd_);
 
   char inotify_events[(sizeof(inotify_event) + PATH_MAX) * 16];
   ssize_t read_ret
-  = ::read(inotify_fd_, inotify_events, sizeof(inotify_events));
+  = ::read(*inotify_fd_, inotify_events, sizeof(inotify_events));
   CHECK_GT(read_ret, 0);
 
   const char* inotify_events_p = inotify_events;
@@ -215,7 +239,7 @@ unique_ptr<FsEvent> FsEventQueue::timeddequeue(const Time& timeout) {
 
 void FsEventQueue::wake() {
   uint64_t data = 1;
-  ssize_t write_ret = ::write(event_fd_, &data, sizeof(data));
+  ssize_t write_ret = ::write(*event_fd_, &data, sizeof(data));
   CHECK_EQ(write_ret, static_cast<ssize_t>(sizeof(data)));
 }
 }
@@ -33,39 +33,38 @@ namespace fs {
 namespace poll {
 namespace linux {
 using std::make_pair;
-using std::map;
 
 Watches::~Watches() {
-  for (iterator watch_i = begin(); watch_i != end(); ++watch_i) {
+  for (auto watch_i = wd_index_.begin(); watch_i != wd_index_.end(); ++watch_i) {
     delete watch_i->second;
   }
 }
 
 Watch* Watches::erase(const Path& path) {
-  for (iterator watch_i = begin(); watch_i != end(); ++watch_i) {
-    if (watch_i->second->path() == path) {
-      Watch* watch = watch_i->second;
-      map<int, Watch*>::erase(watch_i);
-      return watch;
-    }
+  auto watch_i = path_index_.find(path);
+  if (watch_i != path_index_.end()) {
+    Watch* watch = watch_i->second;
+    path_index_.erase(watch_i);
+    size_t erased = wd_index_.erase(watch->wd());
+    CHECK_EQ(erased, 1u);
+    return watch;
   }
 
   return NULL;
 }
 
 Watch* Watches::find(const Path& path) {
-  for (iterator watch_i = begin(); watch_i != end(); ++watch_i) {
-    if (watch_i->second->path() == path) {
-      return watch_i->second;
-    }
+  auto watch_i = path_index_.find(path);
+  if (watch_i != path_index_.end()) {
+    return watch_i->second;
+  } else {
+    return NULL;
   }
-
-  return NULL;
 }
 
 Watch* Watches::find(int wd) {
-  iterator watch_i = map<int, Watch*>::find(wd);
-  if (watch_i != end()) {
+  auto watch_i = wd_index_.find(wd);
+  if (watch_i != wd_index_.end()) {
     return watch_i->second;
   } else {
     return NULL;
@@ -73,9 +72,10 @@ Watch* Watches::find(int wd) {
 }
 
 void Watches::insert(Watch& watch) {
-  iterator watch_i = map<int, Watch*>::find(watch.wd());
-  CHECK_EQ(watch_i, end());
-  map<int, Watch*>::insert(make_pair(watch.wd(), &watch));
+  CHECK(wd_index_.find(watch.wd()) == wd_index_.end());
+  CHECK(path_index_.find(watch.path()) == path_index_.end());
+  wd_index_.insert(make_pair(watch.wd(), &watch));
+  path_index_.insert(make_pair(watch.path(), &watch));
 }
 }
 }
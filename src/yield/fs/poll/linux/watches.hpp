@@ -30,13 +30,19 @@
 
 #include "watch.hpp"
 
-#include <map>
+#include <string>
+#include <unordered_map>
 
 namespace yield {
 namespace fs {
 namespace poll {
 namespace linux {
-class Watches : private std::map<int, Watch*> {
+/**
+  Watches indexed by inotify watch descriptor, for dispatching events,
+    and by hashed Path, for associate/dissociate, so that both lookups
+    stay O(1) as the number of watched directories grows.
+*/
+class Watches {
 public:
   ~Watches();
 
@@ -47,6 +53,22 @@ public:
   Watch* find(int wd);
 
   void insert(Watch& watch);
+
+  size_t size() const {
+    return wd_index_.size();
+  }
+
+private:
+  class PathHash {
+  public:
+    size_t operator()(const Path& path) const {
+      return ::std::hash< ::std::string >()(path);
+    }
+  };
+
+private:
+  ::std::unordered_map<Path, Watch*, PathHash> path_index_;
+  ::std::unordered_map<int, Watch*> wd_index_;
 };
 }
 }
@@ -25,6 +25,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "./associate_directory_tree.hpp"
 #include "./scanning_directory_watch.hpp"
 #include "./scanning_file_watch.hpp"
 #include "yield/logging.hpp"
@@ -60,6 +61,14 @@ ScanningFsEventQueue::associate(
   return true;
 }
 
+bool
+ScanningFsEventQueue::associate_tree(
+  const Path& path,
+  FsEvent::Type fs_event_types
+) {
+  return associate_directory_tree(*this, path, fs_event_types);
+}
+
 bool ScanningFsEventQueue::dissociate(const Path& path) {
   return watches_.erase(path) == 1;
 }
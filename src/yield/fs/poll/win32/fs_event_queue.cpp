@@ -26,6 +26,7 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "./directory_watch.hpp"
+#include "../associate_directory_tree.hpp"
 #include "./file_watch.hpp"
 #include "yield/exception.hpp"
 #include "yield/logging.hpp"
@@ -121,6 +122,14 @@ bool FsEventQueue::associate(const Path& path, FsEvent::Type fs_event_types) {
   }
 }
 
+bool
+FsEventQueue::associate_tree(
+  const Path& path,
+  FsEvent::Type fs_event_types
+) {
+  return associate_directory_tree(*this, path, fs_event_types);
+}
+
 bool FsEventQueue::dissociate(const Path& path) {
   auto watch_i = watches_.find(path);
   if (watch_i != watches_.end()) {
@@ -219,7 +219,7 @@ File::mmap(
 #pragma GCC diagnostic warning "-Wold-style-cast"
 
 ssize_t File::pread(Buffer& buffer, off_t offset) {
-  if (buffer.get_next_buffer() == NULL) {
+  if (!buffer.next_buffer()) {
     ssize_t pread_ret
     = pread(buffer, buffer.capacity() - buffer.size(), offset);
     if (pread_ret > 0) {
@@ -255,7 +255,7 @@ ssize_t File::preadv(const iovec* iov, int iovlen, off_t offset) {
 }
 
 ssize_t File::pwrite(const Buffer& buffer, off_t offset) {
-  if (buffer.get_next_buffer() == NULL) {
+  if (!buffer.next_buffer()) {
     return pwrite(buffer, buffer.size(), offset);
   } else {
     ::std::vector<iovec> iov;
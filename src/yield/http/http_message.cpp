@@ -25,7 +25,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
 #include "yield/date_time.hpp"
 #include "yield/logging.hpp"
 #include "yield/fs/file.hpp"
@@ -34,12 +34,13 @@
 #include "yield/http/http_request.hpp"
 #include "yield/http/http_response.hpp"
 
+#include <ctime>
+
 #ifdef _WIN32
 #include <Windows.h> // For SYSTEMTIME
 #pragma warning(push)
 #pragma warning(disable:4702)
 #else
-#include <stdio.h> // For snprintf
 #include <stdlib.h> // For atoi
 #endif
 
@@ -49,6 +50,101 @@ using ::std::make_shared;
 using ::std::shared_ptr;
 using ::yield::fs::File;
 
+// Length of the longest decimal size_t
+static const size_t SIZE_T_DIGITS_MAX = 20;
+
+static inline void format_2_digits(unsigned value, char* out) {
+  static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+  memcpy(out, &digit_pairs[value * 2], 2);
+}
+
+// Format value right-aligned so that its last digit is at end[-1],
+// two digits per table lookup; returns the number of digits written.
+static size_t format_size_t(size_t value, char* end) {
+  char* p = end;
+  while (value >= 100) {
+    p -= 2;
+    format_2_digits(static_cast<unsigned>(value % 100), p);
+    value /= 100;
+  }
+  if (value >= 10) {
+    p -= 2;
+    format_2_digits(static_cast<unsigned>(value), p);
+  } else {
+    *--p = static_cast<char>('0' + value);
+  }
+  return static_cast<size_t>(end - p);
+}
+
+static void
+format_rfc1123_date(
+  int week_day,
+  int day,
+  int month,
+  int year,
+  int hour,
+  int minute,
+  int second,
+  char* date
+) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  static const char week_days[] = "SunMonTueWedThuFriSat";
+
+  memcpy(date, &week_days[week_day * 3], 3);
+  memcpy(date + 3, ", ", 2);
+  format_2_digits(static_cast<unsigned>(day), date + 5);
+  date[7] = ' ';
+  memcpy(date + 8, &months[month * 3], 3);
+  date[11] = ' ';
+  format_2_digits(static_cast<unsigned>(year / 100), date + 12);
+  format_2_digits(static_cast<unsigned>(year % 100), date + 14);
+  date[16] = ' ';
+  format_2_digits(static_cast<unsigned>(hour), date + 17);
+  date[19] = ':';
+  format_2_digits(static_cast<unsigned>(minute), date + 20);
+  date[22] = ':';
+  format_2_digits(static_cast<unsigned>(second), date + 23);
+  memcpy(date + 25, " GMT", 4);
+}
+
+static void format_rfc1123_date(const DateTime& value, char* date) {
+#ifdef _WIN32
+  SYSTEMTIME utc_system_time = value.as_utc_SYSTEMTIME();
+  format_rfc1123_date(
+    utc_system_time.wDayOfWeek,
+    utc_system_time.wDay,
+    utc_system_time.wMonth - 1,
+    utc_system_time.wYear,
+    utc_system_time.wHour,
+    utc_system_time.wMinute,
+    utc_system_time.wSecond,
+    date
+  );
+#else
+  tm utc_tm = value.as_utc_tm();
+  format_rfc1123_date(
+    utc_tm.tm_wday,
+    utc_tm.tm_mday,
+    utc_tm.tm_mon,
+    utc_tm.tm_year + 1900,
+    utc_tm.tm_hour,
+    utc_tm.tm_min,
+    utc_tm.tm_sec,
+    date
+  );
+#endif
+}
+
 template <class HttpMessageType>
 HttpMessage<HttpMessageType>::HttpMessage(
   shared_ptr<Buffer> body_buffer,
@@ -56,7 +152,7 @@ HttpMessage<HttpMessageType>::HttpMessage(
   uint8_t http_version
 ) : body_buffer_(body_buffer),
     body_file_(body_file),
-  header_(make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize())),
+  header_(BufferPool::get(Buffer::getpagesize())),
   http_version_(http_version) {
   if (body_buffer != NULL) {
     CHECK_EQ(body_file, NULL);
@@ -70,10 +166,12 @@ HttpMessage(
   shared_ptr<Buffer> body_buffer,
   shared_ptr<File> body_file,
   uint16_t fields_offset,
+  const HttpMessageFieldIndex& field_index,
   shared_ptr<Buffer> header,
   uint8_t http_version
 ) : body_buffer_(body_buffer),
     body_file_(body_file),
+  field_index_(field_index),
   fields_offset_(fields_offset),
   header_(header),
   http_version_(http_version) {
@@ -87,14 +185,45 @@ void HttpMessage<HttpMessageType>::finalize() {
   header_->put("\r\n", 2);
 }
 
+template <class HttpMessageType>
+void
+HttpMessage<HttpMessageType>::format_date(
+  const DateTime& value,
+  char* date
+) {
+  format_rfc1123_date(value, date);
+}
+
 template <class HttpMessageType>
 size_t HttpMessage<HttpMessageType>::get_content_length() const {
+  if (field_index_.full()) {
+    size_t content_length = 0;
+    HttpMessageParser::parse_content_length_field(
+      static_cast<const char*>(*header_) + fields_offset_,
+      static_cast<const char*>(*header_) + header_->size(),
+      content_length
+    );
+    return content_length;
+  }
+
+  // Transfer-Encoding: chunked overrides any Content-Length.
   size_t content_length = 0;
-  HttpMessageParser::parse_content_length_field(
-    static_cast<const char*>(*header_) + fields_offset_,
-    static_cast<const char*>(*header_) + header_->size(),
-    content_length
-  );
+  iovec name, value;
+  name.iov_base = const_cast<char*>("Transfer-Encoding");
+  name.iov_len = 17;
+  if (
+    get_field(static_cast<char*>(name.iov_base), name.iov_len, value)
+    &&
+    HttpMessageParser::parse_content_length_field(name, value, content_length)
+  ) {
+    return content_length;
+  }
+
+  name.iov_base = const_cast<char*>("Content-Length");
+  name.iov_len = 14;
+  if (get_field(static_cast<char*>(name.iov_base), name.iov_len, value)) {
+    HttpMessageParser::parse_content_length_field(name, value, content_length);
+  }
   return content_length;
 }
 
@@ -115,15 +244,23 @@ HttpMessage<HttpMessageType>::get_field(
   size_t name_len,
   iovec& value
 ) const {
-  iovec name_iov;
-  name_iov.iov_base = const_cast<char*>(name);
-  name_iov.iov_len = name_len;
-  return HttpMessageParser::parse_field(
-           static_cast<const char*>(*header_) + fields_offset_,
-           static_cast<const char*>(*header_) + header_->size(),
-           name_iov,
-           value
-         );
+  if (
+    field_index_.find(static_cast<const char*>(*header_), name, name_len, value)
+  ) {
+    return true;
+  } else if (field_index_.full()) {
+    iovec name_iov;
+    name_iov.iov_base = const_cast<char*>(name);
+    name_iov.iov_len = name_len;
+    return HttpMessageParser::parse_field(
+             static_cast<const char*>(*header_) + fields_offset_,
+             static_cast<const char*>(*header_) + header_->size(),
+             name_iov,
+             value
+           );
+  } else {
+    return false;
+  }
 }
 
 template <class HttpMessageType>
@@ -131,11 +268,15 @@ void
 HttpMessage<HttpMessageType>::get_fields(
   ::std::vector< std::pair<iovec, iovec> >& fields
 ) const {
-  return HttpMessageParser::parse_fields(
-           static_cast<const char*>(*header_) + fields_offset_,
-           static_cast<const char*>(*header_) + header_->size(),
-           fields
-         );
+  if (field_index_.full()) {
+    HttpMessageParser::parse_fields(
+      static_cast<const char*>(*header_) + fields_offset_,
+      static_cast<const char*>(*header_) + header_->size(),
+      fields
+    );
+  } else {
+    field_index_.get_fields(static_cast<const char*>(*header_), fields);
+  }
 }
 
 template <class HttpMessageType>
@@ -153,59 +294,64 @@ void HttpMessage<HttpMessageType>::set_body(shared_ptr<File> body_file) {
 template <class HttpMessageType>
 HttpMessageType&
 HttpMessage<HttpMessageType>::
-set_field(
-  const char* name,
-  size_t name_len,
-  const DateTime& value
+put_field(
+  const char* field,
+  size_t field_len,
+  size_t name_len
 ) {
-  static const char* months[] = {
-    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
-    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
-  };
+  CHECK_GT(fields_offset_, 0);
+  CHECK_GT(name_len, 0);
+  CHECK_GT(field_len, name_len + 4);
 
-  static const char* week_days[] = {
-    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"
-  };
+  size_t header_size = header_->size();
+  bool indexed = field_index_.size() == header_size;
 
-  char date[30];
-  int date_len;
+  header_->put(field, field_len);
 
-#ifdef _WIN32
-  SYSTEMTIME utc_system_time = value.as_utc_SYSTEMTIME();
+  if (indexed && header_->size() == header_size + field_len) {
+    iovec name_iov;
+    name_iov.iov_base = static_cast<char*>(*header_) + header_size;
+    name_iov.iov_len = name_len;
+    iovec value_iov;
+    value_iov.iov_base = static_cast<char*>(name_iov.iov_base) + name_len + 2;
+    value_iov.iov_len = field_len - name_len - 4;
+    field_index_.insert(static_cast<const char*>(*header_), name_iov, value_iov);
+    field_index_.size(header_->size());
+  } else {
+    // Appended past the indexed fields, e.g. after finalize
+    field_index_.set_full();
+  }
 
-  date_len
-  = _snprintf_s(
-      date,
-      30,
-      _TRUNCATE,
-      "%s, %02d %s %04d %02d:%02d:%02d GMT",
-      week_days[utc_system_time.wDayOfWeek],
-      utc_system_time.wDay,
-      months[utc_system_time.wMonth - 1],
-      utc_system_time.wYear,
-      utc_system_time.wHour,
-      utc_system_time.wMinute,
-      utc_system_time.wSecond
-    );
-#else
-  tm utc_tm = value.as_utc_tm();
+  return static_cast<HttpMessageType&>(*this);
+}
 
-  date_len
-  = snprintf(
-      date,
-      30,
-      "%s, %02d %s %04d %02d:%02d:%02d GMT",
-      week_days[utc_tm.tm_wday],
-      utc_tm.tm_mday,
-      months[utc_tm.tm_mon],
-      utc_tm.tm_year + 1900,
-      utc_tm.tm_hour,
-      utc_tm.tm_min,
-      utc_tm.tm_sec
-    );
-#endif
+template <class HttpMessageType>
+HttpMessageType&
+HttpMessage<HttpMessageType>::set_content_length_field(size_t content_length) {
+  char field[16 + SIZE_T_DIGITS_MAX + 2];
+  char* value_end = field + 16 + SIZE_T_DIGITS_MAX;
+  size_t value_len = format_size_t(content_length, value_end);
+  char* field_start = value_end - value_len - 16;
+  memcpy(field_start, "Content-Length: ", 16);
+  memcpy(value_end, "\r\n", 2);
+  return put_field(field_start, 16 + value_len + 2, 14);
+}
+
+template <class HttpMessageType>
+HttpMessageType& HttpMessage<HttpMessageType>::set_date_field() {
+  // "Date: " + date + CRLF, reformatted once per second per thread.
+  static thread_local time_t date_field_s = 0;
+  static thread_local char date_field[6 + DATE_LENGTH + 2];
+
+  time_t now_s = ::time(NULL);
+  if (now_s != date_field_s) {
+    memcpy(date_field, "Date: ", 6);
+    format_rfc1123_date(DateTime(now_s), date_field + 6);
+    memcpy(date_field + 6 + DATE_LENGTH, "\r\n", 2);
+    date_field_s = now_s;
+  }
 
-  return set_field(name, name_len, date, date_len);
+  return put_field(date_field, sizeof(date_field), 4);
 }
 
 template <class HttpMessageType>
@@ -214,18 +360,30 @@ HttpMessage<HttpMessageType>::
 set_field(
   const char* name,
   size_t name_len,
-  size_t value
+  const DateTime& value
 ) {
-  char value_str[64];
-  int value_str_len;
-
-#ifdef _WIN32
-  value_str_len = sprintf_s(value_str, 64, "%u", value);
-#else
-  value_str_len = snprintf(value_str, 64, "%zu", value);
-#endif
+  char date[DATE_LENGTH];
+  format_rfc1123_date(value, date);
+  return set_field(name, name_len, date, DATE_LENGTH);
+}
 
-  return set_field(name, name_len, value_str, value_str_len);
+template <class HttpMessageType>
+HttpMessageType&
+HttpMessage<HttpMessageType>::
+set_field(
+  const char* name,
+  size_t name_len,
+  size_t value
+) {
+  char value_str[SIZE_T_DIGITS_MAX];
+  size_t value_str_len
+    = format_size_t(value, value_str + SIZE_T_DIGITS_MAX);
+  return set_field(
+           name,
+           name_len,
+           value_str + SIZE_T_DIGITS_MAX - value_str_len,
+           value_str_len
+         );
 }
 
 template <class HttpMessageType>
@@ -241,11 +399,28 @@ set_field(
   CHECK_GT(name_len, 0);
   CHECK_GT(value_len, 0);
 
+  size_t header_size = header_->size();
+  bool indexed = field_index_.size() == header_size;
+
+  iovec name_iov;
+  name_iov.iov_base = static_cast<char*>(*header_) + header_->size();
+  name_iov.iov_len = name_len;
   header_->put(name, name_len);
   header_->put(": ", 2);
+  iovec value_iov;
+  value_iov.iov_base = static_cast<char*>(*header_) + header_->size();
+  value_iov.iov_len = value_len;
   header_->put(value, value_len);
   header_->put("\r\n");
 
+  // Extend an up-to-date index rather than re-scanning the new field later.
+  if (indexed && header_->size() == header_size + name_len + value_len + 4) {
+    field_index_.insert(static_cast<const char*>(*header_), name_iov, value_iov);
+    field_index_.size(header_->size());
+  } else {
+    field_index_.set_full();
+  }
+
   return static_cast<HttpMessageType&>(*this);
 }
 
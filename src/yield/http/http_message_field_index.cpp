@@ -0,0 +1,167 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/http/http_message_field_index.hpp"
+
+#include <cstring>
+
+namespace yield {
+namespace http {
+namespace {
+inline char to_lower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+}
+
+void HttpMessageFieldIndex::clear() {
+  field_count_ = 0;
+  full_ = false;
+  size_ = 0;
+  memset(slots_, 0, sizeof(slots_));
+}
+
+bool
+HttpMessageFieldIndex::find(
+  const char* base,
+  const char* name,
+  size_t name_len,
+  iovec& value
+) const {
+  uint32_t name_hash = hash(name, name_len);
+  for (
+    uint8_t slot_i = name_hash & (SLOTS_MAX - 1);
+    slots_[slot_i] != 0;
+    slot_i = (slot_i + 1) & (SLOTS_MAX - 1)
+  ) {
+    const Field& field = fields_[slots_[slot_i] - 1];
+    if (field.hash == name_hash && field.name_len == name_len) {
+      const char* field_name = base + field.name_offset;
+      size_t char_i = 0;
+      while (
+        char_i < name_len
+        &&
+        to_lower(field_name[char_i]) == to_lower(name[char_i])
+      ) {
+        ++char_i;
+      }
+
+      if (char_i == name_len) {
+        value.iov_base = const_cast<char*>(base) + field.value_offset;
+        value.iov_len = field.value_len;
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+void
+HttpMessageFieldIndex::get_fields(
+  const char* base,
+  ::std::vector< ::std::pair<iovec, iovec> >& fields
+) const {
+  for (uint8_t field_i = 0; field_i < field_count_; ++field_i) {
+    const Field& field = fields_[field_i];
+    iovec name, value;
+    name.iov_base = const_cast<char*>(base) + field.name_offset;
+    name.iov_len = field.name_len;
+    value.iov_base = const_cast<char*>(base) + field.value_offset;
+    value.iov_len = field.value_len;
+    fields.push_back(::std::make_pair(name, value));
+  }
+}
+
+uint32_t HttpMessageFieldIndex::hash(const char* name, size_t name_len) {
+  // FNV-1a
+  uint32_t name_hash = 2166136261U;
+  for (size_t char_i = 0; char_i < name_len; ++char_i) {
+    name_hash ^= static_cast<uint8_t>(to_lower(name[char_i]));
+    name_hash *= 16777619U;
+  }
+  return name_hash;
+}
+
+bool
+HttpMessageFieldIndex::insert(
+  const char* base,
+  const iovec& name,
+  const iovec& value
+) {
+  if (
+    full_
+    ||
+    field_count_ == FIELDS_MAX
+    ||
+    name.iov_len > UINT16_MAX
+    ||
+    value.iov_len > UINT16_MAX
+  ) {
+    full_ = true;
+    return false;
+  }
+
+  Field& field = fields_[field_count_];
+  field.hash = hash(static_cast<const char*>(name.iov_base), name.iov_len);
+  field.name_offset
+  = static_cast<uint32_t>(static_cast<const char*>(name.iov_base) - base);
+  field.name_len = static_cast<uint16_t>(name.iov_len);
+  field.value_offset
+  = static_cast<uint32_t>(static_cast<const char*>(value.iov_base) - base);
+  field.value_len = static_cast<uint16_t>(value.iov_len);
+  ++field_count_;
+
+  // Only the first occurrence of a name is reachable from the table,
+  // the same as a front-to-back scan of the header.
+  iovec existing_value;
+  if (
+    !find(
+      base,
+      static_cast<const char*>(name.iov_base),
+      name.iov_len,
+      existing_value
+    )
+  ) {
+    uint8_t slot_i = field.hash & (SLOTS_MAX - 1);
+    while (slots_[slot_i] != 0) {
+      slot_i = (slot_i + 1) & (SLOTS_MAX - 1);
+    }
+    slots_[slot_i] = field_count_;
+  }
+
+  return true;
+}
+
+void HttpMessageFieldIndex::rebase(size_t offset) {
+  for (uint8_t field_i = 0; field_i < field_count_; ++field_i) {
+    fields_[field_i].name_offset -= static_cast<uint32_t>(offset);
+    fields_[field_i].value_offset -= static_cast<uint32_t>(offset);
+  }
+  size_ = size_ > offset ? size_ - offset : 0;
+}
+}
+}
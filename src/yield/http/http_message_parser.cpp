@@ -27,7 +27,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/http_message_body_chunk.hpp"
 #include "yield/http/http_message_parser.hpp"
@@ -46,21 +46,53 @@
 namespace yield {
 namespace http {
 HttpMessageParser::HttpMessageParser(::std::shared_ptr<Buffer> buffer)
-  : buffer_(buffer) {
+  : buffer_(buffer),
+    cs(0) {
   CHECK(!buffer->empty());
 
+  field_name.iov_base = field_value.iov_base = NULL;
+  field_name.iov_len = field_value.iov_len = 0;
+
   ps = p = *buffer_;
   eof = ps + buffer_->size();
 }
 
 HttpMessageParser::HttpMessageParser(const ::std::string& buffer)
-  : buffer_(Buffer::copy(buffer)) {
+  : buffer_(Buffer::copy(buffer)),
+    cs(0) {
   CHECK(!buffer.empty());
 
+  field_name.iov_base = field_value.iov_base = NULL;
+  field_name.iov_len = field_value.iov_len = 0;
+
   ps = p = *buffer_;
   eof = ps + buffer_->size();
 }
 
+void HttpMessageParser::rebase(::std::shared_ptr<Buffer> buffer) {
+  ::std::shared_ptr<Buffer> old_buffer;
+  old_buffer.swap(buffer_);
+  const char* old_ps = ps;
+
+  buffer_ = buffer;
+  ps = *buffer_;
+  p = ps + (p - old_ps);
+  eof = ps + buffer_->size();
+
+  rebase(field_name, old_ps);
+  rebase(field_value, old_ps);
+  field_index_.rebase(old_ps - static_cast<const char*>(*old_buffer));
+}
+
+void HttpMessageParser::rebase(iovec& mark, const char* old_ps) const {
+  if (mark.iov_base != NULL && mark.iov_base >= old_ps) {
+    mark.iov_base = ps + (static_cast<char*>(mark.iov_base) - old_ps);
+  } else { // Unset, or left over from an earlier message
+    mark.iov_base = NULL;
+    mark.iov_len = 0;
+  }
+}
+
 bool
 HttpMessageParser::parse_body(
   size_t content_length,
@@ -91,7 +123,7 @@ void HttpMessageParser::parse_body_chunks(ParseCallbacks& callbacks) {
   ps = p;
 
   
-/* #line 92 "http_message_parser.cpp" */
+/* #line 127 "http_message_parser.cpp" */
 static const char _chunk_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4, 1, 5, 1, 6, 1, 
@@ -640,12 +672,12 @@ static const int chunk_parser_error = 0;
 static const int chunk_parser_en_main = 1;
 
 
-/* #line 639 "http_message_parser.cpp" */
+/* #line 676 "http_message_parser.cpp" */
 	{
 	cs = chunk_parser_start;
 	}
 
-/* #line 642 "http_message_parser.cpp" */
+/* #line 681 "http_message_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -788,7 +820,7 @@ _match:
 	{ chunk_size = 0; }
 	break;
 	case 8:
-/* #line 97 "http_message_parser.rl" */
+/* #line 129 "http_message_parser.rl" */
 	{
     if (chunk_size > 0) {
       // Cut off the chunk size + extension + CRLF before
@@ -802,7 +834,7 @@ _match:
 	}
     }
 	break;
-/* #line 788 "http_message_parser.cpp" */
+/* #line 838 "http_message_parser.cpp" */
 		}
 	}
 
@@ -814,12 +846,12 @@ _again:
 	_out: {}
 	}
 
-/* #line 114 "http_message_parser.rl" */
+/* #line 146 "http_message_parser.rl" */
 
 
   CHECK(cs == chunk_parser_error);
   if (p == eof && chunk_size != 0) {
-    callbacks.read(::std::make_shared<Buffer>(chunk_size + 2)); // Assumes no trailers.
+    callbacks.read(BufferPool::get(chunk_size + 2)); // Assumes no trailers.
   }
 }
 
@@ -837,7 +869,7 @@ HttpMessageParser::parse_content_length_field(
   // Don't look for the trailing CRLF before the body,
   // since it may not be present yet.
   
-/* #line 819 "http_message_parser.cpp" */
+/* #line 873 "http_message_parser.cpp" */
 static const char _content_length_field_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4, 2, 2, 3
@@ -891,12 +923,12 @@ static const int content_length_field_parser_error = 0;
 static const int content_length_field_parser_en_main = 5;
 
 
-/* #line 871 "http_message_parser.cpp" */
+/* #line 927 "http_message_parser.cpp" */
 	{
 	cs = content_length_field_parser_start;
 	}
 
-/* #line 874 "http_message_parser.cpp" */
+/* #line 932 "http_message_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -987,7 +1019,7 @@ _match:
 	{ field_value.iov_len = p - static_cast<char*>(field_value.iov_base); }
 	break;
 	case 4:
-/* #line 142 "http_message_parser.rl" */
+/* #line 174 "http_message_parser.rl" */
 	{
         if (
           parse_content_length_field(
@@ -999,7 +1031,7 @@ _match:
           return true;
       }
 	break;
-/* #line 971 "http_message_parser.cpp" */
+/* #line 1035 "http_message_parser.cpp" */
 		}
 	}
 
@@ -1012,7 +1044,7 @@ _again:
 	_out: {}
 	}
 
-/* #line 157 "http_message_parser.rl" */
+/* #line 189 "http_message_parser.rl" */
 
 
   return false;
@@ -1070,7 +1102,7 @@ DateTime HttpMessageParser::parse_date(const char* ps, const char* pe) {
   int day = 0, month = 0, year = 0;
 
   
-/* #line 1038 "http_message_parser.cpp" */
+/* #line 1106 "http_message_parser.cpp" */
 static const char _date_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4, 1, 5, 1, 6, 1, 
@@ -1296,12 +1328,12 @@ static const int date_parser_error = 0;
 static const int date_parser_en_main = 1;
 
 
-/* #line 1262 "http_message_parser.cpp" */
+/* #line 1332 "http_message_parser.cpp" */
 	{
 	cs = date_parser_start;
 	}
 
-/* #line 1265 "http_message_parser.cpp" */
+/* #line 1337 "http_message_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -1438,10 +1470,10 @@ _match:
 	{ year = atoi(p); }
 	break;
 	case 8:
-/* #line 220 "http_message_parser.rl" */
+/* #line 252 "http_message_parser.rl" */
 	{ return DateTime::INVALID_DATE_TIME; }
 	break;
-/* #line 1395 "http_message_parser.cpp" */
+/* #line 1477 "http_message_parser.cpp" */
 		}
 	}
 
@@ -1458,10 +1490,10 @@ _again:
 	while ( __nacts-- > 0 ) {
 		switch ( *__acts++ ) {
 	case 8:
-/* #line 220 "http_message_parser.rl" */
+/* #line 252 "http_message_parser.rl" */
 	{ return DateTime::INVALID_DATE_TIME; }
 	break;
-/* #line 1413 "http_message_parser.cpp" */
+/* #line 1497 "http_message_parser.cpp" */
 		}
 	}
 	}
@@ -1469,7 +1501,7 @@ _again:
 	_out: {}
 	}
 
-/* #line 225 "http_message_parser.rl" */
+/* #line 257 "http_message_parser.rl" */
 
 
   if (cs != date_parser_error) {
@@ -1495,7 +1527,7 @@ HttpMessageParser::parse_field(
   // Don't look for the trailing CRLF before the body,
   // since it may not be present yet.
   
-/* #line 1443 "http_message_parser.cpp" */
+/* #line 1531 "http_message_parser.cpp" */
 static const char _field_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4, 2, 2, 3
@@ -1549,12 +1581,12 @@ static const int field_parser_error = 0;
 static const int field_parser_en_main = 5;
 
 
-/* #line 1495 "http_message_parser.cpp" */
+/* #line 1585 "http_message_parser.cpp" */
 	{
 	cs = field_parser_start;
 	}
 
-/* #line 1498 "http_message_parser.cpp" */
+/* #line 1590 "http_message_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -1645,7 +1677,7 @@ _match:
 	{ field_value.iov_len = p - static_cast<char*>(field_value.iov_base); }
 	break;
 	case 4:
-/* #line 256 "http_message_parser.rl" */
+/* #line 288 "http_message_parser.rl" */
 	{
         if (
           field_name.iov_len == in_field_name.iov_len
@@ -1661,7 +1693,7 @@ _match:
         }
       }
 	break;
-/* #line 1599 "http_message_parser.cpp" */
+/* #line 1697 "http_message_parser.cpp" */
 		}
 	}
 
@@ -1674,7 +1706,7 @@ _again:
 	_out: {}
 	}
 
-/* #line 275 "http_message_parser.rl" */
+/* #line 307 "http_message_parser.rl" */
 
 
   return false;
@@ -1694,7 +1726,7 @@ HttpMessageParser::parse_fields(
   // Don't look for the trailing CRLF before the body,
   // since it may not be present yet.
   
-/* #line 1628 "http_message_parser.cpp" */
+/* #line 1730 "http_message_parser.cpp" */
 static const char _static_fields_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4, 2, 2, 3
@@ -1748,12 +1780,12 @@ static const int static_fields_parser_error = 0;
 static const int static_fields_parser_en_main = 5;
 
 
-/* #line 1680 "http_message_parser.cpp" */
+/* #line 1784 "http_message_parser.cpp" */
 	{
 	cs = static_fields_parser_start;
 	}
 
-/* #line 1683 "http_message_parser.cpp" */
+/* #line 1789 "http_message_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -1844,10 +1876,10 @@ _match:
 	{ field_value.iov_len = p - static_cast<char*>(field_value.iov_base); }
 	break;
 	case 4:
-/* #line 300 "http_message_parser.rl" */
+/* #line 332 "http_message_parser.rl" */
 	{ fields.push_back(std::make_pair(field_name, field_value)); }
 	break;
-/* #line 1771 "http_message_parser.cpp" */
+/* #line 1883 "http_message_parser.cpp" */
 		}
 	}
 
@@ -1860,24 +1892,20 @@ _again:
 	_out: {}
 	}
 
-/* #line 306 "http_message_parser.rl" */
+/* #line 338 "http_message_parser.rl" */
 
 }
 
 bool
 HttpMessageParser::parse_fields(
   uint16_t& fields_offset,
-  size_t& content_length
+  size_t& content_length,
+  bool resume
 ) {
-  fields_offset = static_cast<uint16_t>(p - ps);
-
-  content_length = 0;
-
-  int cs;
-  iovec field_name = {0, 0}, field_value = {0, 0};
+  const char* pe = eof;
 
   
-/* #line 1797 "http_message_parser.cpp" */
+/* #line 1909 "http_message_parser.cpp" */
 static const char _fields_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4, 1, 5, 1, 6, 2, 
@@ -1946,12 +1974,25 @@ static const int fields_parser_error = 0;
 static const int fields_parser_en_main = 1;
 
 
-/* #line 1864 "http_message_parser.cpp" */
+/* #line 373 "http_message_parser.rl" */
+
+
+  if (!resume) {
+    fields_offset = static_cast<uint16_t>(p - static_cast<char*>(*buffer_));
+    content_length = 0;
+    field_index_.clear();
+
+    
+/* #line 1987 "http_message_parser.cpp" */
 	{
 	cs = fields_parser_start;
 	}
 
-/* #line 1867 "http_message_parser.cpp" */
+/* #line 381 "http_message_parser.rl" */
+  }
+
+  
+/* #line 1996 "http_message_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -1959,6 +2000,8 @@ static const int fields_parser_en_main = 1;
 	unsigned int _nacts;
 	const unsigned char *_keys;
 
+	if ( p == pe )
+		goto _test_eof;
 	if ( cs == 0 )
 		goto _out;
 _resume:
@@ -2040,32 +2083,38 @@ _match:
 	{ field_value.iov_len = p - static_cast<char*>(field_value.iov_base); }
 	break;
 	case 4:
-/* #line 328 "http_message_parser.rl" */
+/* #line 356 "http_message_parser.rl" */
 	{
         parse_content_length_field(
           field_name,
           field_value,
           content_length
         );
+        field_index_.insert(
+          static_cast<const char*>(*buffer_),
+          field_name,
+          field_value
+        );
       }
 	break;
 	case 5:
-/* #line 336 "http_message_parser.rl" */
+/* #line 369 "http_message_parser.rl" */
 	{ {p++; goto _out; } }
 	break;
 	case 6:
-/* #line 337 "http_message_parser.rl" */
+/* #line 370 "http_message_parser.rl" */
 	{ return false; }
 	break;
-/* #line 1965 "http_message_parser.cpp" */
+/* #line 2109 "http_message_parser.cpp" */
 		}
 	}
 
 _again:
 	if ( cs == 0 )
 		goto _out;
-	p += 1;
-	goto _resume;
+	if ( ++p != pe )
+		goto _resume;
+	_test_eof: {}
 	if ( p == eof )
 	{
 	const char *__acts = _fields_parser_actions + _fields_parser_eof_actions[cs];
@@ -2073,10 +2122,10 @@ _again:
 	while ( __nacts-- > 0 ) {
 		switch ( *__acts++ ) {
 	case 6:
-/* #line 337 "http_message_parser.rl" */
+/* #line 370 "http_message_parser.rl" */
 	{ return false; }
 	break;
-/* #line 1982 "http_message_parser.cpp" */
+/* #line 2129 "http_message_parser.cpp" */
 		}
 	}
 	}
@@ -2084,10 +2133,14 @@ _again:
 	_out: {}
 	}
 
-/* #line 342 "http_message_parser.rl" */
+/* #line 384 "http_message_parser.rl" */
 
-
-  return cs != fields_parser_error;
+  if (cs >= fields_parser_first_final) {
+    field_index_.size(p - static_cast<char*>(*buffer_));
+    return true;
+  } else {
+    return false;
+  }
 }
 }
 }
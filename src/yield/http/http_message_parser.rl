@@ -25,7 +25,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/http_message_body_chunk.hpp"
 #include "yield/http/http_message_parser.hpp"
@@ -44,21 +44,53 @@
 namespace yield {
 namespace http {
 HttpMessageParser::HttpMessageParser(::std::shared_ptr<Buffer> buffer)
-  : buffer_(buffer) {
+  : buffer_(buffer),
+    cs(0) {
   CHECK(!buffer->empty());
 
+  field_name.iov_base = field_value.iov_base = NULL;
+  field_name.iov_len = field_value.iov_len = 0;
+
   ps = p = *buffer_;
   eof = ps + buffer_->size();
 }
 
 HttpMessageParser::HttpMessageParser(const ::std::string& buffer)
-  : buffer_(Buffer::copy(buffer)) {
+  : buffer_(Buffer::copy(buffer)),
+    cs(0) {
   CHECK(!buffer.empty());
 
+  field_name.iov_base = field_value.iov_base = NULL;
+  field_name.iov_len = field_value.iov_len = 0;
+
   ps = p = *buffer_;
   eof = ps + buffer_->size();
 }
 
+void HttpMessageParser::rebase(::std::shared_ptr<Buffer> buffer) {
+  ::std::shared_ptr<Buffer> old_buffer;
+  old_buffer.swap(buffer_);
+  const char* old_ps = ps;
+
+  buffer_ = buffer;
+  ps = *buffer_;
+  p = ps + (p - old_ps);
+  eof = ps + buffer_->size();
+
+  rebase(field_name, old_ps);
+  rebase(field_value, old_ps);
+  field_index_.rebase(old_ps - static_cast<const char*>(*old_buffer));
+}
+
+void HttpMessageParser::rebase(iovec& mark, const char* old_ps) const {
+  if (mark.iov_base != NULL && mark.iov_base >= old_ps) {
+    mark.iov_base = ps + (static_cast<char*>(mark.iov_base) - old_ps);
+  } else { // Unset, or left over from an earlier message
+    mark.iov_base = NULL;
+    mark.iov_len = 0;
+  }
+}
+
 bool
 HttpMessageParser::parse_body(
   size_t content_length,
@@ -115,7 +147,7 @@ void HttpMessageParser::parse_body_chunks(ParseCallbacks& callbacks) {
 
   CHECK(cs == chunk_parser_error);
   if (p == eof && chunk_size != 0) {
-    callbacks.read(::std::make_shared<Buffer>(chunk_size + 2)); // Assumes no trailers.
+    callbacks.read(BufferPool::get(chunk_size + 2)); // Assumes no trailers.
   }
 }
 
@@ -309,14 +341,10 @@ HttpMessageParser::parse_fields(
 bool
 HttpMessageParser::parse_fields(
   uint16_t& fields_offset,
-  size_t& content_length
+  size_t& content_length,
+  bool resume
 ) {
-  fields_offset = static_cast<uint16_t>(p - ps);
-
-  content_length = 0;
-
-  int cs;
-  iovec field_name = {0, 0}, field_value = {0, 0};
+  const char* pe = eof;
 
   %%{
     machine fields_parser;
@@ -331,17 +359,35 @@ HttpMessageParser::parse_fields(
           field_value,
           content_length
         );
+        field_index_.insert(
+          static_cast<const char*>(*buffer_),
+          field_name,
+          field_value
+        );
       }
     )* crlf
     @{ fbreak; }
     $err{ return false; };
 
     write data;
-    write init;
-    write exec noend;
   }%%
 
-  return cs != fields_parser_error;
+  if (!resume) {
+    fields_offset = static_cast<uint16_t>(p - static_cast<char*>(*buffer_));
+    content_length = 0;
+    field_index_.clear();
+
+    %% write init;
+  }
+
+  %% write exec;
+
+  if (cs >= fields_parser_first_final) {
+    field_index_.size(p - static_cast<char*>(*buffer_));
+    return true;
+  } else {
+    return false;
+  }
 }
 }
 }
@@ -109,6 +109,120 @@ HttpRequest::Method::parse(
   throw Exception("unknown method");
 }
 
+const size_t HttpRequest::BYTE_RANGES_MAX;
+
+// Parse a decimal uint64_t at p, advancing p; false if there is none or
+// it overflows.
+static bool parse_uint64(const char*& p, const char* pe, uint64_t& value) {
+  const char* ps = p;
+  value = 0;
+  for (; p < pe && *p >= '0' && *p <= '9'; ++p) {
+    uint64_t digit = static_cast<uint64_t>(*p - '0');
+    if (value > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    value = value * 10 + digit;
+  }
+  return p > ps;
+}
+
+static void skip_spaces(const char*& p, const char* pe) {
+  while (p < pe && (*p == ' ' || *p == '\t')) {
+    ++p;
+  }
+}
+
+bool
+HttpRequest::get_byte_ranges(
+  uint64_t instance_length,
+  ::std::vector<ByteRange>& byte_ranges
+) const {
+  byte_ranges.clear();
+
+  iovec range;
+  if (!get_field("Range", 5, range)) {
+    return false;
+  }
+
+  const char* p = static_cast<const char*>(range.iov_base);
+  const char* pe = p + range.iov_len;
+  for (const char* bytes_unit = "bytes="; *bytes_unit != 0; ++bytes_unit) {
+    if (p == pe || (*p | 0x20) != (*bytes_unit | 0x20)) {
+      return false;
+    }
+    ++p;
+  }
+
+  size_t byte_range_specs_count = 0;
+  for (;;) {
+    skip_spaces(p, pe);
+
+    uint64_t first_byte_pos, last_byte_pos;
+    if (p < pe && *p == '-') {
+      // suffix-byte-range-spec: the last N bytes
+      ++p;
+      uint64_t suffix_length;
+      if (!parse_uint64(p, pe, suffix_length)) {
+        byte_ranges.clear();
+        return false;
+      }
+      if (suffix_length == 0 || instance_length == 0) {
+        first_byte_pos = 1;
+        last_byte_pos = 0; // Unsatisfiable
+      } else {
+        first_byte_pos
+          = suffix_length < instance_length
+            ? instance_length - suffix_length
+            : 0;
+        last_byte_pos = instance_length - 1;
+      }
+    } else {
+      if (!parse_uint64(p, pe, first_byte_pos) || p == pe || *p != '-') {
+        byte_ranges.clear();
+        return false;
+      }
+      ++p;
+      if (p < pe && *p >= '0' && *p <= '9') {
+        if (!parse_uint64(p, pe, last_byte_pos)) {
+          byte_ranges.clear();
+          return false;
+        }
+        if (last_byte_pos < first_byte_pos) {
+          byte_ranges.clear();
+          return false;
+        }
+      } else {
+        last_byte_pos = UINT64_MAX;
+      }
+      if (last_byte_pos >= instance_length) {
+        last_byte_pos = instance_length - 1;
+      }
+    }
+
+    if (++byte_range_specs_count > BYTE_RANGES_MAX) {
+      byte_ranges.clear();
+      return false;
+    }
+
+    if (first_byte_pos < instance_length && first_byte_pos <= last_byte_pos) {
+      ByteRange byte_range;
+      byte_range.first_byte_pos = first_byte_pos;
+      byte_range.last_byte_pos = last_byte_pos;
+      byte_ranges.push_back(byte_range);
+    }
+
+    skip_spaces(p, pe);
+    if (p == pe) {
+      return true;
+    } else if (*p == ',') {
+      ++p;
+    } else {
+      byte_ranges.clear();
+      return false;
+    }
+  }
+}
+
 void HttpRequest::init_header() {
   header()->put(method_.get_name(), method_.get_name_len());
 
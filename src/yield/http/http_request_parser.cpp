@@ -27,7 +27,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
+#include "yield/buffer_view.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/http_request_parser.hpp"
 #include "yield/http/http_response.hpp"
@@ -46,84 +47,183 @@ namespace yield {
 namespace http {
 using yield::uri::Uri;
 
+void HttpRequestParser::handle_http_request(
+  ParseCallbacks& callbacks,
+  ::std::shared_ptr<Buffer> body
+) {
+  iovec uri_fragment = {0, 0};
+  Uri uri(
+    buffer_,
+    uri_fragment,
+    uri_host_,
+    uri_path_,
+    uri_port_,
+    uri_query_,
+    uri_scheme_,
+    uri_userinfo_
+  );
+
+  state_ = State::START;
+  // The header ends where the index does. A view bounded there keeps the
+  // request out of the rest of the buffer, which later requests are received
+  // and parsed into.
+  callbacks.handle_http_request(
+    body,
+    fields_offset_,
+    field_index_,
+    ::std::make_shared<BufferView>(buffer_, 0, field_index_.size()),
+    http_version_,
+    method_,
+    uri
+  );
+}
+
 void HttpRequestParser::parse(ParseCallbacks& callbacks) {
-  if (p < eof) {
-    ps = p;
+  if (state_ == State::BODY && body_ != NULL) {
+    if (body_->size() < content_length_) {
+      callbacks.read(body_);
+    } else {
+      ::std::shared_ptr<Buffer> body;
+      body.swap(body_);
+      handle_http_request(callbacks, body);
+    }
+    return;
+  }
+
+  // Pick up any data received into the buffer since the last call.
+  eof = static_cast<const char*>(*buffer_) + buffer_->size();
+
+  bool resume = true;
 
-    uint8_t http_version;
-    HttpRequest::Method method;
-    iovec uri_fragment = {0, 0};
-    iovec uri_host = {0, 0};
-    iovec uri_path = {0, 0};
-    uint16_t uri_port = 0;
-    iovec uri_query = {0, 0};
-    iovec uri_scheme = {0, 0};
-    iovec uri_userinfo = {0, 0};
+  if (state_ == State::START) {
+    if (p == eof) {
+      // Receive the next request into a new buffer rather than into the rest
+      // of this one, so that it is unlikely to outgrow the buffer and have to
+      // be moved.
+      buffer_ = BufferPool::get(Buffer::getpagesize());
+      ps = p = *buffer_;
+      eof = p;
+      callbacks.read(buffer_);
+      return;
+    }
 
+    ps = p;
+    uri_host_.iov_base = uri_path_.iov_base = uri_query_.iov_base = NULL;
+    uri_scheme_.iov_base = uri_userinfo_.iov_base = NULL;
+    uri_host_.iov_len = uri_path_.iov_len = uri_query_.iov_len = 0;
+    uri_scheme_.iov_len = uri_userinfo_.iov_len = 0;
+    uri_port_ = 0;
+    state_ = State::REQUEST_LINE;
+    resume = false;
+  }
+
+  if (state_ == State::REQUEST_LINE) {
     if (
-      parse_request_line(
-        http_version,
-        method,
-        uri_host,
-        uri_path,
-        uri_port,
-        uri_query,
-        uri_scheme,
-        uri_userinfo
+      !parse_request_line(
+        http_version_,
+        method_,
+        uri_host_,
+        uri_path_,
+        uri_port_,
+        uri_query_,
+        uri_scheme_,
+        uri_userinfo_,
+        resume
       )
     ) {
-      Uri uri(
-        buffer_,
-        uri_fragment,
-        uri_host,
-        uri_path,
-        uri_port,
-        uri_query,
-        uri_scheme,
-        uri_userinfo
-      );
-
-      uint16_t fields_offset;
-      size_t content_length;
-      if (parse_fields(fields_offset, content_length)) {
-	    ::std::shared_ptr<Buffer> body;
-        if (parse_body(content_length, body)) {
-          callbacks.handle_http_request(body, fields_offset, buffer_, http_version, method, uri);
-          return;
-        } else {
-          ::std::shared_ptr<Buffer> next_buffer
-          = Buffer::copy(
-              Buffer::getpagesize(),
-              p - ps + content_length,
-              ps,
-              eof - ps
-            );
-          ps = p;
-		  callbacks.read(next_buffer);
-		  return;
-        }
+      if (p == eof) {
+        read(callbacks);
+      } else { // cs == request_line_parser_error
+        state_ = State::START;
+        p = ps;
+        parse_body_chunks(callbacks);
       }
-    } else { // cs == request_line_parser_error
-      parse_body_chunks(callbacks);
-	  return;
+      return;
     }
 
-    if (p == eof) { // EOF parsing
-      ::std::shared_ptr<Buffer> next_buffer
-      = Buffer::copy(
-          Buffer::getpagesize(),
-          eof - ps + Buffer::getpagesize(),
-          ps,
-          eof - ps
-        );
-      p = ps;
-	  callbacks.read(next_buffer);
-    } else { // Error parsing
-	  callbacks.handle_error_http_response(http_version, 400);
+    state_ = State::FIELDS;
+    resume = false;
+  }
+
+  if (state_ == State::FIELDS) {
+    if (!parse_fields(fields_offset_, content_length_, resume)) {
+      if (p == eof) {
+        read(callbacks);
+      } else { // Error parsing
+        state_ = State::START;
+        callbacks.handle_error_http_response(http_version_, 400);
+      }
+      return;
     }
-  } else { // p == eof
-	callbacks.read(::std::make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize()));
+
+    state_ = State::BODY;
+  }
+
+  if (
+    content_length_ == 0
+    ||
+    content_length_ == HttpRequest::CONTENT_LENGTH_CHUNKED
+  ) {
+    handle_http_request(callbacks, NULL);
+  } else if (static_cast<size_t>(eof - p) >= content_length_) {
+    // A view of the body where it was received
+    ::std::shared_ptr<Buffer> body
+    = ::std::make_shared<BufferView>(
+        buffer_,
+        p - static_cast<char*>(*buffer_),
+        content_length_
+      );
+    p += content_length_;
+    handle_http_request(callbacks, body);
+  } else if (
+    static_cast<size_t>(p - static_cast<char*>(*buffer_)) + content_length_
+    <=
+    buffer_->capacity()
+  ) {
+    // Receive the rest of the body into the rest of the buffer.
+    callbacks.read(buffer_);
+  } else {
+    // Receive the rest of the body directly into a buffer of its own.
+    body_ = BufferPool::get(content_length_);
+    body_->put(p, eof - p);
+    p = const_cast<char*>(eof);
+    callbacks.read(body_);
+  }
+}
+
+void HttpRequestParser::read(ParseCallbacks& callbacks) {
+  if (buffer_->size() < buffer_->capacity()) {
+    // Receive into the rest of the buffer, then resume at p. Requests parsed
+    // from the buffer earlier only see their own header's view of it.
+    callbacks.read(buffer_);
+    return;
   }
+
+  // The buffer is full. The header of a request has to be contiguous, so
+  // move the partial request to a new buffer, the only copy of it, and
+  // resume at p there with the machine state and the marks moved along.
+  ::std::shared_ptr<Buffer> old_buffer = buffer_;
+  const char* old_ps = ps;
+  rebase(
+    Buffer::copy(
+      Buffer::getpagesize(),
+      eof - ps + Buffer::getpagesize(),
+      ps,
+      eof - ps
+    )
+  );
+  if (state_ == State::FIELDS) {
+    fields_offset_
+    = static_cast<uint16_t>(
+        fields_offset_ - (old_ps - static_cast<const char*>(*old_buffer))
+      );
+  }
+  rebase(uri_host_, old_ps);
+  rebase(uri_path_, old_ps);
+  rebase(uri_query_, old_ps);
+  rebase(uri_scheme_, old_ps);
+  rebase(uri_userinfo_, old_ps);
+  callbacks.read(buffer_);
 }
 
 bool HttpRequestParser::parse_request_line(
@@ -134,12 +234,13 @@ bool HttpRequestParser::parse_request_line(
   uint16_t& port,
   iovec& query,
   iovec& scheme,
-  iovec& userinfo
+  iovec& userinfo,
+  bool resume
 ) {
-  int cs;
+  const char* pe = eof;
 
   
-/* #line 140 "http_request_parser.cpp" */
+/* #line 244 "http_request_parser.cpp" */
 static const char _request_line_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 5, 1, 
 	6, 1, 7, 1, 8, 1, 9, 1, 
@@ -3141,12 +3242,21 @@ static const int request_line_parser_error = 0;
 static const int request_line_parser_en_main = 1;
 
 
-/* #line 3140 "http_request_parser.cpp" */
+/* #line 291 "http_request_parser.rl" */
+
+
+  if (!resume) {
+    
+/* #line 3251 "http_request_parser.cpp" */
 	{
 	cs = request_line_parser_start;
 	}
 
-/* #line 3143 "http_request_parser.cpp" */
+/* #line 295 "http_request_parser.rl" */
+  }
+
+  
+/* #line 3260 "http_request_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -3154,6 +3264,8 @@ static const int request_line_parser_en_main = 1;
 	unsigned int _nacts;
 	const unsigned char *_keys;
 
+	if ( p == pe )
+		goto _test_eof;
 	if ( cs == 0 )
 		goto _out;
 _resume:
@@ -3271,97 +3383,97 @@ _match:
 	{ query.iov_len = p - static_cast<char*>(query.iov_base); }
 	break;
 	case 13:
-/* #line 148 "http_request_parser.rl" */
+/* #line 249 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::CONNECT; }
 	break;
 	case 14:
-/* #line 149 "http_request_parser.rl" */
+/* #line 250 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::COPY; }
 	break;
 	case 15:
-/* #line 150 "http_request_parser.rl" */
+/* #line 251 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::DELETE; }
 	break;
 	case 16:
-/* #line 151 "http_request_parser.rl" */
+/* #line 252 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::GET; }
 	break;
 	case 17:
-/* #line 152 "http_request_parser.rl" */
+/* #line 253 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::HEAD; }
 	break;
 	case 18:
-/* #line 153 "http_request_parser.rl" */
+/* #line 254 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::LOCK; }
 	break;
 	case 19:
-/* #line 154 "http_request_parser.rl" */
+/* #line 255 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::MKCOL; }
 	break;
 	case 20:
-/* #line 155 "http_request_parser.rl" */
+/* #line 256 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::MOVE; }
 	break;
 	case 21:
-/* #line 156 "http_request_parser.rl" */
+/* #line 257 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::OPTIONS; }
 	break;
 	case 22:
-/* #line 157 "http_request_parser.rl" */
+/* #line 258 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::PATCH; }
 	break;
 	case 23:
-/* #line 158 "http_request_parser.rl" */
+/* #line 259 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::POST; }
 	break;
 	case 24:
-/* #line 159 "http_request_parser.rl" */
+/* #line 260 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::PROPFIND; }
 	break;
 	case 25:
-/* #line 160 "http_request_parser.rl" */
+/* #line 261 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::PROPPATCH; }
 	break;
 	case 26:
-/* #line 161 "http_request_parser.rl" */
+/* #line 262 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::PUT; }
 	break;
 	case 27:
-/* #line 162 "http_request_parser.rl" */
+/* #line 263 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::TRACE; }
 	break;
 	case 28:
-/* #line 163 "http_request_parser.rl" */
+/* #line 264 "http_request_parser.rl" */
 	{ method = HttpRequest::Method::UNLOCK; }
 	break;
 	case 29:
-/* #line 175 "http_request_parser.rl" */
+/* #line 276 "http_request_parser.rl" */
 	{ path.iov_base = p; }
 	break;
 	case 30:
-/* #line 176 "http_request_parser.rl" */
+/* #line 277 "http_request_parser.rl" */
 	{ path.iov_len = p - static_cast<char*>(path.iov_base); }
 	break;
 	case 31:
-/* #line 187 "http_request_parser.rl" */
+/* #line 288 "http_request_parser.rl" */
 	{ {p++; goto _out; } }
 	break;
-/* #line 3310 "http_request_parser.cpp" */
+/* #line 3462 "http_request_parser.cpp" */
 		}
 	}
 
 _again:
 	if ( cs == 0 )
 		goto _out;
-	p += 1;
-	goto _resume;
+	if ( ++p != pe )
+		goto _resume;
+	_test_eof: {}
 	_out: {}
 	}
 
-/* #line 192 "http_request_parser.rl" */
-
+/* #line 298 "http_request_parser.rl" */
 
-  return cs != request_line_parser_error;
+  return cs >= request_line_parser_first_final;
 }
 }
 }
@@ -25,7 +25,8 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
+#include "yield/buffer_view.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/http_request_parser.hpp"
 #include "yield/http/http_response.hpp"
@@ -44,84 +45,183 @@ namespace yield {
 namespace http {
 using yield::uri::Uri;
 
+void HttpRequestParser::handle_http_request(
+  ParseCallbacks& callbacks,
+  ::std::shared_ptr<Buffer> body
+) {
+  iovec uri_fragment = {0, 0};
+  Uri uri(
+    buffer_,
+    uri_fragment,
+    uri_host_,
+    uri_path_,
+    uri_port_,
+    uri_query_,
+    uri_scheme_,
+    uri_userinfo_
+  );
+
+  state_ = State::START;
+  // The header ends where the index does. A view bounded there keeps the
+  // request out of the rest of the buffer, which later requests are received
+  // and parsed into.
+  callbacks.handle_http_request(
+    body,
+    fields_offset_,
+    field_index_,
+    ::std::make_shared<BufferView>(buffer_, 0, field_index_.size()),
+    http_version_,
+    method_,
+    uri
+  );
+}
+
 void HttpRequestParser::parse(ParseCallbacks& callbacks) {
-  if (p < eof) {
-    ps = p;
+  if (state_ == State::BODY && body_ != NULL) {
+    if (body_->size() < content_length_) {
+      callbacks.read(body_);
+    } else {
+      ::std::shared_ptr<Buffer> body;
+      body.swap(body_);
+      handle_http_request(callbacks, body);
+    }
+    return;
+  }
 
-    uint8_t http_version;
-    HttpRequest::Method method;
-    iovec uri_fragment = {0, 0};
-    iovec uri_host = {0, 0};
-    iovec uri_path = {0, 0};
-    uint16_t uri_port = 0;
-    iovec uri_query = {0, 0};
-    iovec uri_scheme = {0, 0};
-    iovec uri_userinfo = {0, 0};
+  // Pick up any data received into the buffer since the last call.
+  eof = static_cast<const char*>(*buffer_) + buffer_->size();
 
+  bool resume = true;
+
+  if (state_ == State::START) {
+    if (p == eof) {
+      // Receive the next request into a new buffer rather than into the rest
+      // of this one, so that it is unlikely to outgrow the buffer and have to
+      // be moved.
+      buffer_ = BufferPool::get(Buffer::getpagesize());
+      ps = p = *buffer_;
+      eof = p;
+      callbacks.read(buffer_);
+      return;
+    }
+
+    ps = p;
+    uri_host_.iov_base = uri_path_.iov_base = uri_query_.iov_base = NULL;
+    uri_scheme_.iov_base = uri_userinfo_.iov_base = NULL;
+    uri_host_.iov_len = uri_path_.iov_len = uri_query_.iov_len = 0;
+    uri_scheme_.iov_len = uri_userinfo_.iov_len = 0;
+    uri_port_ = 0;
+    state_ = State::REQUEST_LINE;
+    resume = false;
+  }
+
+  if (state_ == State::REQUEST_LINE) {
     if (
-      parse_request_line(
-        http_version,
-        method,
-        uri_host,
-        uri_path,
-        uri_port,
-        uri_query,
-        uri_scheme,
-        uri_userinfo
+      !parse_request_line(
+        http_version_,
+        method_,
+        uri_host_,
+        uri_path_,
+        uri_port_,
+        uri_query_,
+        uri_scheme_,
+        uri_userinfo_,
+        resume
       )
     ) {
-      Uri uri(
-        buffer_,
-        uri_fragment,
-        uri_host,
-        uri_path,
-        uri_port,
-        uri_query,
-        uri_scheme,
-        uri_userinfo
-      );
-
-      uint16_t fields_offset;
-      size_t content_length;
-      if (parse_fields(fields_offset, content_length)) {
-	    ::std::shared_ptr<Buffer> body;
-        if (parse_body(content_length, body)) {
-          callbacks.handle_http_request(body, fields_offset, buffer_, http_version, method, uri);
-          return;
-        } else {
-          ::std::shared_ptr<Buffer> next_buffer
-          = Buffer::copy(
-              Buffer::getpagesize(),
-              p - ps + content_length,
-              ps,
-              eof - ps
-            );
-          ps = p;
-		  callbacks.read(next_buffer);
-		  return;
-        }
+      if (p == eof) {
+        read(callbacks);
+      } else { // cs == request_line_parser_error
+        state_ = State::START;
+        p = ps;
+        parse_body_chunks(callbacks);
       }
-    } else { // cs == request_line_parser_error
-      parse_body_chunks(callbacks);
-	  return;
+      return;
     }
 
-    if (p == eof) { // EOF parsing
-      ::std::shared_ptr<Buffer> next_buffer
-      = Buffer::copy(
-          Buffer::getpagesize(),
-          eof - ps + Buffer::getpagesize(),
-          ps,
-          eof - ps
-        );
-      p = ps;
-	  callbacks.read(next_buffer);
-    } else { // Error parsing
-	  callbacks.handle_error_http_response(http_version, 400);
+    state_ = State::FIELDS;
+    resume = false;
+  }
+
+  if (state_ == State::FIELDS) {
+    if (!parse_fields(fields_offset_, content_length_, resume)) {
+      if (p == eof) {
+        read(callbacks);
+      } else { // Error parsing
+        state_ = State::START;
+        callbacks.handle_error_http_response(http_version_, 400);
+      }
+      return;
     }
-  } else { // p == eof
-	callbacks.read(::std::make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize()));
+
+    state_ = State::BODY;
+  }
+
+  if (
+    content_length_ == 0
+    ||
+    content_length_ == HttpRequest::CONTENT_LENGTH_CHUNKED
+  ) {
+    handle_http_request(callbacks, NULL);
+  } else if (static_cast<size_t>(eof - p) >= content_length_) {
+    // A view of the body where it was received
+    ::std::shared_ptr<Buffer> body
+    = ::std::make_shared<BufferView>(
+        buffer_,
+        p - static_cast<char*>(*buffer_),
+        content_length_
+      );
+    p += content_length_;
+    handle_http_request(callbacks, body);
+  } else if (
+    static_cast<size_t>(p - static_cast<char*>(*buffer_)) + content_length_
+    <=
+    buffer_->capacity()
+  ) {
+    // Receive the rest of the body into the rest of the buffer.
+    callbacks.read(buffer_);
+  } else {
+    // Receive the rest of the body directly into a buffer of its own.
+    body_ = BufferPool::get(content_length_);
+    body_->put(p, eof - p);
+    p = const_cast<char*>(eof);
+    callbacks.read(body_);
+  }
+}
+
+void HttpRequestParser::read(ParseCallbacks& callbacks) {
+  if (buffer_->size() < buffer_->capacity()) {
+    // Receive into the rest of the buffer, then resume at p. Requests parsed
+    // from the buffer earlier only see their own header's view of it.
+    callbacks.read(buffer_);
+    return;
+  }
+
+  // The buffer is full. The header of a request has to be contiguous, so
+  // move the partial request to a new buffer, the only copy of it, and
+  // resume at p there with the machine state and the marks moved along.
+  ::std::shared_ptr<Buffer> old_buffer = buffer_;
+  const char* old_ps = ps;
+  rebase(
+    Buffer::copy(
+      Buffer::getpagesize(),
+      eof - ps + Buffer::getpagesize(),
+      ps,
+      eof - ps
+    )
+  );
+  if (state_ == State::FIELDS) {
+    fields_offset_
+    = static_cast<uint16_t>(
+        fields_offset_ - (old_ps - static_cast<const char*>(*old_buffer))
+      );
   }
+  rebase(uri_host_, old_ps);
+  rebase(uri_path_, old_ps);
+  rebase(uri_query_, old_ps);
+  rebase(uri_scheme_, old_ps);
+  rebase(uri_userinfo_, old_ps);
+  callbacks.read(buffer_);
 }
 
 bool HttpRequestParser::parse_request_line(
@@ -132,9 +232,10 @@ bool HttpRequestParser::parse_request_line(
   uint16_t& port,
   iovec& query,
   iovec& scheme,
-  iovec& userinfo
+  iovec& userinfo,
+  bool resume
 ) {
-  int cs;
+  const char* pe = eof;
 
   %%{
     machine request_line_parser;
@@ -187,11 +288,15 @@ bool HttpRequestParser::parse_request_line(
             @{ fbreak; };
 
     write data;
-    write init;
-    write exec noend;
   }%%
 
-  return cs != request_line_parser_error;
+  if (!resume) {
+    %% write init;
+  }
+
+  %% write exec;
+
+  return cs >= request_line_parser_first_final;
 }
 }
 }
@@ -220,7 +220,7 @@ void HttpResponse::init() {
 
   set_fields_offset(static_cast<uint16_t>(header()->size()));
 
-  set_field("Date", DateTime::now());
+  set_date_field();
 }
 
 std::ostream& operator<<(std::ostream& os, const HttpResponse& http_response) {
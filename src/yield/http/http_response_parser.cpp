@@ -27,7 +27,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/http_response_parser.hpp"
 
@@ -55,7 +55,7 @@ void HttpResponseParser::parse(ParseCallbacks& callbacks) {
       if (parse_fields(fields_offset, content_length)) {
         ::std::shared_ptr<Buffer> body;
         if (parse_body(content_length, body)) {
-          callbacks.handle_http_response(body, fields_offset, buffer_, http_version, status_code);
+          callbacks.handle_http_response(body, fields_offset, field_index_, buffer_, http_version, status_code);
         } else {
           ::std::shared_ptr<Buffer> next_buffer
             = Buffer::copy(
@@ -88,7 +88,7 @@ void HttpResponseParser::parse(ParseCallbacks& callbacks) {
       callbacks.handle_http_response(NULL, http_version, 400);
     }
   } else { // p == eof
-    callbacks.read(::std::make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize()));
+    callbacks.read(BufferPool::get(Buffer::getpagesize()));
   }
 }
 
@@ -100,7 +100,7 @@ HttpResponseParser::parse_status_line(
   int cs;
 
   
-/* #line 101 "http_response_parser.cpp" */
+/* #line 104 "http_response_parser.cpp" */
 static const char _status_line_parser_actions[] = {
 	0, 1, 0, 1, 1, 1, 2, 1, 
 	3, 1, 4
@@ -165,12 +165,12 @@ static const int status_line_parser_error = 0;
 static const int status_line_parser_en_main = 1;
 
 
-/* #line 164 "http_response_parser.cpp" */
+/* #line 169 "http_response_parser.cpp" */
 	{
 	cs = status_line_parser_start;
 	}
 
-/* #line 167 "http_response_parser.cpp" */
+/* #line 174 "http_response_parser.cpp" */
 	{
 	int _klen;
 	unsigned int _trans;
@@ -262,7 +262,7 @@ _match:
 /* #line 117 "http_response_parser.rl" */
 	{ return false; }
 	break;
-/* #line 253 "http_response_parser.cpp" */
+/* #line 266 "http_response_parser.cpp" */
 		}
 	}
 
@@ -281,7 +281,7 @@ _again:
 /* #line 117 "http_response_parser.rl" */
 	{ return false; }
 	break;
-/* #line 270 "http_response_parser.cpp" */
+/* #line 285 "http_response_parser.cpp" */
 		}
 	}
 	}
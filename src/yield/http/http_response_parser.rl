@@ -25,7 +25,7 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yield/buffer.hpp"
+#include "yield/buffer_pool.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/http_response_parser.hpp"
 
@@ -53,7 +53,7 @@ void HttpResponseParser::parse(ParseCallbacks& callbacks) {
       if (parse_fields(fields_offset, content_length)) {
         ::std::shared_ptr<Buffer> body;
         if (parse_body(content_length, body)) {
-          callbacks.handle_http_response(body, fields_offset, buffer_, http_version, status_code);
+          callbacks.handle_http_response(body, fields_offset, field_index_, buffer_, http_version, status_code);
         } else {
           ::std::shared_ptr<Buffer> next_buffer
             = Buffer::copy(
@@ -86,7 +86,7 @@ void HttpResponseParser::parse(ParseCallbacks& callbacks) {
       callbacks.handle_http_response(NULL, http_version, 400);
     }
   } else { // p == eof
-    callbacks.read(::std::make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize()));
+    callbacks.read(BufferPool::get(Buffer::getpagesize()));
   }
 }
 
@@ -25,40 +25,63 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "yield/buffer_pool.hpp"
+#include "yield/buffer_view.hpp"
 #include "yield/logging.hpp"
 #include "yield/fs/file.hpp"
 #include "yield/http/http_request_parser.hpp"
 #include "yield/http/server/http_server_connection.hpp"
 #include "yield/http/server/http_server_request.hpp"
-#include "yield/sockets/aio/send_aiocb.hpp"
-#include "yield/sockets/aio/sendfile_aiocb.hpp"
 
 namespace yield {
 namespace http {
 namespace server {
 using ::std::make_shared;
+using ::std::move;
 using ::std::shared_ptr;
 using ::std::unique_ptr;
+using ::std::vector;
 using ::yield::fs::File;
 using ::yield::sockets::Socket;
 using ::yield::sockets::SocketAddress;
 using ::yield::sockets::StreamSocket;
 using ::yield::sockets::TcpSocket;
 using ::yield::sockets::aio::AcceptAiocb;
-using ::yield::sockets::aio::RecvAiocb;
-using ::yield::sockets::aio::SendAiocb;
-using ::yield::sockets::aio::SendfileAiocb;
+using ::yield::thread::Mutex;
+
+namespace {
+// Append buffer to the chain of Buffers from head to tail.
+void
+chain(
+  shared_ptr<Buffer> buffer,
+  shared_ptr<Buffer>& head,
+  shared_ptr<Buffer>& tail
+) {
+  if (head == NULL) {
+    head = buffer;
+  } else {
+    tail->set_next_buffer(buffer);
+  }
+  tail = buffer;
+}
+}
 
 class HttpServerConnection::ParseCallbacks final : public HttpRequestParser::ParseCallbacks {
 public:
   ParseCallbacks(HttpServerConnection& connection)
-    : connection_(connection) {
+    : connection_(connection),
+      handled_http_request_(false) {
+  }
+
+  bool handled_http_request() const {
+    return handled_http_request_;
   }
 
   void handle_error_http_response(uint8_t http_version, uint16_t status_code) override {
       unique_ptr<HttpServerResponse> http_response(new HttpServerResponse(http_version, status_code));
+      http_response->set_content_length_field(0);
       DLOG(DEBUG) << "parsed " << *http_response;
-      connection_.handle(move(http_response));
+      connection_.handle(move(http_response), connection_.reserve_response());
   }
 
   void handle_http_message_body_chunk(shared_ptr<Buffer> data) override {
@@ -68,25 +91,37 @@ public:
   handle_http_request(
     ::std::shared_ptr<Buffer> body,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     HttpRequest::Method method,
     const yield::uri::Uri& uri
   ) {
-      unique_ptr<HttpServerRequest> http_request(new HttpServerRequest(body, connection_.shared_from_this(), fields_offset, header, http_version, method, uri));
+      unique_ptr<HttpServerRequest> http_request(new HttpServerRequest(body, connection_.shared_from_this(), fields_offset, field_index, header, http_version, method, uri));
+      ++connection_.requests_count_;
+      uint64_t response_sequence_number = connection_.reserve_response();
+      http_request->response_sequence_number_ = response_sequence_number;
       DLOG(DEBUG) << "parsed " << *http_request;
-      connection_.event_handler_->tryenqueue(move(http_request));
+      if (connection_.event_handler_->tryenqueue(move(http_request)) != NULL) {
+        unique_ptr<HttpServerResponse> http_response(new HttpServerResponse(http_version, 503));
+        http_response->set_content_length_field(0);
+        connection_.handle(move(http_response), response_sequence_number);
+      }
+      handled_http_request_ = true;
   }
 
   void read(shared_ptr<Buffer> buffer) override {
-    unique_ptr<RecvAiocb> recv_aiocb(new RecvAiocb(buffer, connection_.shared_from_this(), 0));
-    if (connection_.aio_queue_->tryenqueue(move(recv_aiocb))) {
-      connection_.state_ = State::ERROR;
-    }
+    connection_.recv(buffer);
+  }
+
+public:
+  void reset() {
+    handled_http_request_ = false;
   }
 
 private:
   HttpServerConnection& connection_;
+  bool handled_http_request_;
 };
 
 void HttpServerConnection::handle(unique_ptr<AcceptAiocb> accept_aiocb) {
@@ -97,77 +132,355 @@ void HttpServerConnection::handle(unique_ptr<AcceptAiocb> accept_aiocb) {
   ) {
     parse(accept_aiocb->recv_buffer());
   } else {
-    shared_ptr<Buffer> recv_buffer
-    = make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize());
-    unique_ptr<RecvAiocb> recv_aiocb(new RecvAiocb(recv_buffer, shared_from_this(), 0));
-    if (aio_queue_->tryenqueue(move(recv_aiocb))) {
-      state_ = State::ERROR;
-    }
+    recv(BufferPool::get(Buffer::getpagesize()));
   }
 }
 
 void
 HttpServerConnection::handle(
-  unique_ptr<HttpMessageBodyChunk> http_message_body_chunk
+  unique_ptr<HttpMessageBodyChunk> http_message_body_chunk,
+  uint64_t sequence_number
 ) {
-  shared_ptr<Buffer> send_buffer;
-  if (http_message_body_chunk->data()) {
-    send_buffer = http_message_body_chunk->data();
+  Mutex::Holder responses_mutex_holder(responses_mutex_);
+
+  if (state_ != State::CONNECTED) {
+    return;
+  }
+
+  size_t response_i;
+  if (sequence_number == SEQUENCE_NUMBER_NONE) {
+    if (responses_.empty()) {
+      LOG(ERROR) << "dropping body chunk without a response";
+      return;
+    }
+    response_i = responses_.size() - 1;
+  } else if (sequence_number < response_sequence_number_) {
+    LOG(ERROR) << "dropping body chunk of a response that has been sent";
+    return;
   } else {
-    send_buffer = Buffer::copy("0\r\n\r\n", 5);
+    response_i = static_cast<size_t>(sequence_number - response_sequence_number_);
+    size_t responses_size = responses_.size();
+    CHECK_LT(response_i, responses_size);
   }
 
-  unique_ptr<SendAiocb> send_aiocb(new SendAiocb(shared_ptr<Socket>(socket_), send_buffer, 0));
-  if (aio_queue_->tryenqueue(move(send_aiocb))) {
-    state_ = State::ERROR;
+  // Sent after the response header, whether or not that has gone out yet.
+  Response& response = responses_[response_i];
+  if (http_message_body_chunk->data()) {
+    response.chunks.push_back(http_message_body_chunk->data());
+  } else {
+    response.chunks.push_back(Buffer::copy("0\r\n\r\n", 5));
+    response.last_chunk = true;
   }
+
+  send_ready_responses();
 }
 
 void
 HttpServerConnection::handle(
-  unique_ptr<HttpServerResponse> http_response
+  unique_ptr<HttpServerResponse> http_response,
+  uint64_t sequence_number
 ) {
-  DLOG(DEBUG) << "sending " << *http_response;
-
-  http_response->finalize();
-
-  if (http_response->body_buffer()) {
-    CHECK(!http_response->body_file());
-    http_response->header()->set_next_buffer(http_response->body_buffer());
-  } else if (http_response->body_file()) {
-    unique_ptr<SendAiocb> send_aiocb(new SendAiocb(socket_, http_response->header(), 0));
-    if (aio_queue_->tryenqueue(move(send_aiocb)) == NULL) {
-      unique_ptr<SendfileAiocb> sendfile_aiocb(new SendfileAiocb(shared_ptr<StreamSocket>(socket_), *http_response->body_file()));
-      if (aio_queue_->tryenqueue(move(sendfile_aiocb)) == NULL) {
-        return;
-      } else {
-        state_ = State::ERROR;
-      }
-    } else {
-      state_ = State::ERROR;
-    }
+  Mutex::Holder responses_mutex_holder(responses_mutex_);
+
+  // The responses to the remaining requests are dropped after an error.
+  if (state_ != State::CONNECTED) {
+    return;
   }
 
-  unique_ptr<SendAiocb> send_aiocb(new SendAiocb(socket_, http_response->header(), 0));
-  if (aio_queue_->tryenqueue(move(send_aiocb))) {
-    state_ = State::ERROR;
+  size_t response_i;
+  if (sequence_number == SEQUENCE_NUMBER_NONE) {
+    // Never a slot reserved by reserve_response, which its request's
+    // response will fill.
+    Response response;
+    response.recv_i = responses_.empty() ? 0 : responses_.back().recv_i;
+    responses_.push_back(move(response));
+    response_i = responses_.size() - 1;
+  } else {
+    CHECK_GE(sequence_number, response_sequence_number_);
+    response_i = static_cast<size_t>(sequence_number - response_sequence_number_);
+    size_t responses_size = responses_.size();
+    CHECK_LT(response_i, responses_size);
   }
+
+  Response& response = responses_[response_i];
+  CHECK(response.http_response == NULL);
+  response.chunked
+    = http_response->get_content_length()
+      == HttpServerResponse::CONTENT_LENGTH_CHUNKED;
+  response.http_response = move(http_response);
+
+  send_ready_responses();
 }
 
 void
 HttpServerConnection::handle(
   unique_ptr< ::yield::sockets::aio::RecvAiocb > recv_aiocb
 ) {
+  recv_pending_ = false;
   if (recv_aiocb->return_() > 0) {
-    parse(recv_aiocb->buffer());
+    if (state_ == State::CONNECTED) {
+      parse(recv_aiocb->buffer());
+    }
+  } else if (recv_aiocb->return_() < 0) {
+    set_error();
   }
+  // else the peer has stopped sending. The responses to its requests are
+  // still sent, and the socket is closed once they have been.
+}
+
+void
+HttpServerConnection::handle(
+  unique_ptr< ::yield::sockets::aio::SendAiocb > send_aiocb
+) {
+  handle_send(send_aiocb->return_());
+}
+
+void
+HttpServerConnection::handle(
+  unique_ptr< ::yield::sockets::aio::SendfileAiocb > sendfile_aiocb
+) {
+  handle_send(sendfile_aiocb->return_());
+}
+
+void HttpServerConnection::handle_send(ssize_t return_) {
+  Mutex::Holder responses_mutex_holder(responses_mutex_);
+  CHECK_GT(sends_count_, 0u);
+  --sends_count_;
+  if (return_ < 0) {
+    set_error();
+  }
+}
+
+bool HttpServerConnection::has_pending_responses() {
+  Mutex::Holder responses_mutex_holder(responses_mutex_);
+  return !responses_.empty();
 }
 
 void HttpServerConnection::parse(shared_ptr<Buffer> recv_buffer) {
   CHECK(!recv_buffer->empty());
-  HttpRequestParser parser(recv_buffer);
+  // A parser that already exists asked for recv_buffer in
+  // ParseCallbacks::read and resumes on the data appended to it.
+  if (parser_ == NULL) {
+    parser_.reset(new HttpRequestParser(recv_buffer));
+  }
+
+  ++recv_count_;
+
+  // The parser stops after each request, and asks for a read once it has
+  // parsed every complete request in the buffer.
   ParseCallbacks parse_callbacks(*this);
-  parser.parse(parse_callbacks);
+  do {
+    parse_callbacks.reset();
+    parser_->parse(parse_callbacks);
+  } while (
+    parse_callbacks.handled_http_request()
+    &&
+    state_ == State::CONNECTED
+  );
+}
+
+void HttpServerConnection::recv(shared_ptr<Buffer> recv_buffer) {
+  unique_ptr<RecvAiocb> recv_aiocb(new RecvAiocb(recv_buffer, shared_from_this(), 0));
+  if (aio_queue_->tryenqueue(move(recv_aiocb)) == NULL) {
+    recv_pending_ = true;
+  } else {
+    set_error();
+  }
+}
+
+uint64_t HttpServerConnection::reserve_response() {
+  Mutex::Holder responses_mutex_holder(responses_mutex_);
+  Response response;
+  response.recv_i = recv_count_;
+  responses_.push_back(move(response));
+  return response_sequence_number_ + responses_.size() - 1;
+}
+
+void HttpServerConnection::send(shared_ptr<Buffer> send_buffer) {
+  if (state_ != State::CONNECTED) {
+    return;
+  }
+
+  unique_ptr<SendAiocb> send_aiocb(new SendAiocb(send_buffer, shared_from_this()));
+  if (aio_queue_->tryenqueue(move(send_aiocb)) == NULL) {
+    ++sends_count_;
+  } else {
+    set_error();
+  }
+}
+
+void
+HttpServerConnection::send_file(
+  fd_t fd,
+  const HttpServerResponse::BodyPart* body_part
+) {
+  if (state_ != State::CONNECTED) {
+    return;
+  }
+
+  unique_ptr<SendfileAiocb> sendfile_aiocb;
+  if (body_part == NULL) {
+    sendfile_aiocb.reset(new SendfileAiocb(shared_from_this(), fd));
+  } else {
+    sendfile_aiocb.reset(
+      new SendfileAiocb(
+        shared_from_this(),
+        fd,
+        static_cast<off_t>(body_part->offset),
+        static_cast<size_t>(body_part->length)
+      )
+    );
+  }
+  if (aio_queue_->tryenqueue(move(sendfile_aiocb)) == NULL) {
+    ++sends_count_;
+  } else {
+    set_error();
+  }
+}
+
+void HttpServerConnection::send_ready_responses() {
+  // Send the responses that are ready, in request order, but hold back the
+  // ready responses to a receive whose requests have not all been answered,
+  // so that the responses to pipelined requests go out together.
+  // A chunked response is not held back, and holds back the responses after
+  // it until its last chunk.
+  size_t ready_responses_len = 0;
+  while (
+    ready_responses_len < responses_.size()
+    &&
+    responses_[ready_responses_len].http_response != NULL
+  ) {
+    ++ready_responses_len;
+  }
+
+  if (ready_responses_len < responses_.size()) {
+    uint32_t recv_i = responses_[ready_responses_len].recv_i;
+    while (
+      ready_responses_len > 0
+      &&
+      responses_[ready_responses_len - 1].recv_i == recv_i
+      &&
+      !responses_[ready_responses_len - 1].chunked
+    ) {
+      --ready_responses_len;
+    }
+  }
+
+  // Coalesce the responses into one chain of Buffers for a single send.
+  shared_ptr<Buffer> send_buffer, send_buffer_tail;
+  for (; ready_responses_len > 0; --ready_responses_len) {
+    Response& response = responses_.front();
+
+    if (!response.header_sent) {
+      send_response(*response.http_response, send_buffer, send_buffer_tail);
+      response.header_sent = true;
+    }
+
+    for (
+      vector< shared_ptr<Buffer> >::const_iterator chunk_i
+        = response.chunks.begin();
+      chunk_i != response.chunks.end();
+      ++chunk_i
+    ) {
+      chain(make_shared<BufferView>(*chunk_i), send_buffer, send_buffer_tail);
+    }
+    response.chunks.clear();
+
+    if (response.chunked && !response.last_chunk) {
+      break;
+    }
+
+    responses_.pop_front();
+    ++response_sequence_number_;
+  }
+
+  if (send_buffer != NULL) {
+    send(send_buffer);
+  }
+}
+
+void
+HttpServerConnection::send_response(
+  HttpServerResponse& http_response,
+  shared_ptr<Buffer>& send_buffer,
+  shared_ptr<Buffer>& send_buffer_tail
+) {
+  DLOG(DEBUG) << "sending " << http_response;
+
+  http_response.finalize();
+
+  shared_ptr<Buffer>& header = http_response.header();
+  chain(header, send_buffer, send_buffer_tail);
+
+  if (http_response.body_file()) {
+    CHECK(!http_response.body_buffer());
+    fd_t body_fd = *http_response.body_file();
+
+    const vector<HttpServerResponse::BodyPart>& body_parts
+      = http_response.body_parts();
+    if (body_parts.empty()) {
+      send(send_buffer);
+      send_buffer.reset();
+      send_file(body_fd, NULL);
+      return;
+    }
+
+    // Chain in-memory parts (multipart boundaries) onto the pending send
+    // and interleave them with sendfiles of the byte ranges.
+    for (
+      vector<HttpServerResponse::BodyPart>::const_iterator body_part_i
+        = body_parts.begin();
+      body_part_i != body_parts.end();
+      ++body_part_i
+    ) {
+      if (body_part_i->data != NULL) {
+        chain(body_part_i->data, send_buffer, send_buffer_tail);
+      } else if (body_part_i->length > 0) {
+        if (send_buffer != NULL) {
+          send(send_buffer);
+          send_buffer.reset();
+        }
+        send_file(body_fd, &*body_part_i);
+      }
+    }
+    return;
+  }
+
+  shared_ptr<Buffer>& body = http_response.body_buffer();
+  if (body != NULL) {
+    if (body->size() <= header->capacity() - header->size()) {
+      header->put(*body);
+    } else {
+      chain(make_shared<BufferView>(body), send_buffer, send_buffer_tail);
+    }
+  }
+}
+
+void HttpServerConnection::set_error() {
+  // Fail the receive and sends in flight, so that they complete and the
+  // socket can be closed.
+  State connected = State::CONNECTED;
+  if (state_.compare_exchange_strong(connected, State::ERROR)) {
+    socket_->shutdown();
+  }
+}
+
+bool HttpServerConnection::try_close() {
+  Mutex::Holder responses_mutex_holder(responses_mutex_);
+
+  if (state_ == State::CLOSED || recv_pending_ || sends_count_ > 0) {
+    return false;
+  }
+
+  // With no receive pending on a connection that is still CONNECTED the peer
+  // has stopped sending, but may still be owed responses.
+  if (state_ == State::CONNECTED && !responses_.empty()) {
+    return false;
+  }
+
+  // The HttpServerEventQueue closes the socket, after dissociating it
+  state_ = State::CLOSED;
+  return true;
 }
 }
 }
@@ -27,6 +27,7 @@
 
 #include "yield/http/server/http_server_event_queue.hpp"
 
+#include "yield/buffer_pool.hpp"
 #include "yield/logging.hpp"
 #include "yield/http/server/http_server_connection.hpp"
 #include "yield/sockets/tcp_socket.hpp"
@@ -41,6 +42,7 @@ using ::std::move;
 using ::std::shared_ptr;
 using ::std::unique_ptr;
 using ::std::vector;
+using ::yield::poll::FdEventQueue;
 using ::yield::sockets::Socket;
 using ::yield::sockets::SocketAddress;
 using ::yield::sockets::StreamSocket;
@@ -48,52 +50,141 @@ using ::yield::sockets::TcpSocket;
 using ::yield::sockets::aio::AcceptAiocb;
 using ::yield::sockets::aio::SocketAioQueue;
 using ::yield::sockets::aio::RecvAiocb;
+using ::yield::sockets::aio::SendAiocb;
+using ::yield::sockets::aio::SendfileAiocb;
 using ::yield::sockets::aio::SocketAiocb;
 
+const Time HttpServerEventQueue::KEEP_ALIVE_TIMEOUT_DEFAULT(60);
+const Time HttpServerEventQueue::REQUEST_TIMEOUT_DEFAULT(20);
+const Time HttpServerEventQueue::TIMEOUT_TICK(0.25);
+const uint32_t HttpServerEventQueue::SLOT_I_NONE;
+
 HttpServerEventQueue::HttpServerEventQueue(
-  const SocketAddress& sockname
-) throw(Exception) : aio_queue_(SocketAioQueue::create()),
-  socket_(make_shared<TcpSocket>(sockname.get_family())) {
-  init(sockname);
+  const SocketAddress& sockname,
+  bool reuse_port,
+  FdEventQueue::Trigger aio_queue_trigger
+) throw(Exception) : aio_queue_(
+    SocketAioQueue::create(
+      SocketAioQueue::Implementation::DEFAULT,
+      aio_queue_trigger
+    )
+  ),
+  free_connection_slot_i_(SLOT_I_NONE),
+  keep_alive_timeout_(KEEP_ALIVE_TIMEOUT_DEFAULT),
+  request_timeout_(REQUEST_TIMEOUT_DEFAULT),
+  socket_(make_shared<TcpSocket>(sockname.get_family())),
+  timer_wheel_(TIMEOUT_TICK, Time::now()),
+  woken_(false) {
+  init(sockname, reuse_port);
 }
 
 HttpServerEventQueue::HttpServerEventQueue(
   ::std::unique_ptr<TcpSocket> socket_,
-  const SocketAddress& sockname
-) throw(Exception) : aio_queue_(SocketAioQueue::create()),
-  socket_(socket_.release()) {
-  init(sockname);
+  const SocketAddress& sockname,
+  bool reuse_port,
+  SocketAioQueue::Implementation aio_queue_implementation,
+  FdEventQueue::Trigger aio_queue_trigger
+) throw(Exception) : aio_queue_(
+    SocketAioQueue::create(aio_queue_implementation, aio_queue_trigger)
+  ),
+  free_connection_slot_i_(SLOT_I_NONE),
+  keep_alive_timeout_(KEEP_ALIVE_TIMEOUT_DEFAULT),
+  request_timeout_(REQUEST_TIMEOUT_DEFAULT),
+  socket_(socket_.release()),
+  timer_wheel_(TIMEOUT_TICK, Time::now()),
+  woken_(false) {
+  init(sockname, reuse_port);
 }
 
 HttpServerEventQueue::~HttpServerEventQueue() {
-  for (auto connection_i = connections_.begin(); connection_i != connections_.end(); ++connection_i) {
-    StreamSocket& socket_ = (*connection_i)->socket();
-    socket_.set_blocking_mode(true);
-    socket_.setsockopt(TcpSocket::Option::LINGER, 30);
-    socket_.shutdown();
-    socket_.close();
+  for (
+    auto slot_i = connection_slots_.begin();
+    slot_i != connection_slots_.end();
+    ++slot_i
+  ) {
+    if (slot_i->connection != NULL) {
+      StreamSocket& socket_ = slot_i->connection->socket();
+      socket_.set_blocking_mode(true);
+      socket_.setsockopt(TcpSocket::Option::LINGER, 30);
+      socket_.shutdown();
+      socket_.close();
+    }
   }
 
   socket_->close();
 }
 
-void HttpServerEventQueue::handle(unique_ptr<AcceptAiocb> accept_aiocb) {
+void HttpServerEventQueue::close_connection(HttpServerConnection& connection) {
+  // Dissociate before closing, while the descriptor can't have been reused
+  aio_queue_->dissociate(connection.socket());
+  connection.socket().close();
+}
+
+void HttpServerEventQueue::close_idle_connections(const Time& now) {
+  timer_wheel_.advance(now, expired_timer_ids_);
+
+  for (
+    auto timer_id_i = expired_timer_ids_.begin();
+    timer_id_i != expired_timer_ids_.end();
+    ++timer_id_i
+  ) {
+    uint32_t slot_i = static_cast<uint32_t>(*timer_id_i);
+    ConnectionSlot& slot = connection_slots_[slot_i];
+    if (
+      slot.connection == NULL
+      ||
+      slot.generation != static_cast<uint32_t>(*timer_id_i >> 32)
+    ) {
+      continue; // The connection has been closed since
+    }
+
+    slot.timer_deadline = Time::FOREVER;
+
+    if (now < slot.deadline) {
+      // Received a request since the timer was set
+      set_deadline(slot_i, slot.deadline, Time::ZERO);
+    } else if (slot.connection->has_pending_responses()) {
+      // Waiting on us rather than on the peer
+      set_deadline(slot_i, now, keep_alive_timeout_);
+    } else {
+      DLOG(DEBUG) << "closing idle connection from " << slot.connection->peername();
+      // Fails the pending receive, which erases the connection.
+      slot.connection->socket().shutdown();
+    }
+  }
+
+  expired_timer_ids_.clear();
+}
+
+void HttpServerEventQueue::erase_connection(HttpServerConnection& connection) {
+  uint32_t slot_i = connection.slot_i_;
+  ConnectionSlot& slot = connection_slots_[slot_i];
+  CHECK_EQ(slot.connection.get(), &connection);
+  slot.connection.reset();
+  ++slot.generation;
+  slot.next_free_slot_i = free_connection_slot_i_;
+  free_connection_slot_i_ = slot_i;
+}
+
+void HttpServerEventQueue::handle(unique_ptr<AcceptAiocb> accept_aiocb, const Time& now) {
   if (accept_aiocb->return_() >= 0) {
     if (aio_queue_->associate(*accept_aiocb->accepted_socket())) {
-      HttpServerConnection* connection
-      = new HttpServerConnection(
-        aio_queue_,
-        event_queue_,
-        accept_aiocb->peername(),
-        accept_aiocb->accepted_socket()
+      // Owned by a shared_ptr from the start, for shared_from_this
+      shared_ptr<HttpServerConnection> connection(
+        new HttpServerConnection(
+          aio_queue_,
+          event_queue_,
+          accept_aiocb->peername(),
+          accept_aiocb->accepted_socket()
+        )
       );
 
       connection->handle(move(accept_aiocb));
 
-      if (connection->state() == HttpServerConnection::State::CONNECTED) {
-        connections_.push_back(connection->shared_from_this());
+      if (connection->try_close()) {
+        close_connection(*connection);
       } else {
-        delete connection;
+        insert_connection(connection, now);
       }
     } else {
       accept_aiocb->accepted_socket()->shutdown();
@@ -101,35 +192,49 @@ void HttpServerEventQueue::handle(unique_ptr<AcceptAiocb> accept_aiocb) {
     }
   }
 
-  unique_ptr<AcceptAiocb> next_accept_aiocb(new AcceptAiocb(socket_, make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize())));
+  unique_ptr<AcceptAiocb> next_accept_aiocb(new AcceptAiocb(socket_, BufferPool::get(Buffer::getpagesize())));
   aio_queue_->tryenqueue(move(next_accept_aiocb));
 }
 
-void HttpServerEventQueue::handle(unique_ptr<RecvAiocb> recv_aiocb) {
-  unique_ptr<HttpServerConnection::RecvAiocb> recv_aiocb_downcast(static_cast<HttpServerConnection::RecvAiocb*>(recv_aiocb.release()));  
+void HttpServerEventQueue::handle(unique_ptr<RecvAiocb> recv_aiocb, const Time& now) {
+  unique_ptr<HttpServerConnection::RecvAiocb> recv_aiocb_downcast(static_cast<HttpServerConnection::RecvAiocb*>(recv_aiocb.release()));
   shared_ptr<HttpServerConnection> connection = recv_aiocb_downcast->connection();
-  if (recv_aiocb_downcast->connection()->state() == HttpServerConnection::State::CONNECTED) {
-    connection->handle(move(recv_aiocb_downcast));
-
-    if (connection->state() == HttpServerConnection::State::ERROR) {
-      for (
-        auto connection_i = connections_.begin(),
-             connections_end = connections_.end();
-        connection_i != connections_end;
-        ++connection_i
-      ) {
-        if (*connection_i == connection) {
-          connections_.erase(connection_i);
-          connection->socket().close();
-        }
-      }
-    }
+  uint32_t requests_count = connection->requests_count_;
+  connection->handle(move(recv_aiocb_downcast));
+  if (connection->requests_count_ != requests_count) {
+    set_deadline(connection->slot_i_, now, keep_alive_timeout_);
+  }
+
+  if (connection->try_close()) {
+    close_connection(*connection);
+    erase_connection(*connection);
+  }
+}
+
+void HttpServerEventQueue::handle(unique_ptr<SendAiocb> send_aiocb) {
+  unique_ptr<HttpServerConnection::SendAiocb> send_aiocb_downcast(static_cast<HttpServerConnection::SendAiocb*>(send_aiocb.release()));
+  shared_ptr<HttpServerConnection> connection = send_aiocb_downcast->connection();
+  connection->handle(move(send_aiocb_downcast));
+  if (connection->try_close()) {
+    close_connection(*connection);
+    erase_connection(*connection);
+  }
+}
+
+void HttpServerEventQueue::handle(unique_ptr<SendfileAiocb> sendfile_aiocb) {
+  unique_ptr<HttpServerConnection::SendfileAiocb> sendfile_aiocb_downcast(static_cast<HttpServerConnection::SendfileAiocb*>(sendfile_aiocb.release()));
+  shared_ptr<HttpServerConnection> connection = sendfile_aiocb_downcast->connection();
+  connection->handle(move(sendfile_aiocb_downcast));
+  if (connection->try_close()) {
+    close_connection(*connection);
+    erase_connection(*connection);
   }
 }
 
 void
 HttpServerEventQueue::init(
-  const SocketAddress& sockname
+  const SocketAddress& sockname,
+  bool reuse_port
 ) throw(Exception) {
   event_queue_ = make_shared< ::yield::queue::SynchronizedEventQueue<HttpServerEvent> >();
 
@@ -141,6 +246,11 @@ HttpServerEventQueue::init(
     throw Exception();
   }
 #endif
+  if (reuse_port) {
+    if (!socket_->setsockopt(Socket::Option::REUSEPORT, true)) {
+      throw Exception();
+    }
+  }
   if (!socket_->bind(sockname)) {
     throw Exception();
   }
@@ -148,50 +258,125 @@ HttpServerEventQueue::init(
     throw Exception();
   }
 
-  unique_ptr<AcceptAiocb> accept_aiocb(new AcceptAiocb(socket_, make_shared<Buffer>(Buffer::getpagesize(), Buffer::getpagesize())));
+  unique_ptr<AcceptAiocb> accept_aiocb(new AcceptAiocb(socket_, BufferPool::get(Buffer::getpagesize())));
   aio_queue_->tryenqueue(move(accept_aiocb));
 }
 
+void
+HttpServerEventQueue::insert_connection(
+  shared_ptr<HttpServerConnection> connection,
+  const Time& now
+) {
+  uint32_t slot_i;
+  if (free_connection_slot_i_ != SLOT_I_NONE) {
+    slot_i = free_connection_slot_i_;
+    free_connection_slot_i_ = connection_slots_[slot_i].next_free_slot_i;
+  } else {
+    CHECK_LT(connection_slots_.size(), static_cast<size_t>(SLOT_I_NONE));
+    slot_i = static_cast<uint32_t>(connection_slots_.size());
+    connection_slots_.push_back(ConnectionSlot());
+  }
+
+  ConnectionSlot& slot = connection_slots_[slot_i];
+  slot.connection = connection;
+  slot.next_free_slot_i = SLOT_I_NONE;
+  slot.timer_deadline = Time::FOREVER;
+  connection->slot_i_ = slot_i;
+
+  set_deadline(slot_i, now, request_timeout_);
+}
+
+void
+HttpServerEventQueue::set_deadline(
+  uint32_t slot_i,
+  const Time& now,
+  const Time& timeout
+) {
+  ConnectionSlot& slot = connection_slots_[slot_i];
+  if (timeout == Time::FOREVER) {
+    slot.deadline = Time::FOREVER;
+    return;
+  }
+
+  slot.deadline = now + timeout;
+
+  // A timer that expires before the deadline is rechecked and set again
+  // then, so a later deadline costs nothing until that happens.
+  if (slot.deadline < slot.timer_deadline) {
+    timer_wheel_.insert(
+      (static_cast<uint64_t>(slot.generation) << 32) | slot_i,
+      slot.deadline
+    );
+    slot.timer_deadline = slot.deadline;
+  }
+}
+
+unique_ptr<SocketAddress> HttpServerEventQueue::sockname() const throw(Exception) {
+  return socket_->getsockname();
+}
+
 unique_ptr<HttpServerEvent> HttpServerEventQueue::timeddequeue(const Time& timeout) {
   Time timeout_remaining(timeout);
+  Time now = Time::now();
   for (;;) {
-    Time start_time = Time::now();
-
     unique_ptr<HttpServerEvent> event = event_queue_->trydequeue();
     if (event != NULL) {
       return event;
     }
 
-    unique_ptr<SocketAiocb> aiocb = aio_queue_->timeddequeue(timeout_remaining);
-    if (aiocb != NULL) {
-      switch (aiocb->type()) {
-      case SocketAiocb::Type::ACCEPT:
-        handle(unique_ptr<AcceptAiocb>(static_cast<AcceptAiocb*>(aiocb.release())));
-        break;
+    close_idle_connections(now);
 
-      case SocketAiocb::Type::RECV:
-        handle(unique_ptr<RecvAiocb>(static_cast<RecvAiocb*>(aiocb.release())));
-        break;
+    // Wake up once a tick to close idle connections.
+    Time aio_timeout(timeout_remaining);
+    bool aio_timeout_ticked = false;
+    if (!timer_wheel_.empty() && TIMEOUT_TICK < aio_timeout) {
+      aio_timeout = TIMEOUT_TICK;
+      aio_timeout_ticked = true;
+    }
 
-      case SocketAiocb::Type::SEND:
-        break;
+    unique_ptr<SocketAiocb> aiocb = aio_queue_->timeddequeue(aio_timeout);
 
-      case SocketAiocb::Type::SENDFILE:
-        break;
+    Time start_time = now;
+    now = Time::now();
+    if (timeout_remaining != Time::FOREVER) {
+      timeout_remaining -= now - start_time;
+    }
 
-      default:
-        CHECK(false);
-        break;
-      }
-    } else if (timeout_remaining) {
-      Time elapsed_time = Time::now() - start_time;
-      if (timeout_remaining > elapsed_time) {
-        timeout_remaining -= elapsed_time;
-      } else {
-        timeout_remaining = 0;
+    if (aiocb == NULL) {
+      if (
+        woken_.exchange(false)
+        ||
+        !aio_timeout_ticked
+        ||
+        timeout_remaining == Time::ZERO
+      ) {
+        // Timed out or woken, possibly by tryenqueue
+        return event_queue_->trydequeue();
       }
-    } else {
-      return unique_ptr<HttpServerEvent>();
+      // Woke up for a tick, or by tryenqueue
+      continue;
+    }
+
+    switch (aiocb->type()) {
+    case SocketAiocb::Type::ACCEPT:
+      handle(unique_ptr<AcceptAiocb>(static_cast<AcceptAiocb*>(aiocb.release())), now);
+      break;
+
+    case SocketAiocb::Type::RECV:
+      handle(unique_ptr<RecvAiocb>(static_cast<RecvAiocb*>(aiocb.release())), now);
+      break;
+
+    case SocketAiocb::Type::SEND:
+      handle(unique_ptr<SendAiocb>(static_cast<SendAiocb*>(aiocb.release())));
+      break;
+
+    case SocketAiocb::Type::SENDFILE:
+      handle(unique_ptr<SendfileAiocb>(static_cast<SendfileAiocb*>(aiocb.release())));
+      break;
+
+    default:
+      CHECK(false);
+      break;
     }
   }
 }
@@ -205,6 +390,7 @@ unique_ptr<HttpServerEvent> HttpServerEventQueue::tryenqueue(unique_ptr<HttpServ
 }
 
 void HttpServerEventQueue::wake() {
+  woken_ = true;
   aio_queue_->wake();
 }
 }
@@ -37,9 +37,9 @@ namespace server {
 void HttpServerRequest::respond(uint16_t status_code, ::std::shared_ptr<Buffer> body) {
   ::std::unique_ptr<HttpServerResponse> http_response(new HttpServerResponse(body, http_version(), status_code));
   if (body != NULL) {
-    http_response->set_field("Content-Length", 14, body->size());
+    http_response->set_content_length_field(body->size());
   } else {
-    http_response->set_field("Content-Length", 14, "0", 1);
+    http_response->set_content_length_field(0);
   }
   respond(::std::move(http_response));
 }
@@ -0,0 +1,175 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "yield/http/server/sharded_http_server.hpp"
+
+#include "yield/logging.hpp"
+#include "yield/http/server/http_server_event_queue.hpp"
+#include "yield/sockets/socket_address.hpp"
+#include "yield/thread/processor_set.hpp"
+#include "yield/thread/runnable.hpp"
+#include "yield/thread/thread.hpp"
+
+#include <atomic>
+
+namespace yield {
+namespace http {
+namespace server {
+using ::std::atomic;
+using ::std::move;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+using ::yield::poll::FdEventQueue;
+using ::yield::sockets::SocketAddress;
+using ::yield::thread::ProcessorSet;
+using ::yield::thread::Runnable;
+using ::yield::thread::Thread;
+
+class ShardedHttpServer::Shard : public Runnable {
+public:
+  Shard(
+    unique_ptr<HttpServerEventQueue> event_queue,
+    shared_ptr< EventSink<HttpServerEvent> > http_server_event_sink
+  ) : event_queue_(move(event_queue)),
+      http_server_event_sink_(http_server_event_sink) {
+    should_run_ = true;
+  }
+
+public:
+  HttpServerEventQueue& event_queue() {
+    return *event_queue_;
+  }
+
+  void stop() {
+    should_run_ = false;
+    event_queue_->wake();
+  }
+
+  // yield::thread::Runnable
+  void run() {
+    while (should_run_) {
+      unique_ptr<HttpServerEvent> event
+      = event_queue_->timeddequeue(Time::FOREVER);
+      if (event != NULL) {
+        if (http_server_event_sink_->tryenqueue(move(event)) != NULL) {
+          LOG(ERROR) << "HTTP server event sink full, dropping event";
+        }
+      }
+    }
+  }
+
+private:
+  unique_ptr<HttpServerEventQueue> event_queue_;
+  shared_ptr< EventSink<HttpServerEvent> > http_server_event_sink_;
+  atomic<bool> should_run_;
+};
+
+ShardedHttpServer::ShardedHttpServer(
+  shared_ptr< EventSink<HttpServerEvent> > http_server_event_sink,
+  const SocketAddress& sockname,
+  uint16_t shard_count,
+  bool setaffinity,
+  FdEventQueue::Trigger aio_queue_trigger
+) throw(Exception) {
+  uint16_t logical_processor_count
+    = ProcessorSet::get_online_logical_processor_count();
+  if (shard_count == 0) {
+    shard_count = logical_processor_count;
+  }
+
+  try {
+    unique_ptr<SocketAddress> shard_sockname;
+    for (uint16_t shard_i = 0; shard_i < shard_count; ++shard_i) {
+      unique_ptr<HttpServerEventQueue> event_queue(
+        new HttpServerEventQueue(
+          shard_sockname != NULL ? *shard_sockname : sockname,
+          true,
+          aio_queue_trigger
+        )
+      );
+
+      // Later shards follow the port the first one ended up with
+      if (shard_sockname == NULL) {
+        shard_sockname = event_queue->sockname();
+      }
+
+      threads_.push_back(
+        unique_ptr<Thread>(
+          new Thread(
+            unique_ptr<Runnable>(
+              new Shard(move(event_queue), http_server_event_sink)
+            )
+          )
+        )
+      );
+
+      if (setaffinity) {
+        uint16_t logical_processor_i = shard_i % logical_processor_count;
+        if (!threads_.back()->setaffinity(logical_processor_i)) {
+          LOG(WARNING) << "could not bind HTTP server shard " << shard_i
+                       << " to logical processor " << logical_processor_i;
+        }
+      }
+    }
+  } catch (Exception&) {
+    stop();
+    throw;
+  }
+}
+
+ShardedHttpServer::~ShardedHttpServer() {
+  stop();
+}
+
+unique_ptr<SocketAddress> ShardedHttpServer::sockname() const throw(Exception) {
+  CHECK(!threads_.empty());
+  return static_cast<Shard&>(threads_.front()->runnable()).event_queue().sockname();
+}
+
+void ShardedHttpServer::stop() {
+  for (
+    auto thread_i = threads_.begin();
+    thread_i != threads_.end();
+    ++thread_i
+  ) {
+    static_cast<Shard&>((*thread_i)->runnable()).stop();
+  }
+
+  for (
+    auto thread_i = threads_.begin();
+    thread_i != threads_.end();
+    ++thread_i
+  ) {
+    (*thread_i)->join();
+  }
+
+  threads_.clear();
+}
+}
+}
+}
@@ -0,0 +1,456 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/http/server/static_file_request_handler.hpp"
+
+#include "yield/logging.hpp"
+#include "yield/fs/file.hpp"
+#include "yield/fs/stat.hpp"
+#include "yield/http/server/http_server_request.hpp"
+#include "yield/http/server/http_server_response.hpp"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace yield {
+namespace http {
+namespace server {
+using ::std::move;
+using ::std::shared_ptr;
+using ::std::string;
+using ::std::unique_ptr;
+using ::std::vector;
+using ::yield::fs::File;
+using ::yield::fs::Path;
+using ::yield::fs::Stat;
+using ::yield::fs::poll::FsEvent;
+using ::yield::thread::Mutex;
+
+class StaticFileRequestHandler::CachedFile {
+public:
+  CachedFile(const Path& path, unique_ptr<File> file, const Stat& stbuf)
+    : file_(file.release()),
+      path_(path),
+      size_(stbuf.size()) {
+    // Like Apache and nginx: a strong validator from mtime and size.
+    ::std::ostringstream etag;
+    etag << '"' << ::std::hex
+         << static_cast<uint64_t>(stbuf.mtime().as_unix_date_time_s())
+         << '-' << size_ << '"';
+    etag_ = etag.str();
+
+    HttpResponse::format_date(stbuf.mtime(), last_modified_);
+  }
+
+public:
+  const string& etag() const {
+    return etag_;
+  }
+
+  shared_ptr<File>& file() {
+    return file_;
+  }
+
+  const char* last_modified() const {
+    return last_modified_;
+  }
+
+  const Path& path() const {
+    return path_;
+  }
+
+  uint64_t size() const {
+    return size_;
+  }
+
+private:
+  string etag_;
+  shared_ptr<File> file_;
+  char last_modified_[HttpResponse::DATE_LENGTH];
+  Path path_;
+  uint64_t size_;
+};
+
+const Time StaticFileRequestHandler::FS_EVENTS_POLL_INTERVAL_DEFAULT(0.1);
+
+StaticFileRequestHandler::StaticFileRequestHandler(
+  const Path& root_directory_path,
+  size_t cache_capacity,
+  const Time& fs_events_poll_interval
+) : cache_capacity_(cache_capacity),
+    fs_events_poll_interval_(fs_events_poll_interval),
+    multipart_boundary_count_(0),
+    next_fs_events_poll_ns_(0),
+    root_directory_path_(root_directory_path) {
+  CHECK_GT(cache_capacity, 0u);
+}
+
+StaticFileRequestHandler::~StaticFileRequestHandler() {
+}
+
+size_t StaticFileRequestHandler::cache_size() {
+  Mutex::Holder mutex_holder(mutex_);
+  return cache_.size();
+}
+
+shared_ptr<StaticFileRequestHandler::CachedFile>
+StaticFileRequestHandler::get_cached_file(const Path& path) {
+  Mutex::Holder mutex_holder(mutex_);
+
+  poll_fs_events();
+
+  auto cache_index_i = cache_index_.find(path);
+  if (cache_index_i != cache_index_.end()) {
+    // Move to the front of the LRU list
+    cache_.splice(cache_.begin(), cache_, cache_index_i->second);
+    return cache_.front();
+  }
+
+  // Watch before opening, so that any change made from here on invalidates
+  // the entry. Without a watch the file is served but not cached.
+  bool watched
+    = fs_event_queue_.associate(
+        path,
+        FsEvent::TYPE_FILE_MODIFY | FsEvent::TYPE_FILE_REMOVE
+      );
+
+  unique_ptr<File> file = file_system_.open(path);
+  unique_ptr<Stat> stbuf;
+  if (file != NULL) {
+    stbuf = file->stat();
+  }
+  if (stbuf == NULL || !stbuf->ISREG()) {
+    if (watched) {
+      fs_event_queue_.dissociate(path);
+    }
+    return shared_ptr<CachedFile>();
+  }
+
+  shared_ptr<CachedFile> cached_file(new CachedFile(path, move(file), *stbuf));
+  if (!watched) {
+    DLOG(WARNING) << "could not watch " << path << ", not caching it";
+    return cached_file;
+  }
+
+  if (cache_.size() == cache_capacity_) {
+    invalidate(cache_.back()->path());
+  }
+
+  cache_.push_front(cached_file);
+  cache_index_[path] = cache_.begin();
+  return cached_file;
+}
+
+void StaticFileRequestHandler::handle(unique_ptr<HttpServerEvent> event) {
+  CHECK_EQ(event->type(), HttpServerEvent::Type::REQUEST);
+  handle(unique_ptr<HttpServerRequest>(static_cast<HttpServerRequest*>(event.release())));
+}
+
+void StaticFileRequestHandler::handle(unique_ptr<HttpServerRequest> http_request) {
+  bool head = http_request->method() == HttpRequest::Method::HEAD;
+  if (!head && http_request->method() != HttpRequest::Method::GET) {
+    http_request->respond(405);
+    return;
+  }
+
+  string uri_path = http_request->uri().get_path();
+  if (uri_path.empty() || uri_path[0] != '/') {
+    http_request->respond(400);
+    return;
+  }
+
+  // Refuse to leave the root directory.
+  for (
+    size_t dot_dot_i = uri_path.find("..");
+    dot_dot_i != string::npos;
+    dot_dot_i = uri_path.find("..", dot_dot_i + 1)
+  ) {
+    if (
+      uri_path[dot_dot_i - 1] == '/'
+      &&
+      (dot_dot_i + 2 == uri_path.size() || uri_path[dot_dot_i + 2] == '/')
+    ) {
+      http_request->respond(403);
+      return;
+    }
+  }
+
+  if (uri_path[uri_path.size() - 1] == '/') {
+    uri_path.append("index.html");
+  }
+
+  shared_ptr<CachedFile> cached_file
+    = get_cached_file(root_directory_path_ / Path(uri_path.substr(1)));
+  if (cached_file == NULL) {
+    http_request->respond(404);
+    return;
+  }
+
+  iovec if_none_match, if_modified_since;
+  bool not_modified;
+  if (http_request->get_field("If-None-Match", 13, if_none_match)) {
+    not_modified
+      = (
+          if_none_match.iov_len == cached_file->etag().size()
+          &&
+          memcmp(
+            if_none_match.iov_base,
+            cached_file->etag().data(),
+            if_none_match.iov_len
+          ) == 0
+        )
+        ||
+        (
+          if_none_match.iov_len == 1
+          &&
+          *static_cast<char*>(if_none_match.iov_base) == '*'
+        );
+  } else if (
+    http_request->get_field("If-Modified-Since", 17, if_modified_since)
+  ) {
+    // An exact match, as in nginx: clients echo Last-Modified back.
+    not_modified
+      = if_modified_since.iov_len == HttpResponse::DATE_LENGTH
+        &&
+        memcmp(
+          if_modified_since.iov_base,
+          cached_file->last_modified(),
+          HttpResponse::DATE_LENGTH
+        ) == 0;
+  } else {
+    not_modified = false;
+  }
+
+  unique_ptr<HttpServerResponse> http_response;
+  if (not_modified) {
+    http_response.reset(
+      new HttpServerResponse(http_request->http_version(), 304)
+    );
+  } else if (head) {
+    http_response.reset(
+      new HttpServerResponse(http_request->http_version(), 200)
+    );
+    http_response->set_content_length_field(
+      static_cast<size_t>(cached_file->size())
+    );
+  } else {
+    vector<HttpRequest::ByteRange> byte_ranges;
+    if (
+      http_request->get_byte_ranges(cached_file->size(), byte_ranges)
+      &&
+      if_range_matches(*http_request, *cached_file)
+    ) {
+      http_response = respond_partial(*http_request, cached_file, byte_ranges);
+    } else {
+      http_response.reset(
+        new HttpServerResponse(
+          cached_file->file(),
+          http_request->http_version(),
+          200
+        )
+      );
+      http_response->set_content_length_field(
+        static_cast<size_t>(cached_file->size())
+      );
+    }
+  }
+
+  if (!not_modified) {
+    http_response->set_field("Accept-Ranges", 13, "bytes", 5);
+  }
+  http_response->set_field("ETag", 4, cached_file->etag());
+  http_response->set_field(
+    "Last-Modified",
+    13,
+    cached_file->last_modified(),
+    HttpResponse::DATE_LENGTH
+  );
+
+  http_request->respond(move(http_response));
+}
+
+bool
+StaticFileRequestHandler::if_range_matches(
+  const HttpServerRequest& http_request,
+  const CachedFile& cached_file
+) {
+  iovec if_range;
+  if (!http_request.get_field("If-Range", 8, if_range)) {
+    return true;
+  }
+
+  // The validator is either the entity tag or the Last-Modified date.
+  if (if_range.iov_len == cached_file.etag().size()) {
+    return memcmp(
+             if_range.iov_base,
+             cached_file.etag().data(),
+             if_range.iov_len
+           ) == 0;
+  } else if (if_range.iov_len == HttpResponse::DATE_LENGTH) {
+    return memcmp(
+             if_range.iov_base,
+             cached_file.last_modified(),
+             HttpResponse::DATE_LENGTH
+           ) == 0;
+  } else {
+    return false;
+  }
+}
+
+unique_ptr<HttpServerResponse>
+StaticFileRequestHandler::respond_partial(
+  const HttpServerRequest& http_request,
+  shared_ptr<CachedFile> cached_file,
+  const vector<HttpRequest::ByteRange>& byte_ranges
+) {
+  unique_ptr<HttpServerResponse> http_response;
+
+  if (byte_ranges.empty()) {
+    http_response.reset(
+      new HttpServerResponse(http_request.http_version(), 416)
+    );
+    ::std::ostringstream content_range;
+    content_range << "bytes */" << cached_file->size();
+    http_response->set_field("Content-Range", 13, content_range.str());
+    http_response->set_content_length_field(0);
+    return http_response;
+  }
+
+  http_response.reset(
+    new HttpServerResponse(
+      cached_file->file(),
+      http_request.http_version(),
+      206
+    )
+  );
+
+  if (byte_ranges.size() == 1) {
+    const HttpRequest::ByteRange& byte_range = byte_ranges[0];
+    uint64_t length = byte_range.last_byte_pos - byte_range.first_byte_pos + 1;
+    ::std::ostringstream content_range;
+    content_range << "bytes " << byte_range.first_byte_pos << '-'
+                  << byte_range.last_byte_pos << '/' << cached_file->size();
+    http_response->set_field("Content-Range", 13, content_range.str());
+    http_response->set_content_length_field(static_cast<size_t>(length));
+    http_response->add_body_part(byte_range.first_byte_pos, length);
+    return http_response;
+  }
+
+  // multipart/byteranges (RFC 2616 section 19.2): each range is preceded by
+  // a part header in memory and sent from the file, all in one response.
+  ::std::ostringstream boundary_oss;
+  boundary_oss << "YIELD_BYTERANGES_" << ::std::setfill('0') << ::std::setw(10)
+               << multipart_boundary_count_++;
+  string boundary = boundary_oss.str();
+
+  string content_type("multipart/byteranges; boundary=");
+  content_type.append(boundary);
+  http_response->set_field("Content-Type", 12, content_type);
+
+  uint64_t content_length = 0;
+  for (
+    vector<HttpRequest::ByteRange>::const_iterator byte_range_i
+      = byte_ranges.begin();
+    byte_range_i != byte_ranges.end();
+    ++byte_range_i
+  ) {
+    ::std::ostringstream part_header;
+    part_header << "\r\n--" << boundary << "\r\n"
+                << "Content-Range: bytes " << byte_range_i->first_byte_pos
+                << '-' << byte_range_i->last_byte_pos << '/'
+                << cached_file->size() << "\r\n\r\n";
+    string part_header_str = part_header.str();
+    http_response->add_body_part(
+      Buffer::copy(part_header_str.data(), part_header_str.size())
+    );
+    content_length += part_header_str.size();
+
+    uint64_t length
+      = byte_range_i->last_byte_pos - byte_range_i->first_byte_pos + 1;
+    http_response->add_body_part(byte_range_i->first_byte_pos, length);
+    content_length += length;
+  }
+
+  string close_delimiter("\r\n--");
+  close_delimiter.append(boundary);
+  close_delimiter.append("--\r\n");
+  http_response->add_body_part(
+    Buffer::copy(close_delimiter.data(), close_delimiter.size())
+  );
+  content_length += close_delimiter.size();
+
+  http_response->set_content_length_field(static_cast<size_t>(content_length));
+  return http_response;
+}
+
+void StaticFileRequestHandler::invalidate(const Path& path) {
+  auto cache_index_i = cache_index_.find(path);
+  if (cache_index_i != cache_index_.end()) {
+    DLOG(DEBUG) << "dropping " << path << " from the static file cache";
+    // Responses that hold the File keep it open.
+    cache_.erase(cache_index_i->second);
+    cache_index_.erase(cache_index_i);
+    fs_event_queue_.dissociate(path);
+  }
+}
+
+void StaticFileRequestHandler::invalidate(const FsEvent& fs_event) {
+  invalidate(fs_event.get_path());
+  if (
+    fs_event.get_type() == FsEvent::TYPE_FILE_RENAME
+    ||
+    fs_event.get_type() == FsEvent::TYPE_DIRECTORY_RENAME
+  ) {
+    invalidate(fs_event.get_new_path());
+  }
+}
+
+void StaticFileRequestHandler::poll_fs_events() {
+  if (cache_.empty()) {
+    return;
+  }
+
+  // Each trydequeue is an epoll_wait, too costly for every request
+  uint64_t now_ns = Time::now().ns();
+  if (now_ns < next_fs_events_poll_ns_) {
+    return;
+  }
+  next_fs_events_poll_ns_ = now_ns + fs_events_poll_interval_.ns();
+
+  for (;;) {
+    unique_ptr<FsEvent> fs_event = fs_event_queue_.trydequeue();
+    if (fs_event != NULL) {
+      invalidate(*fs_event);
+    } else {
+      break;
+    }
+  }
+}
+}
+}
+}
@@ -0,0 +1,238 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/http/server/ygi/reverse_dns_cache.hpp"
+
+#include "yield/logging.hpp"
+#include "yield/queue/synchronized_queue.hpp"
+#include "yield/thread/runnable.hpp"
+#include "yield/thread/thread.hpp"
+
+namespace yield {
+namespace http {
+namespace server {
+namespace ygi {
+using ::std::make_shared;
+using ::std::move;
+using ::std::string;
+using ::std::unique_ptr;
+using ::yield::queue::SynchronizedQueue;
+using ::yield::sockets::SocketAddress;
+using ::yield::thread::Mutex;
+using ::yield::thread::Runnable;
+using ::yield::thread::Thread;
+
+class ReverseDnsCache::Entry {
+public:
+  Entry(const string& remote_addr, const Time& expires)
+    : expires_(expires),
+      remote_addr_(remote_addr),
+      resolved_(false) {
+  }
+
+public:
+  const Time& expires() const {
+    return expires_;
+  }
+
+  const string& remote_addr() const {
+    return remote_addr_;
+  }
+
+  const string& remote_host() const {
+    return remote_host_;
+  }
+
+  bool resolved() const {
+    return resolved_;
+  }
+
+public:
+  void resolve(const string& remote_host, const Time& expires) {
+    expires_ = expires;
+    remote_host_ = remote_host;
+    resolved_ = true;
+  }
+
+  void unresolve(const Time& expires) {
+    expires_ = expires;
+    remote_host_.clear();
+    resolved_ = false;
+  }
+
+private:
+  Time expires_;
+  string remote_addr_;
+  string remote_host_;
+  bool resolved_;
+};
+
+class ReverseDnsCache::Resolver : public Runnable {
+public:
+  class Lookup {
+  public:
+    Lookup(const SocketAddress& peername, const string& remote_addr)
+      : peername_(peername),
+        remote_addr_(remote_addr) {
+    }
+
+  public:
+    const SocketAddress& peername() const {
+      return peername_;
+    }
+
+    const string& remote_addr() const {
+      return remote_addr_;
+    }
+
+  private:
+    SocketAddress peername_;
+    string remote_addr_;
+  };
+
+public:
+  Resolver(ReverseDnsCache& reverse_dns_cache)
+    : reverse_dns_cache_(reverse_dns_cache) {
+  }
+
+public:
+  void enqueue(const SocketAddress& peername, const string& remote_addr) {
+    lookups_.tryenqueue(
+      unique_ptr<Lookup>(new Lookup(peername, remote_addr))
+    );
+  }
+
+  void stop() {
+    lookups_.wake();
+  }
+
+  // yield::thread::Runnable
+  void run() {
+    for (;;) {
+      unique_ptr<Lookup> lookup = lookups_.dequeue();
+      if (lookup == NULL) {
+        break;
+      }
+
+      string remote_host;
+      if (
+        !lookup->peername().getnameinfo(
+          remote_host,
+          NULL,
+          SocketAddress::GETNAMEINFO_FLAG_NAMEREQD
+        )
+      ) {
+        DLOG(DEBUG) << "no host name for " << lookup->remote_addr();
+      }
+
+      reverse_dns_cache_.put(lookup->remote_addr(), remote_host);
+    }
+  }
+
+private:
+  SynchronizedQueue<Lookup> lookups_;
+  ReverseDnsCache& reverse_dns_cache_;
+};
+
+const Time ReverseDnsCache::TTL_DEFAULT(300.0);
+
+ReverseDnsCache::ReverseDnsCache(size_t capacity, const Time& ttl)
+  : capacity_(capacity),
+    ttl_(ttl) {
+  CHECK_GT(capacity_, 0u);
+  resolver_thread_.reset(new Thread(unique_ptr<Runnable>(new Resolver(*this))));
+}
+
+ReverseDnsCache::~ReverseDnsCache() {
+  static_cast<Resolver&>(resolver_thread_->runnable()).stop();
+  resolver_thread_->join();
+}
+
+bool
+ReverseDnsCache::get(
+  const SocketAddress& peername,
+  const string& remote_addr,
+  string& remote_host
+) {
+  Time now = Time::now();
+
+  {
+    Mutex::Holder mutex_holder(mutex_);
+
+    auto entry_i = entries_index_.find(remote_addr);
+    if (entry_i != entries_index_.end()) {
+      // Move the entry to the front
+      entries_.splice(entries_.begin(), entries_, entry_i->second);
+      Entry& entry = *entries_.front();
+
+      if (now < entry.expires()) {
+        if (entry.resolved()) {
+          remote_host = entry.remote_host();
+          return true;
+        } else {
+          // Still waiting on the resolver
+          return false;
+        }
+      }
+
+      // Expired: look the address up again
+      entry.unresolve(now + ttl_);
+    } else {
+      if (entries_.size() == capacity_) {
+        // Evict the least recently used entry
+        entries_index_.erase(entries_.back()->remote_addr());
+        entries_.pop_back();
+      }
+
+      entries_.push_front(make_shared<Entry>(remote_addr, now + ttl_));
+      entries_index_[remote_addr] = entries_.begin();
+    }
+  }
+
+  static_cast<Resolver&>(resolver_thread_->runnable())
+  .enqueue(peername, remote_addr);
+  return false;
+}
+
+void ReverseDnsCache::put(const string& remote_addr, const string& remote_host) {
+  Mutex::Holder mutex_holder(mutex_);
+
+  // The entry may have been evicted while the lookup was in progress
+  auto entry_i = entries_index_.find(remote_addr);
+  if (entry_i != entries_index_.end()) {
+    (*entry_i->second)->resolve(remote_host, Time::now() + ttl_);
+  }
+}
+
+size_t ReverseDnsCache::size() {
+  Mutex::Holder mutex_holder(mutex_);
+  return entries_.size();
+}
+}
+}
+}
+}
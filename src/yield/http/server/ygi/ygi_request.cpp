@@ -28,6 +28,7 @@
 #include "yield/http/server/ygi/ygi_request.hpp"
 
 #include "yield/http/server/http_server_connection.hpp"
+#include "yield/http/server/ygi/reverse_dns_cache.hpp"
 
 #include <yield/logging.hpp>
 
@@ -35,10 +36,15 @@ namespace yield {
 namespace http {
 namespace server {
 namespace ygi {
+using ::std::string;
 using ::yield::sockets::SocketAddress;
 
-YgiRequest::YgiRequest(::std::unique_ptr<HttpServerRequest> http_request)
-  : http_request_(::std::move(http_request)) {
+YgiRequest::YgiRequest(
+  ::std::unique_ptr<HttpServerRequest> http_request,
+  ReverseDnsCache* reverse_dns_cache
+)
+  : http_request_(::std::move(http_request)),
+    reverse_dns_cache_(reverse_dns_cache) {
   ygi_request_t::AUTH_TYPE = static_AUTH_TYPE;
   ygi_request_t::CONTENT_LENGTH = static_CONTENT_LENGTH;
   ygi_request_t::CONTENT_TYPE = static_CONTENT_TYPE;
@@ -62,9 +68,6 @@ YgiRequest::YgiRequest(::std::unique_ptr<HttpServerRequest> http_request)
   ygi_request_t::SERVER_PROTOCOL = static_SERVER_PROTOCOL;
   ygi_request_t::SERVER_SOFTWARE = static_SERVER_SOFTWARE;
 
-  http_request_->connection().peername().getnameinfo(remote_addr_, NULL, SocketAddress::GETNAMEINFO_FLAG_NUMERICHOST | SocketAddress::GETNAMEINFO_FLAG_NUMERICSERV);
-  http_request_->connection().peername().getnameinfo(remote_host_, NULL, SocketAddress::GETNAMEINFO_FLAG_NAMEREQD | SocketAddress::GETNAMEINFO_FLAG_NUMERICSERV);
-
   if (http_request_->http_version() == 0) {
     server_protocol_.iov_base = const_cast<char*>("HTTP/1.0");
   } else if (http_request_->http_version() == 1) {
@@ -138,12 +141,41 @@ iovec YgiRequest::QUERY_STRING() const {
 
 iovec YgiRequest::REMOTE_ADDR() const {
   iovec remote_addr;
-  remote_addr.iov_base = const_cast<char*>(remote_addr_.c_str());
+  remote_addr.iov_base = const_cast<char*>(this->remote_addr().c_str());
   remote_addr.iov_len = remote_addr_.size();
   return remote_addr;
 }
 
+const string& YgiRequest::remote_addr() const {
+  if (remote_addr_.empty()) {
+    const SocketAddress& peername = http_request_->connection().peername();
+    if (!peername.ntop(remote_addr_)) {
+      // e.g., a Unix domain socket
+      peername.getnameinfo(remote_addr_);
+    }
+  }
+  return remote_addr_;
+}
+
 iovec YgiRequest::REMOTE_HOST() const {
+  if (remote_host_.empty()) {
+    // RFC 3875 4.1.9 lets the server substitute REMOTE_ADDR when the host
+    // name is not available, as it is not until the resolver has cached it
+    if (
+      reverse_dns_cache_ == NULL
+      ||
+      !reverse_dns_cache_->get(
+        http_request_->connection().peername(),
+        remote_addr(),
+        remote_host_
+      )
+      ||
+      remote_host_.empty()
+    ) {
+      return REMOTE_ADDR();
+    }
+  }
+
   iovec remote_host;
   remote_host.iov_base = const_cast<char*>(remote_host_.c_str());
   remote_host.iov_len = remote_host_.size();
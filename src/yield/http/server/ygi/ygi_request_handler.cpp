@@ -41,7 +41,7 @@ YgiRequestHandler::YgiRequestHandler(ygi_request_handler_t ygi_request_handler)
 
 void YgiRequestHandler::handle(::std::unique_ptr<HttpServerEvent> event) {
   CHECK_EQ(event->type(), HttpServerEvent::Type::REQUEST);
-  YgiRequest ygi_request(::std::unique_ptr<HttpServerRequest>(static_cast<HttpServerRequest*>(event.release())));
+  YgiRequest ygi_request(::std::unique_ptr<HttpServerRequest>(static_cast<HttpServerRequest*>(event.release())), &reverse_dns_cache_);
   ygi_request_handler(&ygi_request);
 }
 }
@@ -33,7 +33,7 @@
 
 namespace yield {
 namespace poll {
-FdEventQueue::FdEventQueue(bool) throw(Exception) {
+FdEventQueue::FdEventQueue(bool, size_t) throw(Exception) {
   kq = kqueue();
   if (kq != -1) {
     try {
@@ -65,12 +65,29 @@ FdEventQueue::~FdEventQueue() {
   close(wake_pipe[1]);
 }
 
-bool FdEventQueue::associate(fd_t fd, FdEvent::Type fd_event_types) {
+bool
+FdEventQueue::associate(
+  fd_t fd,
+  FdEvent::Type fd_event_types,
+  Trigger trigger
+) {
   if (fd_event_types > 0) {
+    u_short flags = EV_ADD;
+    switch (trigger) {
+    case Trigger::EDGE:
+      flags |= EV_CLEAR;
+      break;
+    case Trigger::ONESHOT:
+      flags |= EV_ONESHOT;
+      break;
+    default:
+      break;
+    }
+
     struct kevent kevent_;
 
     if (fd_event_types & FdEvent::TYPE_READ_READY) {
-      EV_SET(&kevent_, fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+      EV_SET(&kevent_, fd, EVFILT_READ, flags, 0, 0, NULL);
       if (kevent(kq, &kevent_, 1, 0, 0, NULL) == -1) {
         return false;
       }
@@ -80,7 +97,7 @@ bool FdEventQueue::associate(fd_t fd, FdEvent::Type fd_event_types) {
     }
 
     if (fd_event_types & FdEvent::TYPE_WRITE_READY) {
-      EV_SET(&kevent_, fd, EVFILT_WRITE, EV_ADD, 0, 0, NULL);
+      EV_SET(&kevent_, fd, EVFILT_WRITE, flags, 0, 0, NULL);
       if (kevent(kq, &kevent_, 1, 0, 0, NULL) == -1) {
         return false;
       }
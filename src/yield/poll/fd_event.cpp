@@ -47,15 +47,9 @@ const FdEvent::Type FdEvent::TYPE_WRITE_READY = POLLOUT;
 #endif
 
 FdEvent::FdEvent(fd_t fd, Type type) : fd_(fd), type_(type) {
-  CHECK(
-    type == TYPE_ERROR
-    ||
-    type == TYPE_HUP
-    ||
-    type == TYPE_READ_READY
-    ||
-    type == TYPE_WRITE_READY
-  );
+  const Type all_types
+  = TYPE_ERROR | TYPE_HUP | TYPE_READ_READY | TYPE_WRITE_READY;
+  CHECK(type != 0 && (type & ~all_types) == 0);
 }
 }
 }
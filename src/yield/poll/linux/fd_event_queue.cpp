@@ -28,6 +28,7 @@
 #include "yield/logging.hpp"
 #include "yield/poll/fd_event_queue.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <errno.h>
 #include <poll.h>
@@ -40,13 +41,17 @@ namespace poll {
 using ::std::move;
 using ::std::unique_ptr;
 
-FdEventQueue::FdEventQueue(bool) throw(Exception) {
+FdEventQueue::FdEventQueue(bool, size_t batch_size) throw(Exception)
+  : batch_size_(batch_size > 0 ? batch_size : 1),
+    ready_event_i_(0) {
   epfd_ = epoll_create(32768);
   if (epfd_ == -1) {
     throw Exception();
   }
 
-  wake_fd_ = eventfd(0, 0);
+  // Non-blocking so that every thread woken by the same counter can try to
+  // reset it without all but the first blocking in read().
+  wake_fd_ = eventfd(0, EFD_NONBLOCK);
   if (wake_fd_ == -1) {
     ::close(epfd_);
     throw Exception();
@@ -57,24 +62,74 @@ FdEventQueue::FdEventQueue(bool) throw(Exception) {
     ::close(epfd_);
     throw Exception();
   }
+
+  epoll_events_ = new epoll_event[batch_size_];
+  ready_events_.reserve(batch_size_);
 }
 
 FdEventQueue::~FdEventQueue() {
   ::close(epfd_);
   ::close(wake_fd_);
+  delete [] epoll_events_;
 }
 
-bool FdEventQueue::associate(fd_t fd, FdEvent::Type fd_event_types) {
+bool
+FdEventQueue::associate(
+  fd_t fd,
+  FdEvent::Type fd_event_types,
+  Trigger trigger
+) {
   if (fd_event_types > 0) {
     epoll_event epoll_event_;
     memset(&epoll_event_, 0, sizeof(epoll_event_));
     epoll_event_.data.fd = fd;
     epoll_event_.events = fd_event_types;
+    switch (trigger) {
+    case Trigger::EDGE:
+      epoll_event_.events |= EPOLLET;
+      break;
+    case Trigger::ONESHOT:
+      epoll_event_.events |= EPOLLONESHOT;
+      break;
+    default:
+      break;
+    }
+
+    auto association_i = associations_.find(fd);
+    if (association_i != associations_.end()) {
+      if (
+        association_i->second == epoll_event_.events
+        &&
+        trigger != Trigger::ONESHOT
+      ) {
+        // Unchanged. The fd may have been closed (and its number reused)
+        // since, which silently drops it from the epoll set, so let ADD
+        // check: EEXIST means the association is still in place.
+        if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &epoll_event_) == 0) {
+          return true;
+        } else {
+          return errno == EEXIST;
+        }
+      }
+
+      if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &epoll_event_) == 0) {
+        association_i->second = epoll_event_.events;
+        return true;
+      } else if (errno != ENOENT) {
+        return false;
+      }
+      // else the fd was closed since: ADD it again
+    }
 
     if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &epoll_event_) == 0) {
+      associations_[fd] = epoll_event_.events;
       return true;
     } else if (errno == EEXIST) {
-      return epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &epoll_event_) == 0;
+      if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &epoll_event_) == 0) {
+        associations_[fd] = epoll_event_.events;
+        return true;
+      }
+      return false;
     } else {
       return false;
     }
@@ -88,9 +143,86 @@ bool FdEventQueue::dissociate(fd_t fd) {
   // the EPOLL_CTL_DEL operation required a non-NULL pointer in event,
   // even though this argument is ignored. Since kernel 2.6.9,
   // event can be specified as NULL when using EPOLL_CTL_DEL.
+  associations_.erase(fd);
+
   epoll_event epoll_event_;
   memset(&epoll_event_, 0, sizeof(epoll_event_));
-  return epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, &epoll_event_) == 0;
+  if (epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, &epoll_event_) != 0) {
+    return false;
+  }
+
+  // Drop buffered events for the fd, which may be closed or reused next
+  if (batch_size_ > 1) {
+    ready_events_.erase(
+      ::std::remove_if(
+        ready_events_.begin() + static_cast<ptrdiff_t>(ready_event_i_),
+        ready_events_.end(),
+        [fd](const FdEvent& fd_event) {
+          return fd_event.fd() == fd;
+        }
+      ),
+      ready_events_.end()
+    );
+  }
+
+  return true;
+}
+
+size_t FdEventQueue::dequeue_batch(const Time& timeout, const FdEvent*& events) {
+  if (ready_event_i_ == ready_events_.size()) {
+    if (!fill_ready_events(timeout)) {
+      return 0;
+    }
+  }
+
+  events = &ready_events_[ready_event_i_];
+  size_t events_len = ready_events_.size() - ready_event_i_;
+  ready_event_i_ = ready_events_.size();
+  return events_len;
+}
+
+bool FdEventQueue::fill_ready_events(const Time& timeout) {
+  int timeout_ms
+    = (timeout == Time::FOREVER) ? -1 : static_cast<int>(timeout.ms());
+  int ret
+  = epoll_wait(epfd_, epoll_events_, static_cast<int>(batch_size_), timeout_ms);
+  if (ret == 0) {
+    return false;
+  } else if (ret < 0) {
+    CHECK_EQ(errno, EINTR);
+    return false;
+  }
+
+  ready_events_.clear();
+  ready_event_i_ = 0;
+  for (int epoll_event_i = 0; epoll_event_i < ret; ++epoll_event_i) {
+    const epoll_event& epoll_event_ = epoll_events_[epoll_event_i];
+    if (epoll_event_.data.fd == wake_fd_) {
+      read_wake_fd();
+    } else {
+      ready_events_.push_back(
+        FdEvent(
+          epoll_event_.data.fd,
+          static_cast<FdEvent::Type>(epoll_event_.events)
+        )
+      );
+    }
+  }
+
+  // A wake alone interrupts the dequeue; alongside ready events it is
+  // subsumed by returning them.
+  return !ready_events_.empty();
+}
+
+void FdEventQueue::read_wake_fd() {
+  uint64_t data;
+  ssize_t read_ret = read(wake_fd_, &data, sizeof(data));
+  if (read_ret == -1) {
+    // Another thread woken by the same wake() got here first
+    CHECK_EQ(errno, EAGAIN);
+  } else {
+    CHECK_EQ(read_ret, static_cast<ssize_t>(sizeof(data)));
+  }
 }
 
 unique_ptr<FdEvent> FdEventQueue::tryenqueue(unique_ptr<FdEvent>) {
@@ -109,26 +241,35 @@ unique_ptr<FdEvent> FdEventQueue::tryenqueue(unique_ptr<FdEvent>) {
 }
 
 unique_ptr<FdEvent> FdEventQueue::timeddequeue(const Time& timeout) {
-  epoll_event epoll_event_;
-  int timeout_ms
-    = (timeout == Time::FOREVER) ? -1 : static_cast<int>(timeout.ms());
-  int ret = epoll_wait(epfd_, &epoll_event_, 1, timeout_ms);
-  if (ret == 0) {
-    return unique_ptr<FdEvent>();
-  } else if (ret < 0) {
-    CHECK_EQ(errno, EINTR);
+  if (batch_size_ == 1) {
+    // Unbuffered, so several threads may dequeue concurrently
+    int timeout_ms
+      = (timeout == Time::FOREVER) ? -1 : static_cast<int>(timeout.ms());
+    epoll_event epoll_event_;
+    int ret = epoll_wait(epfd_, &epoll_event_, 1, timeout_ms);
+    if (ret == 1) {
+      if (epoll_event_.data.fd != wake_fd_) {
+        return unique_ptr<FdEvent>(
+                 new FdEvent(
+                   epoll_event_.data.fd,
+                   static_cast<FdEvent::Type>(epoll_event_.events)
+                 )
+               );
+      }
+      read_wake_fd();
+    } else if (ret < 0) {
+      CHECK_EQ(errno, EINTR);
+    }
     return unique_ptr<FdEvent>();
   }
-  CHECK_EQ(ret, 1);
 
-  if (epoll_event_.data.fd == wake_fd_) {
-    uint64_t data;
-    ssize_t read_ret = read(wake_fd_, &data, sizeof(data));
-    CHECK_EQ(read_ret, static_cast<ssize_t>(sizeof(data)));
-    return unique_ptr<FdEvent>();
+  if (ready_event_i_ == ready_events_.size()) {
+    if (!fill_ready_events(timeout)) {
+      return unique_ptr<FdEvent>();
+    }
   }
 
-  return unique_ptr<FdEvent>(new FdEvent(epoll_event_.data.fd, epoll_event_.events));
+  return unique_ptr<FdEvent>(new FdEvent(ready_events_[ready_event_i_++]));
 }
 
 void FdEventQueue::wake() {
@@ -36,7 +36,7 @@ namespace poll {
     !defined(__MACH__) && \
     !defined(__FreeBSD__) && \
     !defined(__sun)
-FdEventQueue::FdEventQueue(bool) throw(Exception) {
+FdEventQueue::FdEventQueue(bool, size_t) throw(Exception) {
   if (pipe(wake_pipe) != -1) {
     try {
       if (!associate(wake_pipe[0], FdEvent::TYPE_READ_READY)) {
@@ -57,7 +57,12 @@ FdEventQueue::~FdEventQueue() {
   close(wake_pipe[1]);
 }
 
-bool FdEventQueue::associate(fd_t fd, FdEvent::Type fd_event_types) {
+bool
+FdEventQueue::associate(
+  fd_t fd,
+  FdEvent::Type fd_event_types,
+  Trigger
+) {
   if (fd_event_types > 0) {
     for (
       auto pollfd_i = pollfds.begin();
@@ -31,7 +31,7 @@
 
 namespace yield {
 namespace poll {
-FdEventQueue::FdEventQueue(bool) throw(Exception) {
+FdEventQueue::FdEventQueue(bool, size_t) throw(Exception) {
   port = port_create();
   if (port == -1) {
     throw Exception();
@@ -42,7 +42,12 @@ FdEventQueue::~FdEventQueue() {
   close(port);
 }
 
-bool FdEventQueue::associate(fd_t fd, FdEvent::Type fd_event_types) {
+bool
+FdEventQueue::associate(
+  fd_t fd,
+  FdEvent::Type fd_event_types,
+  Trigger
+) {
   if (fd_event_types > 0) {
     return port_associate(
              port,
@@ -541,7 +541,7 @@ private:
 };
 
 
-FdEventQueue::FdEventQueue(bool for_sockets_only) throw(Exception) {
+FdEventQueue::FdEventQueue(bool for_sockets_only, size_t) throw(Exception) {
   if (for_sockets_only) {
 #if _WIN32_WINNT >= 0x0600
     pimpl_ = new SocketPoller;
@@ -557,7 +557,12 @@ FdEventQueue::~FdEventQueue() {
   delete pimpl_;
 }
 
-bool FdEventQueue::associate(fd_t fd, FdEvent::Type fd_event_types) {
+bool
+FdEventQueue::associate(
+  fd_t fd,
+  FdEvent::Type fd_event_types,
+  Trigger
+) {
   return pimpl_->associate(fd, fd_event_types);
 }
 
@@ -0,0 +1,929 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "yield/buffer.hpp"
+#include "yield/buffers.hpp"
+#include "yield/exception.hpp"
+#include "yield/logging.hpp"
+#include "yield/time.hpp"
+#include "yield/sockets/socket_address.hpp"
+#include "yield/sockets/stream_socket.hpp"
+#include "yield/sockets/aio/accept_aiocb.hpp"
+#include "yield/sockets/aio/connect_aiocb.hpp"
+#include "yield/sockets/aio/recv_aiocb.hpp"
+#include "yield/sockets/aio/recvfrom_aiocb.hpp"
+#include "yield/sockets/aio/send_aiocb.hpp"
+#include "yield/sockets/aio/sendfile_aiocb.hpp"
+#include "io_uring_socket_aio_queue.hpp"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace yield {
+namespace sockets {
+namespace aio {
+namespace linux {
+using ::std::map;
+using ::std::move;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+using ::std::vector;
+
+namespace {
+// user_data values that cannot collide with Operation pointers
+const uint64_t CANCEL_USER_DATA = 1;
+const uint64_t WAKE_USER_DATA = 0;
+}
+
+class IoUringSocketAioQueue::Operation {
+public:
+  enum class Stage {
+    ACCEPT,
+    CONNECT,
+    RECV,
+    SEND,
+    SENDFILE
+  };
+
+public:
+  Operation(unique_ptr<SocketAiocb> aiocb)
+    : aiocb(move(aiocb)),
+      error(0),
+      fd(static_cast<socket_t>(this->aiocb->socket())),
+      next(NULL),
+      partial_send_len(0),
+      peername_len(0),
+      polling(false) {
+    switch (this->aiocb->type()) {
+    case SocketAiocb::Type::ACCEPT:
+      direction = 0;
+      stage = Stage::ACCEPT;
+      break;
+    case SocketAiocb::Type::CONNECT:
+      direction = 1;
+      stage = Stage::CONNECT;
+      break;
+    case SocketAiocb::Type::RECV:
+    case SocketAiocb::Type::RECVFROM:
+      direction = 0;
+      stage = Stage::RECV;
+      break;
+    case SocketAiocb::Type::SEND:
+      direction = 1;
+      stage = Stage::SEND;
+      break;
+    case SocketAiocb::Type::SENDFILE:
+      direction = 1;
+      // io_uring has no sendfile opcode: poll for writability, then sendfile
+      polling = true;
+      stage = Stage::SENDFILE;
+      break;
+    default:
+      CHECK(false);
+      direction = 0;
+      stage = Stage::RECV;
+      break;
+    }
+  }
+
+public:
+  unique_ptr<SocketAiocb> aiocb;
+  uint8_t direction; // 0 = accept/recv/recvfrom, 1 = connect/send/sendfile
+  uint32_t error; // Set by prep when an operation cannot be submitted
+  fd_t fd;
+  vector<iovec> iov;
+  msghdr msg;
+  Operation* next;
+  size_t partial_send_len;
+  shared_ptr<SocketAddress> peername;
+  socklen_t peername_len;
+  bool polling;
+  Stage stage;
+};
+
+class IoUringSocketAioQueue::SocketState {
+public:
+  SocketState() {
+    head[0] = head[1] = NULL;
+    tail[0] = tail[1] = NULL;
+  }
+
+  bool empty() const {
+    return head[0] == NULL && head[1] == NULL;
+  }
+
+public:
+  // The head Operation is in flight; the rest wait for it to complete.
+  Operation* head[2];
+  Operation* tail[2];
+};
+
+IoUringSocketAioQueue::IoUringSocketAioQueue(uint32_t entries)
+  : inflight_count_(0),
+    waiting_(false),
+    wake_value_(0),
+    woken_(false),
+    sq_tail_local_(0),
+    to_submit_(0) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (ring_fd_ == -1) {
+    throw Exception();
+  }
+
+  // EXT_ARG is needed for timed waits, NODROP to never lose a completion.
+  if (
+    (params.features & IORING_FEAT_EXT_ARG) == 0
+    ||
+    (params.features & IORING_FEAT_NODROP) == 0
+  ) {
+    ::close(ring_fd_);
+    throw Exception(ENOTSUP);
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_
+  = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+    if (cq_ring_size_ > sq_ring_size_) {
+      sq_ring_size_ = cq_ring_size_;
+    }
+    cq_ring_size_ = 0;
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  cq_ring_ = sqes_ = NULL;
+  sq_ring_
+  = mmap(
+      NULL,
+      sq_ring_size_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      ring_fd_,
+      IORING_OFF_SQ_RING
+    );
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = NULL;
+    unmap();
+    throw Exception();
+  }
+
+  if (cq_ring_size_ > 0) {
+    cq_ring_
+    = mmap(
+        NULL,
+        cq_ring_size_,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        ring_fd_,
+        IORING_OFF_CQ_RING
+      );
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = NULL;
+      unmap();
+      throw Exception();
+    }
+  } else {
+    cq_ring_ = sq_ring_;
+  }
+
+  void* sqes
+  = mmap(
+      NULL,
+      sqes_size_,
+      PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE,
+      ring_fd_,
+      IORING_OFF_SQES
+    );
+  if (sqes == MAP_FAILED) {
+    unmap();
+    throw Exception();
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  char* sq_ring = static_cast<char*>(sq_ring_);
+  sq_array_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.array);
+  sq_entries_ = params.sq_entries;
+  sq_head_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.head);
+  sq_ring_mask_
+  = *reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.ring_mask);
+  sq_tail_ = reinterpret_cast<uint32_t*>(sq_ring + params.sq_off.tail);
+  sq_tail_local_ = *sq_tail_;
+  // Identity mapping: SQE i is always at index i of the array
+  for (uint32_t sqe_i = 0; sqe_i < sq_entries_; ++sqe_i) {
+    sq_array_[sqe_i] = sqe_i;
+  }
+
+  char* cq_ring = static_cast<char*>(cq_ring_);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+  cq_head_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.head);
+  cq_ring_mask_
+  = *reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.ring_mask);
+  cq_tail_ = reinterpret_cast<uint32_t*>(cq_ring + params.cq_off.tail);
+
+  wake_fd_ = eventfd(0, EFD_CLOEXEC);
+  if (wake_fd_ == -1) {
+    unmap();
+    throw Exception();
+  }
+  prep_wake();
+}
+
+IoUringSocketAioQueue::~IoUringSocketAioQueue() {
+  // Cancel everything in flight and wait for the kernel to let go of the
+  // Operations' buffers before freeing them.
+  for (
+    map<fd_t, SocketState*>::iterator socket_state_i = socket_state_.begin();
+    socket_state_i != socket_state_.end();
+    ++socket_state_i
+  ) {
+    for (uint8_t direction = 0; direction < 2; ++direction) {
+      Operation* op = socket_state_i->second->head[direction];
+      if (op != NULL) {
+        io_uring_sqe& sqe = get_sqe();
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = reinterpret_cast<uintptr_t>(op);
+        sqe.user_data = CANCEL_USER_DATA;
+      }
+    }
+  }
+
+  {
+    io_uring_sqe& sqe = get_sqe();
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.addr = WAKE_USER_DATA;
+    sqe.user_data = CANCEL_USER_DATA;
+  }
+
+  while (inflight_count_ > 0) {
+    if (enter(1, NULL) == -1 && errno != EINTR) {
+      LOG(ERROR) << "io_uring_enter: " << Exception().what();
+      break;
+    }
+
+    uint32_t cq_head = *cq_head_;
+    uint32_t cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; cq_head != cq_tail; ++cq_head) {
+      if (cqes_[cq_head & cq_ring_mask_].user_data != CANCEL_USER_DATA) {
+        --inflight_count_;
+      }
+    }
+    __atomic_store_n(cq_head_, cq_head, __ATOMIC_RELEASE);
+  }
+
+  for (
+    map<fd_t, SocketState*>::iterator socket_state_i = socket_state_.begin();
+    socket_state_i != socket_state_.end();
+    ++socket_state_i
+  ) {
+    for (uint8_t direction = 0; direction < 2; ++direction) {
+      Operation* op = socket_state_i->second->head[direction];
+      while (op != NULL) {
+        Operation* next_op = op->next;
+        delete op;
+        op = next_op;
+      }
+    }
+    delete socket_state_i->second;
+  }
+
+  ::close(wake_fd_);
+  unmap();
+}
+
+unique_ptr<SocketAiocb>
+IoUringSocketAioQueue::complete(
+  Operation& op,
+  int32_t res
+) {
+  if (op.error != 0) {
+    res = -static_cast<int32_t>(op.error);
+    op.error = 0;
+  }
+
+  SocketAiocb& aiocb = *op.aiocb;
+
+  if (op.polling) {
+    if (res >= 0) {
+      op.polling = false;
+      if (op.stage != Operation::Stage::SENDFILE) {
+        prep(op);
+        return unique_ptr<SocketAiocb>();
+      }
+
+      // The socket is writable: sendfile as much as it will take
+      SendfileAiocb& sendfile_aiocb = static_cast<SendfileAiocb&>(aiocb);
+      if (sendfile_aiocb.socket().set_blocking_mode(false)) {
+        ssize_t sendfile_ret
+        = sendfile_aiocb.socket().sendfile(
+            sendfile_aiocb.fd(),
+            sendfile_aiocb.offset() + op.partial_send_len,
+            sendfile_aiocb.nbytes() - op.partial_send_len
+          );
+
+        if (sendfile_ret >= 0) {
+          op.partial_send_len += static_cast<size_t>(sendfile_ret);
+          if (op.partial_send_len == sendfile_aiocb.nbytes()) {
+            sendfile_aiocb.set_return(op.partial_send_len);
+            return finish(op);
+          }
+        }
+
+        if (sendfile_ret >= 0 || sendfile_aiocb.socket().want_send()) {
+          op.polling = true;
+          prep(op);
+          return unique_ptr<SocketAiocb>();
+        }
+      }
+
+      res = -static_cast<int32_t>(Exception::get_last_error_code());
+    }
+  } else if (
+    res == -EAGAIN
+    ||
+    (
+      op.stage == Operation::Stage::CONNECT
+      &&
+      (res == -EINPROGRESS || res == -EALREADY)
+    )
+  ) {
+    // Non-blocking socket: wait for readiness and resubmit
+    op.polling = true;
+    prep(op);
+    return unique_ptr<SocketAiocb>();
+  } else if (res == -EINTR) {
+    prep(op);
+    return unique_ptr<SocketAiocb>();
+  } else if (op.stage == Operation::Stage::CONNECT && res == -EISCONN) {
+    res = 0;
+  }
+
+  if (res < 0) {
+    aiocb.set_error(static_cast<uint32_t>(-res));
+    aiocb.set_return(-1);
+    return finish(op);
+  }
+
+  switch (op.stage) {
+  case Operation::Stage::ACCEPT: {
+    AcceptAiocb& accept_aiocb = static_cast<AcceptAiocb&>(aiocb);
+    shared_ptr<StreamSocket>
+    accepted_socket(accept_aiocb.socket().dup2(res).release());
+    accept_aiocb.set_accepted_socket(accepted_socket);
+    accept_aiocb.set_peername(op.peername);
+    op.peername.reset();
+
+    if (accept_aiocb.recv_buffer()) {
+      // Like AcceptEx, complete once the peer has sent something.
+      // The accepted socket has its own queue, so later accepts on the
+      // listen socket can proceed in the meantime.
+      pop(op);
+      op.stage = Operation::Stage::RECV;
+      start(op, res);
+      return unique_ptr<SocketAiocb>();
+    } else {
+      accept_aiocb.set_return(0);
+      return finish(op);
+    }
+  }
+
+  case Operation::Stage::CONNECT: {
+    if (static_cast<ConnectAiocb&>(aiocb).send_buffer()) {
+      op.stage = Operation::Stage::SEND;
+      prep(op);
+      return unique_ptr<SocketAiocb>();
+    } else {
+      aiocb.set_return(0);
+      return finish(op);
+    }
+  }
+
+  case Operation::Stage::RECV: {
+    Buffer* buffer;
+    switch (aiocb.type()) {
+    case SocketAiocb::Type::ACCEPT:
+      buffer = static_cast<AcceptAiocb&>(aiocb).recv_buffer().get();
+      break;
+    case SocketAiocb::Type::RECVFROM: {
+      RecvfromAiocb& recvfrom_aiocb = static_cast<RecvfromAiocb&>(aiocb);
+      recvfrom_aiocb.peername_len() = op.msg.msg_namelen;
+      buffer = recvfrom_aiocb.buffer().get();
+    }
+    break;
+    default:
+      buffer = static_cast<RecvAiocb&>(aiocb).buffer().get();
+      break;
+    }
+
+    if (res > 0) {
+      if (!buffer->next_buffer()) {
+        buffer->put(NULL, static_cast<size_t>(res));
+      } else {
+        Buffers::put(*buffer, NULL, static_cast<size_t>(res));
+      }
+      aiocb.set_return(res);
+    } else if (aiocb.type() == SocketAiocb::Type::ACCEPT) {
+      // Peer closed the new connection before sending anything
+      aiocb.set_error(0);
+      aiocb.set_return(-1);
+    } else {
+      aiocb.set_return(0);
+    }
+
+    return finish(op);
+  }
+
+  case Operation::Stage::SEND: {
+    const Buffer& buffer
+    = aiocb.type() == SocketAiocb::Type::SEND
+      ? static_cast<SendAiocb&>(aiocb).buffer()
+      : *static_cast<ConnectAiocb&>(aiocb).send_buffer();
+
+    op.partial_send_len += static_cast<size_t>(res);
+    if (op.partial_send_len < Buffers::size(buffer)) {
+      prep(op);
+      return unique_ptr<SocketAiocb>();
+    }
+
+    aiocb.set_return(op.partial_send_len);
+    return finish(op);
+  }
+
+  default:
+    CHECK(false);
+    return unique_ptr<SocketAiocb>();
+  }
+}
+
+int IoUringSocketAioQueue::enter(uint32_t min_complete, const Time* timeout) {
+  __atomic_store_n(sq_tail_, sq_tail_local_, __ATOMIC_RELEASE);
+
+  uint32_t flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+  long ret;
+  if (timeout != NULL) {
+    timespec timeout_ts = *timeout;
+    __kernel_timespec timeout_kts;
+    timeout_kts.tv_sec = timeout_ts.tv_sec;
+    timeout_kts.tv_nsec = timeout_ts.tv_nsec;
+
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uintptr_t>(&timeout_kts);
+
+    ret
+    = syscall(
+        __NR_io_uring_enter,
+        ring_fd_,
+        to_submit_,
+        min_complete,
+        flags | IORING_ENTER_EXT_ARG,
+        &arg,
+        sizeof(arg)
+      );
+  } else {
+    ret
+    = syscall(
+        __NR_io_uring_enter,
+        ring_fd_,
+        to_submit_,
+        min_complete,
+        flags,
+        NULL,
+        _NSIG / 8
+      );
+  }
+
+  if (ret >= 0) {
+    to_submit_ -= static_cast<uint32_t>(ret);
+  }
+
+  return static_cast<int>(ret);
+}
+
+unique_ptr<SocketAiocb> IoUringSocketAioQueue::finish(Operation& op) {
+  pop(op);
+
+  unique_ptr<SocketAiocb> aiocb(move(op.aiocb));
+  delete &op;
+
+  switch (aiocb->type()) {
+  case SocketAiocb::Type::ACCEPT:
+    log_completion(static_cast<AcceptAiocb&>(*aiocb));
+    break;
+  case SocketAiocb::Type::CONNECT:
+    log_completion(static_cast<ConnectAiocb&>(*aiocb));
+    break;
+  case SocketAiocb::Type::RECV:
+    log_completion(static_cast<RecvAiocb&>(*aiocb));
+    break;
+  case SocketAiocb::Type::RECVFROM:
+    log_completion(static_cast<RecvfromAiocb&>(*aiocb));
+    break;
+  case SocketAiocb::Type::SEND:
+    log_completion(static_cast<SendAiocb&>(*aiocb));
+    break;
+  case SocketAiocb::Type::SENDFILE:
+    log_completion(static_cast<SendfileAiocb&>(*aiocb));
+    break;
+  case SocketAiocb::Type::RECVMMSG:
+  case SocketAiocb::Type::SENDMMSG:
+  case SocketAiocb::Type::SPLICE:
+    // Refused by tryenqueue
+    CHECK(false);
+    break;
+  }
+
+  return aiocb;
+}
+
+io_uring_sqe& IoUringSocketAioQueue::get_sqe() {
+  if (
+    sq_tail_local_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)
+    == sq_entries_
+  ) {
+    // The kernel consumes submitted entries synchronously
+    submit();
+    CHECK_LT(
+      sq_tail_local_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE),
+      sq_entries_
+    );
+  }
+
+  io_uring_sqe& sqe = sqes_[sq_tail_local_ & sq_ring_mask_];
+  ++sq_tail_local_;
+  ++to_submit_;
+  memset(&sqe, 0, sizeof(sqe));
+  return sqe;
+}
+
+void IoUringSocketAioQueue::pop(Operation& op) {
+  map<fd_t, SocketState*>::iterator socket_state_i = socket_state_.find(op.fd);
+  CHECK(socket_state_i != socket_state_.end());
+  SocketState& socket_state = *socket_state_i->second;
+  CHECK_EQ(socket_state.head[op.direction], &op);
+
+  socket_state.head[op.direction] = op.next;
+  if (op.next != NULL) {
+    prep(*op.next);
+    op.next = NULL;
+  } else {
+    socket_state.tail[op.direction] = NULL;
+    if (socket_state.empty()) {
+      delete &socket_state;
+      socket_state_.erase(socket_state_i);
+    }
+  }
+}
+
+void IoUringSocketAioQueue::prep(Operation& op) {
+  io_uring_sqe& sqe = get_sqe();
+  sqe.fd = op.fd;
+  sqe.user_data = reinterpret_cast<uintptr_t>(&op);
+  ++inflight_count_;
+
+  if (op.polling) {
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.poll32_events = op.direction == 0 ? POLLIN : POLLOUT;
+    return;
+  }
+
+  SocketAiocb& aiocb = *op.aiocb;
+
+  switch (op.stage) {
+  case Operation::Stage::ACCEPT: {
+    op.peername.reset(new SocketAddress);
+    op.peername_len = op.peername->len();
+    sqe.opcode = IORING_OP_ACCEPT;
+    sqe.addr
+    = reinterpret_cast<uintptr_t>(static_cast<sockaddr*>(*op.peername));
+    sqe.addr2 = reinterpret_cast<uintptr_t>(&op.peername_len);
+  }
+  break;
+
+  case Operation::Stage::CONNECT: {
+    const SocketAddress* peername
+    = static_cast<ConnectAiocb&>(aiocb).peername().filter(
+        aiocb.socket().domain()
+      );
+    if (peername != NULL) {
+      sqe.opcode = IORING_OP_CONNECT;
+      sqe.addr
+      = reinterpret_cast<uintptr_t>(static_cast<const sockaddr*>(*peername));
+      sqe.off = peername->len();
+    } else {
+      // Fail through the completion path
+      sqe.opcode = IORING_OP_NOP;
+      op.error = EAFNOSUPPORT;
+    }
+  }
+  break;
+
+  case Operation::Stage::RECV: {
+    Buffer* buffer;
+    Socket::MessageFlags flags;
+    SocketAddress* peername = NULL;
+    switch (aiocb.type()) {
+    case SocketAiocb::Type::ACCEPT:
+      buffer = static_cast<AcceptAiocb&>(aiocb).recv_buffer().get();
+      break;
+    case SocketAiocb::Type::RECVFROM: {
+      RecvfromAiocb& recvfrom_aiocb = static_cast<RecvfromAiocb&>(aiocb);
+      buffer = recvfrom_aiocb.buffer().get();
+      flags = recvfrom_aiocb.flags();
+      peername = &recvfrom_aiocb.peername();
+    }
+    break;
+    default: {
+      RecvAiocb& recv_aiocb = static_cast<RecvAiocb&>(aiocb);
+      buffer = recv_aiocb.buffer().get();
+      flags = recv_aiocb.flags();
+    }
+    break;
+    }
+
+    sqe.msg_flags = static_cast<uint32_t>(static_cast<int>(flags));
+
+    if (!buffer->next_buffer() && peername == NULL) {
+      iovec iov = buffer->as_read_iovec();
+      sqe.opcode = IORING_OP_RECV;
+      sqe.addr = reinterpret_cast<uintptr_t>(iov.iov_base);
+      sqe.len = static_cast<uint32_t>(iov.iov_len);
+    } else {
+      op.iov.clear();
+      if (!buffer->next_buffer()) {
+        op.iov.push_back(buffer->as_read_iovec());
+      } else {
+        Buffers::as_read_iovecs(*buffer, op.iov);
+      }
+
+      memset(&op.msg, 0, sizeof(op.msg));
+      op.msg.msg_iov = &op.iov[0];
+      op.msg.msg_iovlen = op.iov.size();
+      if (peername != NULL) {
+        op.msg.msg_name = static_cast<sockaddr*>(*peername);
+        op.msg.msg_namelen = peername->len();
+      }
+
+      sqe.opcode = IORING_OP_RECVMSG;
+      sqe.addr = reinterpret_cast<uintptr_t>(&op.msg);
+      sqe.len = 1;
+    }
+  }
+  break;
+
+  case Operation::Stage::SEND: {
+    const Buffer* buffer;
+    Socket::MessageFlags flags;
+    if (aiocb.type() == SocketAiocb::Type::SEND) {
+      SendAiocb& send_aiocb = static_cast<SendAiocb&>(aiocb);
+      buffer = &send_aiocb.buffer();
+      flags = send_aiocb.flags();
+    } else {
+      buffer = static_cast<ConnectAiocb&>(aiocb).send_buffer().get();
+    }
+
+    sqe.msg_flags = static_cast<uint32_t>(static_cast<int>(flags));
+
+    if (!buffer->next_buffer()) {
+      sqe.opcode = IORING_OP_SEND;
+      sqe.addr
+      = reinterpret_cast<uintptr_t>(
+          static_cast<const char*>(*buffer) + op.partial_send_len
+        );
+      sqe.len = static_cast<uint32_t>(buffer->size() - op.partial_send_len);
+    } else {
+      op.iov.clear();
+      Buffers::as_write_iovecs(*buffer, op.partial_send_len, op.iov);
+
+      memset(&op.msg, 0, sizeof(op.msg));
+      op.msg.msg_iov = &op.iov[0];
+      op.msg.msg_iovlen = op.iov.size();
+
+      sqe.opcode = IORING_OP_SENDMSG;
+      sqe.addr = reinterpret_cast<uintptr_t>(&op.msg);
+      sqe.len = 1;
+    }
+  }
+  break;
+
+  default:
+    CHECK(false);
+    break;
+  }
+}
+
+void IoUringSocketAioQueue::prep_wake() {
+  io_uring_sqe& sqe = get_sqe();
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = wake_fd_;
+  sqe.addr = reinterpret_cast<uintptr_t>(&wake_value_);
+  sqe.len = sizeof(wake_value_);
+  sqe.user_data = WAKE_USER_DATA;
+  ++inflight_count_;
+}
+
+unique_ptr<SocketAiocb> IoUringSocketAioQueue::reap(bool& woken) {
+  uint32_t cq_head = *cq_head_;
+  for (;;) {
+    if (cq_head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      return unique_ptr<SocketAiocb>();
+    }
+
+    const io_uring_cqe& cqe = cqes_[cq_head & cq_ring_mask_];
+    uint64_t user_data = cqe.user_data;
+    int32_t res = cqe.res;
+    __atomic_store_n(cq_head_, ++cq_head, __ATOMIC_RELEASE);
+
+    if (user_data == CANCEL_USER_DATA) {
+      continue;
+    }
+
+    --inflight_count_;
+
+    if (user_data == WAKE_USER_DATA) {
+      prep_wake();
+      // tryenqueue also writes the eventfd; only wake() interrupts dequeue
+      if (woken_.exchange(false)) {
+        woken = true;
+        return unique_ptr<SocketAiocb>();
+      }
+    } else {
+      unique_ptr<SocketAiocb> aiocb
+      = complete(*reinterpret_cast<Operation*>(user_data), res);
+      if (aiocb != NULL) {
+        return aiocb;
+      }
+    }
+  }
+}
+
+void IoUringSocketAioQueue::start(unique_ptr<SocketAiocb> aiocb) {
+  Operation* op = new Operation(move(aiocb));
+  start(*op, op->fd);
+}
+
+void IoUringSocketAioQueue::start(Operation& op, fd_t fd) {
+  op.fd = fd;
+
+  SocketState*& socket_state = socket_state_[fd];
+  if (socket_state == NULL) {
+    socket_state = new SocketState;
+  }
+
+  if (socket_state->tail[op.direction] == NULL) {
+    socket_state->head[op.direction] = socket_state->tail[op.direction] = &op;
+    prep(op);
+  } else {
+    socket_state->tail[op.direction]->next = &op;
+    socket_state->tail[op.direction] = &op;
+  }
+}
+
+void IoUringSocketAioQueue::submit() {
+  while (to_submit_ > 0) {
+    if (enter(0, NULL) == -1 && errno != EINTR) {
+      LOG(ERROR) << "io_uring_enter: " << Exception().what();
+      return;
+    }
+  }
+}
+
+unique_ptr<SocketAiocb> IoUringSocketAioQueue::timeddequeue(const Time& timeout) {
+  Time timeout_remaining = timeout;
+
+  for (;;) {
+    bool woken = false;
+    unique_ptr<SocketAiocb> ret = reap(woken);
+    if (ret != NULL || woken) {
+      submit(); // Follow-on operations queued by reap
+      return ret;
+    }
+
+    // Publish waiting_ before draining, so a concurrent tryenqueue either
+    // is drained here or sees waiting_ and writes the eventfd.
+    if (timeout_remaining > Time::ZERO) {
+      waiting_.store(true);
+    }
+
+    for (;;) {
+      unique_ptr<SocketAiocb> aiocb = aiocb_queue_.trydequeue();
+      if (aiocb != NULL) {
+        start(move(aiocb));
+      } else {
+        break;
+      }
+    }
+
+    if (timeout_remaining == Time::ZERO) {
+      // Submit without waiting; operations may complete inline.
+      submit();
+      ret = reap(woken);
+      submit();
+      return ret;
+    }
+
+    // Submit the batch and wait for a completion in one system call
+    Time start_time = Time::now();
+    int enter_ret
+    = enter(
+        1,
+        timeout_remaining == Time::FOREVER ? NULL : &timeout_remaining
+      );
+    waiting_.store(false);
+    if (enter_ret == -1 && errno != EINTR && errno != ETIME) {
+      LOG(ERROR) << "io_uring_enter: " << Exception().what();
+      return unique_ptr<SocketAiocb>();
+    }
+
+    if (timeout_remaining != Time::FOREVER) {
+      Time elapsed_time = Time::now() - start_time;
+      if (timeout_remaining > elapsed_time) {
+        timeout_remaining -= elapsed_time;
+      } else {
+        timeout_remaining = Time::ZERO;
+      }
+    }
+  }
+}
+
+unique_ptr<SocketAiocb>
+IoUringSocketAioQueue::tryenqueue(
+  unique_ptr<SocketAiocb> aiocb
+) {
+  switch (aiocb->type()) {
+  case SocketAiocb::Type::RECVMMSG:
+  case SocketAiocb::Type::SENDMMSG:
+  case SocketAiocb::Type::SPLICE:
+    // Only the SocketNbioQueue implements these
+    return aiocb;
+  default:
+    break;
+  }
+
+  unique_ptr<SocketAiocb> ret = aiocb_queue_.tryenqueue(move(aiocb));
+  if (ret == NULL && waiting_.load()) {
+    uint64_t value = 1;
+    ssize_t write_ret = ::write(wake_fd_, &value, sizeof(value));
+    CHECK_EQ(write_ret, static_cast<ssize_t>(sizeof(value)));
+  }
+  return ret;
+}
+
+void IoUringSocketAioQueue::unmap() {
+  if (sqes_ != NULL) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != NULL && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != NULL) {
+    munmap(sq_ring_, sq_ring_size_);
+  }
+  ::close(ring_fd_);
+}
+
+void IoUringSocketAioQueue::wake() {
+  woken_.store(true);
+  uint64_t value = 1;
+  ssize_t write_ret = ::write(wake_fd_, &value, sizeof(value));
+  CHECK_EQ(write_ret, static_cast<ssize_t>(sizeof(value)));
+}
+}
+}
+}
+}
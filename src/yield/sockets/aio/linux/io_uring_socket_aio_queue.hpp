@@ -0,0 +1,147 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef _YIELD_SOCKETS_AIO_LINUX_IO_URING_SOCKET_AIO_QUEUE_HPP_
+#define _YIELD_SOCKETS_AIO_LINUX_IO_URING_SOCKET_AIO_QUEUE_HPP_
+
+#include "yield/fd_t.hpp"
+#include "yield/queue/blocking_concurrent_queue.hpp"
+#include "yield/sockets/aio/socket_aio_queue.hpp"
+
+#include <atomic>
+#include <map>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace yield {
+namespace sockets {
+namespace aio {
+namespace linux {
+/**
+  Queue for asynchronous input/output (AIO) operations on sockets,
+    implemented in terms of Linux io_uring.
+  AIO operations are translated into submission queue entries and submitted
+    to the kernel in batches, on the next dequeue call. Completions are reaped
+    directly from the shared completion ring without further system calls.
+  Operations on a socket are serialized per direction (accept/recv/recvfrom
+    and connect/send/sendfile), as in the SocketNbioQueue.
+  The queue bypasses the Socket I/O methods, so socket types that override
+    them (e.g., SSL sockets) must use the SocketNbioQueue.
+*/
+class IoUringSocketAioQueue final : public SocketAioQueue {
+public:
+  /**
+    Construct an IoUringSocketAioQueue.
+    @param entries size of the submission queue
+    @throw Exception if io_uring is unavailable or lacks a required feature
+  */
+  IoUringSocketAioQueue(uint32_t entries = 256);
+
+  ~IoUringSocketAioQueue();
+
+public:
+  /**
+    Associate a socket with this AioQueue.
+    This is a no-op in the IoUringSocketAioQueue, intended only to conform to
+      the interface of the AioQueue on Win32.
+  */
+  bool associate(socket_t) override {
+    return true;
+  }
+
+public:
+  // yield::EventQueue
+  ::std::unique_ptr<SocketAiocb> dequeue() override {
+    return timeddequeue(Time::FOREVER);
+  }
+
+  ::std::unique_ptr<SocketAiocb> timeddequeue(const Time& timeout) override;
+
+  ::std::unique_ptr<SocketAiocb> trydequeue() override {
+    return timeddequeue(Time::ZERO);
+  }
+
+  ::std::unique_ptr<SocketAiocb> tryenqueue(::std::unique_ptr<SocketAiocb> aiocb) override;
+  void wake() override;
+
+private:
+  class Operation;
+  class SocketState;
+
+private:
+  ::std::unique_ptr<SocketAiocb> complete(Operation&, int32_t res);
+  int enter(uint32_t min_complete, const Time* timeout);
+  ::std::unique_ptr<SocketAiocb> finish(Operation&);
+  io_uring_sqe& get_sqe();
+  void pop(Operation&);
+  void prep(Operation&);
+  void prep_wake();
+  ::std::unique_ptr<SocketAiocb> reap(bool& woken);
+  void start(::std::unique_ptr<SocketAiocb> aiocb);
+  void start(Operation&, fd_t fd);
+  void submit();
+  void unmap();
+
+private:
+  ::yield::queue::BlockingConcurrentQueue<SocketAiocb> aiocb_queue_;
+  uint32_t inflight_count_;
+  int ring_fd_;
+  ::std::map<fd_t, SocketState*> socket_state_;
+  ::std::atomic<bool> waiting_;
+  fd_t wake_fd_;
+  uint64_t wake_value_;
+  ::std::atomic<bool> woken_;
+
+  // Submission ring
+  uint32_t* sq_array_;
+  uint32_t sq_entries_;
+  uint32_t* sq_head_;
+  uint32_t sq_ring_mask_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  uint32_t* sq_tail_;
+  uint32_t sq_tail_local_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+  uint32_t to_submit_;
+
+  // Completion ring
+  io_uring_cqe* cqes_;
+  uint32_t* cq_head_;
+  uint32_t cq_ring_mask_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  uint32_t* cq_tail_;
+};
+}
+}
+}
+}
+
+#endif
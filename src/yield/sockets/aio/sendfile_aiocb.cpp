@@ -67,7 +67,7 @@ SendfileAiocb::SendfileAiocb(
     throw Exception();
   }
 #else
-  offset_ = ::lseek(fd_, 0, SEEK_CUR);
+  offset_ = ::lseek(*fd_, 0, SEEK_CUR);
   if (offset_ == static_cast<off_t>(-1)) {
     throw Exception();
   }
@@ -87,6 +87,7 @@ SendfileAiocb::SendfileAiocb(
   size_t nbytes
 ) : SocketAiocb(offset),
   nbytes_(nbytes),
+  offset_(offset),
   socket_(socket_) {
   init(fd);
 }
@@ -26,31 +26,58 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "yield/sockets/aio/socket_aio_queue.hpp"
+#include "yield/exception.hpp"
 #include "yield/logging.hpp"
 #include "yield/sockets/aio/accept_aiocb.hpp"
 #include "yield/sockets/aio/connect_aiocb.hpp"
 #include "yield/sockets/aio/recv_aiocb.hpp"
 #include "yield/sockets/aio/recvfrom_aiocb.hpp"
+#include "yield/sockets/aio/recvmmsg_aiocb.hpp"
 #include "yield/sockets/aio/send_aiocb.hpp"
 #include "yield/sockets/aio/sendfile_aiocb.hpp"
+#include "yield/sockets/aio/sendmmsg_aiocb.hpp"
+#include "yield/sockets/aio/splice_aiocb.hpp"
 
-#ifdef _WIN32
-#include "win32/win32_socket_aio_queue.hpp"
-#else
 #include "yield/sockets/aio/socket_nbio_queue.hpp"
+
+#if defined(__linux__)
+#include "linux/io_uring_socket_aio_queue.hpp"
+#elif defined(_WIN32)
+#include "win32/win32_socket_aio_queue.hpp"
 #endif
 
 namespace yield {
 namespace sockets {
 namespace aio {
 using ::std::unique_ptr;
+using ::yield::poll::FdEventQueue;
 
-unique_ptr<SocketAioQueue> SocketAioQueue::create() {
+unique_ptr<SocketAioQueue>
+SocketAioQueue::create(
+  Implementation implementation,
+  FdEventQueue::Trigger trigger
+) {
+  switch (implementation) {
+  case Implementation::IO_URING:
+#ifdef __linux__
+    try {
+      return unique_ptr<SocketAioQueue>(new linux::IoUringSocketAioQueue());
+    } catch (Exception& exception) {
+      LOG(WARNING) << "io_uring unavailable, falling back: " << exception.what();
+    }
+#endif
+    return create(Implementation::DEFAULT, trigger);
+
+  case Implementation::NBIO:
+    return unique_ptr<SocketAioQueue>(new SocketNbioQueue(trigger));
+
+  default:
 #ifdef _WIN32
-  return unique_ptr<SocketAioQueue>(new win32::Win32SocketAioQueue());
+    return unique_ptr<SocketAioQueue>(new win32::Win32SocketAioQueue());
 #else
-  return unique_ptr<SocketAioQueue>(new SocketNbioQueue());
+    return unique_ptr<SocketAioQueue>(new SocketNbioQueue(trigger));
 #endif
+  }
 }
 
 template <class AiocbType> void SocketAioQueue::log_completion(AiocbType& aiocb) {
@@ -73,20 +100,29 @@ template void SocketAioQueue::log_completion(AcceptAiocb&);
 template void SocketAioQueue::log_completion(ConnectAiocb&);
 template void SocketAioQueue::log_completion(RecvAiocb&);
 template void SocketAioQueue::log_completion(RecvfromAiocb&);
+template void SocketAioQueue::log_completion(RecvmmsgAiocb&);
 template void SocketAioQueue::log_completion(SendAiocb&);
 template void SocketAioQueue::log_completion(SendfileAiocb&);
+template void SocketAioQueue::log_completion(SendmmsgAiocb&);
+template void SocketAioQueue::log_completion(SpliceAiocb&);
 template void SocketAioQueue::log_enqueue(AcceptAiocb&);
 template void SocketAioQueue::log_enqueue(ConnectAiocb&);
 template void SocketAioQueue::log_enqueue(RecvAiocb&);
 template void SocketAioQueue::log_enqueue(RecvfromAiocb&);
+template void SocketAioQueue::log_enqueue(RecvmmsgAiocb&);
 template void SocketAioQueue::log_enqueue(SendAiocb&);
 template void SocketAioQueue::log_enqueue(SendfileAiocb&);
+template void SocketAioQueue::log_enqueue(SendmmsgAiocb&);
+template void SocketAioQueue::log_enqueue(SpliceAiocb&);
 template void SocketAioQueue::log_error(AcceptAiocb&);
 template void SocketAioQueue::log_error(ConnectAiocb&);
 template void SocketAioQueue::log_error(RecvAiocb&);
 template void SocketAioQueue::log_error(RecvfromAiocb&);
+template void SocketAioQueue::log_error(RecvmmsgAiocb&);
 template void SocketAioQueue::log_error(SendAiocb&);
 template void SocketAioQueue::log_error(SendfileAiocb&);
+template void SocketAioQueue::log_error(SendmmsgAiocb&);
+template void SocketAioQueue::log_error(SpliceAiocb&);
 }
 }
 }
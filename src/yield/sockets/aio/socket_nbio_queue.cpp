@@ -34,9 +34,18 @@
 #include "yield/sockets/aio/connect_aiocb.hpp"
 #include "yield/sockets/aio/recv_aiocb.hpp"
 #include "yield/sockets/aio/recvfrom_aiocb.hpp"
+#include "yield/sockets/aio/recvmmsg_aiocb.hpp"
 #include "yield/sockets/aio/socket_nbio_queue.hpp"
 #include "yield/sockets/aio/send_aiocb.hpp"
 #include "yield/sockets/aio/sendfile_aiocb.hpp"
+#include "yield/sockets/aio/sendmmsg_aiocb.hpp"
+#include "yield/sockets/aio/splice_aiocb.hpp"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace yield {
 namespace sockets {
@@ -45,14 +54,22 @@ using ::std::map;
 using ::std::move;
 using ::std::shared_ptr;
 using ::std::unique_ptr;
-using ::std::vector;
 using ::yield::poll::FdEvent;
+using ::yield::poll::FdEventQueue;
+using ::yield::thread::Mutex;
 
 class SocketNbioQueue::AiocbState {
 public:
-  AiocbState(unique_ptr<SocketAiocb> aiocb, ssize_t partial_send_len)
+  AiocbState(
+    unique_ptr<SocketAiocb> aiocb,
+    ssize_t partial_send_len,
+    const Buffers::WriteCursor& send_cursor,
+    RetryStatus want
+  )
     : aiocb_(move(aiocb)),
-      partial_send_len_(partial_send_len) {
+      partial_send_len_(partial_send_len),
+      send_cursor_(send_cursor),
+      want_(want) {
     next_aiocb_state_ = NULL;
   }
 
@@ -64,11 +81,16 @@ public:
   unique_ptr<SocketAiocb> aiocb_;
   AiocbState* next_aiocb_state_;
   size_t partial_send_len_;
+  // Position in a chained send buffer after partial_send_len_ bytes
+  Buffers::WriteCursor send_cursor_;
+  RetryStatus want_; // WANT_RECV or WANT_SEND
 };
 
 class SocketNbioQueue::SocketState {
 public:
-  SocketState() {
+  SocketState(FdEvent::Type ready_fd_event_types)
+    : associated_fd_event_types(0),
+      ready_fd_event_types(ready_fd_event_types) {
     memset(aiocb_state, 0, sizeof(aiocb_state));
   }
 
@@ -88,44 +110,191 @@ public:
     return true;
   }
 
+  // Sends and receives wait for a pending accept or connect
+  bool gated(uint8_t aiocb_priority) const {
+    return aiocb_priority >= 2
+           &&
+           (aiocb_state[0] != NULL || aiocb_state[1] != NULL);
+  }
+
+  // Queue an aiocb behind those of the same priority
+  void push_back(uint8_t aiocb_priority, AiocbState* aiocb_state) {
+    if (this->aiocb_state[aiocb_priority] == NULL) {
+      this->aiocb_state[aiocb_priority] = aiocb_state;
+    } else {
+      AiocbState* last_aiocb_state = this->aiocb_state[aiocb_priority];
+      while (last_aiocb_state->next_aiocb_state_ != NULL) {
+        last_aiocb_state = last_aiocb_state->next_aiocb_state_;
+      }
+      last_aiocb_state->next_aiocb_state_ = aiocb_state;
+    }
+  }
+
+  FdEvent::Type want_fd_event_types() const {
+    FdEvent::Type want_fd_event_types = 0;
+    for (uint8_t i = 0; i < 4; ++i) {
+      if (aiocb_state[i] != NULL && !gated(i)) {
+        want_fd_event_types |= get_fd_event_type(aiocb_state[i]->want_);
+      }
+    }
+    return want_fd_event_types;
+  }
+
 public:
   AiocbState* aiocb_state[4]; // accept, connect, send, recv
+  // FdEvent types the fd is currently associated for
+  FdEvent::Type associated_fd_event_types;
+  // Directions reported ready that have not would-blocked since
+  FdEvent::Type ready_fd_event_types;
 };
 
-SocketNbioQueue::SocketNbioQueue()
-  : fd_event_queue_(true) {
+SocketNbioQueue::SocketNbioQueue(FdEventQueue::Trigger trigger)
+  : fd_event_queue_(
+      true,
+      // Several threads may only share an unbuffered FdEventQueue
+      trigger == FdEventQueue::Trigger::ONESHOT ? 1 : FD_EVENT_BATCH_SIZE
+    ),
+    trigger_(trigger),
+    woken_(false) {
 }
 
-void SocketNbioQueue::associate(SocketAiocb& aiocb, RetryStatus retry_status) {
-  switch (retry_status) {
-  case RetryStatus::WANT_RECV: {
-    bool associate_ret =
-      fd_event_queue_.associate(
-        aiocb.socket(),
-        FdEvent::TYPE_READ_READY
-      );
-    CHECK(associate_ret);
+SocketNbioQueue::~SocketNbioQueue() {
+  for (
+    auto socket_state_i = socket_state_.begin();
+    socket_state_i != socket_state_.end();
+    ++socket_state_i
+  ) {
+    delete socket_state_i->second;
+  }
+}
+
+bool SocketNbioQueue::associate(socket_t socket_) {
+  if (trigger_ != FdEventQueue::Trigger::EDGE) {
+    return true;
+  }
+
+#ifdef _WIN32
+  fd_t fd = reinterpret_cast<fd_t>(socket_);
+#else
+  fd_t fd = socket_;
+#endif
+
+  Mutex::Holder socket_state_mutex_holder(socket_state_mutex_);
+  // Associate even a descriptor that is in edge_associated_fds_, in case it
+  // was closed without being dissociated and has been reused since.
+  if (
+    !fd_event_queue_.associate(
+      fd,
+      FdEvent::TYPE_READ_READY | FdEvent::TYPE_WRITE_READY,
+      trigger_
+    )
+  ) {
+    return false;
+  }
+  edge_associated_fds_.insert(fd);
+  return true;
+}
+
+void SocketNbioQueue::associate(map<fd_t, SocketState*>::iterator socket_state_i) {
+  fd_t fd = socket_state_i->first;
+  SocketState* socket_state = socket_state_i->second;
+
+  if (socket_state->empty()) {
+    if (
+      trigger_ == FdEventQueue::Trigger::LEVEL
+      &&
+      socket_state->associated_fd_event_types != 0
+    ) {
+      fd_event_queue_.dissociate(fd);
+    }
+    // An EDGE association stays in place for the next SocketState of the fd;
+    // a fired ONESHOT association is already disarmed.
+    delete socket_state;
+    socket_state_.erase(socket_state_i);
+    return;
+  }
+
+  FdEvent::Type associate_fd_event_types;
+  switch (trigger_) {
+  case FdEventQueue::Trigger::EDGE: {
+    // Once per SocketState. If the fd is still associated this is only an
+    // EPOLL_CTL_ADD probe that fails with EEXIST; if it was closed without
+    // being dissociated and has been reused since, it is associated anew.
+    if (socket_state->associated_fd_event_types != 0) {
+      return;
+    }
+    edge_associated_fds_.insert(fd);
+    associate_fd_event_types
+      = FdEvent::TYPE_READ_READY | FdEvent::TYPE_WRITE_READY;
   }
   break;
 
-  case RetryStatus::WANT_SEND: {
-    bool associate_ret =
-      fd_event_queue_.associate(
-        aiocb.socket(),
-        FdEvent::TYPE_WRITE_READY
-      );
-    CHECK(associate_ret);
+  case FdEventQueue::Trigger::ONESHOT: {
+    FdEvent::Type want_fd_event_types = socket_state->want_fd_event_types();
+    if (
+      (want_fd_event_types & ~socket_state->associated_fd_event_types) == 0
+    ) {
+      return;
+    }
+    associate_fd_event_types
+      = socket_state->associated_fd_event_types | want_fd_event_types;
   }
   break;
 
-  default:
-    CHECK(false);
-    break;
+  default: {
+    associate_fd_event_types = socket_state->want_fd_event_types();
+    if (associate_fd_event_types == socket_state->associated_fd_event_types) {
+      return;
+    }
+  }
+  break;
   }
+
+  CHECK_NE(associate_fd_event_types, 0);
+  bool associate_ret
+  = fd_event_queue_.associate(fd, associate_fd_event_types, trigger_);
+  CHECK(associate_ret);
+  socket_state->associated_fd_event_types = associate_fd_event_types;
+}
+
+void SocketNbioQueue::associate_splice_fds() {
+  for (
+    auto aiocb_state_i = splice_aiocb_states_.begin();
+    aiocb_state_i != splice_aiocb_states_.end();
+    ++aiocb_state_i
+  ) {
+    AiocbState* aiocb_state = *aiocb_state_i;
+    fd_t fd = static_cast<SpliceAiocb&>(*aiocb_state->aiocb_).fd();
+
+    // The descriptor has just would-blocked on a write
+    auto socket_state_i = socket_state_.find(fd);
+    if (socket_state_i == socket_state_.end()) {
+      socket_state_i
+        = socket_state_.insert(
+            ::std::make_pair(fd, new SocketState(FdEvent::TYPE_READ_READY))
+          ).first;
+    } else {
+      socket_state_i->second->ready_fd_event_types
+        &= ~FdEvent::TYPE_WRITE_READY;
+    }
+
+    // Behind the sends already queued on the descriptor
+    socket_state_i->second->push_back(
+      get_aiocb_priority(SocketAiocb::Type::SEND),
+      aiocb_state
+    );
+    associate(socket_state_i);
+  }
+
+  splice_aiocb_states_.clear();
 }
 
 uint8_t SocketNbioQueue::get_aiocb_priority(const SocketAiocb& aiocb) {
-  switch (aiocb.type()) {
+  return get_aiocb_priority(aiocb.type());
+}
+
+uint8_t SocketNbioQueue::get_aiocb_priority(SocketAiocb::Type aiocb_type) {
+  switch (aiocb_type) {
   case SocketAiocb::Type::ACCEPT:
     return 0;
   case SocketAiocb::Type::CONNECT:
@@ -134,10 +303,40 @@ uint8_t SocketNbioQueue::get_aiocb_priority(const SocketAiocb& aiocb) {
     return 3;
   case SocketAiocb::Type::RECVFROM:
     return 3;
+  case SocketAiocb::Type::RECVMMSG:
+    return 3;
   case SocketAiocb::Type::SEND:
     return 2;
   case SocketAiocb::Type::SENDFILE:
     return 2;
+  case SocketAiocb::Type::SENDMMSG:
+    return 2;
+  case SocketAiocb::Type::SPLICE:
+    return 3;
+  default:
+    CHECK(false);
+    return 0;
+  }
+}
+
+SocketNbioQueue::RetryStatus SocketNbioQueue::get_aiocb_want(const SocketAiocb& aiocb) {
+  switch (aiocb.type()) {
+  case SocketAiocb::Type::CONNECT:
+  case SocketAiocb::Type::SEND:
+  case SocketAiocb::Type::SENDFILE:
+  case SocketAiocb::Type::SENDMMSG:
+    return RetryStatus::WANT_SEND;
+  default:
+    return RetryStatus::WANT_RECV;
+  }
+}
+
+FdEvent::Type SocketNbioQueue::get_fd_event_type(RetryStatus retry_status) {
+  switch (retry_status) {
+  case RetryStatus::WANT_RECV:
+    return FdEvent::TYPE_READ_READY;
+  case RetryStatus::WANT_SEND:
+    return FdEvent::TYPE_WRITE_READY;
   default:
     CHECK(false);
     return 0;
@@ -172,26 +371,103 @@ void SocketNbioQueue::log_wouldblock(AiocbType& aiocb, RetryStatus retry_status)
   DLOG(DEBUG) << aiocb << " would block on " << retry_status_str;
 }
 
-SocketNbioQueue::RetryStatus SocketNbioQueue::retry(SocketAiocb& aiocb, size_t& partial_send_len) {
+SocketNbioQueue::RetryStatus
+SocketNbioQueue::retry(
+  SocketAiocb& aiocb,
+  size_t& partial_send_len,
+  Buffers::WriteCursor& send_cursor
+) {
   switch (aiocb.type()) {
   case SocketAiocb::Type::ACCEPT:
     return retry_accept(static_cast<AcceptAiocb&>(aiocb));
   case SocketAiocb::Type::CONNECT:
-    return retry_connect(static_cast<ConnectAiocb&>(aiocb), partial_send_len);
+    return retry_connect(
+             static_cast<ConnectAiocb&>(aiocb),
+             partial_send_len,
+             send_cursor
+           );
   case SocketAiocb::Type::RECV:
     return retry_recv(static_cast<RecvAiocb&>(aiocb));
   case SocketAiocb::Type::RECVFROM:
     return retry_recvfrom(static_cast<RecvfromAiocb&>(aiocb));
+  case SocketAiocb::Type::RECVMMSG:
+    return retry_recvmmsg(static_cast<RecvmmsgAiocb&>(aiocb));
   case SocketAiocb::Type::SEND:
-    return retry_send(static_cast<SendAiocb&>(aiocb), partial_send_len);
+    return retry_send(
+             static_cast<SendAiocb&>(aiocb),
+             partial_send_len,
+             send_cursor
+           );
   case SocketAiocb::Type::SENDFILE:
     return retry_sendfile(static_cast<SendfileAiocb&>(aiocb), partial_send_len);
+  case SocketAiocb::Type::SENDMMSG:
+    return retry_sendmmsg(static_cast<SendmmsgAiocb&>(aiocb), partial_send_len);
+  case SocketAiocb::Type::SPLICE:
+    return retry_splice(static_cast<SpliceAiocb&>(aiocb), partial_send_len);
   default:
     CHECK(false);
     return RetryStatus::ERROR;
   }
 }
 
+void SocketNbioQueue::retry_ready(SocketState& socket_state) {
+  for (uint8_t aiocb_priority = 0; aiocb_priority < 4; ++aiocb_priority) {
+    if (socket_state.gated(aiocb_priority)) {
+      break;
+    }
+
+    for (;;) {
+      AiocbState* aiocb_state = socket_state.aiocb_state[aiocb_priority];
+      if (
+        aiocb_state == NULL
+        ||
+        (
+          socket_state.ready_fd_event_types
+          & get_fd_event_type(aiocb_state->want_)
+        ) == 0
+      ) {
+        break;
+      }
+
+      size_t& partial_send_len = aiocb_state->partial_send_len_;
+      size_t old_partial_send_len = partial_send_len;
+      RetryStatus retry_status
+      = retry(
+          *aiocb_state->aiocb_,
+          partial_send_len,
+          aiocb_state->send_cursor_
+        );
+
+      if (
+        retry_status == RetryStatus::COMPLETE
+        ||
+        retry_status == RetryStatus::ERROR
+      ) {
+        completed_aiocbs_.push_back(move(aiocb_state->aiocb_));
+        socket_state.aiocb_state[aiocb_priority]
+        = aiocb_state->next_aiocb_state_;
+        aiocb_state->next_aiocb_state_ = NULL;
+        delete aiocb_state;
+      } else if (retry_status == RetryStatus::WANT_SEND_FD) {
+        // Wait on the splice's descriptor from now on
+        socket_state.aiocb_state[aiocb_priority]
+        = aiocb_state->next_aiocb_state_;
+        aiocb_state->next_aiocb_state_ = NULL;
+        aiocb_state->want_ = RetryStatus::WANT_SEND;
+        splice_aiocb_states_.push_back(aiocb_state);
+      } else {
+        aiocb_state->want_ = retry_status;
+        // A partial send may have stopped short of filling the socket buffer,
+        // so only a retry without progress shows the direction is not ready.
+        if (partial_send_len == old_partial_send_len) {
+          socket_state.ready_fd_event_types
+          &= ~get_fd_event_type(retry_status);
+        }
+      }
+    }
+  }
+}
+
 SocketNbioQueue::RetryStatus SocketNbioQueue::retry_accept(AcceptAiocb& accept_aiocb) {
   log_retry(accept_aiocb);
 
@@ -237,7 +513,8 @@ SocketNbioQueue::RetryStatus SocketNbioQueue::retry_accept(AcceptAiocb& accept_a
 SocketNbioQueue::RetryStatus
 SocketNbioQueue::retry_connect(
   ConnectAiocb& connect_aiocb,
-  size_t& partial_send_len
+  size_t& partial_send_len,
+  Buffers::WriteCursor& send_cursor
 ) {
   log_retry(connect_aiocb);
 
@@ -247,7 +524,8 @@ SocketNbioQueue::retry_connect(
         return retry_send(
                  connect_aiocb,
                  *connect_aiocb.send_buffer(),
-                 partial_send_len
+                 partial_send_len,
+                 send_cursor
                );
       } else {
         connect_aiocb.set_return(0);
@@ -322,16 +600,49 @@ SocketNbioQueue::RetryStatus SocketNbioQueue::retry_recvfrom(RecvfromAiocb& recv
   return RetryStatus::ERROR;
 }
 
+SocketNbioQueue::RetryStatus SocketNbioQueue::retry_recvmmsg(RecvmmsgAiocb& recvmmsg_aiocb) {
+  log_retry(recvmmsg_aiocb);
+
+  if (recvmmsg_aiocb.socket().set_blocking_mode(false)) {
+    ssize_t recv_ret
+    = recvmmsg_aiocb.socket().recvmmsg(
+        recvmmsg_aiocb.buffers_.data(),
+        recvmmsg_aiocb.buffers_.size(),
+        recvmmsg_aiocb.flags(),
+        recvmmsg_aiocb.peernames_.data(),
+        recvmmsg_aiocb.gro_segment_sizes_.data()
+      );
+
+    if (recv_ret >= 0) {
+      recvmmsg_aiocb.set_return(recv_ret);
+      log_completion(recvmmsg_aiocb);
+      return RetryStatus::COMPLETE;
+    } else if (recvmmsg_aiocb.socket().want_recv()) {
+      log_wouldblock(recvmmsg_aiocb, RetryStatus::WANT_RECV);
+      return RetryStatus::WANT_RECV;
+    }
+  }
+
+  recvmmsg_aiocb.set_error(Exception::get_last_error_code());
+  log_error(recvmmsg_aiocb);
+  return RetryStatus::ERROR;
+}
 
 SocketNbioQueue::RetryStatus
 SocketNbioQueue::retry_send(
   SendAiocb& send_aiocb,
-  size_t& partial_send_len
+  size_t& partial_send_len,
+  Buffers::WriteCursor& send_cursor
 ) {
   log_retry(send_aiocb);
 
   if (send_aiocb.socket().set_blocking_mode(false)) {
-    return retry_send(send_aiocb, send_aiocb.buffer(), partial_send_len);
+    return retry_send(
+             send_aiocb,
+             send_aiocb.buffer(),
+             partial_send_len,
+             send_cursor
+           );
   } else {
     send_aiocb.set_error(Exception::get_last_error_code());
     log_error(send_aiocb);
@@ -344,11 +655,11 @@ SocketNbioQueue::RetryStatus
 SocketNbioQueue::retry_send(
   AiocbType& aiocb,
   const Buffer& buffer,
-  size_t& partial_send_len
+  size_t& partial_send_len,
+  Buffers::WriteCursor& send_cursor
 ) {
-  ssize_t complete_send_ret, send_ret;
+  ssize_t send_ret;
   if (!buffer.next_buffer()) {
-    complete_send_ret = buffer.size() - partial_send_len;
     send_ret
     = aiocb.socket().send(
         static_cast<const char*>(buffer) + partial_send_len,
@@ -356,16 +667,34 @@ SocketNbioQueue::retry_send(
         0
       );
   } else {
-    vector<iovec> iov;
-    complete_send_ret
-    = Buffers::as_write_iovecs(buffer, partial_send_len, iov);
-    send_ret = aiocb.socket().sendmsg(&iov[0], iov.size(), 0);
+    if (partial_send_len == 0) {
+      send_cursor.reset(buffer);
+    }
+
+    // Chains longer than the array go out over successive sendmsg calls
+    iovec iov[Buffers::WRITE_IOVECS_MAX];
+    size_t iov_size;
+    int iovlen
+    = send_cursor.as_write_iovecs(iov, Buffers::WRITE_IOVECS_MAX, iov_size);
+    if (iovlen > 0) {
+      send_ret = aiocb.socket().sendmsg(iov, iovlen, 0);
+    } else {
+      send_ret = 0;
+    }
   }
 
   if (send_ret >= 0) {
     partial_send_len += static_cast<size_t>(send_ret);
 
-    if (send_ret == complete_send_ret) {
+    bool complete;
+    if (!buffer.next_buffer()) {
+      complete = partial_send_len == buffer.size();
+    } else {
+      send_cursor.advance(static_cast<size_t>(send_ret));
+      complete = send_cursor.empty();
+    }
+
+    if (complete) {
       aiocb.set_return(partial_send_len);
       log_completion(aiocb);
       return RetryStatus::COMPLETE;
@@ -426,178 +755,323 @@ SocketNbioQueue::retry_sendfile(
   return RetryStatus::ERROR;
 }
 
+SocketNbioQueue::RetryStatus
+SocketNbioQueue::retry_sendmmsg(
+  SendmmsgAiocb& sendmmsg_aiocb,
+  size_t& partial_send_len
+) {
+  log_retry(sendmmsg_aiocb);
+
+  // partial_send_len counts the buffers sent
+  if (sendmmsg_aiocb.socket().set_blocking_mode(false)) {
+    while (partial_send_len < sendmmsg_aiocb.buffers().size()) {
+      ssize_t send_ret
+      = sendmmsg_aiocb.socket().sendmmsg(
+          sendmmsg_aiocb.buffers().data() + partial_send_len,
+          sendmmsg_aiocb.buffers().size() - partial_send_len,
+          sendmmsg_aiocb.flags(),
+          sendmmsg_aiocb.peernames().empty()
+          ? NULL
+          : sendmmsg_aiocb.peernames().data() + partial_send_len,
+          sendmmsg_aiocb.gso_segment_size()
+        );
+
+      if (send_ret > 0) {
+        partial_send_len += static_cast<size_t>(send_ret);
+      } else if (send_ret < 0 && sendmmsg_aiocb.socket().want_send()) {
+        if (partial_send_len > 0) {
+          log_partial_send(sendmmsg_aiocb, partial_send_len);
+        } else {
+          log_wouldblock(sendmmsg_aiocb, RetryStatus::WANT_SEND);
+        }
+        return RetryStatus::WANT_SEND;
+      } else {
+        break;
+      }
+    }
+
+    if (partial_send_len == sendmmsg_aiocb.buffers().size()) {
+      sendmmsg_aiocb.set_return(partial_send_len);
+      log_completion(sendmmsg_aiocb);
+      return RetryStatus::COMPLETE;
+    }
+  }
+
+  sendmmsg_aiocb.set_error(Exception::get_last_error_code());
+  log_error(sendmmsg_aiocb);
+  return RetryStatus::ERROR;
+}
+
+SocketNbioQueue::RetryStatus
+SocketNbioQueue::retry_splice(
+  SpliceAiocb& splice_aiocb,
+  size_t& partial_send_len
+) {
+  log_retry(splice_aiocb);
+
+#ifdef _WIN32
+  splice_aiocb.set_error(ERROR_NOT_SUPPORTED);
+  log_error(splice_aiocb);
+  return RetryStatus::ERROR;
+#else
+  // Data received by an earlier retry is written before anything else
+  bool received = false;
+  if (splice_aiocb.recv_len_ == 0) {
+    if (!splice_aiocb.socket().set_blocking_mode(false)) {
+      splice_aiocb.set_error(Exception::get_last_error_code());
+      log_error(splice_aiocb);
+      return RetryStatus::ERROR;
+    }
+
+#ifdef __linux__
+    ssize_t recv_ret
+    = ::splice(
+        static_cast<socket_t>(splice_aiocb.socket()),
+        NULL,
+        *splice_aiocb.pipe_[1],
+        NULL,
+        splice_aiocb.nbytes(),
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK
+      );
+#else
+    ssize_t recv_ret = splice_aiocb.socket().recv(*splice_aiocb.buffer_, 0);
+#endif
+
+    if (recv_ret > 0) {
+      splice_aiocb.recv_len_ = static_cast<size_t>(recv_ret);
+      received = true;
+    } else if (recv_ret == 0) {
+      splice_aiocb.set_return(0);
+      log_completion(splice_aiocb);
+      return RetryStatus::COMPLETE;
+    } else if (splice_aiocb.socket().want_recv()) {
+      log_wouldblock(splice_aiocb, RetryStatus::WANT_RECV);
+      return RetryStatus::WANT_RECV;
+    } else {
+      splice_aiocb.set_error(Exception::get_last_error_code());
+      log_error(splice_aiocb);
+      return RetryStatus::ERROR;
+    }
+  }
+
+  while (partial_send_len < splice_aiocb.recv_len_) {
+#ifdef __linux__
+    ssize_t write_ret
+    = ::splice(
+        *splice_aiocb.pipe_[0],
+        NULL,
+        splice_aiocb.fd(),
+        NULL,
+        splice_aiocb.recv_len_ - partial_send_len,
+        SPLICE_F_MOVE | SPLICE_F_NONBLOCK
+      );
+#else
+    ssize_t write_ret
+    = ::write(
+        splice_aiocb.fd(),
+        static_cast<const char*>(*splice_aiocb.buffer_) + partial_send_len,
+        splice_aiocb.recv_len_ - partial_send_len
+      );
+#endif
+
+    if (write_ret > 0) {
+      partial_send_len += static_cast<size_t>(write_ret);
+    } else if (write_ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      log_wouldblock(splice_aiocb, RetryStatus::WANT_SEND);
+      return received ? RetryStatus::WANT_SEND_FD : RetryStatus::WANT_SEND;
+    } else {
+      splice_aiocb.set_error(Exception::get_last_error_code());
+      log_error(splice_aiocb);
+      return RetryStatus::ERROR;
+    }
+  }
+
+  splice_aiocb.set_return(partial_send_len);
+  log_completion(splice_aiocb);
+  return RetryStatus::COMPLETE;
+#endif
+}
+
+unique_ptr<SocketAiocb> SocketNbioQueue::pop_completed_aiocb() {
+  if (completed_aiocbs_.empty()) {
+    return unique_ptr<SocketAiocb>();
+  }
+
+  unique_ptr<SocketAiocb> aiocb = move(completed_aiocbs_.front());
+  completed_aiocbs_.pop_front();
+  return aiocb;
+}
+
+bool SocketNbioQueue::dissociate(socket_t socket_) {
+  if (trigger_ != FdEventQueue::Trigger::EDGE) {
+    return true;
+  }
+
+#ifdef _WIN32
+  fd_t fd = reinterpret_cast<fd_t>(socket_);
+#else
+  fd_t fd = socket_;
+#endif
+
+  Mutex::Holder socket_state_mutex_holder(socket_state_mutex_);
+  if (edge_associated_fds_.erase(fd) == 1) {
+    return fd_event_queue_.dissociate(fd);
+  } else {
+    return true;
+  }
+}
+
 unique_ptr<SocketAiocb> SocketNbioQueue::timeddequeue(const Time& timeout) {
-  Time timeout_remaining = timeout;
+  {
+    Mutex::Holder socket_state_mutex_holder(socket_state_mutex_);
+    unique_ptr<SocketAiocb> ret = pop_completed_aiocb();
+    if (ret) {
+      return ret;
+    }
+  }
 
-  Time start_time = Time::now();
   unique_ptr<SocketAiocb> ret(timeddequeue_fd_event_queue(Time::ZERO));
   if (ret) {
     return ret;
   }
-  Time elapsed_time = Time::now() - start_time;
-  if (timeout_remaining <= elapsed_time) {
-    return unique_ptr<SocketAiocb>();
-  }
-  timeout_remaining -= elapsed_time;
 
+  Time deadline
+    = timeout == Time::FOREVER ? Time::FOREVER : Time::now() + timeout;
   for (;;) {
-    start_time = Time::now();
+    if (woken_.exchange(false)) {
+      return unique_ptr<SocketAiocb>();
+    }
+
     ret = trydequeue_aiocb_queue();
     if (ret) {
       return ret;
     }
-    elapsed_time = Time::now() - start_time;
-    if (timeout_remaining <= elapsed_time) {
-      return unique_ptr<SocketAiocb>();
-    }
-    timeout_remaining -= elapsed_time;
 
-    start_time = Time::now();
+    // Past the deadline this polls once more
+    Time timeout_remaining
+      = deadline == Time::FOREVER ? Time::FOREVER : deadline - Time::now();
     ret = timeddequeue_fd_event_queue(timeout_remaining);
     if (ret) {
       return ret;
-    }
-    elapsed_time = Time::now() - start_time;
-    if (timeout_remaining <= elapsed_time) {
+    } else if (timeout_remaining == Time::ZERO) {
       return unique_ptr<SocketAiocb>();
     }
-    timeout_remaining -= elapsed_time;
   }
 }
 
 unique_ptr<SocketAiocb> SocketNbioQueue::timeddequeue_fd_event_queue(const Time& timeout) {
-  shared_ptr<FdEvent> fd_event = fd_event_queue_.timeddequeue(timeout);
+  unique_ptr<FdEvent> fd_event = fd_event_queue_.timeddequeue(timeout);
   if (!fd_event) {
     return unique_ptr<SocketAiocb>();
   }
 
-  fd_t fd = fd_event->fd();
+  Mutex::Holder socket_state_mutex_holder(socket_state_mutex_);
 
-  auto socket_state_i = this->socket_state_.find(fd);
-  CHECK_NE(socket_state_i, this->socket_state_.end());
+  auto socket_state_i = this->socket_state_.find(fd_event->fd());
+  if (socket_state_i == this->socket_state_.end()) {
+    // Nothing is pending on the fd (any more): the event is stale, or it is
+    // an EDGE association outliving its SocketState. A later aiocb on the fd
+    // is retried before it waits for readiness, so nothing is lost.
+    return unique_ptr<SocketAiocb>();
+  }
   SocketState* socket_state = socket_state_i->second;
 
-  uint16_t want_fd_event_types = 0;
-
-  for (uint8_t aiocb_priority = 0; aiocb_priority < 4; ++aiocb_priority) {
-    AiocbState* aiocb_state = socket_state->aiocb_state[aiocb_priority];
-    if (aiocb_state != NULL) {
-      SocketAiocb& aiocb = *aiocb_state->aiocb_;
-      size_t& partial_send_len = aiocb_state->partial_send_len_;
-      RetryStatus retry_status = retry(aiocb, partial_send_len);
-
-      if (
-        retry_status == RetryStatus::COMPLETE
-        ||
-        retry_status == RetryStatus::ERROR
-      ) {
-        unique_ptr<SocketAiocb> ret = move(aiocb_state->aiocb_);
-
-        if (aiocb_state->next_aiocb_state_ == NULL) {
-          socket_state->aiocb_state[aiocb_priority] = NULL;
-
-          if (socket_state->empty()) {
-            delete socket_state;
-            this->socket_state_.erase(socket_state_i);
-            fd_event_queue_.dissociate(fd);
-          }
-        } else {
-          socket_state->aiocb_state[aiocb_priority]
-          = aiocb_state->next_aiocb_state_;
-          aiocb_state->next_aiocb_state_ = NULL;
-          delete aiocb_state;
-        }
-
-        return ret;
-      } else if (retry_status == RetryStatus::WANT_RECV) {
-        want_fd_event_types |= FdEvent::TYPE_READ_READY;
-        break;
-      } else if (retry_status == RetryStatus::WANT_SEND) {
-        want_fd_event_types |= FdEvent::TYPE_WRITE_READY;
-        break;
-      }
-    }
+  if (trigger_ == FdEventQueue::Trigger::ONESHOT) {
+    // The event disarmed the association
+    socket_state->associated_fd_event_types = 0;
   }
 
-  CHECK_NE(want_fd_event_types, 0);
-  bool associate_ret
-  = fd_event_queue_.associate(fd, want_fd_event_types);
-  CHECK(associate_ret);
+  if (fd_event->type() & (FdEvent::TYPE_ERROR | FdEvent::TYPE_HUP)) {
+    // Let the retries discover the error
+    socket_state->ready_fd_event_types
+      = FdEvent::TYPE_READ_READY | FdEvent::TYPE_WRITE_READY;
+  } else {
+    socket_state->ready_fd_event_types
+    |= fd_event->type()
+       & (FdEvent::TYPE_READ_READY | FdEvent::TYPE_WRITE_READY);
+  }
 
-  return unique_ptr<SocketAiocb>();
+  retry_ready(*socket_state);
+  associate(socket_state_i);
+  associate_splice_fds();
+  return pop_completed_aiocb();
 }
 
 unique_ptr<SocketAiocb> SocketNbioQueue::trydequeue_aiocb_queue() {
-  unique_ptr<SocketAiocb> aiocb(aiocb_queue_.trydequeue());
-  if (!aiocb) {
-    return unique_ptr<SocketAiocb>();
-  }
-
-  auto socket_state_i = this->socket_state_.find(aiocb->socket());
-  if (socket_state_i == this->socket_state_.end()) {
-    size_t partial_send_len = 0;
-    RetryStatus retry_status = retry(*aiocb, partial_send_len);
-    switch (retry_status) {
-    case RetryStatus::COMPLETE:
-    case RetryStatus::ERROR:
-      return aiocb;
-    default: {
-      uint8_t aiocb_priority = get_aiocb_priority(*aiocb);
-      SocketState* socket_state = new SocketState();
-      this->socket_state_[aiocb->socket()] = socket_state;
-      associate(*aiocb, retry_status);
-      socket_state->aiocb_state[aiocb_priority] = new AiocbState(move(aiocb), partial_send_len);
-      // aiocb is empty here
-    }
-    break;
+  // Drain the queue: its wakes have been consumed by now
+  for (;;) {
+    unique_ptr<SocketAiocb> aiocb(aiocb_queue_.trydequeue());
+    if (!aiocb) {
+      return unique_ptr<SocketAiocb>();
     }
-  } else {
-    SocketState* socket_state = socket_state_i->second;
-
-    uint8_t aiocb_priority = get_aiocb_priority(*aiocb);
 
-    // Check if there's already an SocketAiocb with an equal or higher priority
-    // on this socket. If not, retry aiocb.
-    bool should_retry_aiocb = true;
-    for (
-      int8_t check_aiocb_priority = aiocb_priority;
-      check_aiocb_priority >= 0;
-      --check_aiocb_priority
-    ) {
-      if (socket_state->aiocb_state[check_aiocb_priority] != NULL) {
-        should_retry_aiocb = false;
-        break;
-      }
-    }
+    Mutex::Holder socket_state_mutex_holder(socket_state_mutex_);
 
-    size_t partial_send_len = 0;
-    if (should_retry_aiocb) {
-      RetryStatus retry_status = retry(*aiocb, partial_send_len);
+    uint8_t aiocb_priority = get_aiocb_priority(*aiocb);
+    fd_t fd = aiocb->socket();
+    auto socket_state_i = this->socket_state_.find(fd);
+    if (socket_state_i == this->socket_state_.end()) {
+      size_t partial_send_len = 0;
+      Buffers::WriteCursor send_cursor;
+      RetryStatus retry_status = retry(*aiocb, partial_send_len, send_cursor);
       switch (retry_status) {
       case RetryStatus::COMPLETE:
       case RetryStatus::ERROR:
-        CHECK(!socket_state->empty());
         return aiocb;
-      default:
-        associate(*aiocb, retry_status);
-        break;
+      case RetryStatus::WANT_SEND_FD: {
+        splice_aiocb_states_.push_back(
+          new AiocbState(
+            move(aiocb),
+            partial_send_len,
+            send_cursor,
+            RetryStatus::WANT_SEND
+          )
+        );
+        associate_splice_fds();
+        continue;
+      }
+      default: {
+        // Only the direction that would block is known not to be ready
+        SocketState* socket_state
+        = new SocketState(
+          (FdEvent::TYPE_READ_READY | FdEvent::TYPE_WRITE_READY)
+          & ~get_fd_event_type(retry_status)
+        );
+        socket_state->aiocb_state[aiocb_priority]
+        = new AiocbState(
+          move(aiocb),
+          partial_send_len,
+          send_cursor,
+          retry_status
+        );
+        // aiocb is empty here
+        socket_state_i = this->socket_state_.insert(
+                           ::std::make_pair(fd, socket_state)
+                         ).first;
       }
+      break;
+      }
+    } else {
+      SocketState* socket_state = socket_state_i->second;
+
+      RetryStatus want = get_aiocb_want(*aiocb);
+      socket_state->push_back(
+        aiocb_priority,
+        new AiocbState(move(aiocb), 0, Buffers::WriteCursor(), want)
+      );
+
+      // Retries the new aiocb if it is first in line and its direction is
+      // (possibly) ready
+      retry_ready(*socket_state);
     }
 
-    AiocbState* aiocb_state = new AiocbState(move(aiocb), partial_send_len);
-    if (socket_state->aiocb_state[aiocb_priority] == NULL) {
-      socket_state->aiocb_state[aiocb_priority] = aiocb_state;
-    } else {
-      AiocbState* last_aiocb_state
-      = socket_state->aiocb_state[aiocb_priority];
-      while (last_aiocb_state->next_aiocb_state_ != NULL) {
-        last_aiocb_state = last_aiocb_state->next_aiocb_state_;
-      }
-      last_aiocb_state->next_aiocb_state_ = aiocb_state;
+    associate(socket_state_i);
+    associate_splice_fds();
+    unique_ptr<SocketAiocb> ret = pop_completed_aiocb();
+    if (ret) {
+      return ret;
     }
   }
-
-  return unique_ptr<SocketAiocb>();
 }
 
 unique_ptr<SocketAiocb> SocketNbioQueue::tryenqueue(unique_ptr<SocketAiocb> aiocb) {
@@ -609,6 +1083,7 @@ unique_ptr<SocketAiocb> SocketNbioQueue::tryenqueue(unique_ptr<SocketAiocb> aioc
 }
 
 void SocketNbioQueue::wake() {
+  woken_.store(true);
   fd_event_queue_.wake();
 }
 }
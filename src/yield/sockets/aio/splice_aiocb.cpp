@@ -0,0 +1,90 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/buffer.hpp"
+#include "yield/exception.hpp"
+#include "yield/sockets/stream_socket.hpp"
+#include "yield/sockets/aio/splice_aiocb.hpp"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace yield {
+namespace sockets {
+namespace aio {
+const size_t SpliceAiocb::NBYTES_MAX;
+
+SpliceAiocb::SpliceAiocb(
+  ::std::shared_ptr<StreamSocket> socket_,
+  fd_t fd,
+  size_t nbytes
+) : fd_(fd),
+  nbytes_(nbytes < NBYTES_MAX ? nbytes : NBYTES_MAX),
+  recv_len_(0),
+  socket_(socket_) {
+#ifndef _WIN32
+  // The descriptor is the caller's; its mode is checked rather than changed
+  int fd_flags = ::fcntl(fd, F_GETFL);
+  if (fd_flags == -1) {
+    throw Exception();
+  } else if ((fd_flags & O_NONBLOCK) == 0) {
+    throw Exception(EINVAL, "SpliceAiocb descriptor must be non-blocking");
+  }
+#endif
+
+#ifdef __linux__
+  int pipefd[2];
+  if (::pipe2(pipefd, O_CLOEXEC | O_NONBLOCK) != 0) {
+    throw Exception();
+  }
+  pipe_[0].reset(pipefd[0]);
+  pipe_[1].reset(pipefd[1]);
+#else
+  buffer_ = ::std::make_shared<Buffer>(nbytes_);
+#endif
+}
+
+SpliceAiocb::~SpliceAiocb() {
+}
+
+std::ostream& operator<<(std::ostream& os, const SpliceAiocb& splice_aiocb) {
+  os <<
+     "SpliceAiocb(" <<
+     "error=" << splice_aiocb.error() <<
+     ", " <<
+     "nbytes=" << splice_aiocb.nbytes() <<
+     ", " <<
+     "return=" << splice_aiocb.return_() <<
+     ")";
+  return os;
+}
+}
+}
+}
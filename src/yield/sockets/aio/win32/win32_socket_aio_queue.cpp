@@ -604,6 +604,13 @@ unique_ptr<SocketAiocb> Win32SocketAioQueue::tryenqueue(unique_ptr<SocketAiocb>
     return unique_ptr<SocketAiocb>(aiocb);
   }
   break;
+
+  default: {
+    // Only the SocketNbioQueue implements mmsg batches and splices
+    aiocb->set_error(ERROR_NOT_SUPPORTED);
+    return unique_ptr<SocketAiocb>(aiocb);
+  }
+  break;
   }
 }
 
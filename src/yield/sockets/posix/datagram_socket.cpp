@@ -25,13 +25,200 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "yield/buffer.hpp"
 #include "yield/sockets/datagram_socket.hpp"
 
+#include <errno.h>
+#ifdef __linux__
+#include <netinet/in.h>
+#include <netinet/udp.h> // For UDP_GRO and UDP_SEGMENT
+#endif
 #include <sys/socket.h>
 
 namespace yield {
 namespace sockets {
 const int DatagramSocket::TYPE = SOCK_DGRAM;
+const size_t DatagramSocket::MMSG_VLEN_MAX;
+
+ssize_t
+DatagramSocket::recvmmsg(
+  const ::std::shared_ptr<Buffer>* buffers,
+  size_t buffers_len,
+  const MessageFlags& flags,
+  SocketAddress* peernames,
+  uint16_t* gro_segment_sizes
+) {
+  if (buffers_len > MMSG_VLEN_MAX) {
+    buffers_len = MMSG_VLEN_MAX;
+  }
+
+#ifdef __linux__
+  mmsghdr msgvec[MMSG_VLEN_MAX];
+  iovec iov[MMSG_VLEN_MAX];
+#ifdef UDP_GRO
+  // The segment size arrives as an int
+  char control[MMSG_VLEN_MAX][CMSG_SPACE(sizeof(int))];
+#endif
+  memset(msgvec, 0, sizeof(msgvec[0]) * buffers_len);
+  for (size_t buffer_i = 0; buffer_i < buffers_len; ++buffer_i) {
+    iov[buffer_i] = buffers[buffer_i]->as_read_iovec();
+    msghdr& msg_hdr = msgvec[buffer_i].msg_hdr;
+    msg_hdr.msg_iov = &iov[buffer_i];
+    msg_hdr.msg_iovlen = 1;
+    msg_hdr.msg_name = static_cast<sockaddr*>(peernames[buffer_i]);
+    msg_hdr.msg_namelen = SocketAddress::len(0);
+#ifdef UDP_GRO
+    if (gro_segment_sizes != NULL) {
+      msg_hdr.msg_control = control[buffer_i];
+      msg_hdr.msg_controllen = sizeof(control[buffer_i]);
+    }
+#endif
+  }
+
+  int recvmmsg_ret
+  = ::recvmmsg(
+      *this,
+      msgvec,
+      static_cast<unsigned int>(buffers_len),
+      flags,
+      NULL
+    );
+  if (recvmmsg_ret <= 0) {
+    return recvmmsg_ret;
+  }
+
+  for (int msg_i = 0; msg_i < recvmmsg_ret; ++msg_i) {
+    buffers[msg_i]->put(NULL, msgvec[msg_i].msg_len);
+
+    if (gro_segment_sizes != NULL) {
+      gro_segment_sizes[msg_i] = 0;
+#ifdef UDP_GRO
+      msghdr& msg_hdr = msgvec[msg_i].msg_hdr;
+      for (
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg_hdr);
+        cmsg != NULL;
+        cmsg = CMSG_NXTHDR(&msg_hdr, cmsg)
+      ) {
+        if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO) {
+          int gro_segment_size;
+          memcpy(&gro_segment_size, CMSG_DATA(cmsg), sizeof(gro_segment_size));
+          gro_segment_sizes[msg_i] = static_cast<uint16_t>(gro_segment_size);
+        }
+      }
+#endif
+    }
+  }
+
+  return recvmmsg_ret;
+#else
+  size_t buffer_i = 0;
+  for (; buffer_i < buffers_len; ++buffer_i) {
+    ssize_t recv_ret
+      = recvfrom(*buffers[buffer_i], flags, peernames[buffer_i]);
+    if (recv_ret < 0) {
+      if (buffer_i > 0 && want_recv()) {
+        break;
+      }
+      return recv_ret;
+    }
+    if (gro_segment_sizes != NULL) {
+      gro_segment_sizes[buffer_i] = 0;
+    }
+  }
+  return static_cast<ssize_t>(buffer_i);
+#endif
+}
+
+ssize_t
+DatagramSocket::sendmmsg(
+  const ::std::shared_ptr<Buffer>* buffers,
+  size_t buffers_len,
+  const MessageFlags& flags,
+  const SocketAddress* peernames,
+  uint16_t gso_segment_size
+) {
+  if (buffers_len > MMSG_VLEN_MAX) {
+    buffers_len = MMSG_VLEN_MAX;
+  }
+
+#ifdef __linux__
+  mmsghdr msgvec[MMSG_VLEN_MAX];
+  iovec iov[MMSG_VLEN_MAX];
+#ifdef UDP_SEGMENT
+  char control[CMSG_SPACE(sizeof(uint16_t))];
+  if (gso_segment_size != 0) {
+    // Every message carries the same control data
+    msghdr msg_hdr;
+    memset(&msg_hdr, 0, sizeof(msg_hdr));
+    msg_hdr.msg_control = control;
+    msg_hdr.msg_controllen = sizeof(control);
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg_hdr);
+    cmsg->cmsg_level = IPPROTO_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(gso_segment_size));
+    memcpy(CMSG_DATA(cmsg), &gso_segment_size, sizeof(gso_segment_size));
+  }
+#else
+  if (gso_segment_size != 0) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+#endif
+
+  memset(msgvec, 0, sizeof(msgvec[0]) * buffers_len);
+  for (size_t buffer_i = 0; buffer_i < buffers_len; ++buffer_i) {
+    iov[buffer_i] = buffers[buffer_i]->as_write_iovec();
+    msghdr& msg_hdr = msgvec[buffer_i].msg_hdr;
+    msg_hdr.msg_iov = &iov[buffer_i];
+    msg_hdr.msg_iovlen = 1;
+    if (peernames != NULL) {
+      const SocketAddress* peername = peernames[buffer_i].filter(domain());
+      if (peername == NULL) {
+        errno = EAFNOSUPPORT;
+        return -1;
+      }
+      const sockaddr* peername_sockaddr = *peername;
+      msg_hdr.msg_name = const_cast<sockaddr*>(peername_sockaddr);
+      msg_hdr.msg_namelen = peername->len();
+    }
+#ifdef UDP_SEGMENT
+    if (gso_segment_size != 0) {
+      msg_hdr.msg_control = control;
+      msg_hdr.msg_controllen = sizeof(control);
+    }
+#endif
+  }
+
+  return ::sendmmsg(
+           *this,
+           msgvec,
+           static_cast<unsigned int>(buffers_len),
+           flags
+         );
+#else
+  if (gso_segment_size != 0) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+
+  size_t buffer_i = 0;
+  for (; buffer_i < buffers_len; ++buffer_i) {
+    ssize_t send_ret;
+    if (peernames != NULL) {
+      send_ret = sendto(*buffers[buffer_i], flags, peernames[buffer_i]);
+    } else {
+      send_ret = send(*buffers[buffer_i], flags);
+    }
+    if (send_ret < 0) {
+      if (buffer_i > 0 && want_send()) {
+        break;
+      }
+      return send_ret;
+    }
+  }
+  return static_cast<ssize_t>(buffer_i);
+#endif
+}
 
 ssize_t
 DatagramSocket::sendmsg(
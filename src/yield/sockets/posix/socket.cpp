@@ -41,6 +41,11 @@ namespace yield {
 namespace sockets {
 const int Socket::Option::RCVBUF = SO_RCVBUF;
 const int Socket::Option::REUSEADDR = SO_REUSEADDR;
+#ifdef SO_REUSEPORT
+const int Socket::Option::REUSEPORT = SO_REUSEPORT;
+#else
+const int Socket::Option::REUSEPORT = -1;
+#endif
 const int Socket::Option::SNDBUF = SO_SNDBUF;
 
 bool Socket::bind(const SocketAddress& _name) {
@@ -28,11 +28,35 @@
 #include "yield/sockets/udp_socket.hpp"
 
 #include <netinet/in.h> // For the IPPROTO_* constants
+#ifdef __linux__
+#include <netinet/udp.h> // For the UDP_* constants
+#endif
 #include <sys/socket.h>
 
 namespace yield {
 namespace sockets {
 const int UdpSocket::DOMAIN_DEFAULT = AF_INET;
 const int UdpSocket::PROTOCOL = IPPROTO_UDP;
+
+#ifdef UDP_GRO
+const int UdpSocket::Option::GRO = UDP_GRO;
+#else
+const int UdpSocket::Option::GRO = -1;
+#endif
+
+bool UdpSocket::setsockopt(int option_name, int option_value) {
+#ifdef UDP_GRO
+  if (option_name == Option::GRO) {
+    return ::setsockopt(
+             *this,
+             IPPROTO_UDP,
+             UDP_GRO,
+             reinterpret_cast<char*>(&option_value),
+             static_cast<int>(sizeof(option_value))
+           ) == 0;
+  }
+#endif
+  return DatagramSocket::setsockopt(option_name, option_value);
+}
 }
 }
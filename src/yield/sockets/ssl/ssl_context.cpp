@@ -29,13 +29,24 @@
 
 #include "ssl_exception.hpp"
 #include "yield/logging.hpp"
+#include "yield/memcpy_s.hpp"
 #include "yield/sockets/ssl/ssl_context.hpp"
+#include "yield/thread/mutex.hpp"
 
 #ifdef YIELD_HAVE_OPENSSL
+#include <cstring>
+
+#include <openssl/evp.h>
 #include <openssl/pem.h>
 #include <openssl/pkcs12.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
 #include <openssl/x509.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#else
+#include <openssl/hmac.h>
+#endif
 #ifdef _WIN32
 //#pragma comment(lib, "advapi32.lib")
 //#pragma comment(lib, "gdi32.lib")
@@ -51,6 +62,189 @@ namespace yield {
 namespace sockets {
 #ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
+using ::std::string;
+using ::yield::thread::Mutex;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX TicketMacCtx;
+#else
+typedef HMAC_CTX TicketMacCtx;
+#endif
+
+class SslContext::SessionTicketKeys {
+public:
+  SessionTicketKeys(const Time& rotation_interval)
+    : current_created_(Time::now()),
+      rotation_interval_(rotation_interval) {
+    generate(current_);
+    previous_ = current_;
+  }
+
+public:
+  // The SSL_CTX_set_tlsext_ticket_key_(evp_)cb callback
+  static int
+  callback(
+    SSL* ssl,
+    unsigned char* key_name,
+    unsigned char* iv,
+    EVP_CIPHER_CTX* cipher_ctx,
+    TicketMacCtx* mac_ctx,
+    int enc
+  ) {
+    SslContext* ssl_context
+    = static_cast<SslContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    SessionTicketKeys& session_ticket_keys
+    = *ssl_context->session_ticket_keys_;
+
+    Key key;
+    int ret;
+    if (!session_ticket_keys.get(key_name, enc != 0, key, ret)) {
+      return ret;
+    }
+
+    if (enc) {
+      if (RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1) {
+        return -1;
+      }
+      memcpy(key_name, key.name, sizeof(key.name));
+      if (
+        EVP_EncryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), NULL, key.aes_key, iv)
+        != 1
+      ) {
+        return -1;
+      }
+    } else if (
+      EVP_DecryptInit_ex(cipher_ctx, EVP_aes_256_cbc(), NULL, key.aes_key, iv)
+      != 1
+    ) {
+      return -1;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    OSSL_PARAM params[3];
+    params[0]
+    = OSSL_PARAM_construct_octet_string(
+        OSSL_MAC_PARAM_KEY,
+        key.hmac_key,
+        sizeof(key.hmac_key)
+      );
+    params[1]
+    = OSSL_PARAM_construct_utf8_string(
+        OSSL_MAC_PARAM_DIGEST,
+        const_cast<char*>("SHA256"),
+        0
+      );
+    params[2] = OSSL_PARAM_construct_end();
+    if (EVP_MAC_CTX_set_params(mac_ctx, params) != 1) {
+      return -1;
+    }
+#else
+    if (
+      HMAC_Init_ex(mac_ctx, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), NULL)
+      != 1
+    ) {
+      return -1;
+    }
+#endif
+
+    return ret;
+  }
+
+private:
+  class Key {
+  public:
+    unsigned char name[16];
+    unsigned char aes_key[32];
+    unsigned char hmac_key[32];
+  };
+
+private:
+  static void generate(Key& key) {
+    if (
+      RAND_bytes(key.name, sizeof(key.name)) != 1
+      ||
+      RAND_bytes(key.aes_key, sizeof(key.aes_key)) != 1
+      ||
+      RAND_bytes(key.hmac_key, sizeof(key.hmac_key)) != 1
+    ) {
+      throw SSLException();
+    }
+  }
+
+  // Copy out the key to encrypt a new ticket with, or the key named by a
+  // ticket, rotating the keys first if they are due.
+  bool get(const unsigned char* key_name, bool enc, Key& key, int& ret) {
+    Mutex::Holder mutex_holder(mutex_);
+
+    Time now = Time::now();
+    if (now - current_created_ >= rotation_interval_) {
+      Key next;
+      try {
+        generate(next);
+        previous_ = current_;
+        current_ = next;
+        current_created_ = now;
+      } catch (SSLException&) {
+        // Keep the current key for now
+      }
+    }
+
+    if (enc) {
+      key = current_;
+      ret = 1;
+      return true;
+    } else if (memcmp(key_name, current_.name, sizeof(current_.name)) == 0) {
+      key = current_;
+      ret = 1;
+      return true;
+    } else if (memcmp(key_name, previous_.name, sizeof(previous_.name)) == 0) {
+      key = previous_;
+      ret = 2; // Renew the ticket under the current key
+      return true;
+    } else {
+      ret = 0; // Unknown or retired key: fall back to a full handshake
+      return false;
+    }
+  }
+
+private:
+  Key current_;
+  Time current_created_;
+  Mutex mutex_; // Protects the keys
+  Key previous_;
+  Time rotation_interval_;
+};
+
+const Time SslContext::SESSION_TICKET_KEY_ROTATION_INTERVAL_DEFAULT(3600);
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+static SSL_SESSION*
+get_session_callback(SSL* ssl, const unsigned char* id, int id_len, int* copy) {
+#else
+static SSL_SESSION*
+get_session_callback(SSL* ssl, unsigned char* id, int id_len, int* copy) {
+#endif
+  SslContext* ssl_context
+  = static_cast<SslContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  // The cache has already taken a reference for the caller
+  *copy = 0;
+  return ssl_context->session_cache()->get(id, static_cast<size_t>(id_len));
+}
+
+static int new_session_callback(SSL* ssl, SSL_SESSION* session) {
+  SslContext* ssl_context
+  = static_cast<SslContext*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+  ssl_context->session_cache()->put(session);
+  return 1; // The cache keeps the reference
+}
+
+static void remove_session_callback(SSL_CTX* ctx, SSL_SESSION* session) {
+  SslContext* ssl_context = static_cast<SslContext*>(SSL_CTX_get_app_data(ctx));
+  unsigned int id_len;
+  const unsigned char* id = SSL_SESSION_get_id(session, &id_len);
+  ssl_context->session_cache()->erase(id, id_len);
+}
+
 SslContext::SslContext(SslVersion ssl_version) throw(Exception) {
   init(ssl_version);
 }
@@ -62,15 +256,113 @@ SslContext::SslContext(
   SslVersion ssl_version
 ) throw(Exception) {
   init(ssl_version);
-  use_pem_certificate(pem_certificate);
-  use_pem_private_key(pem_private_key, pem_private_key_passphrase);
+  try {
+    use_pem_certificate(pem_certificate);
+    use_pem_private_key(pem_private_key, pem_private_key_passphrase);
+  } catch (Exception&) {
+    SSL_CTX_free(ctx_);
+    throw;
+  }
 }
 
 SslContext::~SslContext() {
-  SSL_CTX_free(ctx);
+  SSL_CTX_free(ctx_);
+}
+
+void
+SslContext::enable_session_cache(
+  size_t capacity,
+  uint16_t shard_count
+) throw(Exception) {
+  static const unsigned char session_id_context[] = "yield";
+  if (
+    SSL_CTX_set_session_id_context(
+      ctx_,
+      session_id_context,
+      sizeof(session_id_context) - 1
+    ) != 1
+  ) {
+    throw SSLException();
+  }
+
+  session_cache_.reset(new SslSessionCache(capacity, shard_count));
+  SSL_CTX_set_app_data(ctx_, this);
+  SSL_CTX_set_session_cache_mode(
+    ctx_,
+    SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL
+  );
+  SSL_CTX_sess_set_get_cb(ctx_, get_session_callback);
+  SSL_CTX_sess_set_new_cb(ctx_, new_session_callback);
+  SSL_CTX_sess_set_remove_cb(ctx_, remove_session_callback);
+}
+
+void
+SslContext::enable_session_tickets(
+  const Time& key_rotation_interval
+) throw(Exception) {
+  session_ticket_keys_.reset(new SessionTicketKeys(key_rotation_interval));
+  SSL_CTX_set_app_data(ctx_, this);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx_, SessionTicketKeys::callback);
+#else
+  SSL_CTX_set_tlsext_ticket_key_cb(ctx_, SessionTicketKeys::callback);
+#endif
+  SSL_CTX_clear_options(ctx_, SSL_OP_NO_TICKET);
 }
 
 void SslContext::init(SslVersion ssl_version) {
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+  // The library initializes itself; SSLv2 and SSLv3 are only reachable
+  // through the version-flexible methods, if at all
+  const SSL_METHOD* method;
+  int proto_version;
+  switch (ssl_version) {
+  case SSL_VERSION_2:
+    method = TLS_method();
+    proto_version = SSL2_VERSION;
+    break;
+  case SSL_VERSION_23:
+    method = TLS_method();
+    proto_version = 0;
+    break;
+  case SSL_VERSION_3:
+    method = TLS_method();
+    proto_version = SSL3_VERSION;
+    break;
+  case TLS_VERSION_1:
+    method = TLS_method();
+    proto_version = TLS1_VERSION;
+    break;
+  case DTLS_VERSION_1:
+    method = DTLS_method();
+    proto_version = DTLS1_VERSION;
+    break;
+  default:
+    CHECK(false);
+    method = TLS_method();
+    proto_version = 0;
+    break;
+  }
+
+  ctx_ = SSL_CTX_new(method);
+  if (ctx_ == NULL) {
+    throw SSLException();
+  }
+
+  if (
+    proto_version != 0
+    &&
+    (
+      SSL_CTX_set_min_proto_version(ctx_, proto_version) != 1
+      ||
+      SSL_CTX_set_max_proto_version(ctx_, proto_version) != 1
+    )
+  ) {
+    SSLException exception;
+    SSL_CTX_free(ctx_);
+    throw exception;
+  }
+#else
   SSL_load_error_strings();
   SSL_library_init();
 
@@ -98,21 +390,32 @@ void SslContext::init(SslVersion ssl_version) {
   }
 
 #if OPENSSL_VERSION_NUMBER >= 0x10000000L
-  ctx = SSL_CTX_new(method);
+  ctx_ = SSL_CTX_new(method);
 #else
-  ctx = SSL_CTX_new(const_cast<SSL_METHOD*>(method));
+  ctx_ = SSL_CTX_new(const_cast<SSL_METHOD*>(method));
+#endif
+  if (ctx_ == NULL) {
+    throw SSLException();
+  }
 #endif
 
-  if (ctx != NULL) {
 #ifdef SSL_OP_NO_TICKET
-    SSL_CTX_set_options(ctx, SSL_OP_ALL | SSL_OP_NO_TICKET);
+  SSL_CTX_set_options(ctx_, SSL_OP_ALL | SSL_OP_NO_TICKET);
 #else
-    SSL_CTX_set_options(ctx, SSL_OP_ALL);
+  SSL_CTX_set_options(ctx_, SSL_OP_ALL);
 #endif
-    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
-  } else {
-    throw SSLException();
-  }
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+  // Hand the keys to the kernel after the handshake, where the kernel (tls
+  // module) and the negotiated cipher allow it, so that SslSocket::sendfile
+  // need not copy through userspace. OpenSSL carries on in userspace if not.
+  SSL_CTX_set_options(ctx_, SSL_OP_ENABLE_KTLS);
+#endif
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+  // Treat a peer that closes without a close_notify, as HTTP clients are
+  // wont to, as an orderly end of the connection
+  SSL_CTX_set_options(ctx_, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+  SSL_CTX_set_verify(ctx_, SSL_VERIFY_NONE, NULL);
 }
 
 int SslContext::pem_password_callback(char* buf, int size, int, void* userdata) {
@@ -141,7 +444,9 @@ SslContext::use_pem_certificate(
         X509* cert = PEM_read_bio_X509(bio, NULL, NULL, NULL);
         if (cert != NULL) {
           try {
-            if (SSL_CTX_use_certificate(ctx, cert) == 1) {
+            if (SSL_CTX_use_certificate(ctx_, cert) == 1) {
+              // The context holds its own reference
+              X509_free(cert);
               BIO_free(bio);
               return;
             } else {
@@ -172,7 +477,7 @@ SslContext::use_pem_certificate_file(
 ) throw(Exception) {
   if (
     SSL_CTX_use_certificate_file(
-      ctx,
+      ctx_,
       pem_certificate_file_path.c_str(),
       SSL_FILETYPE_PEM
     ) != 1
@@ -204,7 +509,9 @@ SslContext::use_pem_private_key(
           );
 
         if (pkey != NULL) {
-          if (SSL_CTX_use_PrivateKey(ctx, pkey) == 1) {
+          int use_PrivateKey_ret = SSL_CTX_use_PrivateKey(ctx_, pkey);
+          EVP_PKEY_free(pkey);
+          if (use_PrivateKey_ret == 1) {
             BIO_free(bio);
           } else {
             throw SSLException();
@@ -229,21 +536,21 @@ SslContext::use_pem_private_key_file(
   const string& pem_private_key_file_path,
   const string& pem_private_key_passphrase
 ) throw(Exception) {
-  SSL_CTX_set_default_passwd_cb(ctx, pem_password_callback);
+  SSL_CTX_set_default_passwd_cb(ctx_, pem_password_callback);
   SSL_CTX_set_default_passwd_cb_userdata(
-    ctx,
+    ctx_,
     const_cast<string*>(&pem_private_key_passphrase)
   );
 
   if (
     SSL_CTX_use_PrivateKey_file(
-      ctx,
+      ctx_,
       pem_private_key_file_path.c_str(),
       SSL_FILETYPE_PEM
     )
   ) {
-    SSL_CTX_set_default_passwd_cb(ctx, NULL);
-    SSL_CTX_set_default_passwd_cb_userdata(ctx, NULL);
+    SSL_CTX_set_default_passwd_cb(ctx_, NULL);
+    SSL_CTX_set_default_passwd_cb_userdata(ctx_, NULL);
   } else {
     throw SSLException();
   }
@@ -271,10 +578,10 @@ SslContext::use_pem_private_key_file(
 //        STACK_OF(X509)* ca = NULL;
 //        if (PKCS12_parse(p12, passphrase.c_str(), &pkey, &cert, &ca)) {
 //          if (pkey != NULL && cert != NULL && ca != NULL) {
-//            SSL_CTX_use_certificate(ctx, cert);
-//            SSL_CTX_use_PrivateKey(ctx, pkey);
+//            SSL_CTX_use_certificate(ctx_, cert);
+//            SSL_CTX_use_PrivateKey(ctx_, pkey);
 //
-//            X509_STORE* store = SSL_CTX_get_cert_store(ctx);
+//            X509_STORE* store = SSL_CTX_get_cert_store(ctx_);
 //            for (int i = 0; i < sk_X509_num(ca); i++) {
 //              X509* store_cert = sk_X509_value(ca, i);
 //              X509_STORE_add_cert(store, store_cert);
@@ -39,12 +39,17 @@ namespace sockets {
 #ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
 SSLException::SSLException()
-  : Exception(ERR_peek_error()) {
+  : Exception(static_cast<uint32_t>(ERR_peek_error())) {
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
   SSL_load_error_strings();
+#endif
 
   char error_message[256];
   ERR_error_string_n(ERR_peek_error(), error_message, 256);
   set_error_message(error_message);
+
+  // Leave the thread's error queue empty for the next SSL_get_error
+  ERR_clear_error();
 }
 }
 #endif
@@ -0,0 +1,186 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/sockets/ssl/ssl_session_cache.hpp"
+#include "yield/thread/mutex.hpp"
+
+#ifdef YIELD_HAVE_OPENSSL
+#include <functional>
+#include <list>
+#include <map>
+
+#include <openssl/crypto.h>
+#include <openssl/ssl.h>
+#endif
+
+namespace yield {
+namespace sockets {
+#ifdef YIELD_HAVE_OPENSSL
+namespace ssl {
+using ::std::string;
+using ::std::unique_ptr;
+using ::yield::thread::Mutex;
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static int SSL_SESSION_up_ref(SSL_SESSION* session) {
+  CRYPTO_add(&session->references, 1, CRYPTO_LOCK_SSL_SESSION);
+  return 1;
+}
+#endif
+
+class SslSessionCache::Shard {
+public:
+  Shard(size_t capacity)
+    : capacity_(capacity) {
+  }
+
+  ~Shard() {
+    for (auto entry_i = entries_.begin(); entry_i != entries_.end(); ++entry_i) {
+      SSL_SESSION_free(entry_i->second);
+    }
+  }
+
+public:
+  void erase(const string& session_id) {
+    Mutex::Holder mutex_holder(mutex_);
+    auto entry_i = entries_index_.find(session_id);
+    if (entry_i != entries_index_.end()) {
+      SSL_SESSION_free(entry_i->second->second);
+      entries_.erase(entry_i->second);
+      entries_index_.erase(entry_i);
+    }
+  }
+
+  SSL_SESSION* get(const string& session_id) {
+    Mutex::Holder mutex_holder(mutex_);
+    auto entry_i = entries_index_.find(session_id);
+    if (entry_i != entries_index_.end()) {
+      entries_.splice(entries_.begin(), entries_, entry_i->second);
+      SSL_SESSION* session = entry_i->second->second;
+      SSL_SESSION_up_ref(session);
+      return session;
+    } else {
+      return NULL;
+    }
+  }
+
+  void put(const string& session_id, SSL_SESSION* session) {
+    Mutex::Holder mutex_holder(mutex_);
+    auto entry_i = entries_index_.find(session_id);
+    if (entry_i != entries_index_.end()) {
+      SSL_SESSION_free(entry_i->second->second);
+      entry_i->second->second = session;
+      entries_.splice(entries_.begin(), entries_, entry_i->second);
+      return;
+    }
+
+    if (entries_.size() == capacity_) {
+      SSL_SESSION_free(entries_.back().second);
+      entries_index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+
+    entries_.push_front(Entry(session_id, session));
+    entries_index_[session_id] = entries_.begin();
+  }
+
+  size_t size() {
+    Mutex::Holder mutex_holder(mutex_);
+    return entries_.size();
+  }
+
+private:
+  typedef ::std::pair<string, SSL_SESSION*> Entry;
+  typedef ::std::list<Entry> EntryList;
+  // Most recently used first
+  EntryList entries_;
+  ::std::map<string, EntryList::iterator> entries_index_;
+  size_t capacity_;
+  Mutex mutex_; // Protects everything above
+};
+
+const size_t SslSessionCache::CAPACITY_DEFAULT;
+const uint16_t SslSessionCache::SHARD_COUNT_DEFAULT;
+
+SslSessionCache::SslSessionCache(size_t capacity, uint16_t shard_count) {
+  if (shard_count == 0) {
+    shard_count = 1;
+  }
+
+  size_t shard_capacity = capacity / shard_count;
+  if (shard_capacity == 0) {
+    shard_capacity = 1;
+  }
+
+  for (uint16_t shard_i = 0; shard_i < shard_count; ++shard_i) {
+    shards_.push_back(unique_ptr<Shard>(new Shard(shard_capacity)));
+  }
+}
+
+SslSessionCache::~SslSessionCache() {
+}
+
+void
+SslSessionCache::erase(
+  const unsigned char* session_id,
+  size_t session_id_len
+) {
+  string session_id_(reinterpret_cast<const char*>(session_id), session_id_len);
+  get_shard(session_id_).erase(session_id_);
+}
+
+SSL_SESSION*
+SslSessionCache::get(
+  const unsigned char* session_id,
+  size_t session_id_len
+) {
+  string session_id_(reinterpret_cast<const char*>(session_id), session_id_len);
+  return get_shard(session_id_).get(session_id_);
+}
+
+SslSessionCache::Shard& SslSessionCache::get_shard(const string& session_id) {
+  return *shards_[::std::hash<string>()(session_id) % shards_.size()];
+}
+
+void SslSessionCache::put(SSL_SESSION* session) {
+  unsigned int session_id_len;
+  const unsigned char* session_id = SSL_SESSION_get_id(session, &session_id_len);
+  string session_id_(reinterpret_cast<const char*>(session_id), session_id_len);
+  get_shard(session_id_).put(session_id_, session);
+}
+
+size_t SslSessionCache::size() {
+  size_t size_ = 0;
+  for (auto shard_i = shards_.begin(); shard_i != shards_.end(); ++shard_i) {
+    size_ += (*shard_i)->size();
+  }
+  return size_;
+}
+}
+#endif
+}
+}
@@ -28,209 +28,306 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "ssl_exception.hpp"
+#include "yield/logging.hpp"
+#include "yield/memcpy_s.hpp"
 #include "yield/sockets/ssl/ssl_socket.hpp"
 
 #ifdef YIELD_HAVE_OPENSSL
+#include <openssl/err.h>
 #include <openssl/ssl.h>
+#ifdef _WIN32
+#include "../win32/winsock.hpp"
+#else
+#include <errno.h>
+#include <unistd.h>
+#endif
 #endif
 
 namespace yield {
 namespace sockets {
 #ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
-SslSocket::SslSocket(int domain)
+using ::std::make_shared;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+
+SslSocket::SslSocket(int domain) throw(Exception)
   : TcpSocket(domain),
-    ssl_context(*new SslContext()) {
-  init(ssl_context);
+    ssl_context_(make_shared<SslContext>()),
+    ssl_error_(SSL_ERROR_NONE) {
+  init();
 }
 
-SslSocket::SslSocket(SslContext& ssl_context, int domain)
+SslSocket::SslSocket(shared_ptr<SslContext> ssl_context, int domain)
+throw(Exception)
   : TcpSocket(domain),
-    ssl_context(ssl_context.inc_ref()) {
-  init(ssl_context);
+    ssl_context_(ssl_context),
+    ssl_error_(SSL_ERROR_NONE) {
+  init();
 }
 
 SslSocket::SslSocket(
+  shared_ptr<SslContext> ssl_context,
   int domain,
-  socket_t socket_,
-  SSL* ssl,
-  SslContext& ssl_context
-) : TcpSocket(domain, socket_),
-  ssl(ssl),
-  ssl_context(ssl_context.inc_ref()) {
-  init(ssl);
+  socket_t socket_
+) throw(Exception)
+  : TcpSocket(domain, socket_),
+    ssl_context_(ssl_context),
+    ssl_error_(SSL_ERROR_NONE) {
+  init();
 }
 
 SslSocket::~SslSocket() {
-  SSL_free(ssl);
-  SslContext::dec_ref(ssl_context);
+  if (ssl_error_ != SSL_ERROR_SSL) {
+    // Closing without a close_notify, as HTTP peers are wont to, would
+    // otherwise make SSL_free drop the session from the session cache.
+    // A fatal TLS error has already dropped it.
+    SSL_set_shutdown(ssl_, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+  }
+  SSL_free(ssl_);
 }
 
-YO_NEW_REF SslSocket* SslSocket::accept() {
-  SocketAddress peername;
-  return accept(peername);
-}
+ssize_t SslSocket::check_ssl_ret(int ssl_ret) {
+  if (ssl_ret > 0) {
+    ssl_error_ = SSL_ERROR_NONE;
+    return ssl_ret;
+  }
+
+  ssl_error_ = SSL_get_error(ssl_, ssl_ret);
+  switch (ssl_error_) {
+  case SSL_ERROR_ZERO_RETURN: {
+    // close_notify from the peer
+    return 0;
+  }
+
+  case SSL_ERROR_WANT_READ:
+  case SSL_ERROR_WANT_WRITE: {
+#ifdef _WIN32
+    Exception::set_last_error_code(WSAEWOULDBLOCK);
+#else
+    Exception::set_last_error_code(EWOULDBLOCK);
+#endif
+    return -1;
+  }
+
+  case SSL_ERROR_SYSCALL: {
+    ERR_clear_error();
+    if (ssl_ret == 0 && Exception::get_last_error_code() == 0) {
+      // EOF without a close_notify, from OpenSSL before 3.0
+      return 0;
+    }
+    return -1;
+  }
 
-YO_NEW_REF SslSocket* SslSocket::accept(SocketAddress& peername) {
-  SslSocket* ssl_socket = static_cast<SslSocket*>(TcpSocket::accept(peername));
-  if (ssl_socket != NULL) {
-    SSL_set_accept_state(*ssl_socket);
+  default: {
+    LOG(ERROR) << "TLS error: " << SSLException().what();
+#ifdef _WIN32
+    Exception::set_last_error_code(WSAECONNABORTED);
+#else
+    Exception::set_last_error_code(ECONNABORTED);
+#endif
+    return -1;
+  }
   }
-  return ssl_socket;
 }
 
 bool SslSocket::connect(const SocketAddress& peername) {
-  if (TcpSocket::connect(peername)) {
-    SSL_set_connect_state(ssl);
-    return true;
-  } else {
-    return false;
-  }
+  SSL_set_connect_state(ssl_);
+  return TcpSocket::connect(peername);
 }
 
 bool SslSocket::do_handshake() {
-  return SSL_do_handshake(ssl) == 1;
+  ERR_clear_error();
+  return check_ssl_ret(SSL_do_handshake(ssl_)) > 0;
 }
 
-YO_NEW_REF SslSocket* SslSocket::dup() {
-  socket_t socket_ = Socket::create(get_domain(), TYPE, PROTOCOL);
-  if (socket_ != -1) {
-    SSL* ssl = SSL_new(ssl_context);
-    if (ssl != NULL) {
-      return new SslSocket(get_domain(), socket_, ssl, ssl_context);
-    } else {
-      SSL_free(ssl);
-      return NULL;
-    }
-  } else {
-    return NULL;
-  }
+bool SslSocket::ktls_send() const {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+  return BIO_get_ktls_send(SSL_get_wbio(ssl_));
+#else
+  return false;
+#endif
 }
 
-YO_NEW_REF SslSocket* SslSocket::dup2(socket_t socket_) {
-  SSL* ssl = SSL_new(ssl_context);
-  if (ssl != NULL) {
-    return new SslSocket(get_domain(), socket_, ssl, ssl_context);
+unique_ptr<StreamSocket> SslSocket::dup() {
+  socket_t socket_ = Socket::create(domain(), TYPE, PROTOCOL);
+  if (socket_ != static_cast<socket_t>(-1)) {
+    return unique_ptr<StreamSocket>(
+             new SslSocket(ssl_context_, domain(), socket_)
+           );
   } else {
-    return NULL;
+    return unique_ptr<StreamSocket>();
   }
 }
 
-void SslSocket::init(SslContext& ssl_context) {
-  ssl = SSL_new(ssl_context);
-  if (ssl != NULL) {
-    try {
-      init(ssl);
-    } catch (SSLException&) {
-      SSL_free(ssl);
-      throw;
-    }
-  } else {
-    throw SSLException();
-  }
+unique_ptr<StreamSocket> SslSocket::dup2(socket_t socket_) {
+  // An accepted socket: the server side of the handshake
+  unique_ptr<SslSocket> ssl_socket(
+    new SslSocket(ssl_context_, domain(), socket_)
+  );
+  SSL_set_accept_state(*ssl_socket);
+  return move(ssl_socket);
 }
 
-void SslSocket::init(SSL* ssl) {
-  BIO* bio = BIO_new_socket(static_cast<socket_t>(*this), BIO_NOCLOSE);
-  if (bio != NULL) {
-    SSL_set_bio(ssl, bio, bio);
-  } else {
+void SslSocket::init() {
+  ssl_ = SSL_new(*ssl_context_);
+  if (ssl_ == NULL) {
     throw SSLException();
   }
 
-  //if (!SSL_set_fd(ssl, *this))
-  //  throw SSLException();
+  // SocketNbioQueue resumes a partial or would-block send where it left off,
+  // from a buffer that may have moved in the meantime
+  SSL_set_mode(
+    ssl_,
+    SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER
+  );
+
+  if (SSL_set_fd(ssl_, static_cast<int>(static_cast<socket_t>(*this))) != 1) {
+    SSLException exception;
+    SSL_free(ssl_);
+    throw exception;
+  }
 }
 
-bool SslSocket::listen() {
-  SSL_set_accept_state(ssl);
-  return TcpSocket::listen();
+ssize_t SslSocket::recv(void* buf, size_t buflen, const MessageFlags&) {
+  ERR_clear_error();
+  return check_ssl_ret(SSL_read(ssl_, buf, static_cast<int>(buflen)));
 }
 
-/*
-void SslSocket::info_callback( const SSL* ssl, int where, int ret )
-{
-  ostringstream info;
-
-  int w = where & ~SSL_ST_MASK;
-  if ( ( w & SSL_ST_CONNECT ) == SSL_ST_CONNECT ) info << "SSL_connect:";
-  else if ( ( w & SSL_ST_ACCEPT ) == SSL_ST_ACCEPT ) info << "SSL_accept:";
-  else info << "undefined:";
+ssize_t
+SslSocket::recvmsg(
+  const iovec* iov,
+  int iovlen,
+  const MessageFlags& flags
+) {
+  // SSL_read has no scatter form: fill the buffers in turn, as long as
+  // that does not mean waiting for another record
+  size_t recv_len = 0;
+  for (int iov_i = 0; iov_i < iovlen; ++iov_i) {
+    if (iov[iov_i].iov_len == 0) {
+      continue;
+    } else if (recv_len > 0 && SSL_pending(ssl_) == 0) {
+      break;
+    }
 
-  if ( ( where & SSL_CB_LOOP ) == SSL_CB_LOOP )
-    info << SSL_state_string_long( ssl );
-  else if ( ( where & SSL_CB_ALERT ) == SSL_CB_ALERT )
-  {
-    if ( ( where & SSL_CB_READ ) == SSL_CB_READ )
-      info << "read:";
-    else
-      info << "write:";
-    info << "SSL3 alert" << SSL_alert_type_string_long( ret ) << ":" <<
-            SSL_alert_desc_string_long( ret );
+    ssize_t recv_ret = recv(iov[iov_i].iov_base, iov[iov_i].iov_len, flags);
+    if (recv_ret > 0) {
+      recv_len += static_cast<size_t>(recv_ret);
+      if (static_cast<size_t>(recv_ret) < iov[iov_i].iov_len) {
+        break;
+      }
+    } else if (recv_len > 0) {
+      // Report what was read; the next call sees the error again
+      break;
+    } else {
+      return recv_ret;
+    }
   }
-  else if ( ( where & SSL_CB_EXIT ) == SSL_CB_EXIT )
-  {
-    if ( ret == 0 )
-      info << "failed in " << SSL_state_string_long( ssl );
-    else
-      info << "error in " << SSL_state_string_long( ssl );
+  return static_cast<ssize_t>(recv_len);
+}
+
+ssize_t SslSocket::send(const void* buf, size_t buflen, const MessageFlags&) {
+  if (buflen == 0) {
+    return 0;
   }
-  else
-    return;
 
-  reinterpret_cast<SslSocket*>( SSL_get_app_data( const_cast<SSL*>( ssl ) ) )
-    ->log->get_stream( Log::NOTICE ) << "SslSocket: " << info.str();
+  ERR_clear_error();
+  return check_ssl_ret(SSL_write(ssl_, buf, static_cast<int>(buflen)));
 }
-*/
 
-ssize_t SslSocket::recv(Buffer& buffer, const MessageFlags& flags) {
-  return TcpSocket::recv(buffer, flags);
-}
+ssize_t
+SslSocket::sendfile(
+  fd_t fd,
+  off_t offset,
+  size_t nbytes
+) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+  if (ktls_send()) {
+    // The kernel encrypts: sendfile(2) straight from the file
+    ERR_clear_error();
+    ossl_ssize_t sendfile_ret = SSL_sendfile(ssl_, fd, offset, nbytes, 0);
+    if (sendfile_ret >= 0) {
+      ssl_error_ = SSL_ERROR_NONE;
+      return static_cast<ssize_t>(sendfile_ret);
+    } else {
+      return check_ssl_ret(static_cast<int>(sendfile_ret));
+    }
+  }
+#endif
 
-ssize_t SslSocket::recv(void* buf, size_t buflen, const MessageFlags&) {
-  return SSL_read(ssl, buf, static_cast<int>(buflen));
-  //ssize_t read_ret = SSL_read(ssl, buf, static_cast<int>(buflen));
-  //if (read_ret >= 0)
-  //  return read_ret;
-  //else
-  //  throw SSLException();
-}
+  // The data has to be encrypted in userspace. Read one record's worth at a
+  // time, so that a send that would block is retried with the same length.
+  char buf[16384];
+  size_t buflen = nbytes < sizeof(buf) ? nbytes : sizeof(buf);
+
+#ifdef _WIN32
+  OVERLAPPED overlapped;
+  memset(&overlapped, 0, sizeof(overlapped));
+  overlapped.Offset = static_cast<DWORD>(offset);
+  overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(offset) >> 32);
+  DWORD read_len;
+  if (!ReadFile(fd, buf, static_cast<DWORD>(buflen), &read_len, &overlapped)) {
+    return -1;
+  }
+  ssize_t read_ret = static_cast<ssize_t>(read_len);
+#else
+  ssize_t read_ret = ::pread(fd, buf, buflen, offset);
+#endif
 
-ssize_t SslSocket::recvmsg(const iovec* iov, int iovlen, const MessageFlags& flags) {
-  if (iovlen == 1) {
-    return recv(iov[0].iov_base, iov[0].iov_len, flags);
+  if (read_ret > 0) {
+    return send(buf, static_cast<size_t>(read_ret), 0);
   } else {
-    return -1;
+    return read_ret;
   }
 }
 
-ssize_t SslSocket::send(const void* buf, size_t buflen, const MessageFlags&) {
-  return SSL_write(ssl, buf, static_cast<int>(buflen));
-  //ssize_t write_ret = SSL_write(ssl, buf, static_cast<int>(buflen));
-  //if (write_ret >= 0)
-  //  return write_ret;
-  //else
-  //  throw SSLException();
-}
+ssize_t
+SslSocket::sendmsg(
+  const iovec* iov,
+  int iovlen,
+  const MessageFlags& flags
+) {
+  // SSL_write has no gather form. Coalesce the buffers into a record rather
+  // than writing a record per buffer: a send that would block is retried with
+  // the same buffers, so it gathers the same data again, as SSL_write requires.
+  char buf[16384];
+  size_t buflen = 0;
+  for (int iov_i = 0; iov_i < iovlen; ++iov_i) {
+    if (buflen == 0 && iov[iov_i].iov_len >= sizeof(buf)) {
+      return send(iov[iov_i].iov_base, iov[iov_i].iov_len, flags);
+    }
 
-ssize_t SslSocket::sendmsg(const iovec* iov, int iovlen, const MessageFlags&) {
-  return Channel::writev(iov, iovlen);
+    size_t copy_len = sizeof(buf) - buflen;
+    if (iov[iov_i].iov_len < copy_len) {
+      copy_len = iov[iov_i].iov_len;
+    }
+    memcpy_s(buf + buflen, sizeof(buf) - buflen, iov[iov_i].iov_base, copy_len);
+    buflen += copy_len;
+    if (buflen == sizeof(buf)) {
+      break;
+    }
+  }
+
+  return send(buf, buflen, flags);
 }
 
 bool SslSocket::shutdown(bool shut_rd, bool shut_wr) {
-  if (SSL_shutdown(ssl) != -1) {
-    return TcpSocket::shutdown(shut_rd, shut_wr);
-  } else {
-    return false;
+  if (shut_wr && SSL_is_init_finished(ssl_)) {
+    // Best effort: a non-blocking socket may not take the close_notify
+    ERR_clear_error();
+    SSL_shutdown(ssl_);
+    ERR_clear_error();
   }
+
+  return TcpSocket::shutdown(shut_rd, shut_wr);
 }
 
 bool SslSocket::want_recv() const {
-  return SSL_want_read(ssl) == 1;
+  return ssl_error_ == SSL_ERROR_WANT_READ;
 }
 
 bool SslSocket::want_send() const {
-  return SSL_want_write(ssl) == 1;
+  return ssl_error_ == SSL_ERROR_WANT_WRITE;
 }
 }
 #endif
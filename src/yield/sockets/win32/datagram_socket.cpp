@@ -26,11 +26,77 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "winsock.hpp"
+#include "yield/buffer.hpp"
 #include "yield/sockets/datagram_socket.hpp"
 
 namespace yield {
 namespace sockets {
 const int DatagramSocket::TYPE = SOCK_DGRAM;
+const size_t DatagramSocket::MMSG_VLEN_MAX;
+
+ssize_t
+DatagramSocket::recvmmsg(
+  const ::std::shared_ptr<Buffer>* buffers,
+  size_t buffers_len,
+  const MessageFlags& flags,
+  SocketAddress* peernames,
+  uint16_t* gro_segment_sizes
+) {
+  if (buffers_len > MMSG_VLEN_MAX) {
+    buffers_len = MMSG_VLEN_MAX;
+  }
+
+  size_t buffer_i = 0;
+  for (; buffer_i < buffers_len; ++buffer_i) {
+    ssize_t recv_ret
+      = recvfrom(*buffers[buffer_i], flags, peernames[buffer_i]);
+    if (recv_ret < 0) {
+      if (buffer_i > 0 && want_recv()) {
+        break;
+      }
+      return recv_ret;
+    }
+    if (gro_segment_sizes != NULL) {
+      gro_segment_sizes[buffer_i] = 0;
+    }
+  }
+  return static_cast<ssize_t>(buffer_i);
+}
+
+ssize_t
+DatagramSocket::sendmmsg(
+  const ::std::shared_ptr<Buffer>* buffers,
+  size_t buffers_len,
+  const MessageFlags& flags,
+  const SocketAddress* peernames,
+  uint16_t gso_segment_size
+) {
+  if (gso_segment_size != 0) {
+    WSASetLastError(WSAEOPNOTSUPP);
+    return -1;
+  }
+
+  if (buffers_len > MMSG_VLEN_MAX) {
+    buffers_len = MMSG_VLEN_MAX;
+  }
+
+  size_t buffer_i = 0;
+  for (; buffer_i < buffers_len; ++buffer_i) {
+    ssize_t send_ret;
+    if (peernames != NULL) {
+      send_ret = sendto(*buffers[buffer_i], flags, peernames[buffer_i]);
+    } else {
+      send_ret = send(*buffers[buffer_i], flags);
+    }
+    if (send_ret < 0) {
+      if (buffer_i > 0 && want_send()) {
+        break;
+      }
+      return send_ret;
+    }
+  }
+  return static_cast<ssize_t>(buffer_i);
+}
 
 ssize_t
 DatagramSocket::sendmsg(
@@ -35,6 +35,7 @@ using ::std::string;
 
 const int Socket::Option::RCVBUF = SO_RCVBUF;
 const int Socket::Option::REUSEADDR = SO_REUSEADDR;
+const int Socket::Option::REUSEPORT = -1;
 const int Socket::Option::SNDBUF = SO_SNDBUF;
 
 bool Socket::bind(const SocketAddress& _name) {
@@ -33,6 +33,7 @@
 namespace yield {
 namespace sockets {
 using ::std::make_shared;
+using ::std::string;
 
 const int SocketAddress::GETNAMEINFO_FLAG_NOFQDN = NI_NOFQDN;
 const int SocketAddress::GETNAMEINFO_FLAG_NAMEREQD = NI_NAMEREQD;
@@ -251,6 +252,56 @@ throw(Exception) {
   }
 }
 
+bool SocketAddress::ntop(string& nodename) const {
+  switch (get_family()) {
+  case AF_INET: {
+    const uint8_t* octets
+    = reinterpret_cast<const uint8_t*>(
+        &reinterpret_cast<const sockaddr_in*>(&addr)->sin_addr
+      );
+    char nodename_[16], *nodename_p = nodename_;
+    for (uint8_t octet_i = 0; octet_i < 4; ++octet_i) {
+      if (octet_i > 0) {
+        *nodename_p++ = '.';
+      }
+
+      uint8_t octet = octets[octet_i];
+      if (octet >= 100) {
+        *nodename_p++ = static_cast<char>('0' + octet / 100);
+      }
+      if (octet >= 10) {
+        *nodename_p++ = static_cast<char>('0' + (octet / 10) % 10);
+      }
+      *nodename_p++ = static_cast<char>('0' + octet % 10);
+    }
+    nodename.assign(nodename_, nodename_p);
+    return true;
+  }
+
+  case AF_INET6: {
+    char nodename_[INET6_ADDRSTRLEN];
+    if (
+      InetNtopA(
+        AF_INET6,
+        const_cast<in6_addr*>(
+          &reinterpret_cast<const sockaddr_in6*>(&addr)->sin6_addr
+        ),
+        nodename_,
+        sizeof(nodename_)
+      ) != NULL
+    ) {
+      nodename.assign(nodename_);
+      return true;
+    } else {
+      return false;
+    }
+  }
+
+  default:
+    return false;
+  }
+}
+
 socklen_t SocketAddress::len(int family) {
   switch (family) {
   case 0:
@@ -32,5 +32,11 @@ namespace yield {
 namespace sockets {
 const int UdpSocket::DOMAIN_DEFAULT = AF_INET;
 const int UdpSocket::PROTOCOL = IPPROTO_UDP;
+
+const int UdpSocket::Option::GRO = -1;
+
+bool UdpSocket::setsockopt(int option_name, int option_value) {
+  return DatagramSocket::setsockopt(option_name, option_value);
+}
 }
 }
@@ -65,7 +65,8 @@ PollingStageScheduler::schedule(
 }
 
 
-PollingStageScheduler::StagePoller::StagePoller(shared_ptr<Stage> first_stage) {
+PollingStageScheduler::StagePoller::StagePoller(shared_ptr<Stage> first_stage)
+  : should_run_(true) {
   stages_.push_back(::std::move(first_stage));
 }
 
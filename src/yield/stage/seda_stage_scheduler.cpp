@@ -32,20 +32,25 @@
 #include "yield/thread/runnable.hpp"
 #include "yield/thread/thread.hpp"
 
+#include <atomic>
+
 namespace yield {
 namespace stage {
-using ::std::make_shared;
+using ::std::atomic;
 using ::std::shared_ptr;
 using ::std::unique_ptr;
-using ::std::vector;
+using ::yield::thread::Mutex;
 using ::yield::thread::Runnable;
 using ::yield::thread::Thread;
 
-class SedaStageScheduler::SedaStage : public Runnable {
+const Time SedaStageScheduler::CONTROL_INTERVAL(0.1);
+const Time SedaStageScheduler::IDLE_TIMEOUT(5);
+const double SedaStageScheduler::RHO_THRESHOLD = 0.9;
+
+class SedaStageScheduler::Controller : public Runnable {
 public:
-  SedaStage(shared_ptr<Stage> stage)
-    : stage_(stage),
-      visit_timeout_(5) {
+  Controller(SedaStageScheduler& scheduler)
+    : scheduler_(scheduler) {
     should_run_ = true;
   }
 
@@ -56,35 +61,228 @@ public:
   // yield::thread::Runnable
   void run() {
     while (should_run_) {
-      stage_->visit(visit_timeout_);
+      Thread::sleep(CONTROL_INTERVAL);
+      scheduler_.control();
     }
   }
 
 private:
-  bool should_run_;
-  shared_ptr<Stage> stage_;
-  Time visit_timeout_;
+  SedaStageScheduler& scheduler_;
+  atomic<bool> should_run_;
+};
+
+class SedaStageScheduler::SedaStage {
+public:
+  SedaStage(
+    shared_ptr<Stage> stage,
+    uint16_t min_concurrency_level,
+    uint16_t max_concurrency_level
+  )
+    : max_concurrency_level(max_concurrency_level),
+      min_concurrency_level(min_concurrency_level),
+      stage(stage) {
+    concurrency_level = 0;
+  }
+
+public:
+  // Give up one thread unless the stage is at its minimum
+  bool retire_thread() {
+    uint16_t concurrency_level = this->concurrency_level.load();
+    while (concurrency_level > min_concurrency_level) {
+      if (
+        this->concurrency_level.compare_exchange_weak(
+          concurrency_level,
+          concurrency_level - 1
+        )
+      ) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+public:
+  atomic<uint16_t> concurrency_level;
+  const uint16_t max_concurrency_level, min_concurrency_level;
+  shared_ptr<Stage> stage;
 };
 
+class SedaStageScheduler::SedaStageThread : public Runnable {
+public:
+  SedaStageThread(SedaStage& seda_stage)
+    : seda_stage_(seda_stage) {
+    should_run_ = true;
+    stopped_ = false;
+  }
+
+  void stop() {
+    should_run_ = false;
+  }
+
+  bool stopped() const {
+    return stopped_;
+  }
+
+  // yield::thread::Runnable
+  void run() {
+    // Short enough for stop() and retirement to be noticed promptly
+    const Time visit_timeout(CONTROL_INTERVAL);
+
+    Time idle_time(Time::ZERO);
+    while (should_run_) {
+      if (seda_stage_.stage->visit(visit_timeout)) {
+        idle_time = Time::ZERO;
+      } else {
+        idle_time += visit_timeout;
+        if (idle_time >= IDLE_TIMEOUT) {
+          if (seda_stage_.retire_thread()) {
+            break;
+          }
+          idle_time = Time::ZERO;
+        }
+      }
+    }
+
+    stopped_ = true;
+  }
+
+private:
+  SedaStage& seda_stage_;
+  atomic<bool> should_run_, stopped_;
+};
+
+
+SedaStageScheduler::SedaStageScheduler()
+  : thread_budget_(
+      static_cast<uint16_t>(4 * ConcurrencyLevel::PER_PROCESSOR)
+    ) {
+  init();
+}
+
+SedaStageScheduler::SedaStageScheduler(uint16_t thread_budget)
+  : thread_budget_(thread_budget) {
+  init();
+}
 
 SedaStageScheduler::~SedaStageScheduler() {
+  static_cast<Controller&>(controller_thread_->runnable()).stop();
+  controller_thread_->join();
+
+  for (
+    auto thread_i = threads.begin();
+    thread_i != threads.end();
+    ++thread_i
+  ) {
+    static_cast<SedaStageThread&>((*thread_i)->runnable()).stop();
+  }
+
   for (
     auto thread_i = threads.begin();
     thread_i != threads.end();
     ++thread_i
   ) {
-    static_cast<SedaStage&>((*thread_i)->runnable()).stop();
     (*thread_i)->join();
   }
 }
 
+void SedaStageScheduler::add_thread(SedaStage& seda_stage) {
+  seda_stage.concurrency_level++;
+  threads.push_back(
+    unique_ptr<Thread>(
+      new Thread(unique_ptr<Runnable>(new SedaStageThread(seda_stage)))
+    )
+  );
+}
+
+void SedaStageScheduler::control() {
+  Mutex::Holder mutex_holder(mutex_);
+
+  // Join the threads that retired since the last sample
+  for (auto thread_i = threads.begin(); thread_i != threads.end();) {
+    if (static_cast<SedaStageThread&>((*thread_i)->runnable()).stopped()) {
+      (*thread_i)->join();
+      thread_i = threads.erase(thread_i);
+    } else {
+      ++thread_i;
+    }
+  }
+
+  for (
+    auto seda_stage_i = seda_stages_.begin();
+    seda_stage_i != seda_stages_.end();
+    ++seda_stage_i
+  ) {
+    if (threads.size() >= thread_budget_) {
+      break;
+    }
+
+    SedaStage& seda_stage = **seda_stage_i;
+    uint16_t concurrency_level = seda_stage.concurrency_level;
+    if (concurrency_level >= seda_stage.max_concurrency_level) {
+      continue;
+    }
+
+    if (
+      seda_stage.stage->event_queue_length() > QUEUE_LENGTH_THRESHOLD
+      ||
+      seda_stage.stage->rho() > RHO_THRESHOLD * concurrency_level
+    ) {
+      DLOG(DEBUG) << "adding thread " << concurrency_level + 1
+                  << " to stage " << seda_stage.stage.get();
+      add_thread(seda_stage);
+    }
+  }
+}
+
+uint16_t SedaStageScheduler::get_concurrency_level(const Stage& stage) {
+  Mutex::Holder mutex_holder(mutex_);
+  for (
+    auto seda_stage_i = seda_stages_.begin();
+    seda_stage_i != seda_stages_.end();
+    ++seda_stage_i
+  ) {
+    if ((*seda_stage_i)->stage.get() == &stage) {
+      return (*seda_stage_i)->concurrency_level;
+    }
+  }
+  return 0;
+}
+
+void SedaStageScheduler::init() {
+  controller_thread_.reset(
+    new Thread(unique_ptr<Runnable>(new Controller(*this)))
+  );
+}
+
 void
 SedaStageScheduler::schedule(
   shared_ptr<Stage> stage,
   ConcurrencyLevel concurrency_level
 ) {
-  for (int16_t thread_i = 0; thread_i < concurrency_level; thread_i++) {
-    threads.push_back(unique_ptr<Thread>(new Thread(unique_ptr<Runnable>(new SedaStage(stage)))));
+  schedule(stage, concurrency_level, concurrency_level);
+}
+
+void
+SedaStageScheduler::schedule(
+  shared_ptr<Stage> stage,
+  ConcurrencyLevel concurrency_level,
+  ConcurrencyLevel max_concurrency_level
+) {
+  CHECK_GE(
+    static_cast<uint16_t>(max_concurrency_level),
+    static_cast<uint16_t>(concurrency_level)
+  );
+
+  Mutex::Holder mutex_holder(mutex_);
+
+  seda_stages_.push_back(
+    unique_ptr<SedaStage>(
+      new SedaStage(stage, concurrency_level, max_concurrency_level)
+    )
+  );
+
+  for (uint16_t thread_i = 0; thread_i < concurrency_level; thread_i++) {
+    add_thread(*seda_stages_.back());
   }
 }
 }
@@ -0,0 +1,254 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/stage/stage_statistics.hpp"
+
+#include <cmath>
+
+namespace yield {
+namespace stage {
+using ::std::atomic;
+using ::std::memory_order_relaxed;
+
+namespace {
+atomic<size_t> next_stripe_i(0);
+
+size_t get_bucket_i(uint64_t ns) {
+  if (ns < 4) {
+    return static_cast<size_t>(ns);
+  }
+
+#ifdef __GNUC__
+  size_t log2_ns = 63 - static_cast<size_t>(__builtin_clzll(ns));
+#else
+  size_t log2_ns = 2;
+  while ((ns >> (log2_ns + 1)) != 0) {
+    ++log2_ns;
+  }
+#endif
+
+  return (log2_ns - 1) * 4 + static_cast<size_t>((ns >> (log2_ns - 2)) & 3);
+}
+
+uint64_t get_bucket_ns(size_t bucket_i) {
+  if (bucket_i < 4) {
+    return bucket_i;
+  }
+
+  size_t log2_ns = bucket_i / 4 + 1;
+  uint64_t lower_ns = static_cast<uint64_t>(4 + bucket_i % 4) << (log2_ns - 2);
+  uint64_t width_ns = static_cast<uint64_t>(1) << (log2_ns - 2);
+  return lower_ns + width_ns / 2;
+}
+}
+
+const Time StageStatistics::HALF_LIFE(2.0);
+const Time StageStatistics::UPDATE_INTERVAL(0.25);
+const uint64_t StageStatistics::INTERARRIVAL_SAMPLING;
+
+StageStatistics::StageStatistics()
+  : arrival_rate_s_(0),
+    last_update_ns_(Time::now().ns()),
+    rho_(0),
+    service_rate_s_(0),
+    updated_arrivals_(0),
+    updated_services_(0),
+    updated_service_ns_(0),
+    updates_(0),
+    services_ewma_(0),
+    service_ns_ewma_(0) {
+  for (size_t stripe_i = 0; stripe_i < STRIPES; ++stripe_i) {
+    stripes_[stripe_i].arrivals.store(0);
+    stripes_[stripe_i].sampled_arrival_ns.store(0);
+    stripes_[stripe_i].services.store(0);
+    stripes_[stripe_i].service_ns.store(0);
+  }
+}
+
+void StageStatistics::arrival() {
+  Stripe& stripe = stripes_[get_stripe_i()];
+  uint64_t arrival_i = stripe.arrivals.fetch_add(1, memory_order_relaxed);
+
+  switch (arrival_i % INTERARRIVAL_SAMPLING) {
+  case 0: {
+    stripe.sampled_arrival_ns.store(Time::now().ns(), memory_order_relaxed);
+  }
+  break;
+
+  case 1: {
+    uint64_t now_ns = Time::now().ns();
+    uint64_t sampled_arrival_ns
+    = stripe.sampled_arrival_ns.load(memory_order_relaxed);
+    if (sampled_arrival_ns != 0 && now_ns >= sampled_arrival_ns) {
+      interarrival_times_.record(now_ns - sampled_arrival_ns, 1);
+    }
+  }
+  break;
+
+  default:
+    break;
+  }
+}
+
+uint64_t StageStatistics::event_queue_length() const {
+  uint64_t arrivals = 0, services = 0;
+  for (size_t stripe_i = 0; stripe_i < STRIPES; ++stripe_i) {
+    arrivals += stripes_[stripe_i].arrivals.load(memory_order_relaxed);
+    services += stripes_[stripe_i].services.load(memory_order_relaxed);
+  }
+  // A service can be counted before the arrival that preceded it
+  return arrivals > services ? arrivals - services : 0;
+}
+
+size_t StageStatistics::get_stripe_i() {
+  static thread_local size_t stripe_i
+    = next_stripe_i.fetch_add(1, memory_order_relaxed) % STRIPES;
+  return stripe_i;
+}
+
+void
+StageStatistics::service(
+  const Time& service_time,
+  uint32_t events_count
+) {
+  if (events_count == 0) {
+    return;
+  }
+
+  Stripe& stripe = stripes_[get_stripe_i()];
+  stripe.services.fetch_add(events_count, memory_order_relaxed);
+  stripe.service_ns.fetch_add(service_time.ns(), memory_order_relaxed);
+  // A batch's events are each taken to have the mean service time
+  service_times_.record(service_time.ns() / events_count, events_count);
+}
+
+void StageStatistics::update(const Time& now) {
+  uint64_t last_update_ns = last_update_ns_.load(memory_order_relaxed);
+  if (
+    now.ns() < last_update_ns + UPDATE_INTERVAL.ns()
+    ||
+    !last_update_ns_.compare_exchange_strong(last_update_ns, now.ns())
+  ) {
+    return;
+  }
+
+  uint64_t arrivals = 0, services = 0, service_ns = 0;
+  for (size_t stripe_i = 0; stripe_i < STRIPES; ++stripe_i) {
+    arrivals += stripes_[stripe_i].arrivals.load(memory_order_relaxed);
+    services += stripes_[stripe_i].services.load(memory_order_relaxed);
+    service_ns += stripes_[stripe_i].service_ns.load(memory_order_relaxed);
+  }
+
+  double elapsed_s = Time(now.ns() - last_update_ns).s();
+  // Weight of the previous averages; the first update has none
+  double keep = updates_++ > 0 ? exp2(-elapsed_s / HALF_LIFE.s()) : 0;
+
+  double arrival_rate_s
+  = static_cast<double>(arrivals - updated_arrivals_) / elapsed_s;
+  arrival_rate_s = arrival_rate_s_.load() * keep + arrival_rate_s * (1 - keep);
+  arrival_rate_s_.store(arrival_rate_s, memory_order_relaxed);
+
+  services_ewma_
+  = services_ewma_ * keep
+    + static_cast<double>(services - updated_services_) * (1 - keep);
+  service_ns_ewma_
+  = service_ns_ewma_ * keep
+    + static_cast<double>(service_ns - updated_service_ns_) * (1 - keep);
+  if (services_ewma_ > 0 && service_ns_ewma_ > 0) {
+    double service_rate_s = services_ewma_ / (service_ns_ewma_ / 1e9);
+    service_rate_s_.store(service_rate_s, memory_order_relaxed);
+    rho_.store(arrival_rate_s / service_rate_s, memory_order_relaxed);
+  } else {
+    rho_.store(0, memory_order_relaxed);
+  }
+
+  updated_arrivals_ = arrivals;
+  updated_services_ = services;
+  updated_service_ns_ = service_ns;
+
+  if (keep > 0) {
+    interarrival_times_.decay(keep);
+    service_times_.decay(keep);
+  }
+}
+
+StageStatistics::Histogram::Histogram() {
+  for (size_t bucket_i = 0; bucket_i < BUCKETS; ++bucket_i) {
+    buckets_[bucket_i].store(0);
+  }
+}
+
+void StageStatistics::Histogram::decay(double factor) {
+  for (size_t bucket_i = 0; bucket_i < BUCKETS; ++bucket_i) {
+    uint64_t weight = buckets_[bucket_i].load(memory_order_relaxed);
+    if (weight > 0) {
+      // Subtract rather than store, so concurrent records are not lost
+      uint64_t decayed_weight
+      = static_cast<uint64_t>(static_cast<double>(weight) * factor);
+      buckets_[bucket_i].fetch_sub(
+        weight - decayed_weight,
+        memory_order_relaxed
+      );
+    }
+  }
+}
+
+Time StageStatistics::Histogram::percentile(double percentile) const {
+  uint64_t weights[BUCKETS], total_weight = 0;
+  for (size_t bucket_i = 0; bucket_i < BUCKETS; ++bucket_i) {
+    weights[bucket_i] = buckets_[bucket_i].load(memory_order_relaxed);
+    total_weight += weights[bucket_i];
+  }
+
+  if (total_weight == 0) {
+    return Time(static_cast<uint64_t>(0));
+  }
+
+  double target_weight = percentile * static_cast<double>(total_weight);
+  uint64_t cumulative_weight = 0;
+  for (size_t bucket_i = 0; bucket_i < BUCKETS; ++bucket_i) {
+    cumulative_weight += weights[bucket_i];
+    if (
+      weights[bucket_i] > 0
+      &&
+      static_cast<double>(cumulative_weight) >= target_weight
+    ) {
+      return Time(get_bucket_ns(bucket_i));
+    }
+  }
+
+  return Time(get_bucket_ns(BUCKETS - 1));
+}
+
+void StageStatistics::Histogram::record(uint64_t ns, uint32_t samples_count) {
+  buckets_[get_bucket_i(ns)].fetch_add(
+    SAMPLE_WEIGHT * samples_count,
+    memory_order_relaxed
+  );
+}
+}
+}
@@ -0,0 +1,281 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/logging.hpp"
+#include "yield/stage/work_stealing_stage_scheduler.hpp"
+#include "yield/thread/runnable.hpp"
+
+#include <deque>
+
+namespace yield {
+namespace stage {
+using ::std::atomic;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+using ::yield::thread::Mutex;
+using ::yield::thread::Runnable;
+using ::yield::thread::Thread;
+
+class WorkStealingStageScheduler::Worker : public Runnable {
+public:
+  Worker(WorkStealingStageScheduler& scheduler, uint16_t worker_i)
+    : scheduler_(scheduler),
+      worker_i_(worker_i) {
+    activations_size_ = 0;
+    should_run_ = true;
+  }
+
+public:
+  bool empty() const {
+    return activations_size_ == 0;
+  }
+
+  // Newest activation, from this worker
+  Stage* pop() {
+    if (empty()) {
+      return NULL;
+    }
+
+    Mutex::Holder activations_mutex_holder(activations_mutex_);
+    if (activations_.empty()) {
+      return NULL;
+    }
+    Stage* stage = activations_.back();
+    activations_.pop_back();
+    activations_size_--;
+    return stage;
+  }
+
+  void push(Stage& stage) {
+    Mutex::Holder activations_mutex_holder(activations_mutex_);
+    activations_.push_back(&stage);
+    activations_size_++;
+  }
+
+  WorkStealingStageScheduler& scheduler() {
+    return scheduler_;
+  }
+
+  bool should_run() const {
+    return should_run_;
+  }
+
+  // Oldest activation, from another worker
+  Stage* steal() {
+    if (empty()) {
+      return NULL;
+    }
+
+    Mutex::Holder activations_mutex_holder(activations_mutex_);
+    if (activations_.empty()) {
+      return NULL;
+    }
+    Stage* stage = activations_.front();
+    activations_.pop_front();
+    activations_size_--;
+    return stage;
+  }
+
+  void stop() {
+    should_run_ = false;
+  }
+
+  // yield::thread::Runnable
+  void run();
+
+public:
+  static thread_local Worker* current;
+
+private:
+  ::std::deque<Stage*> activations_;
+  Mutex activations_mutex_;
+  atomic<size_t> activations_size_;
+  WorkStealingStageScheduler& scheduler_;
+  atomic<bool> should_run_;
+  uint16_t worker_i_;
+};
+
+thread_local WorkStealingStageScheduler::Worker*
+WorkStealingStageScheduler::Worker::current = NULL;
+
+void WorkStealingStageScheduler::Worker::run() {
+  current = this;
+
+  const ::std::vector<Worker*>& workers = scheduler_.workers_;
+  while (should_run_) {
+    Stage* stage = pop();
+
+    for (
+      size_t victim_i = 1;
+      stage == NULL && victim_i < workers.size();
+      ++victim_i
+    ) {
+      stage = workers[(worker_i_ + victim_i) % workers.size()]->steal();
+    }
+
+    if (stage != NULL) {
+      stage->visit(Time::ZERO);
+    } else {
+      scheduler_.wait(*this);
+    }
+  }
+
+  current = NULL;
+}
+
+
+WorkStealingStageScheduler::WorkStealingStageScheduler() {
+  init(ConcurrencyLevel::PER_PROCESSOR, true);
+}
+
+WorkStealingStageScheduler::WorkStealingStageScheduler(
+  uint16_t workers_count
+) {
+  init(workers_count, false);
+}
+
+WorkStealingStageScheduler::~WorkStealingStageScheduler() {
+  // Events enqueued from now on stay in their stages' queues. Detach the
+  // stages before stopping the workers, so that an activation already in
+  // flight still lands on a live worker.
+  {
+    Mutex::Holder stages_mutex_holder(stages_mutex_);
+    for (
+      auto stage_i = stages_.begin();
+      stage_i != stages_.end();
+      ++stage_i
+    ) {
+      (*stage_i)->set_activator(NULL);
+    }
+  }
+
+  idle_cond_.lock_mutex();
+  for (
+    auto worker_i = workers_.begin();
+    worker_i != workers_.end();
+    ++worker_i
+  ) {
+    (*worker_i)->stop();
+  }
+  idle_cond_.broadcast();
+  idle_cond_.unlock_mutex();
+
+  for (
+    auto thread_i = threads_.begin();
+    thread_i != threads_.end();
+    ++thread_i
+  ) {
+    (*thread_i)->join();
+  }
+}
+
+void WorkStealingStageScheduler::activate(Stage& stage) {
+  Worker* worker = Worker::current;
+  if (worker == NULL || &worker->scheduler() != this) {
+    worker = workers_[next_worker_i_++ % workers_.size()];
+  }
+
+  worker->push(stage);
+
+  if (idle_workers_count_ > 0) {
+    idle_cond_.lock_mutex();
+    idle_cond_.signal();
+    idle_cond_.unlock_mutex();
+  }
+}
+
+bool WorkStealingStageScheduler::has_activations() const {
+  for (
+    auto worker_i = workers_.begin();
+    worker_i != workers_.end();
+    ++worker_i
+  ) {
+    if (!(*worker_i)->empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingStageScheduler::init(uint16_t workers_count, bool setaffinity) {
+  CHECK_GT(workers_count, 0);
+
+  idle_workers_count_ = 0;
+  next_worker_i_ = 0;
+
+  // All workers must exist before any of them steals
+  for (uint16_t worker_i = 0; worker_i < workers_count; ++worker_i) {
+    workers_.push_back(new Worker(*this, worker_i));
+  }
+
+  for (uint16_t worker_i = 0; worker_i < workers_count; ++worker_i) {
+    unique_ptr<Thread> thread(
+      new Thread(unique_ptr<Runnable>(workers_[worker_i]))
+    );
+    if (setaffinity && !thread->setaffinity(worker_i)) {
+      LOG(WARNING) << "could not bind worker " << worker_i
+                   << " to its processor";
+    }
+    threads_.push_back(::std::move(thread));
+  }
+}
+
+void
+WorkStealingStageScheduler::schedule(
+  shared_ptr<Stage> stage,
+  ConcurrencyLevel
+) {
+  {
+    Mutex::Holder stages_mutex_holder(stages_mutex_);
+    stages_.push_back(stage);
+  }
+
+  stage->set_activator(this);
+
+  // Events enqueued before the stage was scheduled
+  for (
+    uint64_t event_i = stage->event_queue_length();
+    event_i > 0;
+    --event_i
+  ) {
+    activate(*stage);
+  }
+}
+
+void WorkStealingStageScheduler::wait(Worker& worker) {
+  idle_cond_.lock_mutex();
+  idle_workers_count_++;
+  // An activation pushed after this check sees idle_workers_count_ > 0 and
+  // signals once this worker is waiting
+  if (worker.should_run() && !has_activations()) {
+    idle_cond_.wait();
+  }
+  idle_workers_count_--;
+  idle_cond_.unlock_mutex();
+}
+}
+}
@@ -38,15 +38,18 @@
 namespace yield {
 namespace thread {
 Thread::Thread(::std::unique_ptr<Runnable> runnable)
-  : runnable_(::std::move(runnable)) {
+  : joinable_(false),
+    runnable_(::std::move(runnable)) {
   state_ = State::READY;
 
+  // Joinable, so that join() actually waits for the thread to exit
   pthread_attr_t attr;
   pthread_attr_init(&attr);
-  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
   if (pthread_create(&pthread, &attr, &run, this) == 0) {
     pthread_attr_destroy(&attr);
+    joinable_ = true;
 
     while (state_ == State::READY) {
       sleep(0);
@@ -58,13 +61,16 @@ Thread::Thread(::std::unique_ptr<Runnable> runnable)
 }
 
 Thread::Thread(pthread_t pthread)
-  : pthread(pthread) {
+  : pthread(pthread),
+    joinable_(false) {
   state_ = State::READY;
 }
 
 Thread::~Thread() {
-  if (is_running()) {
-    cancel();
+  if (joinable_) {
+    if (is_running()) {
+      cancel();
+    }
     join();
   }
 }
@@ -78,7 +84,12 @@ void* Thread::getspecific(uintptr_t key) {
 }
 
 bool Thread::join() {
-  return pthread_join(pthread, NULL) != -1;
+  if (pthread_join(pthread, NULL) == 0) {
+    joinable_ = false;
+    return true;
+  } else {
+    return false;
+  }
 }
 
 uintptr_t Thread::key_create() {
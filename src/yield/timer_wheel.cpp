@@ -0,0 +1,157 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/logging.hpp"
+#include "yield/timer_wheel.hpp"
+
+namespace yield {
+using ::std::vector;
+
+const uint8_t TimerWheel::LEVELS;
+const uint16_t TimerWheel::LEVEL_SLOTS;
+const uint8_t TimerWheel::LEVEL_SLOTS_BITS;
+
+TimerWheel::TimerWheel(const Time& tick, const Time& now)
+  : current_tick_(0),
+    origin_(now),
+    size_(0),
+    tick_(tick) {
+  CHECK_GT(tick.ns(), 0u);
+  CHECK_EQ(1 << LEVEL_SLOTS_BITS, LEVEL_SLOTS);
+}
+
+void TimerWheel::advance(const Time& now, vector<uint64_t>& expired_timer_ids) {
+  uint64_t now_tick = (now - origin_).ns() / tick_.ns();
+
+  if (size_ == 0) {
+    if (now_tick > current_tick_) {
+      current_tick_ = now_tick;
+    }
+    return;
+  }
+
+  while (current_tick_ < now_tick) {
+    ++current_tick_;
+
+    // Every level whose finer digits just wrapped around to zero has
+    // a slot that is now current; empty it into the finer levels,
+    // coarsest first.
+    uint8_t wrapped_levels = 1;
+    while (
+      wrapped_levels < LEVELS
+      &&
+      (current_tick_ & ((1ull << (LEVEL_SLOTS_BITS * wrapped_levels)) - 1)) == 0
+    ) {
+      ++wrapped_levels;
+    }
+    for (uint8_t level = wrapped_levels - 1; level > 0; --level) {
+      cascade(level);
+    }
+
+    vector<Timer>& slot = slots_[0][current_tick_ & (LEVEL_SLOTS - 1)];
+    for (auto timer_i = slot.begin(); timer_i != slot.end(); ++timer_i) {
+      DCHECK_LE(timer_i->deadline_tick, current_tick_);
+      expired_timer_ids.push_back(timer_i->id);
+    }
+    size_ -= slot.size();
+    slot.clear();
+
+    if (size_ == 0) {
+      current_tick_ = now_tick;
+    }
+  }
+}
+
+void TimerWheel::cascade(uint8_t level) {
+  vector<Timer>& slot
+    = slots_[level][
+        (current_tick_ >> (LEVEL_SLOTS_BITS * level)) & (LEVEL_SLOTS - 1)
+      ];
+  if (slot.empty()) {
+    return;
+  }
+
+  vector<Timer> timers;
+  timers.swap(slot);
+  for (auto timer_i = timers.begin(); timer_i != timers.end(); ++timer_i) {
+    place(*timer_i);
+  }
+  // Keep the slot's capacity for the next round
+  timers.clear();
+  timers.swap(slot);
+}
+
+void TimerWheel::insert(uint64_t timer_id, const Time& deadline) {
+  Timer timer;
+  timer.deadline_tick
+    = ((deadline - origin_).ns() + tick_.ns() - 1) / tick_.ns();
+  // The current slot has already expired.
+  if (timer.deadline_tick <= current_tick_) {
+    timer.deadline_tick = current_tick_ + 1;
+  }
+  timer.id = timer_id;
+  place(timer);
+  ++size_;
+}
+
+void TimerWheel::place(const Timer& timer) {
+  uint64_t deadline_tick = timer.deadline_tick;
+  if (
+    (deadline_tick >> (LEVEL_SLOTS_BITS * LEVELS))
+    !=
+    (current_tick_ >> (LEVEL_SLOTS_BITS * LEVELS))
+  ) {
+    // Beyond the range of the wheel: expire at the end of the range.
+    deadline_tick
+      = current_tick_ | ((1ull << (LEVEL_SLOTS_BITS * LEVELS)) - 1);
+    if (deadline_tick == current_tick_) {
+      ++deadline_tick;
+    }
+  }
+
+  // A timer goes on the finest level above which its deadline and the
+  // current tick agree, so that its slot there is reached before the
+  // current tick passes the deadline.
+  uint8_t level = 0;
+  while (
+    level < LEVELS - 1
+    &&
+    (deadline_tick >> (LEVEL_SLOTS_BITS * (level + 1)))
+    !=
+    (current_tick_ >> (LEVEL_SLOTS_BITS * (level + 1)))
+  ) {
+    ++level;
+  }
+
+  Timer placed_timer;
+  placed_timer.deadline_tick = deadline_tick;
+  placed_timer.id = timer.id;
+  slots_[level][
+    (deadline_tick >> (LEVEL_SLOTS_BITS * level)) & (LEVEL_SLOTS - 1)
+  ].push_back(placed_timer);
+}
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/buffer_pool.hpp"
+#include "gtest/gtest.h"
+
+#include <thread>
+
+namespace yield {
+using ::std::shared_ptr;
+
+TEST(BufferPool, get) {
+  shared_ptr<Buffer> buffer = BufferPool::get(2);
+  ASSERT_EQ(buffer->capacity(), 2);
+  ASSERT_EQ(buffer->size(), 0);
+  ASSERT_TRUE(buffer->is_page_aligned());
+  buffer->put("xy", 2);
+  ASSERT_EQ(buffer->size(), 2);
+}
+
+TEST(BufferPool, get_alignment) {
+  shared_ptr<Buffer> buffer = BufferPool::get(Buffer::getpagesize(), 16 * 1024);
+  ASSERT_EQ(buffer->capacity(), 16 * 1024);
+  ASSERT_TRUE(buffer->is_page_aligned());
+}
+
+TEST(BufferPool, get_huge) {
+  shared_ptr<Buffer> buffer = BufferPool::get(BufferPool::CAPACITY_MAX + 1);
+  ASSERT_EQ(buffer->capacity(), BufferPool::CAPACITY_MAX + 1);
+  ASSERT_TRUE(buffer->is_page_aligned());
+}
+
+TEST(BufferPool, release_other_thread) {
+  shared_ptr<Buffer> buffer = BufferPool::get(64 * 1024);
+  ::std::thread thread([&buffer]() {
+    buffer.reset();
+    BufferPool::get(1).reset();
+  });
+  thread.join();
+  ASSERT_TRUE(buffer == NULL);
+  BufferPool::trim();
+}
+
+TEST(BufferPool, reuse) {
+  for (size_t capacity = 1; capacity <= BufferPool::CAPACITY_MAX; capacity *= 4) {
+    void* data = BufferPool::get(capacity)->data();
+    shared_ptr<Buffer> buffer = BufferPool::get(capacity);
+    ASSERT_EQ(buffer->data(), data);
+  }
+}
+}
@@ -0,0 +1,76 @@
+// buffer_view_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/buffer_view.hpp"
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+namespace yield {
+using ::std::make_shared;
+using ::std::shared_ptr;
+
+TEST(BufferView, constructor) {
+  shared_ptr<Buffer> buffer = Buffer::copy("test string");
+  BufferView buffer_view(buffer);
+  ASSERT_EQ(buffer_view.data(), buffer->data());
+  ASSERT_EQ(buffer_view.size(), buffer->size());
+  ASSERT_EQ(buffer_view.capacity(), buffer->capacity());
+}
+
+TEST(BufferView, constructor_slice) {
+  shared_ptr<Buffer> buffer = Buffer::copy("test string");
+  BufferView buffer_view(buffer, 5, 6);
+  ASSERT_EQ(buffer_view.size(), 6u);
+  ASSERT_EQ(buffer_view.capacity(), 6u);
+  ASSERT_EQ(memcmp(buffer_view.data(), "string", 6), 0);
+}
+
+TEST(BufferView, put) {
+  shared_ptr<Buffer> buffer = make_shared<Buffer>(Buffer::getpagesize());
+  buffer->put("test");
+  BufferView buffer_view(buffer, 0, buffer->size());
+
+  // The buffer grows underneath the view, which keeps its own size
+  buffer->put(" string");
+  ASSERT_EQ(buffer_view.size(), 4u);
+
+  // and has no room to grow into the buffer's data.
+  buffer_view.put("!", 1);
+  ASSERT_EQ(buffer_view.size(), 4u);
+  ASSERT_EQ(memcmp(buffer->data(), "test string", 11), 0);
+}
+
+TEST(BufferView, lifetime) {
+  shared_ptr<Buffer> buffer = Buffer::copy("test");
+  shared_ptr<Buffer> buffer_view = make_shared<BufferView>(buffer);
+  buffer.reset();
+  ASSERT_EQ(memcmp(buffer_view->data(), "test", 4), 0);
+}
+}
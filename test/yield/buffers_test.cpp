@@ -130,4 +130,82 @@ TEST(Buffers, size) {
     Buffer::getpagesize() + Buffer::getpagesize() / 2
   );
 }
+
+TEST(Buffers, write_cursor) {
+  shared_ptr<Buffer> buffers = Buffer::copy("test ");
+  buffers->set_next_buffer(make_shared<Buffer>(Buffer::getpagesize()));
+  buffers->next_buffer()->set_next_buffer(Buffer::copy("string"));
+
+  Buffers::WriteCursor write_cursor(*buffers);
+  ASSERT_FALSE(write_cursor.empty());
+
+  iovec write_iovecs[Buffers::WRITE_IOVECS_MAX];
+  size_t size;
+  ASSERT_EQ(
+    write_cursor.as_write_iovecs(
+      write_iovecs,
+      Buffers::WRITE_IOVECS_MAX,
+      size
+    ),
+    2
+  );
+  ASSERT_EQ(size, 11u);
+  ASSERT_EQ(write_iovecs[0], buffers->as_write_iovec());
+  ASSERT_EQ(
+    write_iovecs[1],
+    buffers->next_buffer()->next_buffer()->as_write_iovec()
+  );
+
+  write_cursor.advance(6);
+  ASSERT_EQ(
+    write_cursor.as_write_iovecs(
+      write_iovecs,
+      Buffers::WRITE_IOVECS_MAX,
+      size
+    ),
+    1
+  );
+  ASSERT_EQ(size, 5u);
+  ASSERT_EQ(
+    write_iovecs[0].iov_base,
+    static_cast<char*>(*buffers->next_buffer()->next_buffer()) + 1
+  );
+
+  write_cursor.advance(5);
+  ASSERT_TRUE(write_cursor.empty());
+}
+
+TEST(Buffers, write_cursor_max) {
+  shared_ptr<Buffer> buffers = Buffer::copy("0");
+  Buffer* last_buffer = buffers.get();
+  for (int i = 1; i < Buffers::WRITE_IOVECS_MAX + 2; ++i) {
+    last_buffer->set_next_buffer(Buffer::copy("1"));
+    last_buffer = last_buffer->next_buffer().get();
+  }
+
+  Buffers::WriteCursor write_cursor(*buffers);
+  iovec write_iovecs[Buffers::WRITE_IOVECS_MAX];
+  size_t size;
+  ASSERT_EQ(
+    write_cursor.as_write_iovecs(
+      write_iovecs,
+      Buffers::WRITE_IOVECS_MAX,
+      size
+    ),
+    Buffers::WRITE_IOVECS_MAX
+  );
+  ASSERT_EQ(size, static_cast<size_t>(Buffers::WRITE_IOVECS_MAX));
+
+  write_cursor.advance(size);
+  ASSERT_EQ(
+    write_cursor.as_write_iovecs(
+      write_iovecs,
+      Buffers::WRITE_IOVECS_MAX,
+      size
+    ),
+    2
+  );
+  write_cursor.advance(size);
+  ASSERT_TRUE(write_cursor.empty());
+}
 }
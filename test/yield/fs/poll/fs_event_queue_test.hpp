@@ -457,6 +457,44 @@ TYPED_TEST_P(FsEventQueueTest, associate_file_dequeue_file_remove) {
   ASSERT_EQ(fs_event->get_path(), this->get_test_file_path());
 }
 
+TYPED_TEST_P(FsEventQueueTest, associate_tree) {
+  Path test_subdirectory_path = this->get_test_directory_path() / "subdir";
+  if (!FileSystem().mkdir(this->get_test_directory_path())) {
+    throw Exception();
+  }
+  if (!FileSystem().mkdir(test_subdirectory_path)) {
+    throw Exception();
+  }
+
+  TypeParam fs_event_queue;
+  if (
+    !fs_event_queue.associate_tree(
+      this->get_test_directory_path(),
+      FsEvent::TYPE_FILE_ADD
+    )
+  ) {
+    throw Exception();
+  }
+
+  Path test_file_path = test_subdirectory_path / "file.txt";
+  if (!FileSystem().touch(test_file_path)) {
+    throw Exception();
+  }
+
+  unique_ptr<FsEvent> fs_event =
+    fs_event_queue.dequeue();
+  ASSERT_EQ(fs_event->get_type(), FsEvent::TYPE_FILE_ADD);
+  ASSERT_EQ(fs_event->get_path(), test_file_path);
+
+  ASSERT_TRUE(fs_event_queue.dissociate(test_subdirectory_path));
+  ASSERT_TRUE(fs_event_queue.dissociate(this->get_test_directory_path()));
+}
+
+TYPED_TEST_P(FsEventQueueTest, associate_tree_missing) {
+  TypeParam fs_event_queue;
+  ASSERT_FALSE(fs_event_queue.associate_tree(this->get_test_directory_path()));
+}
+
 TYPED_TEST_P(FsEventQueueTest, dissociate) {
   TypeParam fs_event_queue;
   fs_event_queue.associate(this->get_test_root_path());
@@ -487,6 +525,8 @@ REGISTER_TYPED_TEST_CASE_P(
   associate_dir_dequeue_file_rename,
   associate_file_dequeue_file_modify,
   associate_file_dequeue_file_remove,
+  associate_tree,
+  associate_tree_missing,
   dissociate
 );
 }
@@ -33,7 +33,7 @@
 namespace yield {
 namespace fs {
 namespace poll {
-INSTANTIATE_TYPED_TEST_CASE_P(FSEventQueue, FSEventQueueTest, FSEventQueue);
+INSTANTIATE_TYPED_TEST_CASE_P(FsEventQueue, FsEventQueueTest, FsEventQueue);
 }
 }
 }
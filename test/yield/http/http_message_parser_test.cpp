@@ -45,12 +45,13 @@ public:
   handle_http_request(
     ::std::shared_ptr<Buffer> body,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     HttpRequest::Method method,
     const yield::uri::Uri& uri
   ) override {
-    http_request_.reset(new HttpRequest(body, fields_offset, header, http_version, method, uri));
+    http_request_.reset(new HttpRequest(body, fields_offset, field_index, header, http_version, method, uri));
   }
 
   void
@@ -54,6 +54,18 @@ TEST(HttpMessage, body_buffer) {
   );
 }
 
+TEST(HttpMessage, get_content_length) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  ASSERT_EQ(http_request->get_content_length(), 0);
+  http_request->set_field("Host", "localhost");
+  http_request->set_field("content-length", "42");
+  ASSERT_EQ(http_request->get_content_length(), 42);
+  http_request->set_field("Transfer-Encoding", "chunked");
+  size_t content_length_chunked = HttpRequest::CONTENT_LENGTH_CHUNKED;
+  ASSERT_EQ(http_request->get_content_length(), content_length_chunked);
+}
+
 TEST(HttpMessage, get_date_field) {
   unique_ptr<HttpRequest> http_request
   (new HttpRequest(HttpRequest::Method::GET, "/"));
@@ -94,6 +106,46 @@ TEST(HttpMessage, get_field) {
   ASSERT_TRUE(http_request->get_field("DateX").empty());
 }
 
+TEST(HttpMessage, get_field_case_insensitive) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  http_request->set_field("User-Agent", "Yield");
+  ASSERT_EQ(http_request->get_field("user-agent"), "Yield");
+  ASSERT_EQ(http_request->get_field("USER-AGENT"), "Yield");
+  ASSERT_FALSE(http_request->has_field("User-Agen"));
+}
+
+TEST(HttpMessage, get_field_duplicate) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  http_request->set_field("Accept", "text/html");
+  ASSERT_EQ(http_request->get_field("Accept"), "text/html");
+  http_request->set_field("Accept", "text/plain");
+  ASSERT_EQ(http_request->get_field("Accept"), "text/html");
+}
+
+TEST(HttpMessage, get_field_many) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  for (char field_i = 0; field_i < 48; ++field_i) {
+    string name("X-Field-");
+    name.push_back(static_cast<char>('a' + field_i / 26));
+    name.push_back(static_cast<char>('a' + field_i % 26));
+    http_request->set_field(name, name);
+  }
+
+  for (char field_i = 0; field_i < 48; ++field_i) {
+    string name("X-Field-");
+    name.push_back(static_cast<char>('a' + field_i / 26));
+    name.push_back(static_cast<char>('a' + field_i % 26));
+    ASSERT_EQ(http_request->get_field(name.c_str()), name);
+  }
+
+  vector< std::pair<iovec, iovec> > fields;
+  http_request->get_fields(fields);
+  ASSERT_EQ(fields.size(), 48);
+}
+
 TEST(HttpMessage, get_fields) {
   unique_ptr<HttpRequest> http_request
   (new HttpRequest(HttpRequest::Method::GET, "/"));
@@ -108,5 +160,58 @@ TEST(HttpMessage, get_fields) {
   ASSERT_EQ(fields[1].first.iov_len, 5);
   ASSERT_EQ(fields[1].second.iov_len, 9);
 }
+TEST(HttpMessage, put_field) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  http_request->set_field("Host", "localhost");
+  http_request->put_field("User-Agent: Yield\r\n", 19, 10);
+  ASSERT_EQ(http_request->get_field("User-Agent"), "Yield");
+  ASSERT_EQ(http_request->get_field("Host"), "localhost");
+}
+
+TEST(HttpMessage, set_content_length_field) {
+  size_t content_lengths[] = { 0, 7, 42, 100, 12345, 4294967295u };
+  for (size_t i = 0; i < sizeof(content_lengths) / sizeof(content_lengths[0]); ++i) {
+    unique_ptr<HttpRequest> http_request
+    (new HttpRequest(HttpRequest::Method::GET, "/"));
+    http_request->set_content_length_field(content_lengths[i]);
+    ASSERT_EQ(http_request->get_content_length(), content_lengths[i]);
+  }
+}
+
+TEST(HttpMessage, set_date_field) {
+  for (;;) {
+    unique_ptr<HttpRequest> http_request
+    (new HttpRequest(HttpRequest::Method::GET, "/"));
+    DateTime now = DateTime::now();
+    http_request->set_date_field();
+    http_request->set_field("X-Date", now);
+    if (static_cast<time_t>(DateTime::now()) != static_cast<time_t>(now)) {
+      continue; // Crossed a second boundary
+    }
+
+    iovec date;
+    ASSERT_TRUE(http_request->get_field("Date", date));
+    ASSERT_EQ(date.iov_len, 29);
+    ASSERT_EQ(http_request->get_field("Date"), http_request->get_field("X-Date"));
+    break;
+  }
+}
+
+TEST(HttpMessage, set_field_date_time) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  http_request->set_field("Date", DateTime(static_cast<time_t>(816416724)));
+  ASSERT_EQ(http_request->get_field("Date"), "Wed, 15 Nov 1995 06:25:24 GMT");
+}
+
+TEST(HttpMessage, set_field_size_t) {
+  unique_ptr<HttpRequest> http_request
+  (new HttpRequest(HttpRequest::Method::GET, "/"));
+  http_request->set_field("X-Zero", static_cast<size_t>(0));
+  http_request->set_field("X-Number", static_cast<size_t>(1234567));
+  ASSERT_EQ(http_request->get_field("X-Zero"), "0");
+  ASSERT_EQ(http_request->get_field("X-Number"), "1234567");
+}
 }
 }
@@ -35,7 +35,9 @@
 
 namespace yield {
 namespace http {
+using ::std::make_shared;
 using ::std::move;
+using ::std::shared_ptr;
 using ::std::unique_ptr;
 
 class TestRequestParseCallbacks : public HttpRequestParser::ParseCallbacks {
@@ -44,12 +46,13 @@ public:
   handle_http_request(
     ::std::shared_ptr<Buffer> body,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     HttpRequest::Method method,
     const yield::uri::Uri& uri
   ) override {
-    http_request_.reset(new HttpRequest(body, fields_offset, header, http_version, method, uri));
+    http_request_.reset(new HttpRequest(body, fields_offset, field_index, header, http_version, method, uri));
   }
 
   void
@@ -63,12 +66,14 @@ public:
   void handle_http_message_body_chunk(::std::shared_ptr<Buffer> data) override {
   }
 
-  void read(::std::shared_ptr<Buffer>) override {
+  void read(::std::shared_ptr<Buffer> buffer) override {
+    read_buffer_ = buffer;
   }
 
 public:
   unique_ptr<HttpResponse> error_http_response_;
   unique_ptr<HttpRequest> http_request_;
+  ::std::shared_ptr<Buffer> read_buffer_;
 };
 
 
@@ -130,5 +135,142 @@ TEST(HttpRequestParser, WellFormedRequestLineOnly) {
   ASSERT_EQ(callbacks.http_request_->http_version(), 1);
   ASSERT_FALSE(callbacks.http_request_->body_buffer());
 }
+TEST(HttpRequestParser, WellFormedRequestPipelinedFields) {
+  HttpRequestParser
+  http_request_parser(
+    "GET / HTTP/1.1\r\nHost: first\r\n\r\n"
+    "GET / HTTP/1.1\r\nHost: second\r\nUser-Agent: test\r\n\r\n"
+  );
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->get_field("Host"), "first");
+
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->get_field("Host"), "second");
+  ASSERT_EQ(callbacks.http_request_->get_field("User-Agent"), "test");
+  ::std::vector< ::std::pair<iovec, iovec> > fields;
+  callbacks.http_request_->get_fields(fields);
+  ASSERT_EQ(fields.size(), 2u);
+}
+
+TEST(HttpRequestParser, WellFormedRequestSplit) {
+  shared_ptr<Buffer> buffer = make_shared<Buffer>(Buffer::getpagesize());
+  buffer->put("GET / HTTP/1.1\r\nHo");
+  HttpRequestParser http_request_parser(buffer);
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_FALSE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.read_buffer_, buffer);
+
+  buffer->put("st: localhost\r\n\r\n");
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->method(), HttpRequest::Method::GET);
+  ASSERT_EQ(callbacks.http_request_->get_field("Host"), "localhost");
+  ASSERT_FALSE(callbacks.error_http_response_);
+}
+
+TEST(HttpRequestParser, WellFormedRequestSplitBody) {
+  shared_ptr<Buffer> buffer = make_shared<Buffer>(Buffer::getpagesize());
+  buffer->put("POST / HTTP/1.1\r\nContent-Length: 10\r\n\r\n01234");
+  HttpRequestParser http_request_parser(buffer);
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_FALSE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.read_buffer_, buffer);
+
+  buffer->put("56789");
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->get_content_length(), 10);
+  shared_ptr<Buffer> body = callbacks.http_request_->body_buffer();
+  ASSERT_EQ(body->size(), 10u);
+  ASSERT_EQ(memcmp(*body, "0123456789", 10), 0);
+  // A view of the body in the buffer it was received into
+  ASSERT_EQ(static_cast<char*>(*body), static_cast<char*>(*buffer) + 39);
+}
+
+TEST(HttpRequestParser, WellFormedRequestSplitLargeBody) {
+  size_t content_length = Buffer::getpagesize() * 2;
+  shared_ptr<Buffer> buffer = make_shared<Buffer>(Buffer::getpagesize());
+  buffer->put("POST / HTTP/1.1\r\nContent-Length: ");
+  buffer->put(::std::to_string(content_length));
+  buffer->put("\r\n\r\n01234");
+  HttpRequestParser http_request_parser(buffer);
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_FALSE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_TRUE(callbacks.read_buffer_ != NULL);
+  ASSERT_NE(callbacks.read_buffer_, buffer);
+  ASSERT_GE(callbacks.read_buffer_->capacity(), content_length);
+  ASSERT_EQ(callbacks.read_buffer_->size(), 5u);
+
+  ::std::string rest(content_length - 5, 'x');
+  callbacks.read_buffer_->put(rest);
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->body_buffer(), callbacks.read_buffer_);
+  ASSERT_EQ(memcmp(*callbacks.read_buffer_, "01234xxx", 8), 0);
+}
+
+TEST(HttpRequestParser, WellFormedRequestSplitPipelined) {
+  shared_ptr<Buffer> buffer = make_shared<Buffer>(Buffer::getpagesize());
+  buffer->put("GET / HTTP/1.1\r\nHost: first\r\n\r\nGET /x HTTP/1.1\r\nHo");
+  HttpRequestParser http_request_parser(buffer);
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  unique_ptr<HttpRequest> first_http_request(move(callbacks.http_request_));
+
+  // The partial request stays in the buffer with room for the rest
+  http_request_parser.parse(callbacks);
+  ASSERT_FALSE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.read_buffer_, buffer);
+
+  buffer->put("st: second\r\n\r\n");
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->uri().get_path(), "/x");
+  ASSERT_EQ(callbacks.http_request_->get_field("Host"), "second");
+  ASSERT_EQ(first_http_request->get_field("Host"), "first");
+  ASSERT_EQ(callbacks.http_request_->header()->data(), buffer->data());
+  ASSERT_LT(first_http_request->header()->size(), buffer->size());
+}
+
+TEST(HttpRequestParser, WellFormedRequestSplitPipelinedFullBuffer) {
+  HttpRequestParser
+  http_request_parser("GET / HTTP/1.1\r\nHost: first\r\n\r\nGET /pa");
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  callbacks.http_request_.reset();
+
+  // The partial request moves to a new buffer, where parsing resumes.
+  http_request_parser.parse(callbacks);
+  ASSERT_FALSE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_TRUE(callbacks.read_buffer_ != NULL);
+  ASSERT_EQ(callbacks.read_buffer_->size(), 7u);
+
+  callbacks.read_buffer_->put("th HTTP/1.1\r\nHost: second\r\n\r\n");
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->uri().get_path(), "/path");
+  ASSERT_EQ(callbacks.http_request_->get_field("Host"), "second");
+}
+
+TEST(HttpRequestParser, WellFormedRequestSplitFullBuffer) {
+  HttpRequestParser http_request_parser("GET / HTTP/1.1\r\nHost: local");
+  TestRequestParseCallbacks callbacks;
+  http_request_parser.parse(callbacks);
+  ASSERT_FALSE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_TRUE(callbacks.read_buffer_ != NULL);
+
+  callbacks.read_buffer_->put("host\r\n\r\n");
+  http_request_parser.parse(callbacks);
+  ASSERT_TRUE(static_cast<bool>(callbacks.http_request_));
+  ASSERT_EQ(callbacks.http_request_->get_field("Host"), "localhost");
+}
 }
 }
@@ -50,6 +50,65 @@ TEST(HttpRequest, constructor) {
 //  );
 //}
 
+TEST(HttpRequest, get_byte_ranges) {
+  HttpRequest http_request(HttpRequest::Method::GET, "/");
+  ::std::vector<HttpRequest::ByteRange> byte_ranges;
+  ASSERT_FALSE(http_request.get_byte_ranges(100, byte_ranges));
+
+  http_request.set_field("Range", "bytes=0-9, 90-, -5,200-300");
+  ASSERT_TRUE(http_request.get_byte_ranges(100, byte_ranges));
+  ASSERT_EQ(byte_ranges.size(), 3u);
+  ASSERT_EQ(byte_ranges[0].first_byte_pos, 0u);
+  ASSERT_EQ(byte_ranges[0].last_byte_pos, 9u);
+  ASSERT_EQ(byte_ranges[1].first_byte_pos, 90u);
+  ASSERT_EQ(byte_ranges[1].last_byte_pos, 99u);
+  ASSERT_EQ(byte_ranges[2].first_byte_pos, 95u);
+  ASSERT_EQ(byte_ranges[2].last_byte_pos, 99u);
+}
+
+TEST(HttpRequest, get_byte_ranges_clipped) {
+  HttpRequest http_request(HttpRequest::Method::GET, "/");
+  http_request.set_field("Range", "BYTES=50-1000,-1000");
+  ::std::vector<HttpRequest::ByteRange> byte_ranges;
+  ASSERT_TRUE(http_request.get_byte_ranges(100, byte_ranges));
+  ASSERT_EQ(byte_ranges.size(), 2u);
+  ASSERT_EQ(byte_ranges[0].first_byte_pos, 50u);
+  ASSERT_EQ(byte_ranges[0].last_byte_pos, 99u);
+  ASSERT_EQ(byte_ranges[1].first_byte_pos, 0u);
+  ASSERT_EQ(byte_ranges[1].last_byte_pos, 99u);
+}
+
+TEST(HttpRequest, get_byte_ranges_malformed) {
+  const char* ranges[] = {
+    "bytes=",
+    "bytes=a-b",
+    "bytes=5-4",
+    "bytes=-",
+    "bytes=0-1;",
+    "lines=0-1",
+    "bytes=99999999999999999999-",
+    "bytes=0-0,1-1,2-2,3-3,4-4,5-5,6-6,7-7,8-8,9-9,10-10,11-11,12-12,13-13,"
+    "14-14,15-15,16-16",
+    NULL
+  };
+
+  for (const char** range = ranges; *range != NULL; ++range) {
+    HttpRequest http_request(HttpRequest::Method::GET, "/");
+    http_request.set_field("Range", *range);
+    ::std::vector<HttpRequest::ByteRange> byte_ranges;
+    ASSERT_FALSE(http_request.get_byte_ranges(100, byte_ranges)) << *range;
+    ASSERT_TRUE(byte_ranges.empty());
+  }
+}
+
+TEST(HttpRequest, get_byte_ranges_unsatisfiable) {
+  HttpRequest http_request(HttpRequest::Method::GET, "/");
+  http_request.set_field("Range", "bytes=100-,-0");
+  ::std::vector<HttpRequest::ByteRange> byte_ranges;
+  ASSERT_TRUE(http_request.get_byte_ranges(100, byte_ranges));
+  ASSERT_TRUE(byte_ranges.empty());
+}
+
 TEST(HttpRequest, method) {
   ASSERT_EQ(
     HttpRequest(HttpRequest::Method::GET, "/").method(),
@@ -55,11 +55,12 @@ public:
   handle_http_response(
     ::std::shared_ptr<Buffer> body,
     uint16_t fields_offset,
+    const HttpMessageFieldIndex& field_index,
     ::std::shared_ptr<Buffer> header,
     uint8_t http_version,
     uint16_t status_code
   ) override {
-    http_response_.reset(new HttpResponse(body, fields_offset, header, http_version, status_code));
+    http_response_.reset(new HttpResponse(body, fields_offset, field_index, header, http_version, status_code));
   }
 
   void read(::std::shared_ptr<Buffer>) override {
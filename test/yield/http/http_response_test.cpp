@@ -28,6 +28,7 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "yield/buffer.hpp"
+#include "yield/date_time.hpp"
 #include "yield/http/http_response.hpp"
 #include "gtest/gtest.h"
 
@@ -37,6 +38,13 @@ TEST(HttpResponse, constructor) {
   HttpResponse(1, 404, Buffer::copy("test"));
 }
 
+TEST(HttpResponse, date_field) {
+  HttpResponse http_response(1, 200);
+  ASSERT_NE(http_response.get_date_field(), DateTime::INVALID_DATE_TIME);
+  http_response.set_content_length_field(4);
+  ASSERT_EQ(http_response.get_content_length(), 4u);
+}
+
 TEST(HttpResponse, status_code) {
   ASSERT_EQ(HttpResponse(1, 200).status_code(), 200);
   ASSERT_EQ(HttpResponse(1, 404).status_code(), 404);
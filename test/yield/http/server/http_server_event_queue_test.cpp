@@ -32,19 +32,33 @@
 #include "yield/fs/file_system.hpp"
 #include "yield/fs/stat.hpp"
 #include "yield/http/http_response.hpp"
+#include "yield/http/server/http_server_message_body_chunk.hpp"
 #include "yield/http/server/http_server_request.hpp"
 #include "yield/http/server/http_server_event_queue.hpp"
+#include "yield/sockets/socket_address.hpp"
+#include "yield/sockets/tcp_socket.hpp"
+#ifdef YIELD_HAVE_OPENSSL
+#include "../../sockets/ssl/test_pem_certificate.hpp"
+#include "../../sockets/ssl/test_pem_private_key.hpp"
+#include "yield/sockets/ssl/ssl_socket.hpp"
+#endif
 #include "gtest/gtest.h"
 
+#include <cstring>
+#include <string>
+
 namespace yield {
 namespace http {
 namespace server {
+using ::std::make_shared;
 using ::std::move;
 using ::std::shared_ptr;
 using ::std::unique_ptr;
 using ::yield::fs::File;
 using ::yield::fs::FileSystem;
 using ::yield::fs::Stat;
+using ::yield::sockets::SocketAddress;
+using ::yield::sockets::TcpSocket;
 
 class TestHttpServerEventQueue : public HttpServerEventQueue {
 public:
@@ -99,6 +113,252 @@ TEST_F(HttpServerEventQueueTest, dequeue) {
     }
   }
 }
+TEST_F(HttpServerEventQueueTest, timeout) {
+  HttpServerEventQueue http_server_event_queue(
+    SocketAddress(SocketAddress::IN_LOOPBACK, 0)
+  );
+  http_server_event_queue.set_keep_alive_timeout(0.5);
+  http_server_event_queue.set_request_timeout(0.5);
+  unique_ptr<SocketAddress> sockname = http_server_event_queue.sockname();
+
+  // A client that never finishes its request, and one that goes idle
+  // after a request.
+  TcpSocket slow_socket(TcpSocket::DOMAIN_DEFAULT);
+  ASSERT_TRUE(slow_socket.connect(*sockname));
+  ASSERT_EQ(slow_socket.send("GET / HTTP/1.1\r\n", 16, 0), 16);
+  ASSERT_TRUE(slow_socket.set_blocking_mode(false));
+
+  TcpSocket idle_socket(TcpSocket::DOMAIN_DEFAULT);
+  ASSERT_TRUE(idle_socket.connect(*sockname));
+  const char* request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(
+    idle_socket.send(request, strlen(request), 0),
+    static_cast<ssize_t>(strlen(request))
+  );
+  ASSERT_TRUE(idle_socket.set_blocking_mode(false));
+
+  bool slow_socket_closed = false, idle_socket_closed = false;
+  ::std::string idle_socket_response;
+  Time start_time = Time::now();
+  while (
+    (!slow_socket_closed || !idle_socket_closed)
+    &&
+    Time::now() - start_time < Time(10.0)
+  ) {
+    unique_ptr<HttpServerEvent> http_request
+      = http_server_event_queue.timeddequeue(0.05);
+    if (http_request != NULL) {
+      handle(unique_ptr<HttpServerRequest>(static_cast<HttpServerRequest*>(http_request.release())));
+    }
+
+    char response[512];
+    if (!slow_socket_closed) {
+      slow_socket_closed = slow_socket.recv(response, sizeof(response), 0) == 0;
+    }
+    if (!idle_socket_closed) {
+      ssize_t response_len = idle_socket.recv(response, sizeof(response), 0);
+      if (response_len > 0) {
+        idle_socket_response.append(response, static_cast<size_t>(response_len));
+      } else if (response_len == 0) {
+        idle_socket_closed = true;
+      }
+    }
+  }
+
+  ASSERT_TRUE(slow_socket_closed);
+  ASSERT_TRUE(idle_socket_closed);
+  ASSERT_EQ(idle_socket_response.compare(0, 12, "HTTP/1.1 200"), 0);
+}
+
+TEST_F(HttpServerEventQueueTest, chunked_pipelined) {
+  HttpServerEventQueue http_server_event_queue(
+    SocketAddress(SocketAddress::IN_LOOPBACK, 0)
+  );
+
+  TcpSocket client_socket(TcpSocket::DOMAIN_DEFAULT);
+  ASSERT_TRUE(client_socket.connect(*http_server_event_queue.sockname()));
+  const char* requests
+    = "GET /a HTTP/1.1\r\nHost: localhost\r\n\r\n"
+      "GET /b HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(
+    client_socket.send(requests, strlen(requests), 0),
+    static_cast<ssize_t>(strlen(requests))
+  );
+  ASSERT_TRUE(client_socket.set_blocking_mode(false));
+
+  unique_ptr<HttpServerRequest> http_requests[2];
+  for (size_t http_request_i = 0; http_request_i < 2;) {
+    unique_ptr<HttpServerEvent> http_request
+      = http_server_event_queue.timeddequeue(10.0);
+    ASSERT_TRUE(http_request != NULL);
+    http_requests[http_request_i++].reset(static_cast<HttpServerRequest*>(http_request.release()));
+  }
+
+  // Answer the second request first, then stream the first.
+  http_requests[1]->respond(200, "b");
+  unique_ptr<HttpServerResponse> http_response(
+    new HttpServerResponse(http_requests[0]->http_version(), 200)
+  );
+  http_response->set_field("Transfer-Encoding", "chunked");
+  http_requests[0]->respond(move(http_response));
+  http_requests[0]->respond(
+    unique_ptr<HttpServerMessageBodyChunk>(
+      new HttpServerMessageBodyChunk(
+        shared_ptr<HttpServerConnection>(),
+        Buffer::copy("1\r\na\r\n")
+      )
+    )
+  );
+  http_requests[0]->respond(
+    unique_ptr<HttpServerMessageBodyChunk>(
+      new HttpServerMessageBodyChunk(
+        shared_ptr<HttpServerConnection>(),
+        shared_ptr<Buffer>()
+      )
+    )
+  );
+
+  ::std::string responses;
+  Time start_time = Time::now();
+  while (
+    responses.find("\r\n\r\nb") == ::std::string::npos
+    &&
+    Time::now() - start_time < Time(10.0)
+  ) {
+    http_server_event_queue.timeddequeue(0.01);
+    char response[512];
+    ssize_t response_len = client_socket.recv(response, sizeof(response), 0);
+    if (response_len > 0) {
+      responses.append(response, static_cast<size_t>(response_len));
+    }
+  }
+
+  // The chunks follow their own header, and precede the next response.
+  size_t chunk_i = responses.find("\r\n\r\n1\r\na\r\n0\r\n\r\n");
+  ASSERT_NE(chunk_i, ::std::string::npos);
+  ASSERT_EQ(responses.find("HTTP/1.1 200"), 0u);
+  ASSERT_GT(responses.find("HTTP/1.1 200", 1), chunk_i);
+  ASSERT_NE(responses.find("\r\n\r\nb"), ::std::string::npos);
+}
+
+TEST_F(HttpServerEventQueueTest, half_close) {
+  HttpServerEventQueue http_server_event_queue(
+    SocketAddress(SocketAddress::IN_LOOPBACK, 0)
+  );
+
+  TcpSocket client_socket(TcpSocket::DOMAIN_DEFAULT);
+  ASSERT_TRUE(client_socket.connect(*http_server_event_queue.sockname()));
+  const char* requests
+    = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n"
+      "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(
+    client_socket.send(requests, strlen(requests), 0),
+    static_cast<ssize_t>(strlen(requests))
+  );
+  ASSERT_TRUE(client_socket.shutdown(false, true));
+  ASSERT_TRUE(client_socket.set_blocking_mode(false));
+
+  unique_ptr<HttpServerRequest> http_requests[2];
+  for (size_t http_request_i = 0; http_request_i < 2;) {
+    unique_ptr<HttpServerEvent> http_request
+      = http_server_event_queue.timeddequeue(10.0);
+    ASSERT_TRUE(http_request != NULL);
+    http_requests[http_request_i++].reset(static_cast<HttpServerRequest*>(http_request.release()));
+  }
+
+  // Let the server see the end of the requests before responding.
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(http_server_event_queue.timeddequeue(0.01) == NULL);
+  }
+
+  handle(move(http_requests[0]));
+  handle(move(http_requests[1]));
+
+  bool client_socket_closed = false;
+  ::std::string responses;
+  Time start_time = Time::now();
+  while (!client_socket_closed && Time::now() - start_time < Time(10.0)) {
+    http_server_event_queue.timeddequeue(0.01);
+    char response[512];
+    ssize_t response_len = client_socket.recv(response, sizeof(response), 0);
+    if (response_len > 0) {
+      responses.append(response, static_cast<size_t>(response_len));
+    } else if (response_len == 0) {
+      client_socket_closed = true;
+    }
+  }
+
+  // Both responses are sent before the server closes the connection.
+  ASSERT_TRUE(client_socket_closed);
+  size_t second_response_i = responses.find("HTTP/1.1 200", 1);
+  ASSERT_EQ(responses.find("HTTP/1.1 200"), 0u);
+  ASSERT_NE(second_response_i, ::std::string::npos);
+  ASSERT_NE(responses.find("Hello world", second_response_i), ::std::string::npos);
+}
+
+#ifdef YIELD_HAVE_OPENSSL
+TEST_F(HttpServerEventQueueTest, ssl) {
+  using ::yield::sockets::aio::SocketAioQueue;
+  using ::yield::sockets::ssl::SslContext;
+  using ::yield::sockets::ssl::SslSocket;
+
+  SocketAddress sockname(SocketAddress::IN_LOOPBACK, 0);
+  HttpServerEventQueue http_server_event_queue(
+    unique_ptr<TcpSocket>(
+      new SslSocket(
+        make_shared<SslContext>(
+          ::yield::sockets::ssl::TEST_PEM_CERTIFICATE,
+          ::yield::sockets::ssl::TEST_PEM_PRIVATE_KEY,
+          ::yield::sockets::ssl::TEST_PEM_PRIVATE_KEY_PASSPHRASE
+        ),
+        sockname.get_family()
+      )
+    ),
+    sockname,
+    false,
+    SocketAioQueue::Implementation::NBIO
+  );
+
+  // The client is non-blocking too, so that both ends of the handshake can
+  // make progress on this thread.
+  SslSocket client_socket(sockname.get_family());
+  ASSERT_TRUE(client_socket.connect(*http_server_event_queue.sockname()));
+  ASSERT_TRUE(client_socket.set_blocking_mode(false));
+
+  const char* request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  bool request_sent = false;
+  ::std::string response;
+  Time start_time = Time::now();
+  while (
+    response.find("Hello world") == ::std::string::npos
+    &&
+    Time::now() - start_time < Time(10.0)
+  ) {
+    unique_ptr<HttpServerEvent> http_request
+      = http_server_event_queue.timeddequeue(0.01);
+    if (http_request != NULL) {
+      handle(unique_ptr<HttpServerRequest>(static_cast<HttpServerRequest*>(http_request.release())));
+    }
+
+    ssize_t ret;
+    if (!request_sent) {
+      ret = client_socket.send(request, strlen(request), 0);
+      request_sent = ret == static_cast<ssize_t>(strlen(request));
+    } else {
+      char response_part[512];
+      ret = client_socket.recv(response_part, sizeof(response_part), 0);
+      if (ret > 0) {
+        response.append(response_part, static_cast<size_t>(ret));
+      }
+    }
+    ASSERT_TRUE(
+      ret > 0 || client_socket.want_recv() || client_socket.want_send()
+    );
+  }
+
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 200"), 0);
+}
+#endif
 }
 }
 }
@@ -0,0 +1,145 @@
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "yield/event_handler.hpp"
+#include "yield/http/server/http_server_request.hpp"
+#include "yield/http/server/sharded_http_server.hpp"
+#include "yield/sockets/socket_address.hpp"
+#include "yield/sockets/stream_socket.hpp"
+#include "yield/sockets/tcp_socket.hpp"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+
+namespace yield {
+namespace http {
+namespace server {
+using ::std::make_shared;
+using ::std::unique_ptr;
+using ::yield::sockets::SocketAddress;
+using ::yield::sockets::TcpSocket;
+
+class HelloWorldHttpServerEventHandler : public EventHandler<HttpServerEvent> {
+public:
+  // yield::EventHandler
+  void handle(unique_ptr<HttpServerEvent> event) override {
+    if (event->type() == HttpServerEvent::Type::REQUEST) {
+      static_cast<HttpServerRequest&>(*event).respond(200, "Hello world");
+    }
+  }
+};
+
+TEST(ShardedHttpServer, constructor) {
+  ShardedHttpServer http_server(
+    make_shared<HelloWorldHttpServerEventHandler>(),
+    SocketAddress(SocketAddress::IN_LOOPBACK, 0),
+    2
+  );
+  ASSERT_EQ(http_server.shard_count(), 2u);
+  ::std::string nodename;
+  uint16_t port = 0;
+  ASSERT_TRUE(http_server.sockname()->getnameinfo(nodename, &port));
+  ASSERT_NE(port, 0);
+}
+
+TEST(ShardedHttpServer, pipeline) {
+  ShardedHttpServer http_server(
+    make_shared<HelloWorldHttpServerEventHandler>(),
+    SocketAddress(SocketAddress::IN_LOOPBACK, 0),
+    1
+  );
+  unique_ptr<SocketAddress> sockname = http_server.sockname();
+
+  TcpSocket socket_(TcpSocket::DOMAIN_DEFAULT);
+  if (!socket_.connect(*sockname)) {
+    throw Exception();
+  }
+
+  // Two rounds on the same connection: the connection is kept alive.
+  for (uint8_t round_i = 0; round_i < 2; ++round_i) {
+    ::std::string requests;
+    for (uint8_t request_i = 0; request_i < 4; ++request_i) {
+      requests.append("GET / HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    }
+    ASSERT_EQ(
+      socket_.send(requests.data(), requests.size(), 0),
+      static_cast<ssize_t>(requests.size())
+    );
+
+    ::std::string responses;
+    size_t response_count = 0;
+    while (response_count < 4) {
+      char response[1024];
+      ssize_t response_len = socket_.recv(response, sizeof(response), 0);
+      ASSERT_GT(response_len, 0);
+      responses.append(response, static_cast<size_t>(response_len));
+
+      response_count = 0;
+      for (
+        size_t response_offset = responses.find("HTTP/1.1 200");
+        response_offset != ::std::string::npos;
+        response_offset = responses.find("HTTP/1.1 200", response_offset + 1)
+      ) {
+        ++response_count;
+      }
+    }
+    ASSERT_EQ(response_count, 4u);
+  }
+}
+
+TEST(ShardedHttpServer, respond) {
+  ShardedHttpServer http_server(
+    make_shared<HelloWorldHttpServerEventHandler>(),
+    SocketAddress(SocketAddress::IN_LOOPBACK, 0),
+    2
+  );
+  unique_ptr<SocketAddress> sockname = http_server.sockname();
+
+  for (uint8_t connection_i = 0; connection_i < 8; ++connection_i) {
+    TcpSocket socket_(TcpSocket::DOMAIN_DEFAULT);
+    if (!socket_.connect(*sockname)) {
+      throw Exception();
+    }
+
+    const char* request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    ASSERT_EQ(
+      socket_.send(request, strlen(request), 0),
+      static_cast<ssize_t>(strlen(request))
+    );
+
+    char response[512];
+    ssize_t response_len = socket_.recv(response, sizeof(response) - 1, 0);
+    ASSERT_GT(response_len, 0);
+    response[response_len] = 0;
+    ASSERT_EQ(strncmp(response, "HTTP/1.1 200", 12), 0);
+  }
+}
+}
+}
+}
@@ -0,0 +1,245 @@
+// static_file_request_handler_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/fs/file.hpp"
+#include "yield/fs/file_system.hpp"
+#include "yield/http/server/sharded_http_server.hpp"
+#include "yield/http/server/static_file_request_handler.hpp"
+#include "yield/sockets/socket_address.hpp"
+#include "yield/sockets/tcp_socket.hpp"
+#include "yield/thread/thread.hpp"
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace yield {
+namespace http {
+namespace server {
+using ::std::make_shared;
+using ::std::shared_ptr;
+using ::std::string;
+using ::std::unique_ptr;
+using ::yield::fs::File;
+using ::yield::fs::FileSystem;
+using ::yield::sockets::SocketAddress;
+using ::yield::sockets::TcpSocket;
+using ::yield::thread::Thread;
+
+class StaticFileRequestHandlerTest : public ::testing::Test {
+protected:
+  StaticFileRequestHandlerTest()
+    : test_file_name_("static_file_request_handler_test.txt") {
+  }
+
+  void SetUp() {
+    write_test_file("static");
+    static_file_request_handler_
+      = make_shared<StaticFileRequestHandler>(".", 1);
+    http_server_.reset(
+      new ShardedHttpServer(
+        static_file_request_handler_,
+        SocketAddress(SocketAddress::IN_LOOPBACK, 0),
+        1
+      )
+    );
+    socket_.reset(new TcpSocket(TcpSocket::DOMAIN_DEFAULT));
+    ASSERT_TRUE(socket_->connect(*http_server_->sockname()));
+  }
+
+  void TearDown() {
+    socket_.reset();
+    http_server_.reset();
+    static_file_request_handler_.reset();
+    FileSystem().unlink(test_file_name_);
+  }
+
+  // Send a request and return its response, header and body
+  string request(const string& request_line, const string& fields = "") {
+    string request_ = request_line + "\r\nHost: localhost\r\n" + fields + "\r\n";
+    if (
+      socket_->send(request_.data(), request_.size(), 0)
+      !=
+      static_cast<ssize_t>(request_.size())
+    ) {
+      return string();
+    }
+
+    string response;
+    for (;;) {
+      size_t header_end = response.find("\r\n\r\n");
+      if (header_end != string::npos) {
+        size_t content_length = 0;
+        size_t content_length_i = response.find("Content-Length: ");
+        if (
+          content_length_i != string::npos
+          &&
+          content_length_i < header_end
+          &&
+          request_line.compare(0, 5, "HEAD ") != 0
+        ) {
+          content_length
+            = static_cast<size_t>(atoi(response.c_str() + content_length_i + 16));
+        }
+        if (response.size() >= header_end + 4 + content_length) {
+          return response;
+        }
+      }
+
+      char data[1024];
+      ssize_t data_len = socket_->recv(data, sizeof(data), 0);
+      if (data_len <= 0) {
+        return response;
+      }
+      response.append(data, static_cast<size_t>(data_len));
+    }
+  }
+
+  static string get_field(const string& response, const string& name) {
+    size_t field_i = response.find("\r\n" + name + ": ");
+    if (field_i == string::npos) {
+      return string();
+    }
+    field_i += 4 + name.size();
+    return response.substr(field_i, response.find("\r\n", field_i) - field_i);
+  }
+
+  void write_test_file(const string& data) {
+    unique_ptr<File> file = FileSystem().creat(test_file_name_);
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(file->write(data.data(), data.size()), static_cast<ssize_t>(data.size()));
+  }
+
+protected:
+  unique_ptr<ShardedHttpServer> http_server_;
+  unique_ptr<TcpSocket> socket_;
+  shared_ptr<StaticFileRequestHandler> static_file_request_handler_;
+  string test_file_name_;
+};
+
+TEST_F(StaticFileRequestHandlerTest, get) {
+  string response = request("GET /" + test_file_name_ + " HTTP/1.1");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 200"), 0);
+  ASSERT_EQ(response.substr(response.size() - 6), "static");
+  ASSERT_EQ(get_field(response, "Content-Length"), "6");
+  ASSERT_FALSE(get_field(response, "ETag").empty());
+  ASSERT_EQ(get_field(response, "Last-Modified").size(), 29u);
+  ASSERT_EQ(static_file_request_handler_->cache_size(), 1u);
+
+  // Served from the cache
+  response = request("GET /" + test_file_name_ + " HTTP/1.1");
+  ASSERT_EQ(response.substr(response.size() - 6), "static");
+}
+
+TEST_F(StaticFileRequestHandlerTest, get_errors) {
+  ASSERT_EQ(request("GET /nonexistent HTTP/1.1").compare(0, 12, "HTTP/1.1 404"), 0);
+  ASSERT_EQ(request("GET /../" + test_file_name_ + " HTTP/1.1").compare(0, 12, "HTTP/1.1 403"), 0);
+  ASSERT_EQ(request("DELETE /" + test_file_name_ + " HTTP/1.1").compare(0, 12, "HTTP/1.1 405"), 0);
+}
+
+TEST_F(StaticFileRequestHandlerTest, get_invalidated) {
+  string response = request("GET /" + test_file_name_ + " HTTP/1.1");
+  ASSERT_EQ(response.substr(response.size() - 6), "static");
+
+  write_test_file("changed!");
+  Thread::sleep(StaticFileRequestHandler::FS_EVENTS_POLL_INTERVAL_DEFAULT);
+  response = request("GET /" + test_file_name_ + " HTTP/1.1");
+  ASSERT_EQ(get_field(response, "Content-Length"), "8");
+  ASSERT_EQ(response.substr(response.size() - 8), "changed!");
+}
+
+TEST_F(StaticFileRequestHandlerTest, get_not_modified) {
+  string response = request("GET /" + test_file_name_ + " HTTP/1.1");
+  string etag = get_field(response, "ETag");
+  string last_modified = get_field(response, "Last-Modified");
+
+  response = request("GET /" + test_file_name_ + " HTTP/1.1", "If-None-Match: " + etag + "\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 304"), 0);
+  ASSERT_EQ(get_field(response, "ETag"), etag);
+
+  response = request("GET /" + test_file_name_ + " HTTP/1.1", "If-Modified-Since: " + last_modified + "\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 304"), 0);
+
+  response = request("GET /" + test_file_name_ + " HTTP/1.1", "If-None-Match: \"other\"\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 200"), 0);
+}
+
+TEST_F(StaticFileRequestHandlerTest, get_range) {
+  string response = request("GET /" + test_file_name_ + " HTTP/1.1", "Range: bytes=1-3\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 206"), 0);
+  ASSERT_EQ(get_field(response, "Content-Range"), "bytes 1-3/6");
+  ASSERT_EQ(get_field(response, "Content-Length"), "3");
+  ASSERT_EQ(response.substr(response.size() - 7), "\r\n\r\ntat");
+
+  response = request("GET /" + test_file_name_ + " HTTP/1.1", "Range: bytes=-2\r\n");
+  ASSERT_EQ(get_field(response, "Content-Range"), "bytes 4-5/6");
+  ASSERT_EQ(response.substr(response.size() - 6), "\r\n\r\nic");
+
+  // A stale If-Range gets the whole file
+  response = request("GET /" + test_file_name_ + " HTTP/1.1", "Range: bytes=1-3\r\nIf-Range: \"other\"\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 200"), 0);
+  ASSERT_EQ(response.substr(response.size() - 6), "static");
+}
+
+TEST_F(StaticFileRequestHandlerTest, get_ranges) {
+  string response = request("GET /" + test_file_name_ + " HTTP/1.1", "Range: bytes=0-1,4-\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 206"), 0);
+  string content_type = get_field(response, "Content-Type");
+  ASSERT_EQ(content_type.compare(0, 31, "multipart/byteranges; boundary="), 0);
+  string boundary = content_type.substr(31);
+
+  string body = response.substr(response.find("\r\n\r\n") + 4);
+  ASSERT_EQ(
+    body,
+    "\r\n--" + boundary + "\r\nContent-Range: bytes 0-1/6\r\n\r\nst"
+    "\r\n--" + boundary + "\r\nContent-Range: bytes 4-5/6\r\n\r\nic"
+    "\r\n--" + boundary + "--\r\n"
+  );
+
+  // The connection is still in sync afterwards
+  response = request("GET /" + test_file_name_ + " HTTP/1.1");
+  ASSERT_EQ(response.substr(response.size() - 6), "static");
+}
+
+TEST_F(StaticFileRequestHandlerTest, get_range_not_satisfiable) {
+  string response = request("GET /" + test_file_name_ + " HTTP/1.1", "Range: bytes=6-\r\n");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 416"), 0);
+  ASSERT_EQ(get_field(response, "Content-Range"), "bytes */6");
+}
+
+TEST_F(StaticFileRequestHandlerTest, head) {
+  string response = request("HEAD /" + test_file_name_ + " HTTP/1.1");
+  ASSERT_EQ(response.compare(0, 12, "HTTP/1.1 200"), 0);
+  ASSERT_EQ(get_field(response, "Content-Length"), "6");
+  ASSERT_EQ(response.substr(response.size() - 4), "\r\n\r\n");
+}
+}
+}
+}
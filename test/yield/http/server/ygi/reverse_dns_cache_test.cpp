@@ -0,0 +1,94 @@
+// reverse_dns_cache_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/http/server/ygi/reverse_dns_cache.hpp"
+#include "yield/thread/thread.hpp"
+#include "gtest/gtest.h"
+
+namespace yield {
+namespace http {
+namespace server {
+namespace ygi {
+using ::std::string;
+using ::yield::sockets::SocketAddress;
+using ::yield::thread::Thread;
+
+TEST(ReverseDnsCache, evict) {
+  ReverseDnsCache reverse_dns_cache(2);
+  string remote_host;
+  for (uint32_t ip = 0x7f000001; ip < 0x7f000004; ++ip) {
+    SocketAddress peername(ip, 0);
+    string remote_addr;
+    ASSERT_TRUE(peername.ntop(remote_addr));
+    reverse_dns_cache.get(peername, remote_addr, remote_host);
+  }
+  ASSERT_EQ(reverse_dns_cache.size(), 2u);
+}
+
+TEST(ReverseDnsCache, get) {
+  ReverseDnsCache reverse_dns_cache;
+  SocketAddress peername(static_cast<uint32_t>(0x7f000001), 0);
+  string remote_addr;
+  ASSERT_TRUE(peername.ntop(remote_addr));
+
+  // The first get queues the lookup and returns at once
+  string remote_host;
+  ASSERT_FALSE(reverse_dns_cache.get(peername, remote_addr, remote_host));
+  ASSERT_EQ(reverse_dns_cache.size(), 1u);
+
+  // 127.0.0.1 may or may not have a name, but the resolver fills the entry
+  // in either way
+  bool resolved = false;
+  for (uint8_t try_i = 0; try_i < 100 && !resolved; ++try_i) {
+    resolved = reverse_dns_cache.get(peername, remote_addr, remote_host);
+    if (!resolved) {
+      Thread::sleep(0.05);
+    }
+  }
+  ASSERT_TRUE(resolved);
+  ASSERT_EQ(reverse_dns_cache.size(), 1u);
+}
+
+TEST(ReverseDnsCache, get_expired) {
+  ReverseDnsCache reverse_dns_cache(ReverseDnsCache::CAPACITY_DEFAULT, 0.0);
+  SocketAddress peername(static_cast<uint32_t>(0x7f000001), 0);
+  string remote_addr, remote_host;
+  ASSERT_TRUE(peername.ntop(remote_addr));
+
+  // Every entry has expired by the time it is looked at
+  for (uint8_t try_i = 0; try_i < 10; ++try_i) {
+    ASSERT_FALSE(reverse_dns_cache.get(peername, remote_addr, remote_host));
+    Thread::sleep(0.01);
+  }
+  ASSERT_EQ(reverse_dns_cache.size(), 1u);
+}
+}
+}
+}
+}
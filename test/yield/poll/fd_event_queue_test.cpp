@@ -187,6 +187,127 @@ TEST_F(FdEventQueueTest, dequeue_writable_FdEvent) {
   ASSERT_EQ(fd_event->type(), FdEvent::TYPE_WRITE_READY);
 }
 
+TEST_F(FdEventQueueTest, dequeue_batch) {
+  FdEventQueue fd_event_queue(false, 8);
+
+  if (!fd_event_queue.associate(get_read_fd(), FdEvent::TYPE_READ_READY)) {
+    throw Exception();
+  }
+
+  if (!fd_event_queue.associate(get_write_fd(), FdEvent::TYPE_WRITE_READY)) {
+    throw Exception();
+  }
+
+  signal_pipe();
+
+  const FdEvent* fd_events;
+  size_t fd_events_len = fd_event_queue.dequeue_batch(Time::FOREVER, fd_events);
+  ASSERT_EQ(fd_events_len, 2u);
+  for (size_t fd_event_i = 0; fd_event_i < fd_events_len; ++fd_event_i) {
+    if (fd_events[fd_event_i].fd() == get_read_fd()) {
+      ASSERT_EQ(fd_events[fd_event_i].type(), FdEvent::TYPE_READ_READY);
+    } else {
+      ASSERT_EQ(fd_events[fd_event_i].fd(), get_write_fd());
+      ASSERT_EQ(fd_events[fd_event_i].type(), FdEvent::TYPE_WRITE_READY);
+    }
+  }
+}
+
+TEST_F(FdEventQueueTest, dequeue_batched_dissociate) {
+  FdEventQueue fd_event_queue(false, 8);
+
+  if (!fd_event_queue.associate(get_read_fd(), FdEvent::TYPE_READ_READY)) {
+    throw Exception();
+  }
+
+  if (!fd_event_queue.associate(get_write_fd(), FdEvent::TYPE_WRITE_READY)) {
+    throw Exception();
+  }
+
+  signal_pipe();
+
+  // Both events are harvested by the first wait; the second is buffered
+  shared_ptr<FdEvent> fd_event = fd_event_queue.dequeue();
+  ASSERT_TRUE(static_cast<bool>(fd_event));
+
+  fd_t other_fd
+  = fd_event->fd() == get_read_fd() ? get_write_fd() : get_read_fd();
+  if (!fd_event_queue.dissociate(other_fd)) {
+    throw Exception();
+  }
+  if (!fd_event_queue.dissociate(fd_event->fd())) {
+    throw Exception();
+  }
+
+  ASSERT_FALSE(fd_event_queue.trydequeue());
+}
+
+#if defined(__linux__) || defined(__MACH__) || defined(__FreeBSD__)
+TEST_F(FdEventQueueTest, dequeue_edge_FdEvent) {
+  FdEventQueue fd_event_queue;
+
+  if (
+    !fd_event_queue.associate(
+      get_read_fd(),
+      FdEvent::TYPE_READ_READY,
+      FdEventQueue::Trigger::EDGE
+    )
+  ) {
+    throw Exception();
+  }
+
+  signal_pipe();
+  shared_ptr<FdEvent> fd_event = fd_event_queue.dequeue();
+  ASSERT_TRUE(fd_event != NULL);
+  ASSERT_EQ(fd_event->fd(), get_read_fd());
+
+  // Still readable, but no new edge
+  ASSERT_FALSE(fd_event_queue.trydequeue());
+
+  signal_pipe();
+  fd_event = fd_event_queue.dequeue();
+  ASSERT_TRUE(fd_event != NULL);
+  ASSERT_EQ(fd_event->fd(), get_read_fd());
+}
+
+TEST_F(FdEventQueueTest, dequeue_oneshot_FdEvent) {
+  FdEventQueue fd_event_queue;
+
+  if (
+    !fd_event_queue.associate(
+      get_read_fd(),
+      FdEvent::TYPE_READ_READY,
+      FdEventQueue::Trigger::ONESHOT
+    )
+  ) {
+    throw Exception();
+  }
+
+  signal_pipe();
+  shared_ptr<FdEvent> fd_event = fd_event_queue.dequeue();
+  ASSERT_TRUE(fd_event != NULL);
+  ASSERT_EQ(fd_event->fd(), get_read_fd());
+
+  // Disarmed until associated again
+  signal_pipe();
+  ASSERT_FALSE(fd_event_queue.trydequeue());
+
+  if (
+    !fd_event_queue.associate(
+      get_read_fd(),
+      FdEvent::TYPE_READ_READY,
+      FdEventQueue::Trigger::ONESHOT
+    )
+  ) {
+    throw Exception();
+  }
+
+  fd_event = fd_event_queue.dequeue();
+  ASSERT_TRUE(fd_event != NULL);
+  ASSERT_EQ(fd_event->fd(), get_read_fd());
+}
+#endif
+
 TEST(FdEventQueue, destructor) {
   FdEventQueue();
 }
@@ -36,6 +36,7 @@
 namespace yield {
 using ::std::move;
 using ::std::unique_ptr;
+using ::std::vector;
 
 template <class TypeParam>
 class EventQueueTest : public ::testing::Test {
@@ -59,6 +60,28 @@ TYPED_TEST_P(EventQueueTest, dequeue) {
   ASSERT_FALSE(static_cast<EventQueue<TestEvent>&>(event_queue).trydequeue());
 }
 
+TYPED_TEST_P(EventQueueTest, dequeue_batch) {
+  TypeParam event_queue;
+  for (int event_i = 0; event_i < 3; ++event_i) {
+    ASSERT_FALSE(event_queue.tryenqueue(unique_ptr<TestEvent>(new TestEvent)));
+  }
+
+  vector< unique_ptr<TestEvent> > events;
+  ASSERT_EQ(event_queue.dequeue_batch(1.0, 2, events), 2u);
+  ASSERT_EQ(events.size(), 2u);
+  ASSERT_TRUE(events[0] != NULL);
+  ASSERT_TRUE(events[1] != NULL);
+
+  ASSERT_EQ(event_queue.dequeue_batch(Time::FOREVER, 2, events), 1u);
+  ASSERT_EQ(events.size(), 3u);
+  ASSERT_TRUE(events[2] != NULL);
+
+  ASSERT_EQ(event_queue.dequeue_batch(0.01, 2, events), 0u);
+  event_queue.wake();
+  ASSERT_EQ(event_queue.dequeue_batch(1.0, 2, events), 0u);
+  ASSERT_EQ(events.size(), 3u);
+}
+
 TYPED_TEST_P(EventQueueTest, timeddequeue) {
   unique_ptr<TestEvent> event = unique_ptr<TestEvent>(new TestEvent);
   TestEvent* event_dead_ptr = event.get();
@@ -86,7 +109,7 @@ TYPED_TEST_P(EventQueueTest, trydequeue) {
   ASSERT_FALSE(static_cast<EventQueue<TestEvent>&>(event_queue).trydequeue());
 }
 
-REGISTER_TYPED_TEST_CASE_P(EventQueueTest, dequeue, timeddequeue, trydequeue);
+REGISTER_TYPED_TEST_CASE_P(EventQueueTest, dequeue, dequeue_batch, timeddequeue, trydequeue);
 }
 
 #endif
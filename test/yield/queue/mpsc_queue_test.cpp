@@ -0,0 +1,117 @@
+// mpsc_queue_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "queue_test.hpp"
+#include "yield/queue/mpsc_queue.hpp"
+#include "yield/thread/runnable.hpp"
+#include "yield/thread/thread.hpp"
+
+#include <vector>
+
+namespace yield {
+namespace queue {
+using ::std::vector;
+using ::yield::thread::Runnable;
+using ::yield::thread::Thread;
+
+INSTANTIATE_TYPED_TEST_CASE_P(MpscQueue, QueueTest, MpscQueue<uint32_t>);
+
+class MpscQueueTestProducer : public Runnable {
+public:
+  MpscQueueTestProducer(MpscQueue<uint32_t>& queue, uint32_t producer_i)
+    : producer_i_(producer_i), queue_(queue) {
+  }
+
+  // yield::thread::Runnable
+  void run() {
+    for (uint32_t value_i = 0; value_i < VALUES_COUNT; ++value_i) {
+      queue_.tryenqueue(
+        unique_ptr<uint32_t>(new uint32_t(producer_i_ * VALUES_COUNT + value_i))
+      );
+    }
+  }
+
+public:
+  const static uint32_t VALUES_COUNT = 10000;
+
+private:
+  uint32_t producer_i_;
+  MpscQueue<uint32_t>& queue_;
+};
+
+TEST(MpscQueue, dequeue_producers) {
+  const uint32_t PRODUCERS_COUNT = 4;
+  const uint32_t VALUES_COUNT = MpscQueueTestProducer::VALUES_COUNT;
+  MpscQueue<uint32_t> queue;
+
+  vector< unique_ptr<Thread> > producers;
+  for (uint32_t producer_i = 0; producer_i < PRODUCERS_COUNT; ++producer_i) {
+    producers.push_back(
+      unique_ptr<Thread>(
+        new Thread(
+          unique_ptr<Runnable>(new MpscQueueTestProducer(queue, producer_i))
+        )
+      )
+    );
+  }
+
+  // Each producer's values arrive in the order they were enqueued
+  vector<uint32_t> next_values(PRODUCERS_COUNT, 0);
+  for (uint32_t value_i = 0; value_i < PRODUCERS_COUNT * VALUES_COUNT; ++value_i) {
+    unique_ptr<uint32_t> value = queue.dequeue();
+    ASSERT_TRUE(value != NULL);
+    uint32_t producer_i = *value / VALUES_COUNT;
+    ASSERT_LT(producer_i, PRODUCERS_COUNT);
+    ASSERT_EQ(*value % VALUES_COUNT, next_values[producer_i]);
+    next_values[producer_i]++;
+  }
+
+  for (auto producer_i = producers.begin(); producer_i != producers.end(); ++producer_i) {
+    (*producer_i)->join();
+  }
+
+  ASSERT_FALSE(queue.trydequeue());
+}
+
+TEST(MpscQueue, timeddequeue) {
+  MpscQueue<uint32_t> queue;
+  ASSERT_FALSE(queue.timeddequeue(0.01));
+  queue.tryenqueue(unique_ptr<uint32_t>(new uint32_t(1)));
+  unique_ptr<uint32_t> value = queue.timeddequeue(0.01);
+  ASSERT_TRUE(value != NULL);
+  ASSERT_EQ(*value, 1u);
+}
+
+TEST(MpscQueue, wake) {
+  MpscQueue<uint32_t> queue;
+  queue.wake();
+  ASSERT_FALSE(queue.dequeue());
+}
+}
+}
@@ -0,0 +1,85 @@
+// io_uring_socket_aio_queue_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "yield/sockets/aio/accept_aiocb.hpp"
+#include "yield/sockets/aio/linux/io_uring_socket_aio_queue.hpp"
+#include "../socket_aio_queue_test.hpp"
+
+namespace yield {
+namespace sockets {
+namespace aio {
+namespace linux {
+INSTANTIATE_TYPED_TEST_CASE_P(IoUringSocketAioQueue, SocketAioQueueTest, IoUringSocketAioQueue);
+
+TEST(IoUringSocketAioQueue, accept_recv) {
+  IoUringSocketAioQueue aio_queue;
+
+  shared_ptr<StreamSocket>
+  listen_stream_socket = make_shared<StreamSocket>(TcpSocket::DOMAIN_DEFAULT);
+  if (!listen_stream_socket->bind(SocketAddress::IN_LOOPBACK)) {
+    throw Exception();
+  }
+  if (!listen_stream_socket->listen()) {
+    throw Exception();
+  }
+
+  shared_ptr<Buffer> recv_buffer = make_shared<Buffer>(4096);
+  unique_ptr<SocketAiocb> aiocb(new AcceptAiocb(listen_stream_socket, recv_buffer));
+  if (aio_queue.tryenqueue(move(aiocb))) {
+    throw Exception();
+  }
+
+  // The accept completes only once the peer has sent something
+  StreamSocket client_stream_socket(TcpSocket::DOMAIN_DEFAULT);
+  if (!client_stream_socket.connect(*listen_stream_socket->getsockname())) {
+    throw Exception();
+  }
+  ASSERT_FALSE(aio_queue.timeddequeue(Time::NS_IN_MS * 10));
+  client_stream_socket.send("m", 1, 0);
+
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), 1);
+  AcceptAiocb& accept_aiocb = static_cast<AcceptAiocb&>(*out_aiocb);
+  ASSERT_TRUE(static_cast<bool>(accept_aiocb.accepted_socket()));
+  ASSERT_TRUE(static_cast<bool>(accept_aiocb.peername()));
+  ASSERT_EQ(recv_buffer->size(), 1);
+  ASSERT_EQ((*recv_buffer)[0], 'm');
+}
+
+TEST(IoUringSocketAioQueue, wake) {
+  IoUringSocketAioQueue aio_queue;
+  aio_queue.wake();
+  ASSERT_FALSE(aio_queue.dequeue());
+}
+}
+}
+}
+}
@@ -29,7 +29,16 @@
 
 #include "./socket_aio_queue_test.hpp"
 #include "partial_send_stream_socket.hpp"
+#include "yield/sockets/udp_socket.hpp"
+#include "yield/sockets/aio/recvmmsg_aiocb.hpp"
+#include "yield/sockets/aio/sendmmsg_aiocb.hpp"
 #include "yield/sockets/aio/socket_nbio_queue.hpp"
+#include "yield/sockets/aio/splice_aiocb.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 namespace yield {
 namespace sockets {
@@ -39,7 +48,210 @@ using ::std::move;
 using ::std::shared_ptr;
 using ::std::unique_ptr;
 
+using ::yield::poll::FdEventQueue;
+
+// Default-constructible SocketNbioQueue with a non-default trigger, for the
+// typed tests
+template <FdEventQueue::Trigger trigger>
+class TriggerSocketNbioQueue {
+public:
+  TriggerSocketNbioQueue()
+    : aio_queue_(trigger) {
+  }
+
+  bool associate(socket_t socket_) {
+    return aio_queue_.associate(socket_);
+  }
+
+  unique_ptr<SocketAiocb> dequeue() {
+    return aio_queue_.dequeue();
+  }
+
+  unique_ptr<SocketAiocb> timeddequeue(const Time& timeout) {
+    return aio_queue_.timeddequeue(timeout);
+  }
+
+  unique_ptr<SocketAiocb> trydequeue() {
+    return aio_queue_.trydequeue();
+  }
+
+  unique_ptr<SocketAiocb> tryenqueue(unique_ptr<SocketAiocb> aiocb) {
+    return aio_queue_.tryenqueue(move(aiocb));
+  }
+
+private:
+  SocketNbioQueue aio_queue_;
+};
+
+typedef TriggerSocketNbioQueue<FdEventQueue::Trigger::EDGE>
+EdgeSocketNbioQueue;
+typedef TriggerSocketNbioQueue<FdEventQueue::Trigger::ONESHOT>
+OneshotSocketNbioQueue;
+
 INSTANTIATE_TYPED_TEST_CASE_P(SocketNbioQueue, SocketAioQueueTest, SocketNbioQueue);
+INSTANTIATE_TYPED_TEST_CASE_P(EdgeSocketNbioQueue, SocketAioQueueTest, EdgeSocketNbioQueue);
+INSTANTIATE_TYPED_TEST_CASE_P(OneshotSocketNbioQueue, SocketAioQueueTest, OneshotSocketNbioQueue);
+
+TEST(SocketNbioQueue, recvmmsg_sendmmsg) {
+  SocketNbioQueue aio_queue;
+
+  shared_ptr<UdpSocket> sockets[2];
+  sockets[0] = make_shared<UdpSocket>();
+  sockets[1] = make_shared<UdpSocket>();
+  ASSERT_TRUE(sockets[0]->bind(SocketAddress(SocketAddress::IN_LOOPBACK, 0)));
+  ASSERT_TRUE(sockets[1]->bind(SocketAddress(SocketAddress::IN_LOOPBACK, 0)));
+
+  // The recv waits for the datagrams
+  ::std::vector< shared_ptr<Buffer> > recv_buffers;
+  for (size_t buffer_i = 0; buffer_i < 4; ++buffer_i) {
+    recv_buffers.push_back(make_shared<Buffer>(16));
+  }
+  unique_ptr<SocketAiocb>
+  recv_aiocb(new RecvmmsgAiocb(sockets[1], recv_buffers, 0));
+  if (aio_queue.tryenqueue(move(recv_aiocb))) {
+    throw Exception();
+  }
+  ASSERT_FALSE(aio_queue.trydequeue());
+
+  ::std::vector< shared_ptr<Buffer> > send_buffers;
+  send_buffers.push_back(Buffer::copy("m"));
+  send_buffers.push_back(Buffer::copy("no"));
+  send_buffers.push_back(Buffer::copy("pqr"));
+  ::std::vector<SocketAddress>
+  peernames(send_buffers.size(), *sockets[1]->getsockname());
+  unique_ptr<SocketAiocb>
+  send_aiocb(new SendmmsgAiocb(sockets[0], send_buffers, peernames, 0));
+  if (aio_queue.tryenqueue(move(send_aiocb))) {
+    throw Exception();
+  }
+
+  size_t datagrams_len = 0;
+  for (uint8_t aiocb_i = 0; aiocb_i < 2 || datagrams_len < 3; ++aiocb_i) {
+    unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+    ASSERT_EQ(out_aiocb->error(), 0);
+    if (out_aiocb->type() == SocketAiocb::Type::SENDMMSG) {
+      ASSERT_EQ(out_aiocb->return_(), 3);
+    } else {
+      ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::RECVMMSG);
+      ASSERT_GT(out_aiocb->return_(), 0);
+      RecvmmsgAiocb& recvmmsg_aiocb = static_cast<RecvmmsgAiocb&>(*out_aiocb);
+      for (ssize_t buffer_i = 0; buffer_i < out_aiocb->return_(); ++buffer_i) {
+        ASSERT_EQ(
+          recvmmsg_aiocb.buffers()[buffer_i]->size(),
+          send_buffers[datagrams_len]->size()
+        );
+        ASSERT_EQ(
+          recvmmsg_aiocb.peernames()[buffer_i],
+          *sockets[0]->getsockname()
+        );
+        ++datagrams_len;
+      }
+
+      if (datagrams_len < 3) {
+        // Receive the rest
+        for (size_t buffer_i = 0; buffer_i < 4; ++buffer_i) {
+          recv_buffers[buffer_i] = make_shared<Buffer>(16);
+        }
+        recv_aiocb.reset(new RecvmmsgAiocb(sockets[1], recv_buffers, 0));
+        if (aio_queue.tryenqueue(move(recv_aiocb))) {
+          throw Exception();
+        }
+      }
+    }
+  }
+  ASSERT_EQ(datagrams_len, 3u);
+}
+
+TEST(SocketNbioQueue, recv_while_send_blocked) {
+  SocketNbioQueue aio_queue(FdEventQueue::Trigger::EDGE);
+
+  StreamSocketPair sockets;
+
+  // Fill the send buffer so that a send would block
+  if (!sockets.first()->set_blocking_mode(false)) {
+    throw Exception();
+  }
+  char fill[8192];
+  memset(fill, 0, sizeof(fill));
+  while (sockets.first()->send(fill, sizeof(fill), 0) > 0)
+    ;
+
+  unique_ptr<SocketAiocb>
+  send_aiocb(new SendAiocb(sockets.first(), Buffer::copy("test"), 0));
+  if (aio_queue.tryenqueue(move(send_aiocb))) {
+    throw Exception();
+  }
+  ASSERT_FALSE(aio_queue.trydequeue());
+
+  unique_ptr<SocketAiocb>
+  recv_aiocb(new RecvAiocb(sockets.first(), make_shared<Buffer>(4), 0));
+  if (aio_queue.tryenqueue(move(recv_aiocb))) {
+    throw Exception();
+  }
+  ASSERT_FALSE(aio_queue.trydequeue());
+
+  // The recv completes although the send ahead of it is still blocked
+  sockets.second()->send("test", 4, 0);
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::RECV);
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), 4);
+}
+
+TEST(SocketNbioQueue, edge_keep_alive) {
+  SocketNbioQueue aio_queue(FdEventQueue::Trigger::EDGE);
+
+  for (int connection_i = 0; connection_i < 2; ++connection_i) {
+    // The second pair reuses the descriptors of the first, which were
+    // dissociated before they were closed
+    StreamSocketPair sockets;
+    if (!aio_queue.associate(*sockets.first())) {
+      throw Exception();
+    }
+
+    // Each recv leaves the socket without pending aiocbs in between
+    for (int recv_i = 0; recv_i < 3; ++recv_i) {
+      unique_ptr<SocketAiocb>
+      recv_aiocb(new RecvAiocb(sockets.first(), make_shared<Buffer>(4), 0));
+      if (aio_queue.tryenqueue(move(recv_aiocb))) {
+        throw Exception();
+      }
+      ASSERT_FALSE(aio_queue.trydequeue());
+
+      sockets.second()->send("test", 4, 0);
+      unique_ptr<SocketAiocb> out_aiocb = aio_queue.timeddequeue(5.0);
+      ASSERT_TRUE(out_aiocb != NULL);
+      ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::RECV);
+      ASSERT_EQ(out_aiocb->error(), 0);
+      ASSERT_EQ(out_aiocb->return_(), 4);
+    }
+
+    ASSERT_TRUE(aio_queue.dissociate(*sockets.first()));
+  }
+}
+
+TEST(SocketNbioQueue, edge_reused_fd) {
+  SocketNbioQueue aio_queue(FdEventQueue::Trigger::EDGE);
+
+  for (int connection_i = 0; connection_i < 2; ++connection_i) {
+    // The second pair reuses the descriptors of the first, which were
+    // closed without being dissociated
+    StreamSocketPair sockets;
+
+    unique_ptr<SocketAiocb>
+    recv_aiocb(new RecvAiocb(sockets.first(), make_shared<Buffer>(4), 0));
+    if (aio_queue.tryenqueue(move(recv_aiocb))) {
+      throw Exception();
+    }
+    ASSERT_FALSE(aio_queue.trydequeue());
+
+    sockets.second()->send("test", 4, 0);
+    unique_ptr<SocketAiocb> out_aiocb = aio_queue.timeddequeue(5.0);
+    ASSERT_TRUE(out_aiocb != NULL);
+    ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::RECV);
+    ASSERT_EQ(out_aiocb->return_(), 4);
+  }
+}
 
 TEST(SocketNbioQueue, partial_send) {
   SocketNbioQueue aio_queue;
@@ -144,6 +356,157 @@ TEST(SocketNbioQueue, partial_sendmsg) {
   ASSERT_EQ(recv_ret, 11);
   ASSERT_EQ(memcmp(test_string, "test string", 11), 0);
 }
+
+TEST(SocketNbioQueue, partial_sendmsg_long) {
+  SocketNbioQueue aio_queue;
+
+  StreamSocketPair sockets;
+  shared_ptr<PartialSendStreamSocket>
+  partial_send_stream_socket = make_shared<PartialSendStreamSocket>(sockets.first());
+  if (!aio_queue.associate(*sockets.first())) {
+    throw Exception();
+  }
+
+  // More buffers than fit in one sendmsg
+  const size_t buffers_len = Buffers::WRITE_IOVECS_MAX * 2 + 1;
+  shared_ptr<Buffer> buffer = Buffer::copy("0");
+  Buffer* last_buffer = buffer.get();
+  for (size_t buffer_i = 1; buffer_i < buffers_len; ++buffer_i) {
+    char data = static_cast<char>('0' + buffer_i % 10);
+    last_buffer->set_next_buffer(Buffer::copy(&data, 1));
+    last_buffer = last_buffer->next_buffer().get();
+  }
+
+  unique_ptr<SendAiocb> aiocb
+  (new SendAiocb(partial_send_stream_socket, buffer, 0));
+  if (aio_queue.tryenqueue(unique_ptr<SocketAiocb>(aiocb.release()))) {
+    throw Exception();
+  }
+
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), static_cast<ssize_t>(buffers_len));
+
+  char test_string[buffers_len];
+  ssize_t recv_ret = sockets.second()->recv(test_string, buffers_len, 0);
+  ASSERT_EQ(recv_ret, static_cast<ssize_t>(buffers_len));
+  for (size_t buffer_i = 0; buffer_i < buffers_len; ++buffer_i) {
+    ASSERT_EQ(test_string[buffer_i], static_cast<char>('0' + buffer_i % 10));
+  }
+}
+
+#ifndef _WIN32
+TEST(SocketNbioQueue, splice) {
+  SocketNbioQueue aio_queue;
+
+  StreamSocketPair in_sockets, out_sockets;
+  if (!out_sockets.first()->set_blocking_mode(false)) {
+    throw Exception();
+  }
+  in_sockets.second()->send("test", 4, 0);
+
+  unique_ptr<SocketAiocb>
+  aiocb(new SpliceAiocb(in_sockets.first(), *out_sockets.first()));
+  if (aio_queue.tryenqueue(move(aiocb))) {
+    throw Exception();
+  }
+
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::SPLICE);
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), 4);
+
+  char test[4];
+  ASSERT_EQ(out_sockets.second()->recv(test, 4, 0), 4);
+  ASSERT_EQ(memcmp(test, "test", 4), 0);
+
+  // End of stream
+  in_sockets.second()->shutdown();
+  aiocb.reset(new SpliceAiocb(in_sockets.first(), *out_sockets.first()));
+  if (aio_queue.tryenqueue(move(aiocb))) {
+    throw Exception();
+  }
+  out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), 0);
+}
+
+TEST(SocketNbioQueue, splice_fd_blocked) {
+  SocketNbioQueue aio_queue(FdEventQueue::Trigger::EDGE);
+
+  StreamSocketPair in_sockets, out_sockets;
+
+  // Fill the out socket's send buffer so that the splice's write blocks
+  if (!out_sockets.first()->set_blocking_mode(false)) {
+    throw Exception();
+  }
+  char fill[8192];
+  memset(fill, 0, sizeof(fill));
+  size_t fill_len = 0;
+  for (;;) {
+    ssize_t send_ret = out_sockets.first()->send(fill, sizeof(fill), 0);
+    if (send_ret > 0) {
+      fill_len += static_cast<size_t>(send_ret);
+    } else {
+      break;
+    }
+  }
+
+  unique_ptr<SocketAiocb>
+  aiocb(new SpliceAiocb(in_sockets.first(), *out_sockets.first(), 4));
+  if (aio_queue.tryenqueue(move(aiocb))) {
+    throw Exception();
+  }
+  ASSERT_FALSE(aio_queue.trydequeue());
+
+  in_sockets.second()->send("test", 4, 0);
+  ASSERT_FALSE(aio_queue.timeddequeue(0.1));
+
+  // Draining the out socket lets the splice finish
+  char data[8192];
+  while (fill_len > 0) {
+    ssize_t recv_ret = out_sockets.second()->recv(data, sizeof(data), 0);
+    ASSERT_GT(recv_ret, 0);
+    fill_len -= static_cast<size_t>(recv_ret);
+  }
+
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::SPLICE);
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), 4);
+  ASSERT_EQ(out_sockets.second()->recv(data, 4, 0), 4);
+  ASSERT_EQ(memcmp(data, "test", 4), 0);
+}
+
+TEST(SocketNbioQueue, splice_pipe) {
+  SocketNbioQueue aio_queue;
+
+  StreamSocketPair sockets;
+  int pipefd[2];
+  ASSERT_EQ(::pipe(pipefd), 0);
+  sockets.second()->send("test", 4, 0);
+
+  // The descriptor is not put in non-blocking mode on the caller's behalf
+  ASSERT_THROW(SpliceAiocb(sockets.first(), pipefd[1]), Exception);
+  ASSERT_NE(::fcntl(pipefd[1], F_SETFL, O_NONBLOCK), -1);
+
+  unique_ptr<SocketAiocb> aiocb(new SpliceAiocb(sockets.first(), pipefd[1]));
+  if (aio_queue.tryenqueue(move(aiocb))) {
+    throw Exception();
+  }
+
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->error(), 0);
+  ASSERT_EQ(out_aiocb->return_(), 4);
+
+  char test[4];
+  ASSERT_EQ(::read(pipefd[0], test, 4), 4);
+  ASSERT_EQ(memcmp(test, "test", 4), 0);
+
+  ::close(pipefd[0]);
+  ::close(pipefd[1]);
+}
+#endif
 }
 }
 }
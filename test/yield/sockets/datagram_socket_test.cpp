@@ -28,7 +28,9 @@
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "socket_test.hpp"
+#include "yield/buffer.hpp"
 #include "yield/sockets/datagram_socket_pair.hpp"
+#include "yield/sockets/udp_socket.hpp"
 
 namespace yield {
 namespace sockets {
@@ -50,6 +52,38 @@ TEST(DatagramSocket, recvfrom) {
   ASSERT_EQ(peername, *sockets.second()->getpeername());
 }
 
+TEST(DatagramSocket, recvmmsg) {
+  UdpSocket sockets[2];
+  ASSERT_TRUE(sockets[0].bind(SocketAddress(SocketAddress::IN_LOOPBACK, 0)));
+  ASSERT_TRUE(sockets[1].bind(SocketAddress(SocketAddress::IN_LOOPBACK, 0)));
+  ::std::unique_ptr<SocketAddress> sockname = sockets[1].getsockname();
+  ASSERT_EQ(sockets[0].sendto("m", 1, 0, *sockname), 1);
+  ASSERT_EQ(sockets[0].sendto("no", 2, 0, *sockname), 2);
+
+  ::std::shared_ptr<Buffer> buffers[3];
+  for (size_t buffer_i = 0; buffer_i < 3; ++buffer_i) {
+    buffers[buffer_i] = ::std::make_shared<Buffer>(16);
+  }
+  SocketAddress peernames[3];
+  uint16_t gro_segment_sizes[3];
+  ASSERT_TRUE(sockets[1].set_blocking_mode(false));
+  ssize_t recvmmsg_ret
+    = sockets[1].recvmmsg(buffers, 3, 0, peernames, gro_segment_sizes);
+  ASSERT_EQ(recvmmsg_ret, 2);
+  ASSERT_EQ(buffers[0]->size(), 1u);
+  ASSERT_EQ((*buffers[0])[0], 'm');
+  ASSERT_EQ(buffers[1]->size(), 2u);
+  ASSERT_EQ(memcmp(*buffers[1], "no", 2), 0);
+  ASSERT_EQ(buffers[2]->size(), 0u);
+  ASSERT_EQ(gro_segment_sizes[0], 0);
+  ASSERT_EQ(peernames[0], *sockets[0].getsockname());
+  ASSERT_EQ(peernames[1], *sockets[0].getsockname());
+
+  // Nothing more to receive
+  ASSERT_EQ(sockets[1].recvmmsg(buffers + 2, 1, 0, peernames), -1);
+  ASSERT_TRUE(sockets[1].want_recv());
+}
+
 TEST(DatagramSocket, recvmsg) {
   DatagramSocketPair sockets;
   sockets.first()->write("mn", 2);
@@ -91,6 +125,50 @@ TEST(DatagramSocket, sendmsg) {
   ASSERT_EQ(mn[1], 'n');
 }
 
+TEST(DatagramSocket, sendmmsg) {
+  UdpSocket sockets[2];
+  ASSERT_TRUE(sockets[1].bind(SocketAddress(SocketAddress::IN_LOOPBACK, 0)));
+  SocketAddress peernames[2];
+  peernames[0] = peernames[1] = *sockets[1].getsockname();
+
+  ::std::shared_ptr<Buffer> buffers[2];
+  buffers[0] = Buffer::copy("m");
+  buffers[1] = Buffer::copy("no");
+  ASSERT_EQ(sockets[0].sendmmsg(buffers, 2, 0, peernames), 2);
+
+  char data[2];
+  ASSERT_EQ(sockets[1].read(data, 2), 1);
+  ASSERT_EQ(data[0], 'm');
+  ASSERT_EQ(sockets[1].read(data, 2), 2);
+  ASSERT_EQ(memcmp(data, "no", 2), 0);
+}
+
+#ifdef __linux__
+TEST(DatagramSocket, sendmmsg_gso) {
+  UdpSocket sockets[2];
+  ASSERT_TRUE(sockets[1].bind(SocketAddress(SocketAddress::IN_LOOPBACK, 0)));
+  ASSERT_TRUE(sockets[1].setsockopt(UdpSocket::Option::GRO, true));
+  SocketAddress peername(*sockets[1].getsockname());
+
+  // One buffer goes out as three datagrams...
+  ::std::shared_ptr<Buffer> buffer = ::std::make_shared<Buffer>(3000);
+  memset(static_cast<char*>(*buffer), 'x', 3000);
+  buffer->put(NULL, 3000);
+  ASSERT_EQ(sockets[0].sendmmsg(&buffer, 1, 0, &peername, 1000), 1);
+
+  // ...and comes back coalesced
+  ::std::shared_ptr<Buffer> recv_buffer = ::std::make_shared<Buffer>(65536);
+  SocketAddress recv_peername;
+  uint16_t gro_segment_size;
+  ASSERT_EQ(
+    sockets[1].recvmmsg(&recv_buffer, 1, 0, &recv_peername, &gro_segment_size),
+    1
+  );
+  ASSERT_EQ(recv_buffer->size(), 3000u);
+  ASSERT_EQ(gro_segment_size, 1000);
+}
+#endif
+
 TEST(DatagramSocket, sendto) {
   DatagramSocketPair sockets;
   ssize_t sendto_ret
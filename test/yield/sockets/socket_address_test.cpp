@@ -73,6 +73,23 @@ TEST(SocketAddress, getnameinfo) {
   ASSERT_EQ(servname, TEST_SERVNAME);
 }
 
+TEST(SocketAddress, ntop) {
+  string nodename;
+  ASSERT_TRUE(SocketAddress(static_cast<uint32_t>(0x7f000001), 0).ntop(nodename));
+  ASSERT_EQ(nodename, "127.0.0.1");
+  ASSERT_TRUE(SocketAddress(static_cast<uint32_t>(0x0a00ff09), 0).ntop(nodename));
+  ASSERT_EQ(nodename, "10.0.255.9");
+  ASSERT_TRUE(SocketAddress(static_cast<uint32_t>(0), 0).ntop(nodename));
+  ASSERT_EQ(nodename, "0.0.0.0");
+
+  // Same as getnameinfo's numeric form
+  SocketAddress sockaddr(TEST_NODENAME, TEST_SERVNAME);
+  string nodename_getnameinfo;
+  ASSERT_TRUE(sockaddr.ntop(nodename));
+  ASSERT_TRUE(sockaddr.getnameinfo(nodename_getnameinfo));
+  ASSERT_EQ(nodename, nodename_getnameinfo);
+}
+
 TEST(SocketAddress, operator_print) {
   std::ostringstream oss;
   oss << SocketAddress(TEST_NODENAME, TEST_SERVNAME);
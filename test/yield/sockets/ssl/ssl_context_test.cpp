@@ -29,27 +29,152 @@
 
 #include "test_pem_certificate.hpp"
 #include "test_pem_private_key.hpp"
-#include "yield/auto_object.hpp"
-#ifdef YIELD_HAVE_OPENSSL
 #include "yield/sockets/ssl/ssl_context.hpp"
-#endif
-#include "yunit.hpp"
+#include "yield/sockets/ssl/ssl_socket.hpp"
+#include "gtest/gtest.h"
 
-TEST_SUITE(SSLContext);
+#include <openssl/ssl.h>
 
 namespace yield {
 namespace sockets {
-#ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
-TEST(SSLContext, construct_from_pem_certificate_string) {
-  auto_Object<SSLContext> ssl_context
-  = new SSLContext(
+using ::std::make_shared;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+
+// Connect a new client to listen_ssl_socket and handshake, resuming session
+// if it is not NULL. Replace session with the client's session afterwards.
+static bool handshake(SslSocket& listen_ssl_socket, SSL_SESSION*& session) {
+  SslSocket client_ssl_socket;
+  if (session != NULL) {
+    SSL_set_session(client_ssl_socket, session);
+    SSL_SESSION_free(session);
+    session = NULL;
+  }
+
+  if (!client_ssl_socket.connect(*listen_ssl_socket.getsockname())) {
+    throw Exception();
+  }
+  unique_ptr<StreamSocket> server_ssl_socket = listen_ssl_socket.accept();
+  if (server_ssl_socket == NULL) {
+    throw Exception();
+  }
+  if (
+    !client_ssl_socket.set_blocking_mode(false)
+    ||
+    !server_ssl_socket->set_blocking_mode(false)
+  ) {
+    throw Exception();
+  }
+
+  // TLS 1.3 session tickets reach the client ahead of the server's first
+  // write, so have the server write something
+  bool sent = false, received = false;
+  while (!sent || !received) {
+    if (!sent) {
+      sent = server_ssl_socket->send("m", 1, 0) == 1;
+      if (
+        !sent
+        &&
+        !server_ssl_socket->want_recv()
+        &&
+        !server_ssl_socket->want_send()
+      ) {
+        throw Exception();
+      }
+    }
+
+    if (!received) {
+      char buf;
+      received = client_ssl_socket.recv(&buf, 1, 0) == 1;
+      if (
+        !received
+        &&
+        !client_ssl_socket.want_recv()
+        &&
+        !client_ssl_socket.want_send()
+      ) {
+        throw Exception();
+      }
+    }
+  }
+
+  session = SSL_get1_session(client_ssl_socket);
+  return SSL_session_reused(client_ssl_socket) == 1;
+}
+
+static shared_ptr<SslContext> new_server_ssl_context() {
+  return make_shared<SslContext>(
+           TEST_PEM_CERTIFICATE,
+           TEST_PEM_PRIVATE_KEY,
+           TEST_PEM_PRIVATE_KEY_PASSPHRASE
+         );
+}
+
+TEST(SslContext, constructor) {
+  SslContext ssl_context;
+  ASSERT_TRUE(static_cast<SSL_CTX*>(ssl_context) != NULL);
+}
+
+TEST(SslContext, constructor_pem_certificate) {
+  SslContext ssl_context(
     TEST_PEM_CERTIFICATE,
     TEST_PEM_PRIVATE_KEY,
     TEST_PEM_PRIVATE_KEY_PASSPHRASE
   );
+  ASSERT_TRUE(static_cast<SSL_CTX*>(ssl_context) != NULL);
+}
+
+TEST(SslContext, constructor_pem_private_key_passphrase) {
+  ASSERT_THROW(
+    SslContext(TEST_PEM_CERTIFICATE, TEST_PEM_PRIVATE_KEY, "wrong"),
+    Exception
+  );
+}
+
+TEST(SslContext, enable_session_cache) {
+  shared_ptr<SslContext> ssl_context = new_server_ssl_context();
+  ssl_context->enable_session_cache();
+  SslSocket listen_ssl_socket(ssl_context);
+  ASSERT_TRUE(listen_ssl_socket.bind(SocketAddress::IN_LOOPBACK));
+  ASSERT_TRUE(listen_ssl_socket.listen());
+
+  SSL_SESSION* session = NULL;
+  ASSERT_FALSE(handshake(listen_ssl_socket, session));
+  ASSERT_GT(ssl_context->session_cache()->size(), 0u);
+  ASSERT_TRUE(handshake(listen_ssl_socket, session));
+  SSL_SESSION_free(session);
+}
+
+TEST(SslContext, enable_session_tickets) {
+  shared_ptr<SslContext> ssl_context = new_server_ssl_context();
+  ssl_context->enable_session_tickets();
+  SslSocket listen_ssl_socket(ssl_context);
+  ASSERT_TRUE(listen_ssl_socket.bind(SocketAddress::IN_LOOPBACK));
+  ASSERT_TRUE(listen_ssl_socket.listen());
+
+  SSL_SESSION* session = NULL;
+  ASSERT_FALSE(handshake(listen_ssl_socket, session));
+  ASSERT_TRUE(ssl_context->session_cache() == NULL);
+  ASSERT_TRUE(handshake(listen_ssl_socket, session));
+  ASSERT_TRUE(handshake(listen_ssl_socket, session));
+  SSL_SESSION_free(session);
+}
+
+TEST(SslContext, enable_session_tickets_rotated) {
+  // Rotate the key on every ticket: the client's ticket is always under the
+  // previous key by the time it comes back
+  shared_ptr<SslContext> ssl_context = new_server_ssl_context();
+  ssl_context->enable_session_tickets(Time::ZERO);
+  SslSocket listen_ssl_socket(ssl_context);
+  ASSERT_TRUE(listen_ssl_socket.bind(SocketAddress::IN_LOOPBACK));
+  ASSERT_TRUE(listen_ssl_socket.listen());
+
+  SSL_SESSION* session = NULL;
+  ASSERT_FALSE(handshake(listen_ssl_socket, session));
+  ASSERT_TRUE(handshake(listen_ssl_socket, session));
+  SSL_SESSION_free(session);
 }
 }
-#endif
 }
 }
@@ -0,0 +1,113 @@
+// ssl_session_cache_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/sockets/ssl/ssl_session_cache.hpp"
+#include "gtest/gtest.h"
+
+#include <cstring>
+
+#include <openssl/ssl.h>
+
+namespace yield {
+namespace sockets {
+namespace ssl {
+static SSL_SESSION* new_session(unsigned char id_byte) {
+  SSL_SESSION* session = SSL_SESSION_new();
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  memset(id, id_byte, sizeof(id));
+  SSL_SESSION_set1_id(session, id, sizeof(id));
+  return session;
+}
+
+static SSL_SESSION* get(SslSessionCache& session_cache, unsigned char id_byte) {
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  memset(id, id_byte, sizeof(id));
+  return session_cache.get(id, sizeof(id));
+}
+
+TEST(SslSessionCache, erase) {
+  SslSessionCache session_cache;
+  session_cache.put(new_session(1));
+  unsigned char id[SSL_MAX_SSL_SESSION_ID_LENGTH];
+  memset(id, 1, sizeof(id));
+  session_cache.erase(id, sizeof(id));
+  ASSERT_EQ(session_cache.size(), 0u);
+  ASSERT_TRUE(get(session_cache, 1) == NULL);
+}
+
+TEST(SslSessionCache, evict) {
+  SslSessionCache session_cache(2, 1);
+  session_cache.put(new_session(1));
+  session_cache.put(new_session(2));
+
+  // 1 becomes the most recently used, so 2 goes to make room for 3
+  SSL_SESSION* session = get(session_cache, 1);
+  ASSERT_TRUE(session != NULL);
+  SSL_SESSION_free(session);
+  session_cache.put(new_session(3));
+
+  ASSERT_EQ(session_cache.size(), 2u);
+  ASSERT_TRUE(get(session_cache, 2) == NULL);
+  session = get(session_cache, 1);
+  ASSERT_TRUE(session != NULL);
+  SSL_SESSION_free(session);
+  session = get(session_cache, 3);
+  ASSERT_TRUE(session != NULL);
+  SSL_SESSION_free(session);
+}
+
+TEST(SslSessionCache, get) {
+  SslSessionCache session_cache;
+  ASSERT_TRUE(get(session_cache, 1) == NULL);
+
+  SSL_SESSION* session = new_session(1);
+  session_cache.put(session);
+  SSL_SESSION* cached_session = get(session_cache, 1);
+  ASSERT_EQ(cached_session, session);
+  SSL_SESSION_free(cached_session);
+}
+
+TEST(SslSessionCache, put) {
+  SslSessionCache session_cache;
+  for (unsigned char id_byte = 0; id_byte < 64; ++id_byte) {
+    session_cache.put(new_session(id_byte));
+  }
+  ASSERT_EQ(session_cache.size(), 64u);
+
+  // Same ID: replaces the cached session
+  SSL_SESSION* session = new_session(0);
+  session_cache.put(session);
+  ASSERT_EQ(session_cache.size(), 64u);
+  SSL_SESSION* cached_session = get(session_cache, 0);
+  ASSERT_EQ(cached_session, session);
+  SSL_SESSION_free(cached_session);
+}
+}
+}
+}
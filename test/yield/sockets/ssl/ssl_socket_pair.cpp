@@ -27,70 +27,70 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "ssl_socket_pair.hpp"
 #include "test_pem_certificate.hpp"
 #include "test_pem_private_key.hpp"
-#include "ssl_socket_pair.hpp"
 
 namespace yield {
 namespace sockets {
-#ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
-SSLSocketPair::SSLSocketPair() {
-  auto_Object<SSLContext> listen_ssl_context
-  = new SSLContext(
-    TEST_PEM_CERTIFICATE,
-    TEST_PEM_PRIVATE_KEY,
-    TEST_PEM_PRIVATE_KEY_PASSPHRASE
-  );
-  SSLSocket listen_ssl_socket(*listen_ssl_context);
-  if (listen_ssl_socket.bind(SocketAddress::IN_LOOPBACK)) {
-    if (listen_ssl_socket.listen()) {
-      try {
-        sockets[0] = new SSLSocket;
-        if (sockets[0]->connect(*listen_ssl_socket.getsockname())) {
-          sockets[1] = listen_ssl_socket.accept();
-          if (sockets[1] != NULL) {
-            if (
-              sockets[0]->set_blocking_mode(false) &&
-              sockets[1]->set_blocking_mode(false)
-            ) {
-              bool did_handshake[2];
-              did_handshake[0] = did_handshake[1] = false;
-              while (!did_handshake[0] || !did_handshake[1]) {
-                for (uint8_t i = 0; i < 2; i++) {
-                  if (!did_handshake[i]) {
-                    did_handshake[i] = sockets[i]->do_handshake();
-                  }
-                }
-              }
+using ::std::make_shared;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+
+SslSocketPair::SslSocketPair() {
+  shared_ptr<SslContext> ssl_context
+  = make_shared<SslContext>(
+      TEST_PEM_CERTIFICATE,
+      TEST_PEM_PRIVATE_KEY,
+      TEST_PEM_PRIVATE_KEY_PASSPHRASE
+    );
 
-              if (
-                !sockets[0]->set_blocking_mode(true) ||
-                !sockets[1]->set_blocking_mode(true)
-              ) {
-                throw Exception();
-              }
-            } else {
-              throw Exception();
-            }
-          } else {
-            throw Exception();
-          }
-        } else {
+  SslSocket listen_ssl_socket(ssl_context);
+  if (!listen_ssl_socket.bind(SocketAddress::IN_LOOPBACK)) {
+    throw Exception();
+  }
+  if (!listen_ssl_socket.listen()) {
+    throw Exception();
+  }
+
+  first_ = make_shared<SslSocket>();
+  if (!first_->connect(*listen_ssl_socket.getsockname())) {
+    throw Exception();
+  }
+
+  unique_ptr<StreamSocket> accepted_socket = listen_ssl_socket.accept();
+  if (accepted_socket == NULL) {
+    throw Exception();
+  }
+  second_.reset(static_cast<SslSocket*>(accepted_socket.release()));
+
+  // Interleave the two sides of the handshake in one thread
+  if (!first_->set_blocking_mode(false) || !second_->set_blocking_mode(false)) {
+    throw Exception();
+  }
+  bool did_handshake[2] = { false, false };
+  while (!did_handshake[0] || !did_handshake[1]) {
+    SslSocket* ssl_sockets[2] = { first_.get(), second_.get() };
+    for (uint8_t i = 0; i < 2; i++) {
+      if (!did_handshake[i]) {
+        did_handshake[i] = ssl_sockets[i]->do_handshake();
+        if (
+          !did_handshake[i]
+          &&
+          !ssl_sockets[i]->want_recv()
+          &&
+          !ssl_sockets[i]->want_send()
+        ) {
           throw Exception();
         }
-      } catch (Exception&) {
-        SSLSocket::dec_ref(sockets[0]);
-        throw;
       }
-    } else {
-      throw Exception();
     }
-  } else {
+  }
+  if (!first_->set_blocking_mode(true) || !second_->set_blocking_mode(true)) {
     throw Exception();
   }
 }
 }
-#endif
 }
 }
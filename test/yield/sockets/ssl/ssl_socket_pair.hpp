@@ -31,21 +31,20 @@
 #define _YIELD_SOCKETS_SSL_SSL_SOCKET_PAIR_HPP_
 
 #include "yield/sockets/socket_pair.hpp"
-
-#ifdef YIELD_HAVE_OPENSSL
 #include "yield/sockets/ssl/ssl_socket.hpp"
-#endif
 
 namespace yield {
 namespace sockets {
-#ifdef YIELD_HAVE_OPENSSL
 namespace ssl {
-class SSLSocketPair : public SocketPair<SSLSocket> {
+/**
+  A pair of SslSockets connected over loopback, handshake done: first is the
+    client, second the server.
+*/
+class SslSocketPair : public SocketPair<SslSocket> {
 public:
-  SSLSocketPair();
+  SslSocketPair();
 };
 }
-#endif
 }
 }
 
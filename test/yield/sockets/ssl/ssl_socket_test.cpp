@@ -29,13 +29,158 @@
 
 #include "../socket_test.hpp"
 #include "ssl_socket_pair.hpp"
+#include "test_pem_certificate.hpp"
+#include "test_pem_private_key.hpp"
+#include "yield/fs/file.hpp"
+#include "yield/fs/file_system.hpp"
+#include "yield/sockets/aio/accept_aiocb.hpp"
+#include "yield/sockets/aio/recv_aiocb.hpp"
+#include "yield/sockets/aio/send_aiocb.hpp"
+#include "yield/sockets/aio/socket_nbio_queue.hpp"
 
-#ifdef YIELD_HAVE_OPENSSL
-TEST_SUITE_EX(
-  SSLSocket,
-  yield::sockets::SocketTestSuite<yield::sockets::ssl::SSLSocketPair>
-);
-#else
-TEST_SUITE(SSLSocket);
-#endif
-//
+#include <openssl/ssl.h>
+
+namespace yield {
+namespace sockets {
+INSTANTIATE_TYPED_TEST_CASE_P(SslSocket, ChannelTest, ssl::SslSocketPair);
+INSTANTIATE_TYPED_TEST_CASE_P(SslSocket, SocketTest, ssl::SslSocketPair);
+
+namespace ssl {
+using ::std::make_shared;
+using ::std::move;
+using ::std::shared_ptr;
+using ::std::unique_ptr;
+using ::yield::sockets::aio::AcceptAiocb;
+using ::yield::sockets::aio::RecvAiocb;
+using ::yield::sockets::aio::SendAiocb;
+using ::yield::sockets::aio::SocketAiocb;
+using ::yield::sockets::aio::SocketNbioQueue;
+
+TEST(SslSocket, dup) {
+  unique_ptr<StreamSocket> socket_ = SslSocket().dup();
+  ASSERT_TRUE(socket_ != NULL);
+}
+
+TEST(SslSocket, sendfile) {
+  // Several records' worth, through kernel TLS or userspace, whichever the
+  // kernel supports
+  ::std::string test_data;
+  for (size_t i = 0; i < 100000; ++i) {
+    test_data.push_back(static_cast<char>('a' + i % 26));
+  }
+  yield::fs::Path test_file_path("SslSocketSendfileTest.txt");
+  {
+    unique_ptr<yield::fs::File> file
+    = yield::fs::FileSystem().creat(test_file_path);
+    ASSERT_TRUE(file != NULL);
+    ASSERT_EQ(
+      file->write(test_data.data(), test_data.size()),
+      static_cast<ssize_t>(test_data.size())
+    );
+  }
+  unique_ptr<yield::fs::File> file
+  = yield::fs::FileSystem().open(test_file_path);
+  ASSERT_TRUE(file != NULL);
+
+  SslSocketPair ssl_sockets;
+  size_t send_len = 0;
+  while (send_len < test_data.size()) {
+    ssize_t sendfile_ret
+    = ssl_sockets.first()->sendfile(
+        *file,
+        static_cast<off_t>(send_len),
+        test_data.size() - send_len
+      );
+    ASSERT_GT(sendfile_ret, 0);
+    send_len += static_cast<size_t>(sendfile_ret);
+  }
+
+  ::std::string recv_data;
+  while (recv_data.size() < test_data.size()) {
+    char buf[16384];
+    ssize_t recv_ret = ssl_sockets.second()->recv(buf, sizeof(buf), 0);
+    ASSERT_GT(recv_ret, 0);
+    recv_data.append(buf, static_cast<size_t>(recv_ret));
+  }
+  ASSERT_EQ(recv_data, test_data);
+
+  file->close();
+  yield::fs::FileSystem().unlink(test_file_path);
+}
+
+TEST(SslSocket, SocketNbioQueue) {
+  // Accept, handshake, request and response all as aiocbs on one queue
+  SocketNbioQueue aio_queue;
+
+  shared_ptr<SslSocket> listen_ssl_socket
+  = make_shared<SslSocket>(
+      make_shared<SslContext>(
+        TEST_PEM_CERTIFICATE,
+        TEST_PEM_PRIVATE_KEY,
+        TEST_PEM_PRIVATE_KEY_PASSPHRASE
+      )
+    );
+  ASSERT_TRUE(listen_ssl_socket->bind(SocketAddress::IN_LOOPBACK));
+  ASSERT_TRUE(listen_ssl_socket->listen());
+  ASSERT_TRUE(aio_queue.associate(*listen_ssl_socket));
+  if (
+    aio_queue.tryenqueue(
+      unique_ptr<SocketAiocb>(new AcceptAiocb(listen_ssl_socket, shared_ptr<Buffer>()))
+    )
+  ) {
+    throw Exception();
+  }
+
+  shared_ptr<SslSocket> client_ssl_socket = make_shared<SslSocket>();
+  ASSERT_TRUE(client_ssl_socket->connect(*listen_ssl_socket->getsockname()));
+  ASSERT_TRUE(aio_queue.associate(*client_ssl_socket));
+
+  unique_ptr<SocketAiocb> out_aiocb = aio_queue.dequeue();
+  ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::ACCEPT);
+  ASSERT_EQ(out_aiocb->error(), 0);
+  shared_ptr<StreamSocket> server_ssl_socket
+  = static_cast<AcceptAiocb&>(*out_aiocb).accepted_socket();
+  ASSERT_TRUE(aio_queue.associate(*server_ssl_socket));
+
+  // Larger than a TLS record, so that the send completes over several retries
+  shared_ptr<Buffer> send_buffer = Buffer::copy(::std::string(65536, 'm'));
+  if (
+    aio_queue.tryenqueue(
+      unique_ptr<SocketAiocb>(new SendAiocb(client_ssl_socket, send_buffer, 0))
+    )
+  ) {
+    throw Exception();
+  }
+
+  size_t recv_len = 0;
+  bool sent = false;
+  while (!sent || recv_len < send_buffer->size()) {
+    if (recv_len < send_buffer->size()) {
+      if (
+        aio_queue.tryenqueue(
+          unique_ptr<SocketAiocb>(
+            new RecvAiocb(server_ssl_socket, make_shared<Buffer>(65536), 0)
+          )
+        )
+      ) {
+        throw Exception();
+      }
+    }
+
+    out_aiocb = aio_queue.dequeue();
+    ASSERT_EQ(out_aiocb->error(), 0);
+    if (out_aiocb->type() == SocketAiocb::Type::SEND) {
+      ASSERT_EQ(out_aiocb->return_(), 65536);
+      sent = true;
+    } else {
+      ASSERT_EQ(out_aiocb->type(), SocketAiocb::Type::RECV);
+      ASSERT_GT(out_aiocb->return_(), 0);
+      recv_len += static_cast<size_t>(out_aiocb->return_());
+    }
+  }
+  ASSERT_EQ(recv_len, send_buffer->size());
+  ASSERT_TRUE(SSL_is_init_finished(*client_ssl_socket));
+}
+}
+}
+}
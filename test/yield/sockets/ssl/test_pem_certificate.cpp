@@ -33,20 +33,24 @@ namespace sockets {
 namespace ssl {
 const char* TEST_PEM_CERTIFICATE = \
                                    "-----BEGIN CERTIFICATE-----\n"
-                                   "MIICmTCCAgICAQYwDQYJKoZIhvcNAQEFBQAwgZAxCzAJBgNVBAYTAkVVMREwDwYD\n"
-                                   "VQQIEwhYdHJlZW1GUzERMA8GA1UEBxMIWHRyZWVtRlMxETAPBgNVBAoTCFh0cmVl\n"
-                                   "bUZTMQ0wCwYDVQQLEwR0ZXN0MRkwFwYDVQQDExBYdHJlZW1GUy10ZXN0LUNBMR4w\n"
-                                   "HAYJKoZIhvcNAQkBFg9DQUB4dHJlZW1mcy5vcmcwHhcNMDkwNDA1MTEzOTMyWhcN\n"
-                                   "MTAwNDA1MTEzOTMyWjCBmDELMAkGA1UEBhMCRVUxETAPBgNVBAgTCFh0cmVlbUZT\n"
-                                   "MREwDwYDVQQHEwhYdHJlZW1GUzERMA8GA1UEChMIWHRyZWVtRlMxDTALBgNVBAsT\n"
-                                   "BHRlc3QxHTAbBgNVBAMTFFh0cmVlbUZTLXRlc3QtQ2xpZW50MSIwIAYJKoZIhvcN\n"
-                                   "AQkBFhNDbGllbnRAeHRyZWVtZnMub3JnMIGfMA0GCSqGSIb3DQEBAQUAA4GNADCB\n"
-                                   "iQKBgQDCjEmDQzzp4+FtNw31mJM6D85EDW8mhrX1xWBRKd4Tr3fibYjYVgkoXX03\n"
-                                   "QmIqmtA4Rbbu7cqkq8grOdX7a2LcZ3tNaByS9C1wFc5QVqXd2ZyKj7O7bvTEawwD\n"
-                                   "bU2gdgFgFsrt7AGT3fPeT3bqK7W0bS/Rgw0hn8OAm6QL9NqiiQIDAQABMA0GCSqG\n"
-                                   "SIb3DQEBBQUAA4GBAJzafyIsGcyK/ZRFozgCwteu4DchMuvHmhkEa8vO5hVJwiK/\n"
-                                   "mDFmtgCUEf3gtyqQVmYyp99OohFNVTmBndX4j/GCUVqRxfCaojzN89kpsJnHuR/B\n"
-                                   "FVHbqso+oavB+jOgu8fWMQ6jNsT4Ql0BgIzf5Lc08m/kIodnES92qNHOdixg\n"
+                                   "MIIDSDCCAjCgAwIBAgITcg6YQoEbhScrEN3loPNMNzBo1DANBgkqhkiG9w0BAQsF\n"
+                                   "ADAzMQ4wDAYDVQQKDAVZaWVsZDENMAsGA1UECwwEdGVzdDESMBAGA1UEAwwJbG9j\n"
+                                   "YWxob3N0MCAXDTI2MTAxODA4NDMyMloYDzIxMjYwOTI0MDg0MzIyWjAzMQ4wDAYD\n"
+                                   "VQQKDAVZaWVsZDENMAsGA1UECwwEdGVzdDESMBAGA1UEAwwJbG9jYWxob3N0MIIB\n"
+                                   "IjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEAoyNpVayQ4wl4ScXO2mFL9Osm\n"
+                                   "+tfpuKWzpNWO0cxyEiapW6c+OINkJouVCahixQ/jPxoShI0/CpibmV7d/ZPhvrtH\n"
+                                   "X3eQdWEyOlXMj9UQBbIfDFKlXHmNxkcsH1h+31vGaCMG1qYfNjxKCWBFItT4xuui\n"
+                                   "10W7qD0CKePK7+G9AYFyKbznmUpnKRONQhkgxuJg4FFh3OXhe7alKn/volSgcFpR\n"
+                                   "t2drUdEnNt/tizV0sazgPWeal/hhOuN4bBi9YVvwi6GPXoSaoQBjM5IAwowYbZ3O\n"
+                                   "rjk0O+g2jbmgiwPTSizHW/Kc4gfaR1HuBLM/LILJ+Nj12hSmFC2I21MzAOl+pwID\n"
+                                   "AQABo1MwUTAdBgNVHQ4EFgQUF9kEC1J5ayyYJqRRvX41Aq8uHh4wHwYDVR0jBBgw\n"
+                                   "FoAUF9kEC1J5ayyYJqRRvX41Aq8uHh4wDwYDVR0TAQH/BAUwAwEB/zANBgkqhkiG\n"
+                                   "9w0BAQsFAAOCAQEAjDr2h3DeK205ahW6AWbXSXFF5iWQuQY5uwVdFI625SAqeROA\n"
+                                   "2Pxx8s0SA74ZMpUvguUfodlxvIXTZ1tdJRvPTycKEIaOHE9KJ7A73QFJtZw6+w6A\n"
+                                   "iMvYiZMzhBMNhaPNrr0AxVJ7I//gHkYCajNhFAn0tdAp2Dv5GxFOSotmVVOm/Bhz\n"
+                                   "vnrqyr7DrTYDn7KWwCSrj0Jsy8u89TCghofqCVRJMxLex3s5lA3aQ+plLuux5pKS\n"
+                                   "YFSVIrAG51LQKVIFymyk/lIMtl6Q2cce9Gq4kJyUmU9w6lU5KgwJ1bw+8+2nC8Kx\n"
+                                   "SJTBbeNfq4a0GKMYcAfXY2UNQwwdS6pQDhtM2A==\n"
                                    "-----END CERTIFICATE-----\n";
 }
 #endif
@@ -27,25 +27,12 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
 // THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include "yunit.hpp"
+#include "yield/logging.hpp"
+#include "gtest/gtest.h"
 
-#include <iostream>
+YIELD_LOGGING_INITIALIZE
 
-extern yunit::TestSuite& SSLContextTestSuite();
-extern yunit::TestSuite& SSLSocketTestSuite();
-
-int main(int, char**) {
-  int failed_test_case_count = 0;
-
-  // SSLContext
-  std::cout << "SSLContext:" << std::endl;
-  failed_test_case_count += SSLContextTestSuite().run();
-  std::cout << std::endl;
-
-  // SSLSocket
-  std::cout << "SSLSocket:" << std::endl;
-  failed_test_case_count += SSLSocketTestSuite().run();
-  std::cout << std::endl;
-
-  return failed_test_case_count;
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
 }
@@ -32,9 +32,102 @@
 
 namespace yield {
 namespace stage {
+using ::std::shared_ptr;
+
 typedef StageSchedulerScheduleTest<SedaStageScheduler> SedaStageSchedulerScheduleTest;
 TEST_F(SedaStageSchedulerScheduleTest, run) {
   this->run();
 }
+// Takes long enough per event for a backlog to build up
+class SleepingTestEventHandler : public EventHandler<TestEvent> {
+public:
+  // EventHandler
+  void handle(unique_ptr<TestEvent> event) override {
+    yield::thread::Thread::sleep(0.001);
+  }
+};
+
+class SedaStageSchedulerControllerTest : public ::testing::Test {
+protected:
+  void enqueue(StageImpl<TestEvent>& stage, uint32_t events_count) {
+    for (uint32_t event_i = 0; event_i < events_count; ++event_i) {
+      stage.tryenqueue(unique_ptr<TestEvent>(new TestEvent));
+    }
+  }
+
+  uint16_t
+  wait_for_concurrency_level(
+    SedaStageScheduler& stage_scheduler,
+    const Stage& stage,
+    uint16_t concurrency_level
+  ) {
+    for (int wait_i = 0; wait_i < 20; ++wait_i) {
+      if (
+        stage_scheduler.get_concurrency_level(stage) >= concurrency_level
+      ) {
+        break;
+      }
+      yield::thread::Thread::sleep(SedaStageScheduler::CONTROL_INTERVAL);
+    }
+    return stage_scheduler.get_concurrency_level(stage);
+  }
+};
+
+TEST_F(SedaStageSchedulerControllerTest, add_thread) {
+  shared_ptr< StageImpl<TestEvent> > stage(
+    new StageImpl<TestEvent>(
+      unique_ptr<SleepingTestEventHandler>(new SleepingTestEventHandler)
+    )
+  );
+  SedaStageScheduler stage_scheduler;
+  stage_scheduler.schedule(stage, 1, 4);
+  ASSERT_EQ(stage_scheduler.get_concurrency_level(*stage), 1);
+
+  enqueue(*stage, 1000);
+  ASSERT_GT(wait_for_concurrency_level(stage_scheduler, *stage, 2), 1);
+}
+
+TEST_F(SedaStageSchedulerControllerTest, max_concurrency_level) {
+  shared_ptr< StageImpl<TestEvent> > stage(
+    new StageImpl<TestEvent>(
+      unique_ptr<SleepingTestEventHandler>(new SleepingTestEventHandler)
+    )
+  );
+  SedaStageScheduler stage_scheduler;
+  stage_scheduler.schedule(stage, 1, 1);
+
+  enqueue(*stage, 1000);
+  yield::thread::Thread::sleep(SedaStageScheduler::CONTROL_INTERVAL * static_cast<uint64_t>(3));
+  ASSERT_EQ(stage_scheduler.get_concurrency_level(*stage), 1);
+}
+
+TEST_F(SedaStageSchedulerControllerTest, schedule_fixed) {
+  shared_ptr< StageImpl<TestEvent> > stage(
+    new StageImpl<TestEvent>(
+      unique_ptr<SleepingTestEventHandler>(new SleepingTestEventHandler)
+    )
+  );
+  SedaStageScheduler stage_scheduler;
+  stage_scheduler.schedule(stage);
+
+  enqueue(*stage, 1000);
+  yield::thread::Thread::sleep(SedaStageScheduler::CONTROL_INTERVAL * static_cast<uint64_t>(3));
+  ASSERT_EQ(stage_scheduler.get_concurrency_level(*stage), 1);
+}
+
+TEST_F(SedaStageSchedulerControllerTest, thread_budget) {
+  shared_ptr< StageImpl<TestEvent> > stage(
+    new StageImpl<TestEvent>(
+      unique_ptr<SleepingTestEventHandler>(new SleepingTestEventHandler)
+    )
+  );
+  SedaStageScheduler stage_scheduler(2);
+  stage_scheduler.schedule(stage, 1, 8);
+
+  enqueue(*stage, 2000);
+  ASSERT_EQ(wait_for_concurrency_level(stage_scheduler, *stage, 2), 2);
+  yield::thread::Thread::sleep(SedaStageScheduler::CONTROL_INTERVAL * static_cast<uint64_t>(3));
+  ASSERT_EQ(stage_scheduler.get_concurrency_level(*stage), 2);
+}
 }
 }
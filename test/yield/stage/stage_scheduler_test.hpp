@@ -40,15 +40,16 @@
 namespace yield {
 namespace stage {
 using ::std::move;
+using ::std::shared_ptr;
 using ::std::unique_ptr;
 
 template <class StageSchedulerType>
 class StageSchedulerScheduleTest : public ::testing::Test {
 public:
   void run() {
-    unique_ptr<StageImpl<TestEvent>> stage(new StageImpl<TestEvent>(unique_ptr<TestEventHandler>(new TestEventHandler)));
+    shared_ptr<StageImpl<TestEvent>> stage(new StageImpl<TestEvent>(unique_ptr<TestEventHandler>(new TestEventHandler)));
     unique_ptr<StageScheduler> stage_scheduler(new StageSchedulerType);
-    stage_scheduler->schedule(move(stage));
+    stage_scheduler->schedule(stage);
     stage->tryenqueue(unique_ptr<TestEvent>(new TestEvent));
     while (static_cast<TestEventHandler&>(stage->event_handler()).get_seen_events_count() < 1) {
       yield::thread::Thread::sleep(0.1);
@@ -0,0 +1,117 @@
+// stage_statistics_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/stage/stage_statistics.hpp"
+#include "gtest/gtest.h"
+
+namespace yield {
+namespace stage {
+TEST(StageStatistics, arrival_rate_s) {
+  StageStatistics statistics;
+  ASSERT_EQ(statistics.arrival_rate_s(), 0);
+
+  Time start_time = Time::now();
+  for (int arrival_i = 0; arrival_i < 100; ++arrival_i) {
+    statistics.arrival();
+  }
+  statistics.update(start_time + Time(1.0));
+  ASSERT_NEAR(statistics.arrival_rate_s(), 100, 1);
+}
+
+TEST(StageStatistics, event_queue_length) {
+  StageStatistics statistics;
+  statistics.arrival();
+  statistics.arrival();
+  ASSERT_EQ(statistics.event_queue_length(), 2u);
+  statistics.service(Time(0.001));
+  ASSERT_EQ(statistics.event_queue_length(), 1u);
+}
+
+TEST(StageStatistics, interarrival_time_percentile) {
+  StageStatistics statistics;
+  ASSERT_EQ(statistics.interarrival_time_percentile(0.5), Time::ZERO);
+  statistics.arrival();
+  statistics.arrival();
+  ASSERT_GT(statistics.interarrival_time_percentile(0.5), Time::ZERO);
+}
+
+TEST(StageStatistics, rho) {
+  StageStatistics statistics;
+
+  Time start_time = Time::now();
+  for (int arrival_i = 0; arrival_i < 50; ++arrival_i) {
+    statistics.arrival();
+  }
+  for (int service_i = 0; service_i < 50; ++service_i) {
+    statistics.service(Time(0.01));
+  }
+  statistics.update(start_time + Time(1.0));
+
+  ASSERT_NEAR(statistics.service_rate_s(), 100, 0.01);
+  ASSERT_NEAR(statistics.rho(), 0.5, 0.01);
+}
+
+TEST(StageStatistics, service_time_percentile) {
+  StageStatistics statistics;
+  ASSERT_EQ(statistics.service_time_percentile(0.5), Time::ZERO);
+
+  for (uint64_t service_time_us = 1; service_time_us <= 100; ++service_time_us) {
+    statistics.service(Time(service_time_us * Time::NS_IN_US));
+  }
+
+  double p50_us = statistics.service_time_percentile(0.5).us();
+  ASSERT_GE(p50_us, 50 * 0.75);
+  ASSERT_LE(p50_us, 50 * 1.25);
+  double p99_us = statistics.service_time_percentile(0.99).us();
+  ASSERT_GE(p99_us, 99 * 0.75);
+  ASSERT_LE(p99_us, 99 * 1.25);
+}
+
+TEST(StageStatistics, update_decay) {
+  StageStatistics statistics;
+
+  Time now = Time::now();
+  for (int arrival_i = 0; arrival_i < 100; ++arrival_i) {
+    statistics.arrival();
+  }
+  now += Time(1.0);
+  statistics.update(now);
+  double arrival_rate_s = statistics.arrival_rate_s();
+
+  // No arrivals for one half-life halves the rate
+  now += StageStatistics::HALF_LIFE;
+  statistics.update(now);
+  ASSERT_NEAR(statistics.arrival_rate_s(), arrival_rate_s / 2, 1);
+
+  // Updates within UPDATE_INTERVAL of the last are skipped
+  statistics.update(now);
+  ASSERT_NEAR(statistics.arrival_rate_s(), arrival_rate_s / 2, 1);
+}
+}
+}
@@ -29,12 +29,14 @@
 
 #include "./test_event.hpp"
 #include "./test_event_handler.hpp"
+#include "yield/queue/mpsc_event_queue.hpp"
 #include "yield/stage/stage_impl.hpp"
 #include "gtest/gtest.h"
 
 namespace yield {
 namespace stage {
 using ::std::unique_ptr;
+using ::std::vector;
 
 TEST(Stage, constructor) {
   StageImpl<TestEvent>(unique_ptr<TestEventHandler>(new TestEventHandler));
@@ -51,5 +53,57 @@ TEST(Stage, visit) {
   ASSERT_TRUE(visit_ret);
   ASSERT_EQ(static_cast<TestEventHandler&>(stage->event_handler()).get_seen_events_count(), 1);
 }
+
+TEST(Stage, visit_mpsc_event_queue) {
+  unique_ptr< StageImpl<TestEvent> > stage(
+    new StageImpl<TestEvent>(
+      unique_ptr<TestEventHandler>(new TestEventHandler),
+      unique_ptr< EventQueue<TestEvent> >(
+        new ::yield::queue::MpscEventQueue<TestEvent>
+      )
+    )
+  );
+  stage->tryenqueue(unique_ptr<TestEvent>(new TestEvent));
+  bool visit_ret = stage->visit(Time::FOREVER);
+  ASSERT_TRUE(visit_ret);
+  ASSERT_EQ(static_cast<TestEventHandler&>(stage->event_handler()).get_seen_events_count(), 1);
+}
+// Records the size of every batch it handles
+class BatchTestEventHandler : public EventHandler<TestEvent> {
+public:
+  const vector<size_t>& get_batch_sizes() const {
+    return batch_sizes_;
+  }
+
+  // EventHandler
+  void handle(unique_ptr<TestEvent> event) override {
+    batch_sizes_.push_back(1);
+  }
+
+  void handle_batch(vector< unique_ptr<TestEvent> >& events) override {
+    batch_sizes_.push_back(events.size());
+  }
+
+private:
+  vector<size_t> batch_sizes_;
+};
+
+TEST(Stage, visit_batch) {
+  BatchTestEventHandler* event_handler = new BatchTestEventHandler;
+  StageImpl<TestEvent> stage((unique_ptr<BatchTestEventHandler>(event_handler)));
+  stage.set_visit_batch_size(4);
+  for (int event_i = 0; event_i < 5; ++event_i) {
+    stage.tryenqueue(unique_ptr<TestEvent>(new TestEvent));
+  }
+
+  ASSERT_TRUE(stage.visit(Time::FOREVER));
+  ASSERT_TRUE(stage.visit(Time::FOREVER));
+  ASSERT_FALSE(stage.visit(0.01));
+
+  ASSERT_EQ(event_handler->get_batch_sizes().size(), 2u);
+  ASSERT_EQ(event_handler->get_batch_sizes()[0], 4u);
+  ASSERT_EQ(event_handler->get_batch_sizes()[1], 1u);
+  ASSERT_EQ(stage.event_queue_length(), 0u);
+}
 }
 }
@@ -0,0 +1,106 @@
+// work_stealing_stage_scheduler_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "./stage_scheduler_test.hpp"
+#include "yield/stage/work_stealing_stage_scheduler.hpp"
+
+#include <atomic>
+
+namespace yield {
+namespace stage {
+using ::std::atomic;
+using ::std::shared_ptr;
+
+typedef StageSchedulerScheduleTest<WorkStealingStageScheduler> WorkStealingStageSchedulerScheduleTest;
+TEST_F(WorkStealingStageSchedulerScheduleTest, run) {
+  this->run();
+}
+
+// Counts events and forwards them to the next stage, if any
+class ForwardingTestEventHandler : public EventHandler<TestEvent> {
+public:
+  ForwardingTestEventHandler(shared_ptr< StageImpl<TestEvent> > next_stage)
+    : next_stage_(next_stage) {
+    seen_events_count_ = 0;
+  }
+
+  uint32_t get_seen_events_count() const {
+    return seen_events_count_;
+  }
+
+  // EventHandler
+  void handle(unique_ptr<TestEvent> event) override {
+    seen_events_count_++;
+    if (next_stage_ != NULL) {
+      next_stage_->tryenqueue(move(event));
+    }
+  }
+
+private:
+  shared_ptr< StageImpl<TestEvent> > next_stage_;
+  atomic<uint32_t> seen_events_count_;
+};
+
+TEST(WorkStealingStageScheduler, pipeline) {
+  const uint32_t EVENTS_COUNT = 10000;
+
+  ForwardingTestEventHandler* second_event_handler
+  = new ForwardingTestEventHandler(shared_ptr< StageImpl<TestEvent> >());
+  shared_ptr< StageImpl<TestEvent> > second_stage(
+    new StageImpl<TestEvent>(unique_ptr<EventHandler<TestEvent> >(second_event_handler))
+  );
+  ForwardingTestEventHandler* first_event_handler
+  = new ForwardingTestEventHandler(second_stage);
+  shared_ptr< StageImpl<TestEvent> > first_stage(
+    new StageImpl<TestEvent>(unique_ptr<EventHandler<TestEvent> >(first_event_handler))
+  );
+
+  // Enqueued before scheduling
+  first_stage->tryenqueue(unique_ptr<TestEvent>(new TestEvent));
+
+  WorkStealingStageScheduler stage_scheduler(4);
+  stage_scheduler.schedule(first_stage);
+  stage_scheduler.schedule(second_stage);
+
+  for (uint32_t event_i = 1; event_i < EVENTS_COUNT; ++event_i) {
+    first_stage->tryenqueue(unique_ptr<TestEvent>(new TestEvent));
+  }
+
+  for (int wait_i = 0; wait_i < 100; ++wait_i) {
+    if (second_event_handler->get_seen_events_count() == EVENTS_COUNT) {
+      break;
+    }
+    yield::thread::Thread::sleep(0.1);
+  }
+
+  ASSERT_EQ(first_event_handler->get_seen_events_count(), EVENTS_COUNT);
+  ASSERT_EQ(second_event_handler->get_seen_events_count(), EVENTS_COUNT);
+}
+}
+}
@@ -0,0 +1,126 @@
+// timer_wheel_test.cpp
+
+// Copyright (c) 2015 Minor Gordon
+// All rights reserved
+
+// This source file is part of the Yield project.
+
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+// * Redistributions in binary form must reproduce the above copyright
+// notice, this list of conditions and the following disclaimer in the
+// documentation and/or other materials provided with the distribution.
+// * Neither the name of the Yield project nor the
+// names of its contributors may be used to endorse or promote products
+// derived from this software without specific prior written permission.
+
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL Minor Gordon BE LIABLE FOR ANY DIRECT,
+// INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+// ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+// THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "yield/timer_wheel.hpp"
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <map>
+
+namespace yield {
+using ::std::map;
+using ::std::vector;
+
+TEST(TimerWheel, advance) {
+  TimerWheel timer_wheel(static_cast<uint64_t>(10), Time::ZERO);
+  timer_wheel.insert(1, static_cast<uint64_t>(10));
+  timer_wheel.insert(2, static_cast<uint64_t>(15));
+  timer_wheel.insert(3, static_cast<uint64_t>(700));
+  timer_wheel.insert(4, static_cast<uint64_t>(50000));
+  timer_wheel.insert(5, static_cast<uint64_t>(3000000));
+  ASSERT_EQ(timer_wheel.size(), 5u);
+
+  vector<uint64_t> expired_timer_ids;
+  timer_wheel.advance(static_cast<uint64_t>(9), expired_timer_ids);
+  ASSERT_TRUE(expired_timer_ids.empty());
+  timer_wheel.advance(static_cast<uint64_t>(10), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 1u);
+  ASSERT_EQ(expired_timer_ids[0], 1u);
+  timer_wheel.advance(static_cast<uint64_t>(19), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 1u);
+  timer_wheel.advance(static_cast<uint64_t>(20), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 2u);
+  ASSERT_EQ(expired_timer_ids[1], 2u);
+  timer_wheel.advance(static_cast<uint64_t>(699), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 2u);
+  timer_wheel.advance(static_cast<uint64_t>(49999), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 3u);
+  ASSERT_EQ(expired_timer_ids[2], 3u);
+  timer_wheel.advance(static_cast<uint64_t>(50000), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 4u);
+  ASSERT_EQ(expired_timer_ids[3], 4u);
+  timer_wheel.advance(static_cast<uint64_t>(3000000), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 5u);
+  ASSERT_EQ(expired_timer_ids[4], 5u);
+  ASSERT_TRUE(timer_wheel.empty());
+}
+
+TEST(TimerWheel, advance_empty) {
+  TimerWheel timer_wheel(static_cast<uint64_t>(10), Time::ZERO);
+  vector<uint64_t> expired_timer_ids;
+  timer_wheel.advance(static_cast<uint64_t>(1000000000), expired_timer_ids);
+  ASSERT_TRUE(expired_timer_ids.empty());
+
+  // Deadlines in the past expire on the next tick.
+  timer_wheel.insert(1, Time::ZERO);
+  timer_wheel.advance(static_cast<uint64_t>(1000000000), expired_timer_ids);
+  ASSERT_TRUE(expired_timer_ids.empty());
+  timer_wheel.advance(static_cast<uint64_t>(1000000010), expired_timer_ids);
+  ASSERT_EQ(expired_timer_ids.size(), 1u);
+}
+
+TEST(TimerWheel, advance_many) {
+  TimerWheel timer_wheel(static_cast<uint64_t>(1), Time::ZERO);
+  map<uint64_t, uint64_t> deadlines;
+  srand(42);
+  uint64_t now = 0;
+  for (uint64_t timer_id = 0; timer_id < 20000; ++timer_id) {
+    if (timer_id % 100 == 0) {
+      // Insert while the wheel is partway through its levels.
+      now += static_cast<uint64_t>(rand() % 5000);
+      vector<uint64_t> expired_timer_ids;
+      timer_wheel.advance(now, expired_timer_ids);
+      for (auto id_i = expired_timer_ids.begin(); id_i != expired_timer_ids.end(); ++id_i) {
+        ASSERT_LE(deadlines[*id_i], now);
+        deadlines.erase(*id_i);
+      }
+    }
+
+    uint64_t deadline = now + 1 + static_cast<uint64_t>(rand()) % 1000000;
+    deadlines[timer_id] = deadline;
+    timer_wheel.insert(timer_id, deadline);
+  }
+
+  while (!deadlines.empty()) {
+    now += static_cast<uint64_t>(rand() % 5000);
+    vector<uint64_t> expired_timer_ids;
+    timer_wheel.advance(now, expired_timer_ids);
+    for (auto id_i = expired_timer_ids.begin(); id_i != expired_timer_ids.end(); ++id_i) {
+      ASSERT_TRUE(deadlines.find(*id_i) != deadlines.end());
+      ASSERT_LE(deadlines[*id_i], now);
+      deadlines.erase(*id_i);
+    }
+    // Nothing due is left behind.
+    for (auto deadline_i = deadlines.begin(); deadline_i != deadlines.end(); ++deadline_i) {
+      ASSERT_GT(deadline_i->second, now);
+    }
+  }
+  ASSERT_TRUE(timer_wheel.empty());
+}
+}